@@ -5,6 +5,10 @@
 #define SUPPORT_GL_FBO
 #define SUPPORT_GL_VBO
 #define SUPPORT_GLSL
+#if !defined(OS_X) && !defined(MORPHOS)
+#define SUPPORT_GL_TIMER_QUERY
+#define SUPPORT_GL_PROGRAM_BINARY
+#endif
 #endif
 
 #ifdef SDL
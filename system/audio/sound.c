@@ -382,15 +382,17 @@ void soundLoadPlaylist(const char *_filename)
 		}
 	}
 
-	FILE *playlist = fopen(filename, "r");
+	size_t playlistSize = 0;
+	char *playlist = (char*)ioMapFile(filename, &playlistSize);
 	if (playlist)
 	{
 		char line[LINE_LENGTH];
 		int line_i = 0;
 		int cursor = 0;
 		char character = 0;
+		size_t position = 0;
 
-		while ((character = fgetc (playlist)) > 0)
+		while (position < playlistSize && (character = playlist[position++]) > 0)
 		{
 			int linebreak = 0;
 			switch (character)
@@ -487,7 +489,7 @@ void soundLoadPlaylist(const char *_filename)
 			}
 		}
 
-		fclose(playlist);
+		ioUnmapFile(playlist, playlistSize);
 	}
 	else
 	{
@@ -876,7 +878,12 @@ void soundPlaySong(int song_number)
 		debugErrorPrintf("BASS ChannelSetPosition error: '%d'", BASS_ErrorGetCode());
 	}
 #elif SDL_MIXER
+	//music is loaded from disk, the archive tool leaves music files out of the data archive
 	songs[song_current].sound = Mix_LoadMUS(songs[song_current].filename);
+	if (songs[song_current].sound == NULL)
+	{
+		debugErrorPrintf("Could not load music '%s': '%s'", songs[song_current].filename, Mix_GetError());
+	}
 	Mix_PlayMusic(songs[song_current].sound, loop);
 #endif
 
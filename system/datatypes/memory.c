@@ -336,7 +336,7 @@ void videoRedrawFrames()
 		video_t *video = (video_t*)memoryCurrent->ptr;
 		if (video)
 		{
-			videoDraw(video);
+			videoUpdate(video);
 		}
 
 		memoryCurrent = memoryNext;
@@ -383,6 +383,20 @@ video_t* memoryAllocateVideo(video_t *video)
 }
 #endif
 
+static int shaderFileChangesPending = 0;
+
+/**
+ * File watch callback of shader files, see fileWatchAdd().
+ */
+void shaderFileChanged(const char *filename, void *shader)
+{
+	assert(shader);
+	//reset the modification time so that shaderLoad() reloads the file
+	((shader_t*)shader)->fileLastModifiedTime = 0;
+	((shader_t*)shader)->fileChanged = 1;
+	shaderFileChangesPending = 1;
+}
+
 static int shaderProgramIsSourceModified(shaderProgram_t *shaderProgram)
 {
 	int modified = 0;
@@ -390,10 +404,10 @@ static int shaderProgramIsSourceModified(shaderProgram_t *shaderProgram)
 	for (i = 0; i < shaderProgram->attachedShadersCount; i++)
 	{
 		shader_t *shader = shaderProgram->attachedShaders[i];
-		time_t fileLastModifiedTime = shader->fileLastModifiedTime;
-		if (fileModified(shader->filename, &fileLastModifiedTime) == 1)
+		if (shader->fileChanged)
 		{
 			disableShaderProgram();
+			ioPathCacheInvalidate();
 
 			//clear error logs before refresh
 			windowSetTitle("");
@@ -422,6 +436,12 @@ static int shaderProgramIsSourceModified(shaderProgram_t *shaderProgram)
 
 int shaderProgramCheckForUpdatesAndRefresh()
 {
+	if (!shaderFileChangesPending)
+	{
+		return 0;
+	}
+	shaderFileChangesPending = 0;
+
 	int updateStatus = 0;
 
 	unsigned int type = MEMORY_TYPE_SHADER_PROGRAM;
@@ -440,6 +460,12 @@ int shaderProgramCheckForUpdatesAndRefresh()
 		memoryCurrent = memoryNext;
 	}
 
+	//shaders shared by several programs are flagged until every program has been relinked
+	for (memoryCurrent = memoryHead[MEMORY_TYPE_SHADER]; memoryCurrent; memoryCurrent = (memory_t*)memoryCurrent->next)
+	{
+		((shader_t*)memoryCurrent->ptr)->fileChanged = 0;
+	}
+
 	return updateStatus;
 }
 
@@ -31,6 +31,7 @@ extern void videoRedrawFrames();
 extern video_t* getVideoFromMemory(const char *filename);
 extern video_t* memoryAllocateVideo(video_t *video);
 
+extern void shaderFileChanged(const char *filename, void *shader);
 extern int shaderProgramCheckForUpdatesAndRefresh();
 extern shaderProgram_t* getShaderProgramFromMemory(const char *name);
 extern shaderProgram_t* memoryAllocateShaderProgram(shaderProgram_t *shaderProgram);
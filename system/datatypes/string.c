@@ -108,3 +108,24 @@ void stringToLower(char *string)
 		string[i] = tolower(string[i]);
 	}
 }
+
+/**
+ * 64-bit FNV-1a hash. Hashes can be chained by passing the previous hash.
+ * @param data [in] data to hash
+ * @param size [in] data size in bytes
+ * @param hash [in] HASH_FNV1A64_INIT or previous hash
+ * @return hash
+ */
+unsigned long long hashFnv1a64(const void *data, unsigned int size, unsigned long long hash)
+{
+	const unsigned char *bytes = (const unsigned char*)data;
+
+	unsigned int i;
+	for (i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
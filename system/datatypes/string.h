@@ -11,6 +11,9 @@ extern int endsWith(const char *string, const char *suffix);
 extern int endsWithIgnoreCase(const char *string, const char *suffix);
 extern void stringToLower(char *string);
 
+#define HASH_FNV1A64_INIT 14695981039346656037ULL
+extern unsigned long long hashFnv1a64(const void *data, unsigned int size, unsigned long long hash);
+
 #ifdef __cplusplus
 /* end 'extern "C"' wrapper */
 }
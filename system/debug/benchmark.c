@@ -0,0 +1,392 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "graphicsIncludes.h"
+#include "system/timer/timer.h"
+#include "system/ui/window/window.h"
+#include "system/xml/xml.h"
+#include "system/rocket/sync.h"
+#ifdef SUPPORT_VIDEO
+#include "system/graphics/video/theoraplay/theoraplay.h"
+#endif
+#include "debug.h"
+
+#include "benchmark.h"
+
+/**
+ * @defgroup benchmark Deterministic playback benchmark
+ * Benchmark mode plays the demo with a fixed timestep over a given time range.
+ * Each frame's CPU time and the checksum of the rendered frame are written to a CSV file
+ * so that separate runs can be compared for performance and rendering regressions.
+ */
+
+#define BENCHMARK_DEFAULT_FPS 60.0
+#define BENCHMARK_DEFAULT_OUTPUT "benchmark.csv"
+#define BENCHMARK_FILENAME_SIZE 1024
+#define BENCHMARK_XML_ITERATIONS 10
+#define BENCHMARK_YUV_ITERATIONS 20
+
+static int benchmarkEnabled = 0;
+static double benchmarkStart = 0.0;
+static double benchmarkEnd = 0.0;
+static double benchmarkFps = BENCHMARK_DEFAULT_FPS;
+static char benchmarkOutputFilename[BENCHMARK_FILENAME_SIZE] = BENCHMARK_DEFAULT_OUTPUT;
+
+static FILE *benchmarkOutput = NULL;
+static unsigned char *benchmarkPixels = NULL;
+static int benchmarkPixelsWidth = 0;
+static int benchmarkPixelsHeight = 0;
+
+static unsigned int benchmarkFrame = 0;
+static unsigned long long benchmarkFrameStartTime = 0;
+static double benchmarkTotalMilliseconds = 0.0;
+static double benchmarkMinMilliseconds = 0.0;
+static double benchmarkMaxMilliseconds = 0.0;
+
+/**
+ * Enable benchmark mode and set the played time range.
+ * @param start [in] start time in seconds
+ * @param end [in] end time in seconds
+ * @ingroup benchmark
+ */
+void benchmarkSetTimeRange(double start, double end)
+{
+	if (start < 0.0)
+	{
+		start = 0.0;
+	}
+
+	benchmarkStart = start;
+	benchmarkEnd = end;
+	benchmarkEnabled = 1;
+}
+
+void benchmarkSetFps(double fps)
+{
+	if (fps <= 0.0)
+	{
+		debugErrorPrintf("Invalid benchmark FPS '%f', using default '%f'", fps, BENCHMARK_DEFAULT_FPS);
+		fps = BENCHMARK_DEFAULT_FPS;
+	}
+
+	benchmarkFps = fps;
+}
+
+void benchmarkSetOutputFile(const char *filename)
+{
+	assert(filename);
+	snprintf(benchmarkOutputFilename, BENCHMARK_FILENAME_SIZE, "%s", filename);
+}
+
+int benchmarkIsEnabled(void)
+{
+	return benchmarkEnabled;
+}
+
+double benchmarkGetStartTime(void)
+{
+	return benchmarkStart;
+}
+
+int benchmarkIsEnd(void)
+{
+	return timerGetTime() >= benchmarkEnd;
+}
+
+/**
+ * Switch timer to fixed timestep and open benchmark output.
+ * Must be called before timerInit() so that playback starts from the fixed clock.
+ * @ingroup benchmark
+ */
+void benchmarkInit(void)
+{
+	if (!benchmarkEnabled)
+	{
+		return;
+	}
+
+	timerSetFixedTimestep(1.0/benchmarkFps);
+
+	benchmarkOutput = fopen(benchmarkOutputFilename, "w");
+	if (benchmarkOutput == NULL)
+	{
+		debugErrorPrintf("Could not open benchmark output file '%s'", benchmarkOutputFilename);
+	}
+	else
+	{
+		fprintf(benchmarkOutput, "frame;time;cpuMilliseconds;checksum\n");
+	}
+
+	benchmarkPixelsWidth = getWindowWidth();
+	benchmarkPixelsHeight = getWindowHeight();
+	benchmarkPixels = (unsigned char*)malloc(benchmarkPixelsWidth*benchmarkPixelsHeight*4);
+	assert(benchmarkPixels);
+
+	benchmarkFrame = 0;
+	benchmarkTotalMilliseconds = 0.0;
+	benchmarkMinMilliseconds = 0.0;
+	benchmarkMaxMilliseconds = 0.0;
+
+	debugPrintf("Benchmark started. start:'%.3f', end:'%.3f', fps:'%.2f', output:'%s'",
+		benchmarkStart, benchmarkEnd, benchmarkFps, benchmarkOutputFilename);
+}
+
+void benchmarkFrameBegin(void)
+{
+	if (!benchmarkEnabled)
+	{
+		return;
+	}
+
+	benchmarkFrameStartTime = timerGetNanoseconds();
+}
+
+/**
+ * FNV-1a hash of the frame's pixels
+ */
+static unsigned int benchmarkChecksum(const unsigned char *data, unsigned int size)
+{
+	unsigned int hash = 2166136261U;
+	unsigned int i;
+	for (i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/**
+ * End frame's CPU time measurement and store checksum of the rendered frame.
+ * Must be called before buffers are swapped.
+ * @ingroup benchmark
+ */
+void benchmarkFrameCapture(void)
+{
+	if (!benchmarkEnabled)
+	{
+		return;
+	}
+
+	double milliseconds = (timerGetNanoseconds() - benchmarkFrameStartTime) / 1000000.0;
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadBuffer(GL_BACK);
+	glReadPixels(0, 0, benchmarkPixelsWidth, benchmarkPixelsHeight, GL_RGBA, GL_UNSIGNED_BYTE, benchmarkPixels);
+	unsigned int checksum = benchmarkChecksum(benchmarkPixels, benchmarkPixelsWidth*benchmarkPixelsHeight*4);
+
+	if (benchmarkOutput)
+	{
+		fprintf(benchmarkOutput, "%u;%.4f;%.4f;%08X\n", benchmarkFrame, timerGetTime(), milliseconds, checksum);
+	}
+
+	if (benchmarkFrame == 0 || milliseconds < benchmarkMinMilliseconds)
+	{
+		benchmarkMinMilliseconds = milliseconds;
+	}
+	if (milliseconds > benchmarkMaxMilliseconds)
+	{
+		benchmarkMaxMilliseconds = milliseconds;
+	}
+	benchmarkTotalMilliseconds += milliseconds;
+
+	benchmarkFrame++;
+}
+
+void benchmarkDeinit(void)
+{
+	if (!benchmarkEnabled)
+	{
+		return;
+	}
+
+	if (benchmarkFrame > 0)
+	{
+		printf("Benchmark: frames:%u, average:%.3f ms, min:%.3f ms, max:%.3f ms\n",
+			benchmarkFrame, benchmarkTotalMilliseconds/benchmarkFrame,
+			benchmarkMinMilliseconds, benchmarkMaxMilliseconds);
+	}
+
+	if (benchmarkOutput)
+	{
+		fclose(benchmarkOutput);
+		benchmarkOutput = NULL;
+	}
+
+	free(benchmarkPixels);
+	benchmarkPixels = NULL;
+
+	timerSetFixedTimestep(0.0);
+}
+
+static int benchmarkXmlCountElement(xml_element_t *element, void *userData)
+{
+	(*(unsigned int*)userData)++;
+	return 1;
+}
+
+/* parse the file and return the elapsed milliseconds or a negative value on failure */
+static double benchmarkXmlParse(const char *filename, int buildTree, unsigned int *elements)
+{
+	xml_t xml;
+	xmlInit(&xml);
+	if (!xmlSetParseFile(&xml, filename))
+	{
+		xmlDeinit(&xml);
+		return -1.0;
+	}
+
+	*elements = 0;
+	xmlSetBuildTree(&xml, buildTree);
+	xmlSetElementCallback(&xml, benchmarkXmlCountElement);
+	xmlSetUserData(&xml, elements);
+
+	unsigned long long start = timerGetNanoseconds();
+	int success = xmlParse(&xml);
+	xmlDeinit(&xml);
+	double milliseconds = (timerGetNanoseconds() - start) / 1000000.0;
+
+	return success ? milliseconds : -1.0;
+}
+
+/**
+ * Measure XML parsing of a file, e.g. a large Rocket export, with and without building the document tree
+ * and with the Rocket track loader. File reading is only included in the Rocket timing.
+ * @param filename [in] XML file
+ * @ingroup benchmark
+ */
+void benchmarkXml(const char *filename)
+{
+	assert(filename);
+
+	unsigned int elements = 0;
+	int buildTree;
+	for (buildTree = 1; buildTree >= 0; buildTree--)
+	{
+		double total = 0.0, min = 0.0;
+		int i;
+		for (i = 0; i < BENCHMARK_XML_ITERATIONS; i++)
+		{
+			double milliseconds = benchmarkXmlParse(filename, buildTree, &elements);
+			if (milliseconds < 0.0)
+			{
+				printf("Benchmark: could not parse XML file '%s'\n", filename);
+				return;
+			}
+
+			if (i == 0 || milliseconds < min)
+			{
+				min = milliseconds;
+			}
+			total += milliseconds;
+		}
+
+		printf("Benchmark XML %s: elements:%u, average:%.3f ms, min:%.3f ms\n",
+			buildTree ? "tree" : "callbacks", elements, total/BENCHMARK_XML_ITERATIONS, min);
+	}
+
+	struct sync_device *device = sync_create_device("benchmark");
+	if (device)
+	{
+		unsigned long long start = timerGetNanoseconds();
+		parseRocketXml(device, filename);
+		printf("Benchmark Rocket XML: %.3f ms\n", (timerGetNanoseconds() - start) / 1000000.0);
+		sync_destroy_device(device);
+	}
+}
+
+#ifdef SUPPORT_VIDEO
+/* average milliseconds of converting the planes to the pixels */
+static double benchmarkYuvConvert(const unsigned char *planes[3], const int strides[3], unsigned int width, unsigned int height, THEORAPLAY_VideoFormat format, int reference, unsigned char *pixels)
+{
+	unsigned long long start = timerGetNanoseconds();
+	int i;
+	for (i = 0; i < BENCHMARK_YUV_ITERATIONS; i++)
+	{
+		THEORAPLAY_convertFrame(planes, strides, width, height, format, reference, pixels);
+	}
+
+	return (timerGetNanoseconds() - start) / 1000000.0 / BENCHMARK_YUV_ITERATIONS;
+}
+#endif
+
+/**
+ * Measure the YUV 4:2:0 to RGB and RGBA conversion of video frames against the reference floating point converter.
+ * @param resolution [in] frame size, "<WIDTH>x<HEIGHT>"
+ * @ingroup benchmark
+ */
+void benchmarkYuv(const char *resolution)
+{
+	assert(resolution);
+
+#ifdef SUPPORT_VIDEO
+	unsigned int width = 0, height = 0;
+	if (sscanf(resolution, "%5ux%5u", &width, &height) != 2 || width == 0 || height == 0)
+	{
+		printf("Benchmark: invalid resolution '%s'\n", resolution);
+		return;
+	}
+
+	unsigned int chromaWidth = (width + 1) / 2;
+	unsigned int chromaHeight = (height + 1) / 2;
+	size_t lumaSize = (size_t)width * height;
+	size_t chromaSize = (size_t)chromaWidth * chromaHeight;
+	size_t pixelsSize = lumaSize * 4;
+
+	unsigned char *data = (unsigned char*)malloc(lumaSize + chromaSize * 2);
+	unsigned char *pixels = (unsigned char*)malloc(pixelsSize);
+	unsigned char *referencePixels = (unsigned char*)malloc(pixelsSize);
+	if (data == NULL || pixels == NULL || referencePixels == NULL)
+	{
+		printf("Benchmark: out of memory\n");
+		free(data);
+		free(pixels);
+		free(referencePixels);
+		return;
+	}
+
+	//deterministic noise covers the whole value range
+	unsigned int seed = 1;
+	size_t i;
+	for (i = 0; i < lumaSize + chromaSize * 2; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		data[i] = (unsigned char)(seed >> 16);
+	}
+
+	const unsigned char *planes[3] = {data, data + lumaSize, data + lumaSize + chromaSize};
+	const int strides[3] = {(int)width, (int)chromaWidth, (int)chromaWidth};
+	const THEORAPLAY_VideoFormat formats[2] = {THEORAPLAY_VIDFMT_RGB, THEORAPLAY_VIDFMT_RGBA};
+	int format;
+	for (format = 0; format < 2; format++)
+	{
+		double referenceMilliseconds = benchmarkYuvConvert(planes, strides, width, height, formats[format], 1, referencePixels);
+		double milliseconds = benchmarkYuvConvert(planes, strides, width, height, formats[format], 0, pixels);
+
+		size_t bytes = lumaSize * (formats[format] == THEORAPLAY_VIDFMT_RGB ? 3 : 4);
+		int maxDifference = 0;
+		for (i = 0; i < bytes; i++)
+		{
+			int difference = abs((int)pixels[i] - (int)referencePixels[i]);
+			if (difference > maxDifference)
+			{
+				maxDifference = difference;
+			}
+		}
+
+		printf("Benchmark YUV to %s %ux%u: reference:%.3f ms, converter:%.3f ms, %.1f Mpixels/s, speedup:%.2fx, max difference:%d\n",
+			formats[format] == THEORAPLAY_VIDFMT_RGB ? "RGB" : "RGBA", width, height,
+			referenceMilliseconds, milliseconds, lumaSize / milliseconds / 1000.0,
+			milliseconds > 0.0 ? referenceMilliseconds / milliseconds : 0.0, maxDifference);
+	}
+
+	free(data);
+	free(pixels);
+	free(referencePixels);
+#else
+	printf("Benchmark: video support is not compiled in, resolution '%s' ignored\n", resolution);
+#endif
+}
@@ -0,0 +1,26 @@
+#ifndef EXH_SYSTEM_DEBUG_BENCHMARK_H_
+#define EXH_SYSTEM_DEBUG_BENCHMARK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void benchmarkSetTimeRange(double start, double end);
+extern void benchmarkSetFps(double fps);
+extern void benchmarkSetOutputFile(const char *filename);
+extern int benchmarkIsEnabled(void);
+extern double benchmarkGetStartTime(void);
+extern int benchmarkIsEnd(void);
+extern void benchmarkInit(void);
+extern void benchmarkFrameBegin(void);
+extern void benchmarkFrameCapture(void);
+extern void benchmarkDeinit(void);
+extern void benchmarkXml(const char *filename);
+extern void benchmarkYuv(const char *resolution);
+
+#ifdef __cplusplus
+/* end 'extern "C"' wrapper */
+}
+#endif
+
+#endif /* EXH_SYSTEM_DEBUG_BENCHMARK_H_ */
@@ -0,0 +1,459 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "system/timer/timer.h"
+#include "system/thread/thread.h"
+#include "debug.h"
+
+#include "profiler.h"
+
+/**
+ * @defgroup profiler Hierarchical frame profiler
+ * Nested zones are recorded with the monotonic nanosecond clock into per-thread ring buffers.
+ * Zone recording does not allocate memory, only the ring buffers are allocated when a thread records its first zone.
+ * Recorded zones can be exported as Chrome trace JSON (chrome://tracing).
+ * Per frame counters are counted regardless of the output file, so that the profiler overlay can show them.
+ */
+
+#define PROFILER_MAX_THREADS 16
+#define PROFILER_RING_SIZE 65536
+#define PROFILER_MAX_DEPTH 64
+#define PROFILER_NAME_SIZE 48
+#define PROFILER_FILENAME_SIZE 1024
+#define PROFILER_COUNTER_RING_SIZE 16384
+#define PROFILER_SUMMARY_SIZE 256
+
+typedef struct {
+	char name[PROFILER_NAME_SIZE];
+	unsigned long long start;
+	unsigned long long duration;
+	unsigned int depth;
+} profilerZone_t;
+
+typedef struct {
+	unsigned long long time;
+	unsigned int jsTransitions;
+	unsigned long long jsHeapUsed;
+	unsigned long long jsHeapReserved;
+} profilerCounters_t;
+
+typedef struct {
+	unsigned int threadId;
+	const char *threadName;
+	profilerZone_t *ring;
+	unsigned int ringHead;
+	unsigned int ringCount;
+	profilerZone_t stack[PROFILER_MAX_DEPTH];
+	unsigned int depth;
+} profilerThread_t;
+
+static int profilerEnabled = 0;
+static int profilerInitialized = 0;
+static char profilerOutputFilename[PROFILER_FILENAME_SIZE] = {'\0'};
+static unsigned long long profilerStartTime = 0;
+
+static profilerThread_t profilerThreads[PROFILER_MAX_THREADS];
+/* slots below the count are published and never change their thread, see profilerGetThread() */
+static unsigned int profilerThreadCount = 0;
+static void *profilerThreadMutex = NULL;
+static unsigned int profilerDroppedZones = 0;
+
+static unsigned int profilerJsTransitions = 0;
+static unsigned long long profilerJsHeapUsed = 0;
+static unsigned long long profilerJsHeapReserved = 0;
+static unsigned int profilerJsCollections = 0;
+static profilerCounters_t *profilerCounterRing = NULL;
+static unsigned int profilerCounterHead = 0;
+static unsigned int profilerCounterCount = 0;
+static char profilerSummary[PROFILER_SUMMARY_SIZE] = {'\0'};
+
+/**
+ * Enable profiling. Recorded zones are exported to the given file in profilerDeinit().
+ * @param filename [in] Chrome trace JSON output file
+ * @ingroup profiler
+ */
+void profilerSetOutputFile(const char *filename)
+{
+	assert(filename);
+	snprintf(profilerOutputFilename, PROFILER_FILENAME_SIZE, "%s", filename);
+	profilerEnabled = 1;
+}
+
+int profilerIsEnabled(void)
+{
+	return profilerEnabled && profilerInitialized;
+}
+
+void profilerInit(void)
+{
+	if (!profilerEnabled || profilerInitialized)
+	{
+		return;
+	}
+
+	memset(profilerThreads, 0, sizeof(profilerThreads));
+	profilerThreadCount = 0;
+	profilerThreadMutex = threadMutexCreate();
+	profilerDroppedZones = 0;
+	profilerCounterRing = (profilerCounters_t*)malloc(sizeof(profilerCounters_t)*PROFILER_COUNTER_RING_SIZE);
+	assert(profilerCounterRing);
+	profilerCounterHead = 0;
+	profilerCounterCount = 0;
+	profilerStartTime = timerGetNanoseconds();
+	profilerInitialized = 1;
+
+	debugPrintf("Profiler enabled, output:'%s'", profilerOutputFilename);
+}
+
+void profilerDeinit(void)
+{
+	if (!profilerInitialized)
+	{
+		return;
+	}
+
+	if (strlen(profilerOutputFilename) > 0)
+	{
+		profilerExportChromeTrace(profilerOutputFilename);
+	}
+
+	profilerInitialized = 0;
+
+	unsigned int i;
+	for (i = 0; i < profilerThreadCount; i++)
+	{
+		free(profilerThreads[i].ring);
+		profilerThreads[i].ring = NULL;
+	}
+	profilerThreadCount = 0;
+	threadMutexDestroy(profilerThreadMutex);
+	profilerThreadMutex = NULL;
+
+	free(profilerCounterRing);
+	profilerCounterRing = NULL;
+}
+
+static profilerThread_t *profilerFindThread(unsigned int threadId, unsigned int count)
+{
+	unsigned int i;
+	for (i = 0; i < count; i++)
+	{
+		if (profilerThreads[i].threadId == threadId)
+		{
+			return &profilerThreads[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Slots are filled before the count that publishes them is stored, so the published slots are
+ * looked up without locking. Only the registration of a new thread takes the profiler lock,
+ * the engine global mutex is not used so that profiled threads don't wait for the loaders.
+ */
+static profilerThread_t *profilerGetThread(unsigned int threadId)
+{
+	profilerThread_t *thread = profilerFindThread(threadId, __atomic_load_n(&profilerThreadCount, __ATOMIC_ACQUIRE));
+	if (thread != NULL)
+	{
+		return thread;
+	}
+
+	threadMutexLock(profilerThreadMutex);
+	unsigned int count = profilerThreadCount;
+	//registered by another thread after the lookup, e.g. a virtual thread
+	thread = profilerFindThread(threadId, count);
+
+	//first zone of the thread, register a new ring buffer
+	if (thread == NULL && count < PROFILER_MAX_THREADS)
+	{
+		thread = &profilerThreads[count];
+		thread->threadId = threadId;
+		thread->threadName = NULL;
+		thread->ring = (profilerZone_t*)malloc(sizeof(profilerZone_t)*PROFILER_RING_SIZE);
+		assert(thread->ring);
+		thread->ringHead = 0;
+		thread->ringCount = 0;
+		thread->depth = 0;
+		__atomic_store_n(&profilerThreadCount, count + 1, __ATOMIC_RELEASE);
+	}
+	threadMutexUnlock(profilerThreadMutex);
+
+	return thread;
+}
+
+/**
+ * Begin a profiler zone. Zones can be nested and must be closed with profilerZoneEnd().
+ * @param name [in] zone name, copied so that temporary strings can be used
+ * @ingroup profiler
+ */
+void profilerZoneBegin(const char *name)
+{
+	if (!profilerIsEnabled())
+	{
+		return;
+	}
+
+	profilerThread_t *thread = profilerGetThread(threadGetCurrentId());
+	if (thread == NULL)
+	{
+		profilerDroppedZones++;
+		return;
+	}
+
+	if (thread->depth < PROFILER_MAX_DEPTH)
+	{
+		profilerZone_t *zone = &thread->stack[thread->depth];
+		snprintf(zone->name, PROFILER_NAME_SIZE, "%s", name ? name : "");
+		zone->depth = thread->depth;
+		zone->start = timerGetNanoseconds();
+	}
+
+	thread->depth++;
+}
+
+/**
+ * End the innermost profiler zone of the calling thread.
+ * @ingroup profiler
+ */
+void profilerZoneEnd(void)
+{
+	if (!profilerIsEnabled())
+	{
+		return;
+	}
+
+	unsigned long long end = timerGetNanoseconds();
+
+	profilerThread_t *thread = profilerGetThread(threadGetCurrentId());
+	if (thread == NULL)
+	{
+		return;
+	}
+
+	if (thread->depth == 0)
+	{
+		debugWarningPrintf("profilerZoneBegin call missing!");
+		return;
+	}
+
+	thread->depth--;
+	if (thread->depth >= PROFILER_MAX_DEPTH)
+	{
+		profilerDroppedZones++;
+		return;
+	}
+
+	profilerZone_t *zone = &thread->ring[thread->ringHead];
+	memcpy(zone, &thread->stack[thread->depth], sizeof(profilerZone_t));
+	zone->duration = end - zone->start;
+
+	thread->ringHead = (thread->ringHead + 1) % PROFILER_RING_SIZE;
+	if (thread->ringCount < PROFILER_RING_SIZE)
+	{
+		thread->ringCount++;
+	}
+}
+
+/**
+ * Record an already measured zone to a virtual thread, e.g. GPU timer query results.
+ * @param threadId [in] virtual thread ID, see PROFILER_GPU_THREAD_ID
+ * @param threadName [in] thread name shown in the trace, static string
+ * @param name [in] zone name
+ * @param start [in] zone start time in nanoseconds, see timerGetNanoseconds()
+ * @param duration [in] zone duration in nanoseconds
+ * @param depth [in] zone nesting depth
+ * @ingroup profiler
+ */
+void profilerAddZone(unsigned int threadId, const char *threadName, const char *name, unsigned long long start, unsigned long long duration, unsigned int depth)
+{
+	if (!profilerIsEnabled())
+	{
+		return;
+	}
+
+	profilerThread_t *thread = profilerGetThread(threadId);
+	if (thread == NULL)
+	{
+		profilerDroppedZones++;
+		return;
+	}
+
+	thread->threadName = threadName;
+
+	profilerZone_t *zone = &thread->ring[thread->ringHead];
+	snprintf(zone->name, PROFILER_NAME_SIZE, "%s", name ? name : "");
+	zone->start = start;
+	zone->duration = duration;
+	zone->depth = depth;
+
+	thread->ringHead = (thread->ringHead + 1) % PROFILER_RING_SIZE;
+	if (thread->ringCount < PROFILER_RING_SIZE)
+	{
+		thread->ringCount++;
+	}
+}
+
+/**
+ * Count a call between JavaScript and native code, i.e. a native call into the JavaScript engine.
+ * @ingroup profiler
+ */
+void profilerCountJsTransition(void)
+{
+	profilerJsTransitions++;
+}
+
+/**
+ * Report the JavaScript heap statistics, the latest values are shown for the frame.
+ * @param usedBytes [in] bytes allocated by the JavaScript engine
+ * @param reservedBytes [in] bytes reserved from the system for the heap
+ * @param collections [in] total amount of garbage collections
+ * @ingroup profiler
+ */
+void profilerSetJsHeap(unsigned long long usedBytes, unsigned long long reservedBytes, unsigned int collections)
+{
+	profilerJsHeapUsed = usedBytes;
+	profilerJsHeapReserved = reservedBytes;
+	profilerJsCollections = collections;
+}
+
+/**
+ * Close the counters of the previous frame. They are recorded as Chrome trace counters and summarized for the overlay.
+ * @ingroup profiler
+ */
+void profilerFrameBegin(void)
+{
+	snprintf(profilerSummary, PROFILER_SUMMARY_SIZE, "JS<->native: %u transitions\nJS heap: %llu KB used, %llu KB reserved, %u collections\n",
+		profilerJsTransitions, profilerJsHeapUsed / 1024, profilerJsHeapReserved / 1024, profilerJsCollections);
+
+	if (profilerIsEnabled())
+	{
+		profilerCounters_t *counters = &profilerCounterRing[profilerCounterHead];
+		counters->time = timerGetNanoseconds();
+		counters->jsTransitions = profilerJsTransitions;
+		counters->jsHeapUsed = profilerJsHeapUsed;
+		counters->jsHeapReserved = profilerJsHeapReserved;
+
+		profilerCounterHead = (profilerCounterHead + 1) % PROFILER_COUNTER_RING_SIZE;
+		if (profilerCounterCount < PROFILER_COUNTER_RING_SIZE)
+		{
+			profilerCounterCount++;
+		}
+	}
+
+	profilerJsTransitions = 0;
+}
+
+/**
+ * Get the counters of the previous frame as text.
+ * @ingroup profiler
+ */
+const char *profilerGetSummary(void)
+{
+	return profilerSummary;
+}
+
+static void profilerWriteJsonString(FILE *file, const char *string)
+{
+	fputc('"', file);
+	for (; *string; string++)
+	{
+		if (*string == '"' || *string == '\\')
+		{
+			fputc('\\', file);
+			fputc(*string, file);
+		}
+		else if ((unsigned char)*string >= 0x20)
+		{
+			fputc(*string, file);
+		}
+	}
+	fputc('"', file);
+}
+
+/**
+ * Export recorded zones as Chrome trace JSON.
+ * @param filename [in] output file name
+ * @return 1 on success, 0 on failure
+ * @ingroup profiler
+ */
+int profilerExportChromeTrace(const char *filename)
+{
+	if (!profilerInitialized)
+	{
+		return 0;
+	}
+
+	FILE *file = fopen(filename, "w");
+	if (file == NULL)
+	{
+		debugErrorPrintf("Could not open profiler output file '%s'", filename);
+		return 0;
+	}
+
+	fprintf(file, "{\"traceEvents\":[\n");
+
+	int first = 1;
+	unsigned int i;
+	for (i = 0; i < profilerThreadCount; i++)
+	{
+		profilerThread_t *thread = &profilerThreads[i];
+
+		if (thread->threadName)
+		{
+			fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+				first ? "" : ",\n",
+				thread->threadId);
+			profilerWriteJsonString(file, thread->threadName);
+			fprintf(file, "}}");
+			first = 0;
+		}
+
+		unsigned int oldest = (thread->ringHead + PROFILER_RING_SIZE - thread->ringCount) % PROFILER_RING_SIZE;
+		unsigned int j;
+		for (j = 0; j < thread->ringCount; j++)
+		{
+			profilerZone_t *zone = &thread->ring[(oldest + j) % PROFILER_RING_SIZE];
+
+			fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+			profilerWriteJsonString(file, zone->name);
+			fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%u}}",
+				thread->threadId,
+				(zone->start - profilerStartTime) / 1000.0,
+				zone->duration / 1000.0,
+				zone->depth);
+			first = 0;
+		}
+	}
+
+	unsigned int oldest = (profilerCounterHead + PROFILER_COUNTER_RING_SIZE - profilerCounterCount) % PROFILER_COUNTER_RING_SIZE;
+	for (i = 0; i < profilerCounterCount; i++)
+	{
+		profilerCounters_t *counters = &profilerCounterRing[(oldest + i) % PROFILER_COUNTER_RING_SIZE];
+
+		fprintf(file, "%s{\"name\":\"JS transitions\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"transitions\":%u}}",
+			first ? "" : ",\n",
+			(counters->time - profilerStartTime) / 1000.0,
+			counters->jsTransitions);
+		fprintf(file, ",\n{\"name\":\"JS heap\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"used\":%llu,\"reserved\":%llu}}",
+			(counters->time - profilerStartTime) / 1000.0,
+			counters->jsHeapUsed,
+			counters->jsHeapReserved);
+		first = 0;
+	}
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+
+	if (profilerDroppedZones > 0)
+	{
+		debugWarningPrintf("Profiler dropped %u zones", profilerDroppedZones);
+	}
+
+	debugPrintf("Profiler data exported to '%s'", filename);
+
+	return 1;
+}
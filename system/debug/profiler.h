@@ -0,0 +1,36 @@
+#ifndef EXH_SYSTEM_DEBUG_PROFILER_H_
+#define EXH_SYSTEM_DEBUG_PROFILER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PROFILER_GPU_THREAD_ID 0
+
+extern void profilerSetOutputFile(const char *filename);
+extern int profilerIsEnabled(void);
+extern void profilerInit(void);
+extern void profilerDeinit(void);
+extern void profilerZoneBegin(const char *name);
+extern void profilerZoneEnd(void);
+extern void profilerAddZone(unsigned int threadId, const char *threadName, const char *name, unsigned long long start, unsigned long long duration, unsigned int depth);
+extern int profilerExportChromeTrace(const char *filename);
+extern void profilerCountJsTransition(void);
+extern void profilerSetJsHeap(unsigned long long usedBytes, unsigned long long reservedBytes, unsigned int collections);
+extern void profilerFrameBegin(void);
+extern const char *profilerGetSummary(void);
+
+extern void profilerGpuInit(void);
+extern void profilerGpuDeinit(void);
+extern int profilerGpuIsEnabled(void);
+extern void profilerGpuFrameBegin(void);
+extern void profilerGpuZoneBegin(const char *name);
+extern void profilerGpuZoneEnd(void);
+extern const char *profilerGpuGetSummary(void);
+
+#ifdef __cplusplus
+/* end 'extern "C"' wrapper */
+}
+#endif
+
+#endif /* EXH_SYSTEM_DEBUG_PROFILER_H_ */
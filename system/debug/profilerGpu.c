@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "graphicsIncludes.h"
+#include "system/timer/timer.h"
+#include "debug.h"
+
+#include "profiler.h"
+
+/**
+ * @defgroup profilerGpu GPU profiler zones
+ * GPU zones are measured with GL_ARB_timer_query timestamp queries.
+ * Query results are double-buffered: the results of a frame are read back two frames later
+ * so that the CPU never waits for the GPU. Results are added to the profiler as a "GPU" thread
+ * and summarized for the in-editor overlay.
+ * All functions are no-op if the timer query extension is not available.
+ * @ingroup profiler
+ */
+
+#define PROFILER_GPU_FRAMES 2
+#define PROFILER_GPU_MAX_ZONES 128
+#define PROFILER_GPU_MAX_DEPTH 16
+#define PROFILER_GPU_NAME_SIZE 48
+#define PROFILER_GPU_SUMMARY_SIZE 4096
+
+static int profilerGpuEnabled = 0;
+static char profilerGpuSummary[PROFILER_GPU_SUMMARY_SIZE] = {'\0'};
+
+#ifdef SUPPORT_GL_TIMER_QUERY
+
+typedef struct {
+	char name[PROFILER_GPU_NAME_SIZE];
+	unsigned int depth;
+	int ended;
+} profilerGpuZone_t;
+
+typedef struct {
+	/* query 0 is the frame start timestamp, zone i uses queries 1+i*2 (begin) and 2+i*2 (end) */
+	GLuint queries[1 + PROFILER_GPU_MAX_ZONES * 2];
+	profilerGpuZone_t zones[PROFILER_GPU_MAX_ZONES];
+	unsigned int zoneCount;
+	unsigned int stack[PROFILER_GPU_MAX_DEPTH];
+	unsigned int depth;
+	unsigned int lastQuery;
+	unsigned long long cpuStart;
+	int pending;
+} profilerGpuFrame_t;
+
+static profilerGpuFrame_t profilerGpuFrames[PROFILER_GPU_FRAMES];
+static profilerGpuFrame_t *profilerGpuCurrent = NULL;
+static unsigned int profilerGpuFrameIndex = 0;
+static unsigned int profilerGpuDroppedFrames = 0;
+
+static void profilerGpuCollect(profilerGpuFrame_t *frame, int wait)
+{
+	if (!frame->pending)
+	{
+		return;
+	}
+	frame->pending = 0;
+
+	if (!wait)
+	{
+		//queries complete in order, checking the last issued one is sufficient
+		GLint available = 0;
+		glGetQueryObjectiv(frame->queries[frame->lastQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+		{
+			profilerGpuDroppedFrames++;
+			return;
+		}
+	}
+
+	GLuint64 frameStart = 0;
+	glGetQueryObjectui64v(frame->queries[0], GL_QUERY_RESULT, &frameStart);
+
+	size_t length = 0;
+	length += snprintf(profilerGpuSummary + length, PROFILER_GPU_SUMMARY_SIZE - length, "GPU zones:\n");
+
+	unsigned int i;
+	for (i = 0; i < frame->zoneCount; i++)
+	{
+		profilerGpuZone_t *zone = &frame->zones[i];
+		if (!zone->ended)
+		{
+			continue;
+		}
+
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(frame->queries[1 + i*2], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(frame->queries[2 + i*2], GL_QUERY_RESULT, &end);
+		if (end < start || start < frameStart)
+		{
+			continue;
+		}
+
+		//GPU timestamps are aligned to the CPU clock at the frame start
+		profilerAddZone(PROFILER_GPU_THREAD_ID, "GPU", zone->name,
+			frame->cpuStart + (start - frameStart), end - start, zone->depth);
+
+		if (length < PROFILER_GPU_SUMMARY_SIZE)
+		{
+			length += snprintf(profilerGpuSummary + length, PROFILER_GPU_SUMMARY_SIZE - length,
+				"%*s%s: %.3f ms\n", (int)zone->depth*2, "", zone->name, (end - start) / 1000000.0);
+		}
+	}
+}
+
+#endif
+
+/**
+ * Initialize GPU zones. Requires OpenGL extensions to be initialized.
+ * @ingroup profilerGpu
+ */
+void profilerGpuInit(void)
+{
+#ifdef SUPPORT_GL_TIMER_QUERY
+	if (profilerGpuEnabled)
+	{
+		return;
+	}
+
+	if (!openGlHasTimerQuery())
+	{
+		debugWarningPrintf("GL_ARB_timer_query not supported, GPU zones disabled");
+		return;
+	}
+
+	memset(profilerGpuFrames, 0, sizeof(profilerGpuFrames));
+	unsigned int i;
+	for (i = 0; i < PROFILER_GPU_FRAMES; i++)
+	{
+		glGenQueries(1 + PROFILER_GPU_MAX_ZONES * 2, profilerGpuFrames[i].queries);
+	}
+
+	profilerGpuCurrent = NULL;
+	profilerGpuFrameIndex = 0;
+	profilerGpuDroppedFrames = 0;
+	profilerGpuSummary[0] = '\0';
+	profilerGpuEnabled = 1;
+#endif
+}
+
+/**
+ * Read back pending results and free the queries.
+ * Must be called before profilerDeinit() so that the GPU zones are included in the export.
+ * @ingroup profilerGpu
+ */
+void profilerGpuDeinit(void)
+{
+#ifdef SUPPORT_GL_TIMER_QUERY
+	if (!profilerGpuEnabled)
+	{
+		return;
+	}
+
+	unsigned int i;
+	for (i = 0; i < PROFILER_GPU_FRAMES; i++)
+	{
+		profilerGpuFrame_t *frame = &profilerGpuFrames[(profilerGpuFrameIndex + 1 + i) % PROFILER_GPU_FRAMES];
+		if (frame == profilerGpuCurrent)
+		{
+			while (frame->depth > 0)
+			{
+				profilerGpuZoneEnd();
+			}
+		}
+		profilerGpuCollect(frame, 1);
+		glDeleteQueries(1 + PROFILER_GPU_MAX_ZONES * 2, frame->queries);
+	}
+
+	if (profilerGpuDroppedFrames > 0)
+	{
+		debugWarningPrintf("GPU profiler dropped %u frames, results were not available in time", profilerGpuDroppedFrames);
+	}
+
+	profilerGpuCurrent = NULL;
+	profilerGpuEnabled = 0;
+#endif
+}
+
+int profilerGpuIsEnabled(void)
+{
+	return profilerGpuEnabled;
+}
+
+/**
+ * Start a new GPU frame. Results of the frame recorded two frames ago are read back here.
+ * @ingroup profilerGpu
+ */
+void profilerGpuFrameBegin(void)
+{
+#ifdef SUPPORT_GL_TIMER_QUERY
+	if (!profilerGpuEnabled)
+	{
+		return;
+	}
+
+	if (profilerGpuCurrent && profilerGpuCurrent->depth > 0)
+	{
+		debugWarningPrintf("profilerGpuZoneEnd call missing!");
+		while (profilerGpuCurrent->depth > 0)
+		{
+			profilerGpuZoneEnd();
+		}
+	}
+
+	profilerGpuFrameIndex = (profilerGpuFrameIndex + 1) % PROFILER_GPU_FRAMES;
+	profilerGpuCurrent = &profilerGpuFrames[profilerGpuFrameIndex];
+
+	profilerGpuCollect(profilerGpuCurrent, 0);
+
+	profilerGpuCurrent->zoneCount = 0;
+	profilerGpuCurrent->depth = 0;
+	profilerGpuCurrent->lastQuery = 0;
+	profilerGpuCurrent->cpuStart = timerGetNanoseconds();
+	profilerGpuCurrent->pending = 1;
+	glQueryCounter(profilerGpuCurrent->queries[0], GL_TIMESTAMP);
+#endif
+}
+
+/**
+ * Begin a GPU zone. Zones can be nested and must be closed with profilerGpuZoneEnd().
+ * @param name [in] zone name
+ * @ingroup profilerGpu
+ */
+void profilerGpuZoneBegin(const char *name)
+{
+#ifdef SUPPORT_GL_TIMER_QUERY
+	if (!profilerGpuEnabled || profilerGpuCurrent == NULL)
+	{
+		return;
+	}
+
+	profilerGpuFrame_t *frame = profilerGpuCurrent;
+	if (frame->depth < PROFILER_GPU_MAX_DEPTH && frame->zoneCount < PROFILER_GPU_MAX_ZONES)
+	{
+		unsigned int i = frame->zoneCount++;
+		profilerGpuZone_t *zone = &frame->zones[i];
+		snprintf(zone->name, PROFILER_GPU_NAME_SIZE, "%s", name ? name : "");
+		zone->depth = frame->depth;
+		zone->ended = 0;
+		frame->stack[frame->depth] = i;
+		frame->lastQuery = 1 + i*2;
+		glQueryCounter(frame->queries[frame->lastQuery], GL_TIMESTAMP);
+	}
+	else if (frame->depth < PROFILER_GPU_MAX_DEPTH)
+	{
+		frame->stack[frame->depth] = PROFILER_GPU_MAX_ZONES;
+	}
+
+	frame->depth++;
+#endif
+}
+
+/**
+ * End the innermost GPU zone.
+ * @ingroup profilerGpu
+ */
+void profilerGpuZoneEnd(void)
+{
+#ifdef SUPPORT_GL_TIMER_QUERY
+	if (!profilerGpuEnabled || profilerGpuCurrent == NULL)
+	{
+		return;
+	}
+
+	profilerGpuFrame_t *frame = profilerGpuCurrent;
+	if (frame->depth == 0)
+	{
+		debugWarningPrintf("profilerGpuZoneBegin call missing!");
+		return;
+	}
+
+	frame->depth--;
+	if (frame->depth >= PROFILER_GPU_MAX_DEPTH)
+	{
+		return;
+	}
+
+	unsigned int i = frame->stack[frame->depth];
+	if (i < PROFILER_GPU_MAX_ZONES)
+	{
+		frame->zones[i].ended = 1;
+		frame->lastQuery = 2 + i*2;
+		glQueryCounter(frame->queries[frame->lastQuery], GL_TIMESTAMP);
+	}
+#endif
+}
+
+/**
+ * Get GPU zone timings of the latest resolved frame as text.
+ * @return zone timing summary, empty if GPU zones are disabled
+ * @ingroup profilerGpu
+ */
+const char *profilerGpuGetSummary(void)
+{
+	return profilerGpuSummary;
+}
@@ -40,11 +40,20 @@ PFNGLUNIFORM4IARBPROC                   glUniform4iARB                  = NULL;
 PFNGLUNIFORMMATRIX4FVARBPROC            glUniformMatrix4fvARB           = NULL;
 #endif
 
+#ifdef SUPPORT_GL_PROGRAM_BINARY
+//program binaries and parallel compilation, optional
+PFNGLGETPROGRAMBINARYPROC               glGetProgramBinary              = NULL;
+PFNGLPROGRAMBINARYPROC                  glProgramBinary                 = NULL;
+PFNGLPROGRAMPARAMETERIPROC              glProgramParameteri             = NULL;
+PFNGLMAXSHADERCOMPILERTHREADSARBPROC    glMaxShaderCompilerThreadsKHR   = NULL;
+#endif
+
 #ifdef SUPPORT_GL_VBO
 //VBOs
 PFNGLGENBUFFERSARBPROC                  glGenBuffersARB                 = NULL;
 PFNGLBINDBUFFERARBPROC                  glBindBufferARB                 = NULL;
 PFNGLBUFFERDATAARBPROC                  glBufferDataARB                 = NULL;
+PFNGLBUFFERSUBDATAARBPROC               glBufferSubDataARB              = NULL;
 PFNGLDELETEBUFFERSARBPROC               glDeleteBuffersARB              = NULL;
 PFNGLGETBUFFERPARAMETERIVARBPROC        glGetBufferParameterivARB       = NULL;
 #endif
@@ -69,6 +78,15 @@ PFNGLGENRENDERBUFFERSEXTPROC                    glGenRenderbuffersEXT
 PFNGLRENDERBUFFERSTORAGEEXTPROC                 glRenderbufferStorageEXT                 = NULL;
 #endif
 
+#ifdef SUPPORT_GL_TIMER_QUERY
+//timer queries
+PFNGLGENQUERIESARBPROC                          glGenQueriesARB                          = NULL;
+PFNGLDELETEQUERIESARBPROC                       glDeleteQueriesARB                       = NULL;
+PFNGLGETQUERYOBJECTIVARBPROC                    glGetQueryObjectivARB                    = NULL;
+PFNGLQUERYCOUNTERPROC                           glQueryCounter                           = NULL;
+PFNGLGETQUERYOBJECTUI64VPROC                    glGetQueryObjectui64v                    = NULL;
+#endif
+
 #ifdef WINDOWS
 PFNGLBLENDFUNCSEPARATEPROC                      glBlendFuncSeparate                      = NULL;
 GL_ActiveTextureARB_Func                        glActiveTextureARB_ptr                   = 0;
@@ -80,6 +98,27 @@ GL_MultiTexCoord2fARB_Func                      glMultiTexCoord2fARB_ptr
 static int hasShaderExtension      = 1;
 static int hasVboExtension         = 1;
 static int hasFboExtension         = 1;
+static int hasTimerQueryExtension  = 0;
+static int hasProgramBinaryExtension = 0;
+
+/**
+ * Check if GPU timer queries (GL_ARB_timer_query) are available.
+ * Timer queries are optional, profiling features are no-op without them.
+ * @return 1 if timer queries can be used, 0 otherwise
+ */
+int openGlHasTimerQuery(void)
+{
+	return hasTimerQueryExtension;
+}
+
+/**
+ * Check if shader program binaries (GL_ARB_get_program_binary) can be stored and loaded.
+ * @return 1 if program binaries are supported, 0 otherwise
+ */
+int openGlHasProgramBinary(void)
+{
+	return hasProgramBinaryExtension;
+}
 
 
 int openGlExtensionsInit(void)
@@ -204,6 +243,40 @@ int openGlExtensionsInit(void)
 		bindOpenGlFunction(glUniform3iARB, PFNGLUNIFORM3IARBPROC);
 		bindOpenGlFunction(glUniform4iARB, PFNGLUNIFORM4IARBPROC);
 		bindOpenGlFunction(glUniformMatrix4fvARB, PFNGLUNIFORMMATRIX4FVARBPROC);
+
+#ifdef SUPPORT_GL_PROGRAM_BINARY
+		//optional extensions, not in the needed extensions list
+		if (strstr((const char*)glExtensionList, "GL_ARB_get_program_binary"))
+		{
+			bindOpenGlFunction(glGetProgramBinary, PFNGLGETPROGRAMBINARYPROC);
+			bindOpenGlFunction(glProgramBinary, PFNGLPROGRAMBINARYPROC);
+			bindOpenGlFunction(glProgramParameteri, PFNGLPROGRAMPARAMETERIPROC);
+
+			GLint binaryFormats = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+			debugPrintf("Program binary formats: %d", (int)binaryFormats);
+			if (glGetProgramBinary && glProgramBinary && glProgramParameteri && binaryFormats > 0)
+			{
+				hasProgramBinaryExtension = 1;
+			}
+		}
+
+		if (strstr((const char*)glExtensionList, "GL_KHR_parallel_shader_compile"))
+		{
+			bindOpenGlFunction(glMaxShaderCompilerThreadsKHR, PFNGLMAXSHADERCOMPILERTHREADSARBPROC);
+		}
+		else if (strstr((const char*)glExtensionList, "GL_ARB_parallel_shader_compile"))
+		{
+			glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSARBPROC)
+				engineGetProcAddress("glMaxShaderCompilerThreadsARB");
+		}
+
+		if (glMaxShaderCompilerThreadsKHR)
+		{
+			debugPrintf("Parallel shader compilation enabled");
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		}
+#endif
 #else
 		hasShaderExtension = 0;
 #endif
@@ -221,6 +294,7 @@ int openGlExtensionsInit(void)
 		bindOpenGlFunction(glGenBuffersARB, PFNGLGENBUFFERSARBPROC);
 		bindOpenGlFunction(glBindBufferARB, PFNGLBINDBUFFERARBPROC);
 		bindOpenGlFunction(glBufferDataARB, PFNGLBUFFERDATAARBPROC);
+		bindOpenGlFunction(glBufferSubDataARB, PFNGLBUFFERSUBDATAARBPROC);
 		bindOpenGlFunction(glDeleteBuffersARB, PFNGLDELETEBUFFERSARBPROC);
 		bindOpenGlFunction(glGetBufferParameterivARB, PFNGLGETBUFFERPARAMETERIVARBPROC);
 #else
@@ -277,6 +351,30 @@ int openGlExtensionsInit(void)
 		debugErrorPrintf("Could not load FBO extensions!");
 	}
 
+#ifdef SUPPORT_GL_TIMER_QUERY
+	//optional extension, not in the needed extensions list
+	if (strstr((const char*)glExtensionList, "GL_ARB_timer_query")
+		&& strstr((const char*)glExtensionList, "GL_ARB_occlusion_query"))
+	{
+		debugPrintf("loading timer queries...");
+		bindOpenGlFunction(glGenQueriesARB, PFNGLGENQUERIESARBPROC);
+		bindOpenGlFunction(glDeleteQueriesARB, PFNGLDELETEQUERIESARBPROC);
+		bindOpenGlFunction(glGetQueryObjectivARB, PFNGLGETQUERYOBJECTIVARBPROC);
+		bindOpenGlFunction(glQueryCounter, PFNGLQUERYCOUNTERPROC);
+		bindOpenGlFunction(glGetQueryObjectui64v, PFNGLGETQUERYOBJECTUI64VPROC);
+
+		if (glGenQueriesARB && glDeleteQueriesARB && glGetQueryObjectivARB
+			&& glQueryCounter && glGetQueryObjectui64v)
+		{
+			hasTimerQueryExtension = 1;
+		}
+	}
+	else
+	{
+		debugPrintf("Timer queries not supported, GPU profiling disabled");
+	}
+#endif
+
 #ifdef WINDOWS
 //typedef void (APIENTRYP PFNGLBLENDFUNCSEPARATEPROC) (GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha);
 //GLAPI void APIENTRY glBlendFuncSeparate (GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha);
@@ -4,6 +4,8 @@
 #include "graphicsIncludes.h"
 
 extern int openGlExtensionsInit(void);
+extern int openGlHasTimerQuery(void);
+extern int openGlHasProgramBinary(void);
 
 #ifdef MORPHOS
 #define glMultiTexCoord2f(param, u, v) glTexCoord2f((u), (v))
@@ -37,11 +39,20 @@ extern PFNGLUNIFORM4IARBPROC                    glUniform4iARB;
 extern PFNGLUNIFORMMATRIX4FVARBPROC             glUniformMatrix4fvARB;
 #endif
 
+#ifdef SUPPORT_GL_PROGRAM_BINARY
+//program binaries and parallel compilation, optional
+extern PFNGLGETPROGRAMBINARYPROC                glGetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC                   glProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC               glProgramParameteri;
+extern PFNGLMAXSHADERCOMPILERTHREADSARBPROC     glMaxShaderCompilerThreadsKHR;
+#endif
+
 #ifdef SUPPORT_GL_VBO
 //VBOs
 extern PFNGLGENBUFFERSARBPROC                   glGenBuffersARB;
 extern PFNGLBINDBUFFERARBPROC                   glBindBufferARB;
 extern PFNGLBUFFERDATAARBPROC                   glBufferDataARB;
+extern PFNGLBUFFERSUBDATAARBPROC                glBufferSubDataARB;
 extern PFNGLDELETEBUFFERSARBPROC                glDeleteBuffersARB;
 extern PFNGLGETBUFFERPARAMETERIVARBPROC         glGetBufferParameterivARB;
 #endif
@@ -72,6 +83,15 @@ extern PFNGLGENRENDERBUFFERSEXTPROC                    glGenRenderbuffersEXT;
 extern PFNGLRENDERBUFFERSTORAGEEXTPROC                 glRenderbufferStorageEXT;
 #endif
 
+#ifdef SUPPORT_GL_TIMER_QUERY
+//timer queries
+extern PFNGLGENQUERIESARBPROC                          glGenQueriesARB;
+extern PFNGLDELETEQUERIESARBPROC                       glDeleteQueriesARB;
+extern PFNGLGETQUERYOBJECTIVARBPROC                    glGetQueryObjectivARB;
+extern PFNGLQUERYCOUNTERPROC                           glQueryCounter;
+extern PFNGLGETQUERYOBJECTUI64VPROC                    glGetQueryObjectui64v;
+#endif
+
 //blending
 typedef void (APIENTRYP PFNGLBLENDFUNCSEPARATEPROC) (GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha);
 extern PFNGLBLENDFUNCSEPARATEPROC                      glBlendFuncSeparate;
@@ -93,6 +113,7 @@ extern GL_MultiTexCoord2fARB_Func glMultiTexCoord2fARB_ptr;
 #define glGenBuffers glGenBuffersARB
 #define glBindBuffer glBindBufferARB
 #define glBufferData glBufferDataARB
+#define glBufferSubData glBufferSubDataARB
 #define glGetBufferParameteriv glGetBufferParameterivARB
 
 #define glShaderSource glShaderSourceARB
@@ -121,6 +142,10 @@ extern GL_MultiTexCoord2fARB_Func glMultiTexCoord2fARB_ptr;
 #define glUniform4i glUniform4iARB
 #define glUniformMatrix4fv glUniformMatrix4fvARB
 
+#define glGenQueries glGenQueriesARB
+#define glDeleteQueries glDeleteQueriesARB
+#define glGetQueryObjectiv glGetQueryObjectivARB
+
 #elif __MACOSX__
 
 #define GL_FRAMEBUFFER_COMPLETE GL_FRAMEBUFFER_COMPLETE_EXT
@@ -128,6 +153,7 @@ extern GL_MultiTexCoord2fARB_Func glMultiTexCoord2fARB_ptr;
 #define GL_RENDERBUFFER GL_RENDERBUFFER_EXT
 #define GL_COLOR_ATTACHMENT0 GL_COLOR_ATTACHMENT0_EXT
 #define GL_DEPTH_ATTACHMENT GL_DEPTH_ATTACHMENT_EXT
+#define GL_FRAMEBUFFER_BINDING GL_FRAMEBUFFER_BINDING_EXT
 
 #endif
 
@@ -189,6 +215,8 @@ extern GL_MultiTexCoord2fARB_Func glMultiTexCoord2fARB_ptr;
 #define glBindBuffer(...) debugWarningPrintf("glBindBuffer is not supported!", __VA_ARGS__)
 #undef glBufferData
 #define glBufferData(...) debugWarningPrintf("glBufferData is not supported!", __VA_ARGS__)
+#undef glBufferSubData
+#define glBufferSubData(...) debugWarningPrintf("glBufferSubData is not supported!", __VA_ARGS__)
 #undef glGetBufferParameteriv
 #define glGetBufferParameteriv(...) debugWarningPrintf("glGetBufferParameteriv is not supported!", __VA_ARGS__)
 #endif
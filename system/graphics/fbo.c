@@ -2,6 +2,7 @@
 #include "graphicsIncludes.h"
 #include "graphics.h"
 #include "system/debug/debug.h"
+#include "system/debug/profiler.h"
 #include "system/ui/window/window.h"
 #include "system/datatypes/memory.h"
 
@@ -25,7 +26,40 @@ void fboBind(fbo_t* fbo)
 		fb = fbo->id;
 	}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, fb);
+	renderStateBindFramebuffer(GL_FRAMEBUFFER, fb);
+}
+
+/**
+ * Begin a GPU profiler zone named after the FBO, unless the FBO has one open already.
+ * @ingroup fbo
+ * @ref JSAPI
+ */
+void fboGpuZoneBegin(fbo_t* fbo)
+{
+	assert(fbo);
+
+	if (!fbo->gpuZoneOpen)
+	{
+		fbo->gpuZoneOpen = 1;
+		profilerGpuZoneBegin(fbo->name);
+	}
+}
+
+/**
+ * End the GPU profiler zone opened by fboGpuZoneBegin(). Without an open zone of the FBO
+ * nothing is ended, so an unmatched end or unbind doesn't end an enclosing zone.
+ * @ingroup fbo
+ * @ref JSAPI
+ */
+void fboGpuZoneEnd(fbo_t* fbo)
+{
+	assert(fbo);
+
+	if (fbo->gpuZoneOpen)
+	{
+		fbo->gpuZoneOpen = 0;
+		profilerGpuZoneEnd();
+	}
 }
 
 static void fboUpdateTextureUvDimensions(fbo_t* fbo)
@@ -69,6 +103,7 @@ fbo_t* fboInit(const char *name)
 	fbo->depthTextureType = GL_DEPTH_COMPONENT;
 	fbo->storeDepth = 0;
 	fbo->depthBuffer = 0;
+	fbo->gpuZoneOpen = 0;
 	
 	fboSetDimensions(fbo, getScreenWidth(), getScreenHeight());
 	fboSetRenderDimensions(fbo, 1.0, 1.0);
@@ -270,34 +305,34 @@ void fboBindTextures(fbo_t* fbo)
 {
 	if (fbo)
 	{
-		glActiveTexture(GL_TEXTURE1);
-		glEnable(GL_TEXTURE_2D);
+		renderStateActiveTexture(GL_TEXTURE1);
+		renderStateEnable(GL_TEXTURE_2D);
 		unsigned int depthId = 0;
 		if (fbo->depth)
 		{
 			depthId = fbo->depth->id;
 		}
-		glBindTexture(GL_TEXTURE_2D, depthId);
+		renderStateBindTexture(GL_TEXTURE_2D, depthId);
 
-		glActiveTexture(GL_TEXTURE0);
-		glEnable(GL_TEXTURE_2D);
-		glBindTexture(GL_TEXTURE_2D, fbo->color->id);
+		renderStateActiveTexture(GL_TEXTURE0);
+		renderStateEnable(GL_TEXTURE_2D);
+		renderStateBindTexture(GL_TEXTURE_2D, fbo->color->id);
 		unsigned int colorId = 0;
 		if (fbo->color)
 		{
 			colorId = fbo->color->id;
 		}
-		glBindTexture(GL_TEXTURE_2D, colorId);
+		renderStateBindTexture(GL_TEXTURE_2D, colorId);
 	}
 	else //unbind textures incase NULL was given as the argument
 	{
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, 0);
-		glDisable(GL_TEXTURE_2D);
+		renderStateActiveTexture(GL_TEXTURE1);
+		renderStateBindTexture(GL_TEXTURE_2D, 0);
+		renderStateDisable(GL_TEXTURE_2D);
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, 0);
-		glDisable(GL_TEXTURE_2D);
+		renderStateActiveTexture(GL_TEXTURE0);
+		renderStateBindTexture(GL_TEXTURE_2D, 0);
+		renderStateDisable(GL_TEXTURE_2D);
 	}
 }
 
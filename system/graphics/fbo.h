@@ -53,9 +53,15 @@ typedef struct {
 	 * FBO logical name
 	 */
 	char *name;
+	/**
+	 * GPU profiler zone opened by fboGpuZoneBegin() is not ended yet
+	 */
+	int gpuZoneOpen;
 } fbo_t;
 
 extern void fboBind(fbo_t* fbo);
+extern void fboGpuZoneBegin(fbo_t* fbo);
+extern void fboGpuZoneEnd(fbo_t* fbo);
 extern fbo_t* fboInit(const char *name);
 extern void fboDeinit(fbo_t* fbo);
 extern void fboStoreDepth(fbo_t* fbo, int _storeDepth);
@@ -129,6 +129,9 @@ unsigned char font_rasters[TOTAL_CHARACTERS][13] = {
 
 #include <SDL/SDL_ttf.h>
 static TTF_Font* font = NULL;
+//FreeType reads the font on demand, so the data stays mapped until the font is closed
+static void *fontFileData = NULL;
+static size_t fontFileSize = 0;
 //static char fontpath[] = "data/gfx/SpecialElite.ttf"; //MetalShow.ttf";
 static char fontpath[] = "data/Arial.ttf";
 
@@ -167,7 +170,11 @@ void fontInit(void)
 		return;
 	}
 	
-	font = TTF_OpenFont(fontpath, 30);
+	fontFileData = ioMapFile(fontpath, &fontFileSize);
+	if (fontFileData != NULL)
+	{
+		font = TTF_OpenFontRW(SDL_RWFromConstMem(fontFileData, (int)fontFileSize), 1, 30);
+	}
 	if(font == NULL)
 	{
 		debugWarningPrintf("Could not load font: %s", TTF_GetError());
@@ -184,6 +191,13 @@ void fontDeinit(void)
 	if (font != NULL)
 	{
 		TTF_CloseFont(font);
+		font = NULL;
+	}
+
+	if (fontFileData != NULL)
+	{
+		ioUnmapFile(fontFileData, fontFileSize);
+		fontFileData = NULL;
 	}
 	
 	TTF_Quit();
@@ -200,7 +214,7 @@ void setTextSize(double w, double h)
 
 void drawText3d(const char *txt)
 {
-	glPushMatrix();
+	matrixPush();
 	
 	SDL_Rect location;
 	location.x = 0;
@@ -228,15 +242,15 @@ void drawText3d(const char *txt)
 	SDL_BlitSurface(initial, 0, intermediary, 0);
 
 	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	renderStateBindTexture(GL_TEXTURE_2D, texture);
 	glTexImage2D(GL_TEXTURE_2D, 0, 4, w, h, 0, GL_BGRA, 
 			GL_UNSIGNED_BYTE, intermediary->pixels );
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);	
 
-	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	renderStateEnable(GL_TEXTURE_2D);
+	renderStateBindTexture(GL_TEXTURE_2D, texture);
 	glColor3f(1.0f, 1.0f, 1.0f);
 
 	glBegin(GL_QUADS);
@@ -259,12 +273,12 @@ void drawText3d(const char *txt)
 	SDL_FreeSurface(intermediary);
 	glDeleteTextures(1, &texture);
 	
-	glPopMatrix();
+	matrixPop();
 }
 
 static void __drawText3d(int x, int y, const char *txt)
 {
-	glPushMatrix();
+	matrixPush();
 	
 	SDL_Rect location;
 	location.x = x;
@@ -292,15 +306,15 @@ static void __drawText3d(int x, int y, const char *txt)
 	SDL_BlitSurface(initial, 0, intermediary, 0);
 
 	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	renderStateBindTexture(GL_TEXTURE_2D, texture);
 	glTexImage2D(GL_TEXTURE_2D, 0, 4, w, h, 0, GL_BGRA, 
 			GL_UNSIGNED_BYTE, intermediary->pixels );
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);	
 
-	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	renderStateEnable(GL_TEXTURE_2D);
+	renderStateBindTexture(GL_TEXTURE_2D, texture);
 	glColor3f(1.0f, 1.0f, 1.0f);
 
 	glBegin(GL_QUADS);
@@ -323,7 +337,7 @@ static void __drawText3d(int x, int y, const char *txt)
 	SDL_FreeSurface(intermediary);
 	glDeleteTextures(1, &texture);
 	
-	glPopMatrix();
+	matrixPop();
 }
 
 static void SDL_GL_RenderText(const char *text, 
@@ -474,10 +488,10 @@ static font_t* my_stbtt_initfont(const char *ttfFilePath)
 
    // can free ttf_buffer at this point
    //glGenTextures(1, &ftex);
-   glBindTexture(GL_TEXTURE_2D, font->fontTexture->id);
+   renderStateBindTexture(GL_TEXTURE_2D, font->fontTexture->id);
    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, FONT_BITMAP_SIZE,FONT_BITMAP_SIZE, 0, GL_ALPHA, GL_UNSIGNED_BYTE, ucPixels);
    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-   glBindTexture(GL_TEXTURE_2D, 0);
+   renderStateBindTexture(GL_TEXTURE_2D, 0);
 
 	free(fontCharacterData.filename);
 	free(fontCharacterData.name);
@@ -502,8 +516,8 @@ static void my_stbtt_print(float x, float y, const char *txt)
    double width = 0.0;
    double lineWidth = 0.0;
    // assume orthographic projection with units = screen pixels, origin at top left
-   glEnable(GL_TEXTURE_2D);
-   glBindTexture(GL_TEXTURE_2D, currentFont->fontTexture->id);
+   renderStateEnable(GL_TEXTURE_2D);
+   renderStateBindTexture(GL_TEXTURE_2D, currentFont->fontTexture->id);
    glBegin(GL_QUADS);
    stbtt_bakedchar *cdata = (stbtt_bakedchar*)currentFont->characterData;
    assert(cdata);
@@ -876,7 +890,7 @@ static void drawText(int is2d)
 		perspective2dBegin((int)canvasWidth,(int)canvasHeight);
 	}
 
-	glPushMatrix();
+	matrixPush();
 
 	double scaleW = textWidth;
 	double scaleH = textHeight;
@@ -887,9 +901,9 @@ static void drawText(int is2d)
 	}
 	//debugPrintf("x:%.0f, y:%.0f, z:%.0f, w:%d, h:%d text:'%s'", textX, textY, textZ, textStringWidth, textStringHeight, textString);
 	
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glEnable(GL_BLEND);
-	glEnable(GL_TEXTURE_2D);
+	renderStateBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	renderStateEnable(GL_BLEND);
+	renderStateEnable(GL_TEXTURE_2D);
 	
 	double xFixed = -getTextStringWidth()/2.0;
 	double yFixed = getTextStringHeight()/2.0;
@@ -943,15 +957,15 @@ static void drawText(int is2d)
 	}
 
 
-	glTranslated(ox*scaleW,oy*scaleH,oz);
+	matrixTranslate(ox*scaleW,oy*scaleH,oz);
 
-	glTranslated(px,py,pz);
-	glRotated(textAngleX,-1,0,0);
-	glRotated(textAngleY,0,-1,0);
-	glRotated(textAngleZ,0,0,-1);
-	glTranslated(-px,-py,-pz);
+	matrixTranslate(px,py,pz);
+	matrixRotate(textAngleX,-1,0,0);
+	matrixRotate(textAngleY,0,-1,0);
+	matrixRotate(textAngleZ,0,0,-1);
+	matrixTranslate(-px,-py,-pz);
 
-	glScaled(scaleW,scaleH,1);
+	matrixScale(scaleW,scaleH,1);
 
 	if (defaultFont != NULL)
 	{
@@ -986,7 +1000,7 @@ static void drawText(int is2d)
 
 			texture_t *texture = &font[(textString[i]-ASCII_CONTROL_CHARACTERS)];
 			
-			glBindTexture(GL_TEXTURE_2D, texture->id);
+			renderStateBindTexture(GL_TEXTURE_2D, texture->id);
 			
 			double w = getTextCharacterWidth();
 			double h = getTextCharacterHeight();
@@ -1026,12 +1040,12 @@ static void drawText(int is2d)
 		}
 	}
 
-	glBindTexture(GL_TEXTURE_2D,0);
+	renderStateBindTexture(GL_TEXTURE_2D,0);
 	
-	glDisable(GL_BLEND);
-	glDisable(GL_TEXTURE_2D);
+	renderStateDisable(GL_BLEND);
+	renderStateDisable(GL_TEXTURE_2D);
 	
-	glPopMatrix();
+	matrixPop();
 
 	if (is2d)
 	{
@@ -38,22 +38,15 @@ color_t* getClearColor()
 
 /**
  * Setup projection and model matrices according to camera data.
+ * Camera matrices are cached and uploaded only if they have changed.
  * @see camera_t
  * @ingroup screen
  * @ref JSAPI
  */
 void viewReset(void)
 {
-	glMatrixMode(GL_PROJECTION);
-
-	glLoadIdentity();
-	
 	camera_t *camera = getCamera();
-	gluPerspective(camera->fovy, camera->aspect, camera->zNear, camera->zFar);
 
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-	
 	float positionX = camera->position.x;
 	float positionY = camera->position.y;
 	float positionZ = camera->position.z;
@@ -73,11 +66,10 @@ void viewReset(void)
 		targetZ += camera->targetObject->position.z;
 	}
 	
-	gluLookAt(
-		positionX, positionY, positionZ,
-		targetX, targetY, targetZ,
-		camera->up.x, camera->up.y, camera->up.z
-	);
+	float eye[3] = {positionX, positionY, positionZ};
+	float target[3] = {targetX, targetY, targetZ};
+	float up[3] = {camera->up.x, camera->up.y, camera->up.z};
+	matrixSetCamera(camera->fovy, camera->aspect, camera->zNear, camera->zFar, eye, target, up);
 	
 	/*printf("CAMERA SETUP\n\tPOSITION\tx:%f, y:%f, z:%f\n\tLOOK\tx:%f, y:%f, z:%f\n\tUP\tx:%f, y:%f, z:%f\n",
 		positionX, positionY, positionZ,
@@ -99,24 +91,23 @@ void perspective2dBegin(int w, int h)
 {
 	if (perspective2dCount == 0)
 	{
-		glDisable(GL_DEPTH_TEST);
-
-		glPushMatrix();
-		glMatrixMode(GL_PROJECTION);
-		glLoadIdentity();
+		renderStateDisable(GL_DEPTH_TEST);
 
-		glPushMatrix();
-		glOrtho(0, w, 0, h, 0, 1);
+		matrixMode(GL_PROJECTION);
+		matrixPush();
+		matrixLoadIdentity();
+		matrixOrtho(0, w, 0, h, 0, 1);
 
-		glMatrixMode(GL_MODELVIEW);
-		glLoadIdentity();
+		matrixMode(GL_MODELVIEW);
+		matrixPush();
+		matrixLoadIdentity();
 	}
 	
 	perspective2dCount++;
 }
 
 /**
- * Change perspective from 2D to 3D.
+ * Change perspective from 2D to 3D. The camera view is set up again with viewReset.
  * @see perspective2dBegin
  * @ingroup screen
  * @ref JSAPI
@@ -125,10 +116,13 @@ void perspective2dEnd(void)
 {
 	if (perspective2dCount == 1)
 	{
-		glPopMatrix();
-		glPopMatrix();
+		matrixMode(GL_PROJECTION);
+		matrixPop();
+
+		matrixMode(GL_MODELVIEW);
+		matrixPop();
 
-		glEnable(GL_DEPTH_TEST);
+		renderStateEnable(GL_DEPTH_TEST);
 
 		viewReset();
 	}
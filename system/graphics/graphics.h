@@ -25,6 +25,8 @@ extern HDC hDC;
 #include "system/graphics/shader/shader.h"
 #include "system/graphics/fbo.h"
 #include "system/graphics/object/vbo.h"
+#include "system/graphics/matrix.h"
+#include "system/graphics/renderState.h"
 
 extern void setClearColor(float r, float g, float b, float a);
 extern color_t* getClearColor();
@@ -8,12 +8,15 @@
 
 #include "image.h"
 #include "system/debug/debug.h"
+#include "system/debug/profiler.h"
 #include "system/player/player.h"
 #include "system/io/io.h"
+#include "system/io/fileWatch.h"
 #include "system/datatypes/memory.h"
 #include "system/thread/thread.h"
 #include "system/graphics/video/video.h"
 #include "system/ui/window/window.h"
+#include "system/graphics/renderState.h"
 
 #ifdef PNG
 
@@ -110,6 +113,26 @@ static void strcat_png_change(char *png_change_log, const char *str)
 	strncat(png_change_log, str, CHANGE_LOG_SIZE-strlen(png_change_log)-1);
 }
 
+typedef struct {
+	const png_byte *data;
+	size_t size;
+	size_t offset;
+} imageMemoryReader_t;
+
+/* PNG files are read from memory so that files mapped from the data archive are not copied */
+static void imageReadPngFromMemory(png_structp png_ptr, png_bytep data, png_size_t length)
+{
+	imageMemoryReader_t *reader = (imageMemoryReader_t*)png_get_io_ptr(png_ptr);
+	if (length > reader->size - reader->offset)
+	{
+		png_error(png_ptr, "Read past the end of the file");
+		return;
+	}
+
+	memcpy(data, reader->data + reader->offset, length);
+	reader->offset += length;
+}
+
 imageData_t* imageLoadPNG(const char* filename)
 {
 	char png_change_log[CHANGE_LOG_SIZE] = {'\0'};
@@ -147,13 +170,16 @@ imageData_t* imageLoadPNG(const char* filename)
 		return NULL;
 	}
 	
-	FILE *f = fopen(filename, "rb");
-	if (f==NULL)
+	imageMemoryReader_t reader;
+	reader.offset = 0;
+	reader.data = (const png_byte*)ioMapFile(filename, &reader.size);
+	if (reader.data == NULL)
 	{
+		png_destroy_read_struct(&png_ptr, &info_ptr, &end_info_ptr);
 		return NULL;
 	}
 
-	png_init_io(png_ptr, f);
+	png_set_read_fn(png_ptr, &reader, imageReadPngFromMemory);
 	png_read_info(png_ptr, info_ptr);
 
 	png_uint_32 width;
@@ -294,7 +320,7 @@ imageData_t* imageLoadPNG(const char* filename)
 
 	png_destroy_read_struct(&png_ptr, &info_ptr, &end_info_ptr);
 
-	fclose(f);
+	ioUnmapFile((void*)reader.data, reader.size);
 
 	return _imageData;
 }
@@ -462,19 +488,11 @@ int imageWritePNG(imageData_t *imageData)
 
 imageData_t* imageLoadPNG(const char* filename)
 {
-	int f = open(filename, O_RDONLY);
-	int count = lseek(f, 0, SEEK_END);
-	close(f);
-	
-	FILE *fp = fopen(filename,"rb");
-	if (fp == NULL) {
+	size_t count = 0;
+	void *content = ioMapFile(filename, &count);
+	if (content == NULL) {
 		return NULL;
 	}
-	
-	char *content = (char *)malloc(sizeof(char) * (count + 1));
-	int readCount = fread(content,sizeof(char),count,fp);
-	content[count] = '\0';
-	assert(count == readCount);
 
 	imageData_t* _imageData = (imageData_t*)malloc(sizeof(imageData_t));
 	assert(_imageData);
@@ -490,14 +508,14 @@ imageData_t* imageLoadPNG(const char* filename)
     int height = 0;
     int channels = 0;
     const int FORCE_RGBA = 4;
-    _imageData->pixels = stbi_load_from_memory(content, count, &width, &height, &channels, FORCE_RGBA);
+    _imageData->pixels = stbi_load_from_memory((const stbi_uc*)content, (int)count, &width, &height, &channels, FORCE_RGBA);
 	assert(_imageData->pixels);
 	
 	_imageData->w = width;
 	_imageData->h = height;
 	_imageData->channels = channels;
 
-	free(content);
+	ioUnmapFile(content, count);
 
 	return _imageData;
 }
@@ -556,6 +574,23 @@ void freeImageData(imageData_t *img)
 	free(img);
 }
 
+static void imageUploadImageData(texture_t *texture, imageData_t *imageData);
+
+/* file watch callback, the pixels are uploaded to the existing texture so that users keep their pointers */
+static void imageFileChanged(const char *filename, void *texture)
+{
+	imageData_t *img = imageLoadPNG(filename);
+	if (img == NULL)
+	{
+		debugWarningPrintf("Couldn't reload image '%s'!", filename);
+		return;
+	}
+
+	imageUploadImageData((texture_t*)texture, img);
+	freeImageData(img);
+	playerForceRedraw();
+}
+
 static texture_t* imageProcessImageData(const char *filename)
 {
 	const char *file = getFilePath(filename);
@@ -570,6 +605,7 @@ static texture_t* imageProcessImageData(const char *filename)
 			debugPrintf("Loaded image '%s' (%p, %dx%d)", file, tex, tex->w, tex->h);
 
 			freeImageData(img);
+			fileWatchAdd(file, imageFileChanged, tex);
 		}
 		else
 		{
@@ -636,19 +672,16 @@ texture_t* imageLoadImage(const char* filename)
 
 #endif
 
-texture_t* imageCreateTextureByImageData(imageData_t* _imageData)
+static void imageUploadImageData(texture_t *_texture, imageData_t *_imageData)
 {
-
-	texture_t *_texture = textureInit(NULL);
-	
-	assert(_imageData->filename && strlen(_imageData->filename) > 0);
-
-	_texture->name = strdup(_imageData->filename);
-
 	threadGlobalMutexLock();
+	profilerZoneBegin("textureUpload");
 
-	GLuint id;
-	glGenTextures(1, &id);
+	GLuint id = _texture->id;
+	if (id == 0)
+	{
+		glGenTextures(1, &id);
+	}
 	glBindTexture(GL_TEXTURE_2D, id);
 	
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -682,13 +715,32 @@ texture_t* imageCreateTextureByImageData(imageData_t* _imageData)
 			break;
 	}
 
-	_texture->customWidth  = _texture->w = _imageData->w;
-	_texture->customHeight = _texture->h = _imageData->h;
+	_texture->w = _imageData->w;
+	_texture->h = _imageData->h;
+	if (!_texture->hasCustomDimensions)
+	{
+		_texture->customWidth = _texture->w;
+		_texture->customHeight = _texture->h;
+	}
 	_texture->multiTextureId[0] = _texture->id = id;
 
 	glBindTexture(GL_TEXTURE_2D, 0);
+	renderStateInvalidateTextures();
 
+	profilerZoneEnd();
 	threadGlobalMutexUnlock();
+}
+
+texture_t* imageCreateTextureByImageData(imageData_t* _imageData)
+{
+
+	texture_t *_texture = textureInit(NULL);
+	
+	assert(_imageData->filename && strlen(_imageData->filename) > 0);
+
+	_texture->name = strdup(_imageData->filename);
+
+	imageUploadImageData(_texture, _imageData);
 
 	return _texture;
 }
@@ -731,6 +783,7 @@ texture_t* imageCreateTexture(const char *name, int filter, int format, int widt
 	_texture->multiTextureId[0] = _texture->id = id;
 
 	glBindTexture(GL_TEXTURE_2D, 0);
+	renderStateInvalidateTextures();
 
 	debugPrintf("Created texture '%s' (%p, %dx%d)", name, _texture, width, height);
 
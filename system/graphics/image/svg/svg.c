@@ -9,14 +9,14 @@
 
 #include "svg.h"
 
-int attributeCallback(xml_element_t *element, xml_attribute_t *attribute)
+int attributeCallback(xml_element_t *element, xml_attribute_t *attribute, void *userData)
 {
 	char *path = getElementPath(element);
 	printf("%s/@%s = '%s'\n", path, attribute->name, attribute->value);
 	free(path);
 	return 1;
 }
-int elementCallback(xml_element_t *element)
+int elementCallback(xml_element_t *element, void *userData)
 {
 	char *path = getElementPath(element);
 	printf("%s (%s) = '%s'\n", path, element->name, element->value);
@@ -0,0 +1,349 @@
+#include <string.h>
+#include <assert.h>
+
+#include "graphicsIncludes.h"
+#include "system/debug/debug.h"
+#include "system/math/general/general.h"
+
+#include "matrix.h"
+
+/**
+ * @defgroup matrix Matrix stack
+ * Modelview and projection matrices are tracked on the CPU so that they can be read
+ * without glGet calls, which stall the pipeline.
+ * Every matrix change is mirrored to OpenGL immediately. Push doesn't touch OpenGL at all
+ * and pop reloads the matrix with glLoadMatrixf only if OpenGL doesn't already hold it,
+ * so the OpenGL stack depth limits don't apply either.
+ * Each stack entry carries a serial that changes when the matrix changes; equal serials mean equal matrices.
+ */
+
+typedef struct {
+	mat4x4 matrix[MATRIX_STACK_DEPTH];
+	unsigned int serial[MATRIX_STACK_DEPTH];
+	unsigned int depth;
+	unsigned int uploadedSerial;
+	GLenum mode;
+} matrixStack_t;
+
+typedef struct {
+	float key[13];
+	mat4x4 projection;
+	mat4x4 view;
+	unsigned int projectionSerial;
+	unsigned int viewSerial;
+	int valid;
+} matrixCamera_t;
+
+static matrixStack_t modelView;
+static matrixStack_t projection;
+static matrixStack_t *current = &modelView;
+static matrixCamera_t camera;
+static unsigned int serialCounter = 0;
+static int viewport[4] = {0, 0, 0, 0};
+
+static void matrixStackInit(matrixStack_t *stack, GLenum mode)
+{
+	stack->depth = 0;
+	stack->mode = mode;
+	mat4x4_identity(stack->matrix[0]);
+	stack->serial[0] = ++serialCounter;
+	//OpenGL state is unknown, first change is always uploaded
+	stack->uploadedSerial = 0;
+}
+
+static int matrixSynced(void)
+{
+	return current->uploadedSerial == current->serial[current->depth];
+}
+
+/*
+ * Mark the current matrix changed. If OpenGL held the matrix before the change
+ * the caller has applied the same change to OpenGL, otherwise the whole matrix is loaded.
+ */
+static void matrixChanged(int synced)
+{
+	current->serial[current->depth] = ++serialCounter;
+	if (!synced)
+	{
+		glLoadMatrixf((const float*)current->matrix[current->depth]);
+	}
+	current->uploadedSerial = current->serial[current->depth];
+}
+
+static void matrixUpload(void)
+{
+	if (current->uploadedSerial != current->serial[current->depth])
+	{
+		glLoadMatrixf((const float*)current->matrix[current->depth]);
+		current->uploadedSerial = current->serial[current->depth];
+	}
+}
+
+/**
+ * Reset both matrix stacks to identity.
+ * @ingroup matrix
+ */
+void matrixInit(void)
+{
+	matrixStackInit(&modelView, GL_MODELVIEW);
+	matrixStackInit(&projection, GL_PROJECTION);
+	current = &modelView;
+	camera.valid = 0;
+	glMatrixMode(GL_MODELVIEW);
+}
+
+/**
+ * Select the matrix stack that subsequent calls change, like glMatrixMode.
+ * @param mode [in] GL_MODELVIEW or GL_PROJECTION
+ * @ingroup matrix
+ */
+void matrixMode(GLenum mode)
+{
+	if (mode == GL_PROJECTION)
+	{
+		current = &projection;
+	}
+	else
+	{
+		if (mode != GL_MODELVIEW)
+		{
+			debugWarningPrintf("Matrix mode not tracked! mode:'0x%X'", mode);
+		}
+		current = &modelView;
+	}
+
+	glMatrixMode(mode);
+}
+
+void matrixPush(void)
+{
+	if (current->depth + 1 >= MATRIX_STACK_DEPTH)
+	{
+		debugErrorPrintf("Matrix stack overflow! mode:'0x%X'", current->mode);
+		return;
+	}
+
+	mat4x4_dup(current->matrix[current->depth + 1], current->matrix[current->depth]);
+	current->serial[current->depth + 1] = current->serial[current->depth];
+	current->depth++;
+}
+
+void matrixPop(void)
+{
+	if (current->depth == 0)
+	{
+		debugErrorPrintf("Matrix stack underflow! mode:'0x%X'", current->mode);
+		return;
+	}
+
+	current->depth--;
+	matrixUpload();
+}
+
+void matrixLoadIdentity(void)
+{
+	mat4x4_identity(current->matrix[current->depth]);
+	glLoadIdentity();
+	matrixChanged(1);
+}
+
+/**
+ * Replace the current matrix.
+ * @param m [in] column-major 4x4 matrix
+ * @ingroup matrix
+ */
+void matrixLoad(const float *m)
+{
+	memcpy(current->matrix[current->depth], m, sizeof(mat4x4));
+	glLoadMatrixf(m);
+	matrixChanged(1);
+}
+
+/**
+ * Multiply the current matrix, like glMultMatrixf.
+ * @param m [in] column-major 4x4 matrix
+ * @ingroup matrix
+ */
+void matrixMultiply(const float *m)
+{
+	int synced = matrixSynced();
+	mat4x4 n;
+	memcpy(n, m, sizeof(mat4x4));
+	mat4x4_mul(current->matrix[current->depth], current->matrix[current->depth], n);
+	if (synced)
+	{
+		glMultMatrixf(m);
+	}
+	matrixChanged(synced);
+}
+
+void matrixTranslate(float x, float y, float z)
+{
+	int synced = matrixSynced();
+	mat4x4_translate_in_place(current->matrix[current->depth], x, y, z);
+	if (synced)
+	{
+		glTranslatef(x, y, z);
+	}
+	matrixChanged(synced);
+}
+
+void matrixRotate(float degrees, float x, float y, float z)
+{
+	int synced = matrixSynced();
+	mat4x4_rotate(current->matrix[current->depth], current->matrix[current->depth], x, y, z, (float)degToRad(degrees));
+	if (synced)
+	{
+		glRotatef(degrees, x, y, z);
+	}
+	matrixChanged(synced);
+}
+
+void matrixScale(float x, float y, float z)
+{
+	int synced = matrixSynced();
+	mat4x4_scale_aniso(current->matrix[current->depth], current->matrix[current->depth], x, y, z);
+	if (synced)
+	{
+		glScalef(x, y, z);
+	}
+	matrixChanged(synced);
+}
+
+void matrixOrtho(float left, float right, float bottom, float top, float zNear, float zFar)
+{
+	mat4x4 m;
+	mat4x4_ortho(m, left, right, bottom, top, zNear, zFar);
+	matrixMultiply((const float*)m);
+}
+
+void matrixFrustum(float left, float right, float bottom, float top, float zNear, float zFar)
+{
+	mat4x4 m;
+	mat4x4_frustum(m, left, right, bottom, top, zNear, zFar);
+	matrixMultiply((const float*)m);
+}
+
+/**
+ * Multiply the current matrix with a perspective projection, like gluPerspective.
+ * @ingroup matrix
+ */
+void matrixPerspective(float fovy, float aspect, float zNear, float zFar)
+{
+	mat4x4 m;
+	mat4x4_perspective(m, (float)degToRad(fovy), aspect, zNear, zFar);
+	matrixMultiply((const float*)m);
+}
+
+/**
+ * Tell that the current OpenGL matrix was changed outside of the matrix stack, e.g. by a display list.
+ * The CPU copy is reloaded to OpenGL on the next pop or change.
+ * @ingroup matrix
+ */
+void matrixInvalidate(void)
+{
+	current->uploadedSerial = 0;
+}
+
+/**
+ * Load camera projection and view, equal to gluPerspective and gluLookAt on identity matrices.
+ * The matrices are rebuilt only when the camera changes and uploaded only when OpenGL doesn't hold them already.
+ * Leaves the modelview matrix selected.
+ * @param fovy [in] field of view in degrees
+ * @param aspect [in] aspect ratio
+ * @param zNear [in] near clipping plane
+ * @param zFar [in] far clipping plane
+ * @param eye [in] camera position
+ * @param target [in] camera target
+ * @param up [in] camera up vector
+ * @ingroup matrix
+ */
+void matrixSetCamera(float fovy, float aspect, float zNear, float zFar, const float *eye, const float *target, const float *up)
+{
+	float key[13] = {
+		fovy, aspect, zNear, zFar,
+		eye[0], eye[1], eye[2],
+		target[0], target[1], target[2],
+		up[0], up[1], up[2]
+	};
+
+	if (!camera.valid || memcmp(camera.key, key, sizeof(key)))
+	{
+		memcpy(camera.key, key, sizeof(key));
+		mat4x4_perspective(camera.projection, (float)degToRad(fovy), aspect, zNear, zFar);
+
+		vec3 e = {eye[0], eye[1], eye[2]};
+		vec3 t = {target[0], target[1], target[2]};
+		vec3 u = {up[0], up[1], up[2]};
+		mat4x4_look_at(camera.view, e, t, u);
+
+		camera.projectionSerial = ++serialCounter;
+		camera.viewSerial = ++serialCounter;
+		camera.valid = 1;
+	}
+
+	matrixMode(GL_PROJECTION);
+	if (projection.serial[projection.depth] != camera.projectionSerial)
+	{
+		mat4x4_dup(projection.matrix[projection.depth], camera.projection);
+		projection.serial[projection.depth] = camera.projectionSerial;
+	}
+	matrixUpload();
+
+	matrixMode(GL_MODELVIEW);
+	if (modelView.serial[modelView.depth] != camera.viewSerial)
+	{
+		mat4x4_dup(modelView.matrix[modelView.depth], camera.view);
+		modelView.serial[modelView.depth] = camera.viewSerial;
+	}
+	matrixUpload();
+}
+
+/**
+ * @return selected matrix stack, GL_MODELVIEW or GL_PROJECTION
+ * @ingroup matrix
+ */
+GLenum matrixGetMode(void)
+{
+	return current->mode;
+}
+
+/**
+ * @return current modelview matrix, column-major
+ * @ingroup matrix
+ */
+const float* matrixGetModelView(void)
+{
+	return (const float*)modelView.matrix[modelView.depth];
+}
+
+/**
+ * @return current projection matrix, column-major
+ * @ingroup matrix
+ */
+const float* matrixGetProjection(void)
+{
+	return (const float*)projection.matrix[projection.depth];
+}
+
+/**
+ * Set the viewport and track it for CPU-side projections.
+ * @ingroup matrix
+ */
+void matrixSetViewport(int x, int y, int width, int height)
+{
+	viewport[0] = x;
+	viewport[1] = y;
+	viewport[2] = width;
+	viewport[3] = height;
+	glViewport(x, y, width, height);
+}
+
+/**
+ * @return current viewport as x, y, width, height
+ * @ingroup matrix
+ */
+const int* matrixGetViewport(void)
+{
+	return viewport;
+}
@@ -0,0 +1,38 @@
+#ifndef EXH_SYSTEM_GRAPHICS_MATRIX_H_
+#define EXH_SYSTEM_GRAPHICS_MATRIX_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "graphicsIncludes.h"
+
+#define MATRIX_STACK_DEPTH 32
+
+extern void matrixInit(void);
+extern void matrixMode(GLenum mode);
+extern GLenum matrixGetMode(void);
+extern void matrixPush(void);
+extern void matrixPop(void);
+extern void matrixLoadIdentity(void);
+extern void matrixLoad(const float *m);
+extern void matrixMultiply(const float *m);
+extern void matrixTranslate(float x, float y, float z);
+extern void matrixRotate(float degrees, float x, float y, float z);
+extern void matrixScale(float x, float y, float z);
+extern void matrixOrtho(float left, float right, float bottom, float top, float zNear, float zFar);
+extern void matrixFrustum(float left, float right, float bottom, float top, float zNear, float zFar);
+extern void matrixPerspective(float fovy, float aspect, float zNear, float zFar);
+extern void matrixInvalidate(void);
+extern void matrixSetCamera(float fovy, float aspect, float zNear, float zFar, const float *eye, const float *target, const float *up);
+extern const float* matrixGetModelView(void);
+extern const float* matrixGetProjection(void);
+extern void matrixSetViewport(int x, int y, int width, int height);
+extern const int* matrixGetViewport(void);
+
+#ifdef __cplusplus
+/* end 'extern "C"' wrapper */
+}
+#endif
+
+#endif /*EXH_SYSTEM_GRAPHICS_MATRIX_H_*/
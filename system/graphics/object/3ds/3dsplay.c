@@ -33,6 +33,7 @@
 #include <lib3ds/matrix.h>
 #include <lib3ds/vector.h>
 #include <lib3ds/light.h>
+#include <lib3ds/io.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -46,6 +47,7 @@
 #include "system/extensions/gl/gl.h"
 #include "system/datatypes/memory.h"
 #include "system/graphics/object/object3d.h"
+#include "system/io/io.h"
 
 
 /*// OS X has a different path than everyone else
@@ -236,6 +238,96 @@ void free_model_3ds(Lib3dsFile *file)
 
 static void light_update(Lib3dsFile *file, Lib3dsLight *l);
 
+/*!
+* lib3ds io reading from a file mapped with ioMapFile(), so that models in the data archive can be loaded.
+*/
+typedef struct {
+  const unsigned char *data;
+  long size;
+  long position;
+} memoryio_t;
+
+static Lib3dsBool
+memoryio_error_func(void *self)
+{
+  return(LIB3DS_FALSE);
+}
+
+static long
+memoryio_seek_func(void *self, long offset, Lib3dsIoSeek origin)
+{
+  memoryio_t *m = (memoryio_t*)self;
+  long position;
+  switch (origin) {
+    case LIB3DS_SEEK_SET:
+      position = offset;
+      break;
+    case LIB3DS_SEEK_CUR:
+      position = m->position + offset;
+      break;
+    case LIB3DS_SEEK_END:
+      position = m->size + offset;
+      break;
+    default:
+      return(-1);
+  }
+  if (position < 0 || position > m->size) {
+    return(-1);
+  }
+  m->position = position;
+  return(0);
+}
+
+static long
+memoryio_tell_func(void *self)
+{
+  return(((memoryio_t*)self)->position);
+}
+
+static size_t
+memoryio_read_func(void *self, void *buffer, size_t size)
+{
+  memoryio_t *m = (memoryio_t*)self;
+  size_t left = (size_t)(m->size - m->position);
+  if (size > left) {
+    size = left;
+  }
+  memcpy(buffer, m->data + m->position, size);
+  m->position += (long)size;
+  return(size);
+}
+
+static size_t
+memoryio_write_func(void *self, const void *buffer, size_t size)
+{
+  return(0);
+}
+
+static Lib3dsFile *
+load_file_3ds(const char *filepath)
+{
+  size_t size = 0;
+  void *data = ioMapFile(filepath, &size);
+  if (data == NULL) {
+    return(NULL);
+  }
+
+  memoryio_t m = {(const unsigned char*)data, (long)size, 0};
+  Lib3dsFile *file = lib3ds_file_new();
+  Lib3dsIo *io = lib3ds_io_new(&m, memoryio_error_func, memoryio_seek_func,
+    memoryio_tell_func, memoryio_read_func, memoryio_write_func);
+  if (file && (!io || !lib3ds_file_read(file, io))) {
+    lib3ds_file_free(file);
+    file = NULL;
+  }
+  if (io) {
+    lib3ds_io_free(io);
+  }
+
+  ioUnmapFile(data, size);
+  return(file);
+}
+
 /*!
 * Load the model from .3ds file.
 */
@@ -254,7 +346,7 @@ load_model_3ds(const char *filepath)
   //object->data.file = (Lib3dsFile*)malloc(sizeof(Lib3dsFile));
   //assert(object->data.file != NULL);
 
-  object->data.file=lib3ds_file_load(filepath);
+  object->data.file=load_file_3ds(filepath);
   if (!object->data.file) {
     debugErrorPrintf("Loading of 3DS file '%s' failed.", filepath);
     return NULL;
@@ -1070,7 +1162,7 @@ render_node(object3d_t *object, Lib3dsNode *node)
 	  mesh_extension *meshext = (mesh_extension*)mesh->user.p;
 	  
 
-      glPushMatrix();
+      matrixPush();
       d=&node->data.object;
 
 //printf("pivot: ");
@@ -1081,11 +1173,13 @@ if (object->clearZBuffer)
 	//glClear(GL_DEPTH_BUFFER_BIT);
 }
 
-      glMultMatrixf(&node->matrix[0][0]);
-      glTranslatef(-d->pivot[0], -d->pivot[1], -d->pivot[2]);
+      matrixMultiply(&node->matrix[0][0]);
+      matrixTranslate(-d->pivot[0], -d->pivot[1], -d->pivot[2]);
 	  if (meshext->list > 0)
 	  {
 		  glCallList(meshext->list);
+		  //the list multiplies the mesh matrix on OpenGL side only
+		  matrixInvalidate();
 	  }
 	  else
 	  {
@@ -1094,7 +1188,7 @@ if (object->clearZBuffer)
           Lib3dsMatrix M;
           lib3ds_matrix_copy(M, mesh->matrix);
           lib3ds_matrix_inv(M);
-          glMultMatrixf(&M[0][0]);
+          matrixMultiply(&M[0][0]);
 	  }
 
 		  vbo_t *vbo = meshext->vbo;
@@ -1214,7 +1308,7 @@ if (object->clearZBuffer)
 	  }
 	  
       /* glutSolidSphere(50.0, 20,20); */
-      glPopMatrix();
+      matrixPop();
       //if( flush )
         //glFlush();
     }
@@ -1490,8 +1584,8 @@ void display3ds(object3d_t *object)
       tgt = cam->target;
   }
 
-  glMatrixMode(GL_PROJECTION);
-  glLoadIdentity();
+  matrixMode(GL_PROJECTION);
+  matrixLoadIdentity();
 
   /* KLUDGE alert:  OpenGL can't handle a near clip plane of zero,
   * so if the camera's near plane is zero, we give it a small number.
@@ -1523,22 +1617,22 @@ void display3ds(object3d_t *object)
 	roll = 0;
   }
 
-  gluPerspective( fov, _aspect, _near, _far);
+  matrixPerspective( fov, _aspect, _near, _far);
 
-  glMatrixMode(GL_MODELVIEW);
+  matrixMode(GL_MODELVIEW);
   //glLoadIdentity();
-  glRotatef(-90, 1.0,0,0);
+  matrixRotate(-90, 1.0,0,0);
 
   /* User rotates the view about the target point */
 
   lib3ds_vector_sub(v, tgt, campos);
   dist = lib3ds_vector_length(v);
 
-  glTranslatef(0.,dist, 0.);
-  glRotatef(view_rotx, 1., 0., 0.);
-  glRotatef(view_roty, 0., 1., 0.);
-  glRotatef(view_rotz, 0., 0., 1.);
-  glTranslatef(0.,-dist, 0.);
+  matrixTranslate(0.,dist, 0.);
+  matrixRotate(view_rotx, 1., 0., 0.);
+  matrixRotate(view_roty, 0., 1., 0.);
+  matrixRotate(view_rotz, 0., 0., 1.);
+  matrixTranslate(0.,-dist, 0.);
  
   lib3ds_matrix_camera2(M, campos, tgt, roll);//-M_PI*0.82);
   //lib3ds_matrix_inv(M);
@@ -1547,7 +1641,7 @@ void display3ds(object3d_t *object)
   M[0][1] *= -1;
   M[0][2] *= -1;
   //M[1][4] *= -1;*/
-  glMultMatrixf(&M[0][0]);
+  matrixMultiply(&M[0][0]);
 
   /* Lights.  Set them from light nodes if possible.  If not, use the
   * light objects directly.
@@ -0,0 +1,93 @@
+/**
+ * Immediate mode geometry recorded to a native command buffer. The geometry is recorded once and
+ * drawn with a single native call per frame, it's recorded again only when the key changes.
+ * @constructor
+ */
+var CommandBuffer = function()
+{
+    this.ref = commandBufferInit();
+    this.key = void null;
+    this.recorded = false;
+};
+
+/** global object, the GL functions are replaced in it while recording */
+CommandBuffer.global = (function() { return this; })();
+
+CommandBuffer.recorders = function(ptr)
+{
+    return {
+        'glBegin': function(mode) { commandBufferPrimitiveBegin(ptr, mode); },
+        'glEnd': function() { commandBufferPrimitiveEnd(ptr); },
+        'glVertex2f': function(x, y) { commandBufferVertex(ptr, x, y, 0); },
+        'glVertex2d': function(x, y) { commandBufferVertex(ptr, x, y, 0); },
+        'glVertex2i': function(x, y) { commandBufferVertex(ptr, x, y, 0); },
+        'glVertex3f': function(x, y, z) { commandBufferVertex(ptr, x, y, z); },
+        'glVertex3d': function(x, y, z) { commandBufferVertex(ptr, x, y, z); },
+        'glVertex3i': function(x, y, z) { commandBufferVertex(ptr, x, y, z); },
+        'glNormal3f': function(x, y, z) { commandBufferNormal(ptr, x, y, z); },
+        'glNormal3d': function(x, y, z) { commandBufferNormal(ptr, x, y, z); },
+        'glTexCoord2f': function(u, v) { commandBufferTexCoord(ptr, u, v); },
+        'glTexCoord2d': function(u, v) { commandBufferTexCoord(ptr, u, v); },
+        'glColor3f': function(r, g, b) { commandBufferColor(ptr, r, g, b, 1); },
+        'glColor3d': function(r, g, b) { commandBufferColor(ptr, r, g, b, 1); },
+        'glColor4f': function(r, g, b, a) { commandBufferColor(ptr, r, g, b, a); },
+        'glColor4d': function(r, g, b, a) { commandBufferColor(ptr, r, g, b, a); },
+        'glColor3ub': function(r, g, b) { commandBufferColor(ptr, r / 255, g / 255, b / 255, 1); },
+        'glColor4ub': function(r, g, b, a) { commandBufferColor(ptr, r / 255, g / 255, b / 255, a / 255); }
+    };
+};
+
+/**
+ * Record the geometry drawn by recordFunction. The vertex calls (glBegin, glEnd, glVertex*,
+ * glNormal3*, glTexCoord2*, glColor*) are recorded, other GL calls are executed while recording
+ * and are not replayed.
+ */
+CommandBuffer.prototype.record = function(recordFunction)
+{
+    var global = CommandBuffer.global;
+    var recorders = CommandBuffer.recorders(this.ref.ptr);
+    var originals = {};
+    var name;
+    for (name in recorders)
+    {
+        originals[name] = global[name];
+        global[name] = recorders[name];
+    }
+
+    commandBufferBegin(this.ref.ptr);
+    try
+    {
+        recordFunction();
+    }
+    finally
+    {
+        for (name in originals)
+        {
+            global[name] = originals[name];
+        }
+        commandBufferEnd(this.ref.ptr);
+    }
+
+    this.recorded = true;
+};
+
+/**
+ * Draw the buffer, recordFunction is called to record it first if the key has changed,
+ * e.g. a key built from the parameters the geometry depends on.
+ */
+CommandBuffer.prototype.draw = function(key, recordFunction)
+{
+    if (!this.recorded || this.key !== key)
+    {
+        this.record(recordFunction);
+        this.key = key;
+    }
+
+    commandBufferDraw(this.ref.ptr);
+};
+
+/** Record the buffer again on the next draw */
+CommandBuffer.prototype.invalidate = function()
+{
+    this.recorded = false;
+};
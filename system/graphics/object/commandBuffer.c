@@ -0,0 +1,334 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "graphicsIncludes.h"
+#include "system/debug/debug.h"
+#include "system/debug/profiler.h"
+#include "system/datatypes/memory.h"
+#include "commandBuffer.h"
+
+/**
+ * @defgroup commandBuffer Recorded immediate mode geometry
+ * Records glBegin()/glEnd() style vertex specification once and replays it with a single call.
+ * Vertices are stored interleaved and uploaded to a static VBO at commandBufferEnd(), draws of
+ * consecutive primitives that can be concatenated are merged. Only the vertex attributes that were
+ * specified while recording are enabled, so e.g. a buffer without colors uses the current color.
+ * Without VBO support the vertices are drawn from client memory.
+ * @ingroup graphics
+ */
+
+#define COMMAND_BUFFER_POSITION 0
+#define COMMAND_BUFFER_NORMAL 3
+#define COMMAND_BUFFER_TEXCOORD 6
+#define COMMAND_BUFFER_COLOR 8
+
+/**
+ * Free the buffer contents, called by the memory garbage collection.
+ * @ingroup commandBuffer
+ */
+void commandBufferDeinit(void *commandBufferPointer)
+{
+	assert(commandBufferPointer);
+	commandBuffer_t *commandBuffer = (commandBuffer_t*)commandBufferPointer;
+
+#ifdef SUPPORT_GL_VBO
+	if (commandBuffer->vertexId)
+	{
+		glDeleteBuffers(1, &commandBuffer->vertexId);
+		commandBuffer->vertexId = 0;
+	}
+#endif
+
+	free(commandBuffer->vertices);
+	commandBuffer->vertices = NULL;
+	free(commandBuffer->draws);
+	commandBuffer->draws = NULL;
+}
+
+/**
+ * Initialize an empty command buffer
+ * @param commandBuffer [in] Pointer to command buffer. NULL creates a new command buffer.
+ * @return pointer to command buffer
+ * @ingroup commandBuffer
+ * @ref JSAPI
+ */
+commandBuffer_t* commandBufferInit(commandBuffer_t *commandBuffer)
+{
+	if (commandBuffer == NULL)
+	{
+		commandBuffer = memoryAllocateGeneral(NULL, sizeof(commandBuffer_t), commandBufferDeinit);
+		assert(commandBuffer);
+	}
+
+	memset(commandBuffer, 0, sizeof(commandBuffer_t));
+	commandBuffer->current[COMMAND_BUFFER_NORMAL + 2] = 1.0f;
+	commandBuffer->current[COMMAND_BUFFER_COLOR + 0] = 1.0f;
+	commandBuffer->current[COMMAND_BUFFER_COLOR + 1] = 1.0f;
+	commandBuffer->current[COMMAND_BUFFER_COLOR + 2] = 1.0f;
+	commandBuffer->current[COMMAND_BUFFER_COLOR + 3] = 1.0f;
+
+	return commandBuffer;
+}
+
+/**
+ * Start recording, previously recorded contents are replaced.
+ * @ingroup commandBuffer
+ * @ref JSAPI
+ */
+void commandBufferBegin(commandBuffer_t *commandBuffer)
+{
+	assert(commandBuffer);
+	if (commandBuffer->recording)
+	{
+		debugWarningPrintf("Command buffer is already recording");
+	}
+
+	commandBuffer->vertexCount = 0;
+	commandBuffer->drawCount = 0;
+	commandBuffer->attributes = 0;
+	commandBuffer->primitive = 0;
+	commandBuffer->recording = 1;
+}
+
+/**
+ * Stop recording and upload the vertices.
+ * @ingroup commandBuffer
+ * @ref JSAPI
+ */
+void commandBufferEnd(commandBuffer_t *commandBuffer)
+{
+	assert(commandBuffer);
+	if (commandBuffer->primitive)
+	{
+		debugWarningPrintf("Command buffer recording ended inside a primitive");
+		commandBufferPrimitiveEnd(commandBuffer);
+	}
+	commandBuffer->recording = 0;
+
+#ifdef SUPPORT_GL_VBO
+	if (commandBuffer->vertexCount > 0)
+	{
+		if (commandBuffer->vertexId == 0)
+		{
+			glGenBuffers(1, &commandBuffer->vertexId);
+		}
+
+		profilerZoneBegin("commandBufferUpload");
+		glBindBuffer(GL_ARRAY_BUFFER, commandBuffer->vertexId);
+		glBufferData(GL_ARRAY_BUFFER, commandBuffer->vertexCount * COMMAND_BUFFER_VERTEX_SIZE * sizeof(float),
+			commandBuffer->vertices, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		profilerZoneEnd();
+	}
+#endif
+}
+
+/**
+ * Begin a primitive, see glBegin().
+ * @ingroup commandBuffer
+ * @ref JSAPI
+ */
+void commandBufferPrimitiveBegin(commandBuffer_t *commandBuffer, GLenum mode)
+{
+	assert(commandBuffer);
+	if (!commandBuffer->recording || commandBuffer->primitive)
+	{
+		debugWarningPrintf("Command buffer primitive can't begin, recording:%d, primitive:%d", commandBuffer->recording, commandBuffer->primitive);
+		return;
+	}
+
+	if (commandBuffer->drawCount == commandBuffer->drawCapacity)
+	{
+		commandBuffer->drawCapacity = commandBuffer->drawCapacity ? commandBuffer->drawCapacity * 2 : 16;
+		commandBuffer->draws = (commandBufferDraw_t*)realloc(commandBuffer->draws, sizeof(commandBufferDraw_t) * commandBuffer->drawCapacity);
+		assert(commandBuffer->draws);
+	}
+
+	commandBufferDraw_t *draw = &commandBuffer->draws[commandBuffer->drawCount++];
+	draw->mode = mode;
+	draw->first = (GLint)commandBuffer->vertexCount;
+	draw->count = 0;
+	commandBuffer->primitive = 1;
+}
+
+static int commandBufferIsConcatenable(GLenum mode)
+{
+	return mode == GL_POINTS || mode == GL_LINES || mode == GL_TRIANGLES || mode == GL_QUADS;
+}
+
+/**
+ * End a primitive, see glEnd().
+ * @ingroup commandBuffer
+ * @ref JSAPI
+ */
+void commandBufferPrimitiveEnd(commandBuffer_t *commandBuffer)
+{
+	assert(commandBuffer);
+	if (!commandBuffer->primitive)
+	{
+		debugWarningPrintf("Command buffer primitive end without begin");
+		return;
+	}
+	commandBuffer->primitive = 0;
+
+	commandBufferDraw_t *draw = &commandBuffer->draws[commandBuffer->drawCount - 1];
+	draw->count = (GLsizei)commandBuffer->vertexCount - draw->first;
+	if (draw->count == 0)
+	{
+		commandBuffer->drawCount--;
+		return;
+	}
+
+	//e.g. a sequence of separately specified quads is drawn with a single call
+	if (commandBuffer->drawCount > 1 && commandBufferIsConcatenable(draw->mode))
+	{
+		commandBufferDraw_t *previous = draw - 1;
+		if (previous->mode == draw->mode && previous->first + previous->count == draw->first)
+		{
+			previous->count += draw->count;
+			commandBuffer->drawCount--;
+		}
+	}
+}
+
+/**
+ * Add a vertex with the current normal, texture coordinate and color, see glVertex3f().
+ * @ingroup commandBuffer
+ * @ref JSAPI
+ */
+void commandBufferVertex(commandBuffer_t *commandBuffer, float x, float y, float z)
+{
+	assert(commandBuffer);
+	if (!commandBuffer->primitive)
+	{
+		debugWarningPrintf("Command buffer vertex outside of a primitive is ignored");
+		return;
+	}
+
+	if (commandBuffer->vertexCount == commandBuffer->vertexCapacity)
+	{
+		commandBuffer->vertexCapacity = commandBuffer->vertexCapacity ? commandBuffer->vertexCapacity * 2 : 256;
+		commandBuffer->vertices = (float*)realloc(commandBuffer->vertices, sizeof(float) * COMMAND_BUFFER_VERTEX_SIZE * commandBuffer->vertexCapacity);
+		assert(commandBuffer->vertices);
+	}
+
+	commandBuffer->current[COMMAND_BUFFER_POSITION + 0] = x;
+	commandBuffer->current[COMMAND_BUFFER_POSITION + 1] = y;
+	commandBuffer->current[COMMAND_BUFFER_POSITION + 2] = z;
+	memcpy(&commandBuffer->vertices[commandBuffer->vertexCount * COMMAND_BUFFER_VERTEX_SIZE], commandBuffer->current, sizeof(commandBuffer->current));
+	commandBuffer->vertexCount++;
+}
+
+/**
+ * Set the current normal, see glNormal3f().
+ * @ingroup commandBuffer
+ * @ref JSAPI
+ */
+void commandBufferNormal(commandBuffer_t *commandBuffer, float x, float y, float z)
+{
+	assert(commandBuffer);
+	commandBuffer->current[COMMAND_BUFFER_NORMAL + 0] = x;
+	commandBuffer->current[COMMAND_BUFFER_NORMAL + 1] = y;
+	commandBuffer->current[COMMAND_BUFFER_NORMAL + 2] = z;
+	commandBuffer->attributes |= COMMAND_BUFFER_USE_NORMAL;
+}
+
+/**
+ * Set the current texture coordinate, see glTexCoord2f().
+ * @ingroup commandBuffer
+ * @ref JSAPI
+ */
+void commandBufferTexCoord(commandBuffer_t *commandBuffer, float u, float v)
+{
+	assert(commandBuffer);
+	commandBuffer->current[COMMAND_BUFFER_TEXCOORD + 0] = u;
+	commandBuffer->current[COMMAND_BUFFER_TEXCOORD + 1] = v;
+	commandBuffer->attributes |= COMMAND_BUFFER_USE_TEXCOORD;
+}
+
+/**
+ * Set the current color, see glColor4f(). Vertices recorded before the first color are white.
+ * @ingroup commandBuffer
+ * @ref JSAPI
+ */
+void commandBufferColor(commandBuffer_t *commandBuffer, float r, float g, float b, float a)
+{
+	assert(commandBuffer);
+	commandBuffer->current[COMMAND_BUFFER_COLOR + 0] = r;
+	commandBuffer->current[COMMAND_BUFFER_COLOR + 1] = g;
+	commandBuffer->current[COMMAND_BUFFER_COLOR + 2] = b;
+	commandBuffer->current[COMMAND_BUFFER_COLOR + 3] = a;
+	commandBuffer->attributes |= COMMAND_BUFFER_USE_COLOR;
+}
+
+/**
+ * Draw the recorded primitives.
+ * @ingroup commandBuffer
+ * @ref JSAPI
+ */
+void commandBufferDraw(commandBuffer_t *commandBuffer)
+{
+	assert(commandBuffer);
+	if (commandBuffer->recording)
+	{
+		debugWarningPrintf("Command buffer can't be drawn while recording");
+		return;
+	}
+	if (commandBuffer->drawCount == 0)
+	{
+		return;
+	}
+
+	const float *base = commandBuffer->vertices;
+#ifdef SUPPORT_GL_VBO
+	glBindBuffer(GL_ARRAY_BUFFER, commandBuffer->vertexId);
+	base = NULL;
+#endif
+	const GLsizei stride = COMMAND_BUFFER_VERTEX_SIZE * sizeof(float);
+	int attributes = commandBuffer->attributes;
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, stride, base + COMMAND_BUFFER_POSITION);
+	if (attributes & COMMAND_BUFFER_USE_NORMAL)
+	{
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(GL_FLOAT, stride, base + COMMAND_BUFFER_NORMAL);
+	}
+	if (attributes & COMMAND_BUFFER_USE_TEXCOORD)
+	{
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(2, GL_FLOAT, stride, base + COMMAND_BUFFER_TEXCOORD);
+	}
+	if (attributes & COMMAND_BUFFER_USE_COLOR)
+	{
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(4, GL_FLOAT, stride, base + COMMAND_BUFFER_COLOR);
+	}
+
+	unsigned int i;
+	for (i = 0; i < commandBuffer->drawCount; i++)
+	{
+		glDrawArrays(commandBuffer->draws[i].mode, commandBuffer->draws[i].first, commandBuffer->draws[i].count);
+	}
+
+	glDisableClientState(GL_VERTEX_ARRAY);
+	if (attributes & COMMAND_BUFFER_USE_NORMAL)
+	{
+		glDisableClientState(GL_NORMAL_ARRAY);
+	}
+	if (attributes & COMMAND_BUFFER_USE_TEXCOORD)
+	{
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	}
+	if (attributes & COMMAND_BUFFER_USE_COLOR)
+	{
+		glDisableClientState(GL_COLOR_ARRAY);
+		//the color array leaves the current color undefined, restore the color that was current at the end of recording
+		glColor4fv(&commandBuffer->current[COMMAND_BUFFER_COLOR]);
+	}
+
+#ifdef SUPPORT_GL_VBO
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+#endif
+}
@@ -0,0 +1,44 @@
+#ifndef EXH_SYSTEM_GRAPHICS_OBJECT_COMMANDBUFFER_H_
+#define EXH_SYSTEM_GRAPHICS_OBJECT_COMMANDBUFFER_H_
+
+/* interleaved vertex: position xyz, normal xyz, texture coordinate uv, color rgba */
+#define COMMAND_BUFFER_VERTEX_SIZE 12
+
+#define COMMAND_BUFFER_USE_NORMAL 0x1
+#define COMMAND_BUFFER_USE_TEXCOORD 0x2
+#define COMMAND_BUFFER_USE_COLOR 0x4
+
+typedef struct {
+	GLenum mode;
+	GLint first;
+	GLsizei count;
+} commandBufferDraw_t;
+
+typedef struct {
+	float *vertices;
+	unsigned int vertexCount;
+	unsigned int vertexCapacity;
+	commandBufferDraw_t *draws;
+	unsigned int drawCount;
+	unsigned int drawCapacity;
+	/* attributes of the next vertex, like the OpenGL current vertex state */
+	float current[COMMAND_BUFFER_VERTEX_SIZE];
+	int recording;
+	int primitive;
+	int attributes;
+	GLuint vertexId;
+} commandBuffer_t;
+
+extern void commandBufferDeinit(void *commandBuffer);
+extern commandBuffer_t* commandBufferInit(commandBuffer_t *commandBuffer);
+extern void commandBufferBegin(commandBuffer_t *commandBuffer);
+extern void commandBufferEnd(commandBuffer_t *commandBuffer);
+extern void commandBufferPrimitiveBegin(commandBuffer_t *commandBuffer, GLenum mode);
+extern void commandBufferPrimitiveEnd(commandBuffer_t *commandBuffer);
+extern void commandBufferVertex(commandBuffer_t *commandBuffer, float x, float y, float z);
+extern void commandBufferNormal(commandBuffer_t *commandBuffer, float x, float y, float z);
+extern void commandBufferTexCoord(commandBuffer_t *commandBuffer, float u, float v);
+extern void commandBufferColor(commandBuffer_t *commandBuffer, float r, float g, float b, float a);
+extern void commandBufferDraw(commandBuffer_t *commandBuffer);
+
+#endif /*EXH_SYSTEM_GRAPHICS_OBJECT_COMMANDBUFFER_H_*/
@@ -2,6 +2,7 @@
 
 #include "graphicsIncludes.h"
 #include "system/debug/debug.h"
+#include "system/graphics/renderState.h"
 #include "lighting.h"
 
 #define MAX_LIGHTS 8
@@ -174,9 +175,9 @@ void lightSetOn(unsigned int i)
 
 	light->enabled = 1;
 
-	glEnable(GL_LIGHTING);
+	renderStateEnable(GL_LIGHTING);
 	
-	glEnable(light->id);
+	renderStateEnable(light->id);
 	lightCalculate(light);
 
 	/*debugPrintf("Light id:'0x%X', enabled:'%d', positionObj:'%p'\n" \
@@ -198,7 +199,7 @@ void lightSetOff(unsigned int i)
 	assert(light);
 	light->enabled = 0;
 
-	glDisable(light->id);
+	renderStateDisable(light->id);
 	
 
 	light_t lightDefault;
@@ -208,7 +209,7 @@ void lightSetOff(unsigned int i)
 	
 	if (!isLightingEnabled())
 	{
-		glDisable(GL_LIGHTING);
+		renderStateDisable(GL_LIGHTING);
 	}
 }
 
@@ -170,10 +170,12 @@ void obj_material_file_load(obj_container_t *obj_container, const char *filename
 	char *full_filename = strdup(getFilePath(filename));
 	assert(full_filename);
 
-	FILE *f = fopen(full_filename, "rb");
-	assert(f);
+	size_t size = 0;
+	const char *data = (const char*)ioMapFile(full_filename, &size);
+	assert(data);
+	const char *cursor = data;
 
-	while (fgets(line, LINE_SIZE, f) != NULL)
+	while (ioGetLine(line, LINE_SIZE, &cursor, data + size) != NULL)
 	{
 		int matches = sscanf(line, "%s", type);
 		if (matches == 0 || line[0] == '#')
@@ -269,7 +271,7 @@ void obj_material_file_load(obj_container_t *obj_container, const char *filename
 	free(line);
 	free(type);
 
-	fclose(f);
+	ioUnmapFile((void*)data, size);
 
 	debugPrintf("Loaded material library '%s'", full_filename);
 	free(full_filename);
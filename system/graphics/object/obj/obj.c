@@ -231,8 +231,10 @@ obj_container_t* obj_file_load(const char *filename)
 	file->filename = strdup(getFilePath(filename));
 	assert(file->filename);
 
-	FILE *f = fopen(file->filename, "rb");
-	assert(f);
+	size_t size = 0;
+	const char *data = (const char*)ioMapFile(file->filename, &size);
+	assert(data);
+	const char *cursor = data;
 
 	obj_object_t *current_object = NULL;
 
@@ -240,7 +242,7 @@ obj_container_t* obj_file_load(const char *filename)
 	initialize_obj_face_parameters(&current_face_parameters);
 
 	int object_count = 0;
-	while (fgets(line, LINE_SIZE, f) != NULL)
+	while (ioGetLine(line, LINE_SIZE, &cursor, data + size) != NULL)
 	{
 		int matches = sscanf(line, "%s", type);
 		if (matches == 0 || line[0] == '#')
@@ -440,7 +442,7 @@ obj_container_t* obj_file_load(const char *filename)
 	free(line);
 	free(type);
 
-	fclose(f);
+	ioUnmapFile((void*)data, size);
 
 	debugPrintf("Loaded object '%s'. Faces:%d (vertices:%d, normals:%d, texture_coordinates:%d)", file->filename, current_object->faces_size, current_object->vertices_size, current_object->vertex_normals_size, current_object->vertex_texture_coordinates_size);
 
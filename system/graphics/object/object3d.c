@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 
 #include "system/graphics/object/lib3ds/types.h"
@@ -18,14 +19,21 @@
 #include "system/graphics/object/lib3ds/light.h"
 
 #include "system/io/io.h"
+#include "system/io/fileWatch.h"
+#include "system/player/player.h"
 #include "system/graphics/graphics.h"
 #include "system/debug/debug.h"
+#include "system/debug/profiler.h"
 #include "system/graphics/object/3ds/3dsplay.h"
 #include "system/graphics/object/basic3dshapes.h"
 #include "system/datatypes/memory.h"
+#include "system/thread/thread.h"
 
 #include "object3d.h"
 
+//meshes with more vertices are deformed in parallel chunks
+#define OBJECT_DEFORM_CHUNK 4096
+
 int replaceObjectTexture(object3d_t *object, const char *findTextureName, const char *replaceTextureName)
 {
 	return replace_model_3ds_material_texture(object, findTextureName, replaceTextureName);
@@ -46,7 +54,8 @@ void objectInit(object3d_t* object)
 	object->useObjectTextureCoordinates = 1;
 	object->useSimpleColors = 0;
 
-	object->vertexTransform = NULL;
+	object->vertexDeformer = NULL;
+	object->vertexStreams = NULL;
 	
 	object->scale.x = 1.0;
 	object->scale.y = 1.0;
@@ -115,22 +124,22 @@ static int obj_object_gl_bind_face_texture(obj_face_t *face)
 		if (texture)
 		{
 			enabledTextures++;
-			glActiveTexture(GL_TEXTURE0);
-			glEnable(GL_TEXTURE_2D);
-			glBindTexture(GL_TEXTURE_2D, texture->id);
+			renderStateActiveTexture(GL_TEXTURE0);
+			renderStateEnable(GL_TEXTURE_2D);
+			renderStateBindTexture(GL_TEXTURE_2D, texture->id);
 		}
 
 		if (obj_material->reflection.texture != NULL)
 		{
 			enabledTextures++;
-			glActiveTexture(GL_TEXTURE1);
-			glEnable(GL_TEXTURE_2D);
-			glBindTexture(GL_TEXTURE_2D, obj_material->reflection.texture->id);
+			renderStateActiveTexture(GL_TEXTURE1);
+			renderStateEnable(GL_TEXTURE_2D);
+			renderStateBindTexture(GL_TEXTURE_2D, obj_material->reflection.texture->id);
 
 			glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_REFLECTION_MAP);
 			glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_REFLECTION_MAP);
-			glEnable(GL_TEXTURE_GEN_T);
-			glEnable(GL_TEXTURE_GEN_S);
+			renderStateEnable(GL_TEXTURE_GEN_T);
+			renderStateEnable(GL_TEXTURE_GEN_S);
 		}
 	}
 
@@ -190,13 +199,7 @@ static void obj_object_gl_legacy_render(object3d_t *object_main, obj_object_t *o
 				}
 			}
 
-			float x = vertex->xyz.x;
-			float y = vertex->xyz.y;
-			float z = vertex->xyz.z;
-			if (object_main->vertexTransform != NULL) {
-				object_main->vertexTransform(&x,&y,&z);
-			}
-			glVertex3f(x,y,z);
+			glVertex3f(vertex->xyz.x, vertex->xyz.y, vertex->xyz.z);
 		}
 	}
 
@@ -220,6 +223,171 @@ static void obj_object_gl_legacy_render(object3d_t *object_main, obj_object_t *o
 	//glDisable(GL_TEXTURE_2D);
 }
 
+static void obj_object_vertex_stream_init(object3d_t *object_main, obj_object_t *object, object_vertex_stream_t *stream)
+{
+	assert(object_main);
+	assert(object);
+	assert(stream);
+
+	obj_face_t *face = object->faces[0];
+	stream->mode = face->size == 4 ? GL_QUADS : GL_TRIANGLES;
+
+	stream->count = 0;
+	unsigned int i;
+	for(i = 0; i < object->faces_size; i++)
+	{
+		stream->count += object->faces[i]->size;
+	}
+
+	stream->positions = (float*)malloc(sizeof(float)*3*stream->count);
+	assert(stream->positions);
+	stream->normals = (float*)malloc(sizeof(float)*3*stream->count);
+	assert(stream->normals);
+	stream->deformed = (float*)malloc(sizeof(float)*3*stream->count);
+	assert(stream->deformed);
+	stream->colors = (float*)malloc(sizeof(float)*4*stream->count);
+	assert(stream->colors);
+
+	//missing normals keep the previous one like glNormal3f does in immediate mode
+	obj_xyz_t lastNormal = {0.0f, 0.0f, 1.0f};
+	unsigned int vertex = 0;
+	for(i = 0; i < object->faces_size; i++)
+	{
+		face = object->faces[i];
+
+		unsigned char vertex_i;
+		for(vertex_i = 0; vertex_i < face->size; vertex_i++, vertex++)
+		{
+			if (face->normals[vertex_i] != NULL)
+			{
+				lastNormal = face->normals[vertex_i]->xyz;
+			}
+
+			obj_vertex_t *v = face->vertices[vertex_i];
+			stream->positions[vertex*3 + 0] = v->xyz.x;
+			stream->positions[vertex*3 + 1] = v->xyz.y;
+			stream->positions[vertex*3 + 2] = v->xyz.z;
+			stream->normals[vertex*3 + 0] = lastNormal.x;
+			stream->normals[vertex*3 + 1] = lastNormal.y;
+			stream->normals[vertex*3 + 2] = lastNormal.z;
+		}
+	}
+
+	vboSetDefaults(&stream->vbo);
+#ifdef SUPPORT_GL_VBO
+	vboInit(&stream->vbo);
+	vboLoadArray(&stream->vbo.normalId, GL_NORMAL_ARRAY, stream->count, stream->normals);
+	vboSetFaceCount(&stream->vbo, stream->count);
+#endif
+}
+
+static void obj_object_vertex_stream_deinit(object_vertex_stream_t *stream)
+{
+	assert(stream);
+
+#ifdef SUPPORT_GL_VBO
+	vboDeinit(&stream->vbo);
+#endif
+	free(stream->positions);
+	free(stream->normals);
+	free(stream->deformed);
+	free(stream->colors);
+}
+
+typedef struct {
+	objectVertexDeformer_t vertexDeformer;
+	object_vertex_stream_t *stream;
+	int useColors;
+	int colorsWritten;
+} obj_object_deform_job_t;
+
+static void obj_object_deform_chunk(void *data, unsigned int chunk)
+{
+	obj_object_deform_job_t *job = (obj_object_deform_job_t*)data;
+	object_vertex_stream_t *stream = job->stream;
+
+	unsigned int first = chunk*OBJECT_DEFORM_CHUNK;
+	unsigned int count = stream->count - first < OBJECT_DEFORM_CHUNK ? stream->count - first : OBJECT_DEFORM_CHUNK;
+
+	int colorsWritten = job->vertexDeformer(&stream->positions[first*3], &stream->deformed[first*3],
+		job->useColors ? &stream->colors[first*4] : NULL, count);
+	if (chunk == 0)
+	{
+		job->colorsWritten = colorsWritten;
+	}
+}
+
+static void obj_object_gl_deformed_render(object3d_t *object_main, object_vertex_stream_t *stream)
+{
+	assert(object_main);
+	assert(object_main->vertexDeformer);
+	assert(stream);
+
+	obj_object_deform_job_t job;
+	job.vertexDeformer = object_main->vertexDeformer;
+	job.stream = stream;
+	//colors only affect materials, without lighting they would replace the current color
+	job.useColors = renderStateIsEnabled(GL_LIGHTING);
+	job.colorsWritten = 0;
+
+	profilerZoneBegin("objectDeform");
+	threadParallelFor(obj_object_deform_chunk, &job, (stream->count + OBJECT_DEFORM_CHUNK - 1) / OBJECT_DEFORM_CHUNK);
+	profilerZoneEnd();
+
+#ifdef SUPPORT_GL_VBO
+	vboStreamArray(&stream->vbo.vertexId, GL_VERTEX_ARRAY, stream->count, stream->deformed);
+	vboEnablePointer(&stream->vbo, GL_VERTEX_ARRAY);
+	if (object_main->useObjectNormals)
+	{
+		vboEnablePointer(&stream->vbo, GL_NORMAL_ARRAY);
+	}
+	//color material goes through the render state cache and is restored to the caller's state
+	GLboolean colorMaterialEnabled = renderStateIsEnabled(GL_COLOR_MATERIAL);
+	if (job.colorsWritten)
+	{
+		vboStreamArray(&stream->vbo.colorId, GL_COLOR_ARRAY, stream->count, stream->colors);
+		vboEnablePointer(&stream->vbo, GL_COLOR_ARRAY);
+		glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
+		renderStateEnable(GL_COLOR_MATERIAL);
+	}
+
+	vboDrawArraysMode(&stream->vbo, stream->mode);
+
+	if (job.colorsWritten)
+	{
+		if (!colorMaterialEnabled)
+		{
+			renderStateDisable(GL_COLOR_MATERIAL);
+		}
+		vboDisablePointer(&stream->vbo, GL_COLOR_ARRAY);
+	}
+	if (object_main->useObjectNormals)
+	{
+		vboDisablePointer(&stream->vbo, GL_NORMAL_ARRAY);
+	}
+	vboDisablePointer(&stream->vbo, GL_VERTEX_ARRAY);
+#else
+	//no buffer objects, draw the deformed arrays in immediate mode
+	glBegin(stream->mode);
+	unsigned int i;
+	for(i = 0; i < stream->count; i++)
+	{
+		if (object_main->useObjectNormals)
+		{
+			glNormal3fv(&stream->normals[i*3]);
+		}
+		if (job.colorsWritten)
+		{
+			//same material as the color material in the buffer object path
+			glMaterialfv(GL_FRONT, GL_AMBIENT, &stream->colors[i*4]);
+			glMaterialfv(GL_FRONT, GL_DIFFUSE, &stream->colors[i*4]);
+		}
+		glVertex3fv(&stream->deformed[i*3]);
+	}
+	glEnd();
+#endif
+}
+
 static void obj_container_gl_legacy_render(object3d_t *object)
 {
 	assert(object);
@@ -233,11 +401,62 @@ static void obj_container_gl_legacy_render(object3d_t *object)
 	{
 		for(i = 0; i < container->objects_size; i++)
 		{
+			if (object->vertexDeformer != NULL)
+			{
+				if (object->vertexStreams == NULL)
+				{
+					object->vertexStreams = (object_vertex_stream_t*)calloc(container->objects_size, sizeof(object_vertex_stream_t));
+					assert(object->vertexStreams);
+				}
+
+				object_vertex_stream_t *stream = &object->vertexStreams[i];
+				if (stream->positions == NULL)
+				{
+					obj_object_vertex_stream_init(object, container->objects[i], stream);
+				}
+
+				obj_object_gl_deformed_render(object, stream);
+				continue;
+			}
+
 			obj_object_gl_legacy_render(object, container->objects[i]);
 		}
 	}
 }
 
+static void obj_object_vertex_streams_free(object3d_t *object)
+{
+	if (object->vertexStreams)
+	{
+		unsigned int i;
+		for(i = 0; i < object->data.obj->objects_size; i++)
+		{
+			if (object->vertexStreams[i].positions)
+			{
+				obj_object_vertex_stream_deinit(&object->vertexStreams[i]);
+			}
+		}
+		free(object->vertexStreams);
+		object->vertexStreams = NULL;
+	}
+}
+
+/* file watch callback, the mesh is replaced in place so that users keep their pointers */
+static void objectObjFileChanged(const char *filename, void *object_ptr)
+{
+	object3d_t *object = (object3d_t*)object_ptr;
+	obj_container_t *container = obj_file_load(filename);
+	if (!container) {
+		debugWarningPrintf("Reloading of OBJ file '%s' failed.", filename);
+		return;
+	}
+
+	obj_object_vertex_streams_free(object);
+	obj_container_free(object->data.obj);
+	object->data.obj = container;
+	playerForceRedraw();
+}
+
 static object3d_t *loadObjectObj(const char *filepath)
 {
 	object3d_t *object = getObjectFromMemory(filepath);
@@ -257,6 +476,7 @@ static object3d_t *loadObjectObj(const char *filepath)
 
 	object->filename = strdup(filepath);
 	object->objectType = BASIC_3D_SHAPE_COMPLEX_OBJ;
+	fileWatchAdd(object->filename, objectObjFileChanged, object);
 
 	return object;
 }
@@ -367,6 +587,17 @@ void setObjectColor(object3d_t* object, float r, float g, float b, float a)
 	object->color.a = a;
 }
 
+/**
+ * Set a batch vertex deformer for OBJ meshes, NULL to disable.
+ * Deformed meshes are drawn from a streaming VBO.
+ */
+void setObjectVertexDeformer(object3d_t* object, objectVertexDeformer_t vertexDeformer)
+{
+	assert(object != NULL);
+
+	object->vertexDeformer = vertexDeformer;
+}
+
 void drawObject(void* object_ptr, const char* displayCamera, double displayFrame, int clear)
 {
 	object3d_t *object = (object3d_t*)object_ptr;
@@ -398,26 +629,26 @@ void drawObject(void* object_ptr, const char* displayCamera, double displayFrame
 	}
 
 
-	glEnable(GL_DEPTH_TEST);
+	renderStateEnable(GL_DEPTH_TEST);
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 	//glEnable(GL_BLEND);
 
 	if (object->objectType != BASIC_3D_MATRIX)
 	{
-		glPushMatrix();
+		matrixPush();
 	}
 
-	glTranslatef(object->position.x, object->position.y, object->position.z);
+	matrixTranslate(object->position.x, object->position.y, object->position.z);
 
-	glScalef(object->scale.x, object->scale.y, object->scale.z);
+	matrixScale(object->scale.x, object->scale.y, object->scale.z);
 
-	glTranslatef(object->pivot.x, object->pivot.y, object->pivot.z);
+	matrixTranslate(object->pivot.x, object->pivot.y, object->pivot.z);
 
-	glRotatef(object->degrees.x, -object->angle.x,                0,                0);
-	glRotatef(object->degrees.y,                0, -object->angle.y,                0);
-	glRotatef(object->degrees.z,                0,                0, -object->angle.z);
+	matrixRotate(object->degrees.x, -object->angle.x,                0,                0);
+	matrixRotate(object->degrees.y,                0, -object->angle.y,                0);
+	matrixRotate(object->degrees.z,                0,                0, -object->angle.z);
 
-	glTranslatef(-object->pivot.x, -object->pivot.y, -object->pivot.z);
+	matrixTranslate(-object->pivot.x, -object->pivot.y, -object->pivot.z);
 
 	//glColor4f(object->color.r,object->color.g,object->color.b,object->color.a);
 
@@ -427,6 +658,8 @@ void drawObject(void* object_ptr, const char* displayCamera, double displayFrame
 		{
 			case BASIC_3D_SHAPE_COMPLEX_3DS:
 				display3ds(object);
+				//3DS materials and display lists change the state with raw OpenGL calls
+				renderStateInvalidate();
 				break;
 			case BASIC_3D_SHAPE_COMPLEX_OBJ:
 				obj_container_gl_legacy_render(object);
@@ -439,7 +672,7 @@ void drawObject(void* object_ptr, const char* displayCamera, double displayFrame
 				break;
 		}
 	
-		glPopMatrix();
+		matrixPop();
 	}
 
 
@@ -450,6 +683,7 @@ void objectDeinit(object3d_t* object)
 {
 	assert(object);
 	debugPrintf("Cleaning '%s'", object->filename);
+	fileWatchRemove(object);
 
     if (object->objectType == BASIC_3D_SHAPE_COMPLEX_3DS)
     {
@@ -460,6 +694,8 @@ void objectDeinit(object3d_t* object)
     }
     else if (object->objectType == BASIC_3D_SHAPE_COMPLEX_OBJ)
     {
+		obj_object_vertex_streams_free(object);
+
         if (object->data.obj)
         {
 			obj_container_free(object->data.obj);
@@ -4,6 +4,7 @@
 #include "system/graphics/object/lib3ds/types.h"
 #include "system/graphics/object/obj/obj.h"
 #include "system/datatypes/datatypes.h"
+#include "system/graphics/object/vbo.h"
 
 #define BASIC_3D_SHAPE_COMPLEX 0
 #define BASIC_3D_SHAPE_CYLINDER 1
@@ -35,6 +36,27 @@ typedef struct object_shape_sphere_t {
 	int longs;
 } object_shape_sphere_t;
 
+/**
+ * Batch vertex deformer. Must be thread-safe, large meshes are deformed in parallel chunks.
+ * @param positions [in] source positions, 3 floats per vertex
+ * @param deformed [out] deformed positions, 3 floats per vertex
+ * @param colors [out] RGBA colors, 4 floats per vertex, NULL if colors are not used
+ * @param count [in] amount of vertices
+ * @return 1 if colors were written, 0 otherwise
+ */
+typedef int (*objectVertexDeformer_t)(const float *positions, float *deformed, float *colors, unsigned int count);
+
+/** Unrolled per face vertex data of a deformed mesh, streamed to a VBO each frame */
+typedef struct object_vertex_stream_t {
+	unsigned int count;
+	GLenum mode;
+	float *positions;
+	float *normals;
+	float *deformed;
+	float *colors;
+	vbo_t vbo;
+} object_vertex_stream_t;
+
 typedef struct object3d_t object3d_t;
 
 struct object3d_t
@@ -57,7 +79,8 @@ struct object3d_t
 	point3d_t angle;
 	color_t color;
 
-	void (*vertexTransform)(float*, float*, float*);
+	objectVertexDeformer_t vertexDeformer;
+	object_vertex_stream_t *vertexStreams;
 	
 	union data {
 		Lib3dsFile *file;
@@ -84,6 +107,7 @@ extern void setObjectPosition(object3d_t* object, float x, float y, float z);
 extern void setObjectPivot(object3d_t* object, float x, float y, float z);
 extern void setObjectRotation(object3d_t* object, float degreesX, float degreesY, float degreesZ, float x, float y, float z);
 extern void setObjectColor(object3d_t* object, float r, float g, float b, float a);
+extern void setObjectVertexDeformer(object3d_t* object, objectVertexDeformer_t vertexDeformer);
 
 extern void drawObject(void* object_ptr, const char* displayCamera, double displayFrame, int clear);
 extern void* loadObjectBasicShape(const char * name, int objectType);
@@ -2,6 +2,7 @@
 
 #include "graphicsIncludes.h"
 #include "system/debug/debug.h"
+#include "system/debug/profiler.h"
 #include "vbo.h"
 
 void vboSetDefaults(vbo_t* vbo)
@@ -12,6 +13,7 @@ void vboSetDefaults(vbo_t* vbo)
 	vbo->vertexId = 0;
 	vbo->normalId = 0;
 	vbo->texCoordId = 0;
+	vbo->colorId = 0;
 	vbo->count = 0;
 }
 
@@ -46,11 +48,15 @@ void vboDeinit(vbo_t* vbo)
 	{
 		glDeleteBuffers(1, &vbo->texCoordId);
 	}
+	if (vbo->colorId)
+	{
+		glDeleteBuffers(1, &vbo->colorId);
+	}
 	
 	glDeleteBuffers(1, &vbo->id);
 }
 
-void vboLoadArray(GLuint* bufferId, GLenum arrayType, unsigned int elementCount, float* buffer)
+static void vboUploadArray(GLuint* bufferId, GLenum arrayType, unsigned int elementCount, float* buffer, GLenum usage)
 {
 	assert(bufferId);
 	assert(buffer);
@@ -71,7 +77,10 @@ void vboLoadArray(GLuint* bufferId, GLenum arrayType, unsigned int elementCount,
 			factor = 2*sizeof(float);
 			break;
 		case GL_NORMAL_ARRAY:
-			factor = 1*sizeof(float);
+			factor = 3*sizeof(float);
+			break;
+		case GL_COLOR_ARRAY:
+			factor = 4*sizeof(float);
 			break;
 		default:
 			debugErrorPrintf("Not supported array type:'%d'!", arrayType);
@@ -79,7 +88,23 @@ void vboLoadArray(GLuint* bufferId, GLenum arrayType, unsigned int elementCount,
 	}	
 	assert(factor > 0);
 
-	glBufferData( GL_ARRAY_BUFFER, elementCount*factor, buffer, GL_STATIC_DRAW );	
+	profilerZoneBegin("vboUpload");
+	glBufferData( GL_ARRAY_BUFFER, elementCount*factor, buffer, usage );	
+	profilerZoneEnd();
+}
+
+void vboLoadArray(GLuint* bufferId, GLenum arrayType, unsigned int elementCount, float* buffer)
+{
+	vboUploadArray(bufferId, arrayType, elementCount, buffer, GL_STATIC_DRAW);
+}
+
+/**
+ * Upload array data that is replaced every frame.
+ * The previous storage is orphaned so the upload doesn't wait for pending draws.
+ */
+void vboStreamArray(GLuint* bufferId, GLenum arrayType, unsigned int elementCount, float* buffer)
+{
+	vboUploadArray(bufferId, arrayType, elementCount, buffer, GL_STREAM_DRAW);
 }
 
 void vboLoad(vbo_t* vbo, unsigned int elementCount, float* vertexBuffer, float* texcoordBuffer, float* normalBuffer)
@@ -139,6 +164,12 @@ void vboSetPointer(vbo_t* vbo, GLenum arrayType, int status)
 			glBindBuffer(GL_ARRAY_BUFFER, vbo->normalId);
 			glNormalPointer(GL_FLOAT, 0, (char*)NULL);
 		}
+		else if (arrayType == GL_COLOR_ARRAY && vbo->colorId > 0)
+		{
+			glEnableClientState(GL_COLOR_ARRAY);
+			glBindBuffer(GL_ARRAY_BUFFER, vbo->colorId);
+			glColorPointer(4, GL_FLOAT, 0, (char*)NULL);
+		}
 	}
 	else
 	{
@@ -157,6 +188,11 @@ void vboSetPointer(vbo_t* vbo, GLenum arrayType, int status)
 			glDisableClientState(GL_NORMAL_ARRAY);
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
 		}
+		else if (arrayType == GL_COLOR_ARRAY && vbo->colorId > 0)
+		{
+			glDisableClientState(GL_COLOR_ARRAY);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
 	}
 }
 
@@ -176,12 +212,17 @@ void vboSetFaceCount(vbo_t* vbo, unsigned int count)
 	vbo->count = count;
 }
 
-void vboDrawArrays(vbo_t* vbo)
+void vboDrawArraysMode(vbo_t* vbo, GLenum mode)
 {
 	assert(vbo);
 	assert(vbo->count > 0);
 
-	glDrawArrays(GL_TRIANGLES, 0, vbo->count);
+	glDrawArrays(mode, 0, vbo->count);
+}
+
+void vboDrawArrays(vbo_t* vbo)
+{
+	vboDrawArraysMode(vbo, GL_TRIANGLES);
 }
 
 void vboDraw(vbo_t* vbo)
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include "graphicsIncludes.h"
 #include "system/graphics/graphics.h"
@@ -368,7 +369,7 @@ static void interpolatePoint3d(float percentage, point3d_t *dest, point3d_t *a,
 static void loadSphericalBillboardMatrix()
 {
 	float modelViewMatrix44[16];
-	glGetFloatv(GL_MODELVIEW_MATRIX, modelViewMatrix44);
+	memcpy(modelViewMatrix44, matrixGetModelView(), sizeof(modelViewMatrix44));
 
 	int i,j;
 	for(i=0; i<3; i++)
@@ -386,7 +387,7 @@ static void loadSphericalBillboardMatrix()
 		}
 	}
 
-	glLoadMatrixf(modelViewMatrix44);
+	matrixLoad(modelViewMatrix44);
 }
 
 /**
@@ -409,20 +410,20 @@ void drawParticleContainer(particleContainer_t *particleContainer)
 		return;
 	}
 
-	glPushMatrix();
+	matrixPush();
 
-	glEnable(GL_BLEND);
+	renderStateEnable(GL_BLEND);
 	unsigned int primitiveType = GL_POINTS;
 	if (particleContainer->particleDefaultTextureCount > 0)
 	{
 		primitiveType = GL_QUADS;
-		glActiveTexture(GL_TEXTURE0);
-		glEnable(GL_TEXTURE_2D);
+		renderStateActiveTexture(GL_TEXTURE0);
+		renderStateEnable(GL_TEXTURE_2D);
 		//glBlendFunc(texture->srcBlend, texture->dstBlend);
 	}
 	else
 	{
-		glEnable(GL_POINT_SMOOTH);
+		renderStateEnable(GL_POINT_SMOOTH);
 	}
 
 	if (particleContainer->perspective3d)
@@ -530,9 +531,9 @@ void drawParticleContainer(particleContainer_t *particleContainer)
 		}
 		else
 		{
-			glBindTexture(GL_TEXTURE_2D, particle->texture->id);
+			renderStateBindTexture(GL_TEXTURE_2D, particle->texture->id);
 			
-			glPushMatrix();
+			matrixPush();
 			float w = particle->texture->w;
 			float h = particle->texture->h;
 			
@@ -551,8 +552,8 @@ void drawParticleContainer(particleContainer_t *particleContainer)
 			float uMax = 1.0;
 			float vMin = 0.0;
 			float vMax = 1.0;
-			glTranslated(particle->position.x-dx, particle->position.y-dy, 0.0);
-			glRotated(-particle->angle.z, 0,0,1);
+			matrixTranslate(particle->position.x-dx, particle->position.y-dy, 0.0);
+			matrixRotate(-particle->angle.z, 0,0,1);
 			glBegin(primitiveType);
 			glMultiTexCoord2f(GL_TEXTURE0, uMax,vMax);
 			glVertex2d(dx+w,dy+h);
@@ -563,21 +564,21 @@ void drawParticleContainer(particleContainer_t *particleContainer)
 			glMultiTexCoord2f(GL_TEXTURE0, uMax,vMin);
 			glVertex2d(dx+w,dy);
 			glEnd();
-			glPopMatrix();
+			matrixPop();
 		}
 	}
 	
 	if (primitiveType == GL_QUADS)
 	{
-		glDisable(GL_TEXTURE_2D);
+		renderStateDisable(GL_TEXTURE_2D);
 	}
 	
-	glDisable(GL_BLEND);
+	renderStateDisable(GL_BLEND);
 
 	if (!particleContainer->perspective3d)
 	{
 		perspective2dEnd();
 	}
 
-	glPopMatrix();
+	matrixPop();
 }
@@ -0,0 +1,460 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "graphicsIncludes.h"
+#include "system/debug/debug.h"
+#include "matrix.h"
+
+#include "renderState.h"
+
+/**
+ * @defgroup renderState Render state cache
+ * Shadow copy of the common OpenGL state: capabilities, blend function, active texture unit,
+ * 2D texture bindings per unit, shader program and framebuffer.
+ * Calls that would set the state to the value OpenGL already has are elided.
+ * All engine draw paths must change this state through the cache. Code that changes it with
+ * raw OpenGL calls must call renderStateInvalidate() afterwards.
+ * Issued and elided calls are counted per frame and shown in the profiler overlay.
+ */
+
+#define RENDER_STATE_UNKNOWN -1
+#define RENDER_STATE_CAPS 10
+#define RENDER_STATE_UNIT_CAPS 3
+#define RENDER_STATE_SUMMARY_SIZE 128
+
+typedef struct {
+	GLenum cap;
+	/* attribute group that saves the capability in addition to GL_ENABLE_BIT */
+	GLbitfield attrib;
+} renderStateCap_t;
+
+static const renderStateCap_t renderStateCaps[RENDER_STATE_CAPS] = {
+	{GL_BLEND, GL_COLOR_BUFFER_BIT},
+	{GL_ALPHA_TEST, GL_COLOR_BUFFER_BIT},
+	{GL_DEPTH_TEST, GL_DEPTH_BUFFER_BIT},
+	{GL_LIGHTING, GL_LIGHTING_BIT},
+	{GL_COLOR_MATERIAL, GL_LIGHTING_BIT},
+	{GL_CULL_FACE, GL_POLYGON_BIT},
+	{GL_NORMALIZE, GL_TRANSFORM_BIT},
+	{GL_POINT_SMOOTH, GL_POINT_BIT},
+	{GL_LINE_SMOOTH, GL_LINE_BIT},
+	{GL_FOG, GL_FOG_BIT}
+};
+
+/* capabilities that are separate for each texture unit */
+static const renderStateCap_t renderStateUnitCaps[RENDER_STATE_UNIT_CAPS] = {
+	{GL_TEXTURE_2D, GL_TEXTURE_BIT},
+	{GL_TEXTURE_GEN_S, GL_TEXTURE_BIT},
+	{GL_TEXTURE_GEN_T, GL_TEXTURE_BIT}
+};
+
+typedef struct {
+	GLbitfield mask;
+	GLint enabled[RENDER_STATE_CAPS];
+	GLint unitEnabled[RENDER_STATE_TEXTURE_UNITS][RENDER_STATE_UNIT_CAPS];
+	GLint blendSrc;
+	GLint blendDst;
+	GLint activeUnit;
+	GLint texture[RENDER_STATE_TEXTURE_UNITS];
+	GLenum matrixMode;
+} renderStateAttrib_t;
+
+static renderStateAttrib_t state;
+static GLint program = RENDER_STATE_UNKNOWN;
+static GLint framebuffer = RENDER_STATE_UNKNOWN;
+static renderStateAttrib_t attribStack[RENDER_STATE_ATTRIB_DEPTH];
+static unsigned int attribDepth = 0;
+static int renderStateValid = 0;
+
+static unsigned int issued = 0;
+static unsigned int elided = 0;
+static char renderStateSummary[RENDER_STATE_SUMMARY_SIZE] = {'\0'};
+
+static int renderStateFindCap(const renderStateCap_t *caps, int count, GLenum cap)
+{
+	int i;
+	for (i = 0; i < count; i++)
+	{
+		if (caps[i].cap == cap)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static int renderStateIsCurrent(GLint cached, GLint value)
+{
+	if (renderStateValid && cached == value)
+	{
+		elided++;
+		return 1;
+	}
+
+	issued++;
+	return 0;
+}
+
+/**
+ * Start tracking the OpenGL state. Requires an OpenGL context.
+ * @ingroup renderState
+ */
+void renderStateInit(void)
+{
+	renderStateInvalidate();
+	attribDepth = 0;
+	issued = 0;
+	elided = 0;
+	renderStateSummary[0] = '\0';
+	renderStateValid = 1;
+}
+
+/**
+ * Forget the cached state, the next change of each state is always issued.
+ * @ingroup renderState
+ */
+void renderStateInvalidate(void)
+{
+	int i;
+	for (i = 0; i < RENDER_STATE_CAPS; i++)
+	{
+		state.enabled[i] = RENDER_STATE_UNKNOWN;
+	}
+
+	state.blendSrc = RENDER_STATE_UNKNOWN;
+	state.blendDst = RENDER_STATE_UNKNOWN;
+	state.activeUnit = RENDER_STATE_UNKNOWN;
+	renderStateInvalidateTextures();
+
+	program = RENDER_STATE_UNKNOWN;
+	framebuffer = RENDER_STATE_UNKNOWN;
+}
+
+/**
+ * Forget the cached texture bindings. Texture creation binds textures with raw OpenGL calls
+ * because it may run on a loader thread context.
+ * @ingroup renderState
+ */
+void renderStateInvalidateTextures(void)
+{
+	int unit, i;
+	for (unit = 0; unit < RENDER_STATE_TEXTURE_UNITS; unit++)
+	{
+		for (i = 0; i < RENDER_STATE_UNIT_CAPS; i++)
+		{
+			state.unitEnabled[unit][i] = RENDER_STATE_UNKNOWN;
+		}
+		state.texture[unit] = RENDER_STATE_UNKNOWN;
+	}
+}
+
+static GLint* renderStateGetCap(GLenum cap)
+{
+	int i = renderStateFindCap(renderStateCaps, RENDER_STATE_CAPS, cap);
+	if (i >= 0)
+	{
+		return &state.enabled[i];
+	}
+
+	i = renderStateFindCap(renderStateUnitCaps, RENDER_STATE_UNIT_CAPS, cap);
+	if (i >= 0 && state.activeUnit >= 0 && state.activeUnit < RENDER_STATE_TEXTURE_UNITS)
+	{
+		return &state.unitEnabled[state.activeUnit][i];
+	}
+
+	//not tracked
+	return NULL;
+}
+
+/**
+ * glEnable through the state cache.
+ * @ingroup renderState
+ */
+void renderStateEnable(GLenum cap)
+{
+	GLint *cached = renderStateGetCap(cap);
+	if (renderStateIsCurrent(cached ? *cached : RENDER_STATE_UNKNOWN, GL_TRUE))
+	{
+		return;
+	}
+
+	glEnable(cap);
+	if (cached)
+	{
+		*cached = GL_TRUE;
+	}
+}
+
+/**
+ * glDisable through the state cache.
+ * @ingroup renderState
+ */
+void renderStateDisable(GLenum cap)
+{
+	GLint *cached = renderStateGetCap(cap);
+	if (renderStateIsCurrent(cached ? *cached : RENDER_STATE_UNKNOWN, GL_FALSE))
+	{
+		return;
+	}
+
+	glDisable(cap);
+	if (cached)
+	{
+		*cached = GL_FALSE;
+	}
+}
+
+/**
+ * glIsEnabled through the state cache.
+ * OpenGL is queried only if the capability is not tracked or not known.
+ * @ingroup renderState
+ */
+GLboolean renderStateIsEnabled(GLenum cap)
+{
+	GLint *cached = renderStateGetCap(cap);
+	GLboolean enabled;
+	if (renderStateValid && cached && *cached != RENDER_STATE_UNKNOWN)
+	{
+		return (GLboolean)*cached;
+	}
+
+	enabled = glIsEnabled(cap);
+	if (cached)
+	{
+		*cached = enabled ? GL_TRUE : GL_FALSE;
+	}
+
+	return enabled;
+}
+
+/**
+ * glBlendFunc through the state cache.
+ * @ingroup renderState
+ */
+void renderStateBlendFunc(GLenum sfactor, GLenum dfactor)
+{
+	if (renderStateValid && state.blendSrc == (GLint)sfactor && state.blendDst == (GLint)dfactor)
+	{
+		elided++;
+		return;
+	}
+
+	issued++;
+	glBlendFunc(sfactor, dfactor);
+	state.blendSrc = (GLint)sfactor;
+	state.blendDst = (GLint)dfactor;
+}
+
+/**
+ * glActiveTexture through the state cache.
+ * @param texture [in] texture unit, GL_TEXTURE0 + n
+ * @ingroup renderState
+ */
+void renderStateActiveTexture(GLenum texture)
+{
+	GLint unit = (GLint)(texture - GL_TEXTURE0);
+	if (renderStateIsCurrent(state.activeUnit, unit))
+	{
+		return;
+	}
+
+	glActiveTexture(texture);
+	state.activeUnit = unit;
+}
+
+/**
+ * glBindTexture through the state cache. Only GL_TEXTURE_2D bindings are tracked.
+ * @ingroup renderState
+ */
+void renderStateBindTexture(GLenum target, GLuint texture)
+{
+	GLint *cached = NULL;
+	if (target == GL_TEXTURE_2D && state.activeUnit >= 0 && state.activeUnit < RENDER_STATE_TEXTURE_UNITS)
+	{
+		cached = &state.texture[state.activeUnit];
+	}
+
+	if (renderStateIsCurrent(cached ? *cached : RENDER_STATE_UNKNOWN, (GLint)texture))
+	{
+		return;
+	}
+
+	glBindTexture(target, texture);
+	if (cached)
+	{
+		*cached = (GLint)texture;
+	}
+}
+
+/**
+ * glUseProgram through the state cache.
+ * @ingroup renderState
+ */
+void renderStateUseProgram(GLuint id)
+{
+	if (renderStateIsCurrent(program, (GLint)id))
+	{
+		return;
+	}
+
+	glUseProgram(id);
+	program = (GLint)id;
+}
+
+/**
+ * Get the current shader program, e.g. to restore it after a temporary change.
+ * OpenGL is queried only if the program is not known.
+ * @ingroup renderState
+ */
+GLuint renderStateGetProgram(void)
+{
+	if (!renderStateValid || program == RENDER_STATE_UNKNOWN)
+	{
+		GLint id = 0;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &id);
+		program = id;
+	}
+
+	return (GLuint)program;
+}
+
+#ifdef SUPPORT_GL_FBO
+/**
+ * glBindFramebuffer through the state cache. Only GL_FRAMEBUFFER bindings are tracked.
+ * @ingroup renderState
+ */
+void renderStateBindFramebuffer(GLenum target, GLuint id)
+{
+	if (target == GL_FRAMEBUFFER && renderStateIsCurrent(framebuffer, (GLint)id))
+	{
+		return;
+	}
+	else if (target != GL_FRAMEBUFFER)
+	{
+		issued++;
+	}
+
+	glBindFramebuffer(target, id);
+	framebuffer = (target == GL_FRAMEBUFFER) ? (GLint)id : RENDER_STATE_UNKNOWN;
+}
+
+/**
+ * Get the current GL_FRAMEBUFFER binding. OpenGL is queried only if the binding is not known.
+ * @ingroup renderState
+ */
+GLuint renderStateGetFramebuffer(void)
+{
+	if (!renderStateValid || framebuffer == RENDER_STATE_UNKNOWN)
+	{
+		GLint id = 0;
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &id);
+		framebuffer = id;
+	}
+
+	return (GLuint)framebuffer;
+}
+#endif
+
+/**
+ * glPushAttrib that also saves the cached state.
+ * @ingroup renderState
+ */
+void renderStatePushAttrib(GLbitfield mask)
+{
+	issued++;
+	glPushAttrib(mask);
+
+	if (attribDepth < RENDER_STATE_ATTRIB_DEPTH)
+	{
+		attribStack[attribDepth] = state;
+		attribStack[attribDepth].mask = mask;
+		attribStack[attribDepth].matrixMode = matrixGetMode();
+	}
+	attribDepth++;
+}
+
+/**
+ * glPopAttrib that restores the cached state saved by the attribute groups of the matching push.
+ * Program and framebuffer bindings are not attribute state and stay as they are.
+ * @ingroup renderState
+ */
+void renderStatePopAttrib(void)
+{
+	issued++;
+	glPopAttrib();
+
+	if (attribDepth == 0)
+	{
+		debugWarningPrintf("renderStatePushAttrib call missing!");
+		renderStateInvalidate();
+		return;
+	}
+
+	attribDepth--;
+	if (attribDepth >= RENDER_STATE_ATTRIB_DEPTH)
+	{
+		//push was not saved
+		renderStateInvalidate();
+		return;
+	}
+
+	const renderStateAttrib_t *saved = &attribStack[attribDepth];
+	GLbitfield mask = saved->mask;
+	int unit, i;
+	for (i = 0; i < RENDER_STATE_CAPS; i++)
+	{
+		if (mask & (GL_ENABLE_BIT | renderStateCaps[i].attrib))
+		{
+			state.enabled[i] = saved->enabled[i];
+		}
+	}
+	for (i = 0; i < RENDER_STATE_UNIT_CAPS; i++)
+	{
+		if (mask & (GL_ENABLE_BIT | renderStateUnitCaps[i].attrib))
+		{
+			for (unit = 0; unit < RENDER_STATE_TEXTURE_UNITS; unit++)
+			{
+				state.unitEnabled[unit][i] = saved->unitEnabled[unit][i];
+			}
+		}
+	}
+	if (mask & GL_COLOR_BUFFER_BIT)
+	{
+		state.blendSrc = saved->blendSrc;
+		state.blendDst = saved->blendDst;
+	}
+	if (mask & GL_TEXTURE_BIT)
+	{
+		state.activeUnit = saved->activeUnit;
+		memcpy(state.texture, saved->texture, sizeof(state.texture));
+	}
+	if (mask & GL_TRANSFORM_BIT)
+	{
+		//OpenGL restored the matrix mode, select the same stack in the matrix tracking
+		matrixMode(saved->matrixMode);
+	}
+}
+
+/**
+ * Start counting calls of a new frame. The cached state is dropped once per frame so that
+ * raw OpenGL calls made outside of the draw paths, e.g. by AntTweakBar or loaders, can't leave it stale.
+ * @ingroup renderState
+ */
+void renderStateFrameBegin(void)
+{
+	snprintf(renderStateSummary, RENDER_STATE_SUMMARY_SIZE,
+		"GL state: %u calls issued, %u elided\n", issued, elided);
+	issued = 0;
+	elided = 0;
+	renderStateInvalidate();
+}
+
+/**
+ * Get issued and elided state call counts of the previous frame as text.
+ * @ingroup renderState
+ */
+const char* renderStateGetSummary(void)
+{
+	return renderStateSummary;
+}
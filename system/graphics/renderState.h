@@ -0,0 +1,38 @@
+#ifndef EXH_SYSTEM_GRAPHICS_RENDERSTATE_H_
+#define EXH_SYSTEM_GRAPHICS_RENDERSTATE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "graphicsIncludes.h"
+
+#define RENDER_STATE_TEXTURE_UNITS 8
+#define RENDER_STATE_ATTRIB_DEPTH 16
+
+extern void renderStateInit(void);
+extern void renderStateInvalidate(void);
+extern void renderStateInvalidateTextures(void);
+extern void renderStateEnable(GLenum cap);
+extern void renderStateDisable(GLenum cap);
+extern GLboolean renderStateIsEnabled(GLenum cap);
+extern void renderStateBlendFunc(GLenum sfactor, GLenum dfactor);
+extern void renderStateActiveTexture(GLenum texture);
+extern void renderStateBindTexture(GLenum target, GLuint texture);
+extern void renderStateUseProgram(GLuint program);
+extern GLuint renderStateGetProgram(void);
+#ifdef SUPPORT_GL_FBO
+extern void renderStateBindFramebuffer(GLenum target, GLuint framebuffer);
+extern GLuint renderStateGetFramebuffer(void);
+#endif
+extern void renderStatePushAttrib(GLbitfield mask);
+extern void renderStatePopAttrib(void);
+extern void renderStateFrameBegin(void);
+extern const char* renderStateGetSummary(void);
+
+#ifdef __cplusplus
+/* end 'extern "C"' wrapper */
+}
+#endif
+
+#endif /*EXH_SYSTEM_GRAPHICS_RENDERSTATE_H_*/
@@ -7,6 +7,7 @@
 #include <graphicsIncludes.h>
 #include "system/graphics/graphics.h"
 #include "system/io/io.h"
+#include "system/io/fileWatch.h"
 #include "system/debug/debug.h"
 #include "system/extensions/gl/gl.h"
 #include "system/player/player.h"
@@ -14,6 +15,7 @@
 #include "system/ui/window/window.h"
 #include "system/thread/thread.h"
 #include "system/datatypes/memory.h"
+#include "system/datatypes/string.h"
 
 #include "shader.h"
 
@@ -21,8 +23,24 @@
 #define FRAGMENT_SHADER 2
 #define GEOMETRY_SHADER 3
 
+#define UNIFORM_LOCATION_UNRESOLVED -2
+
+#define SHADER_CACHE_DIRECTORY "shadercache"
+#define SHADER_CACHE_MAGIC 0x4250484A
+#define SHADER_CACHE_PATH_SIZE 1024
+
 static shaderProgram_t *activeShaderProgram = NULL;
 
+/* nesting depth of shaderCompileBatchBegin() calls, the outermost shaderCompileBatchEnd() checks the batch */
+static unsigned int shaderBatchDepth = 0;
+static shader_t **shaderBatchShaders = NULL;
+static unsigned int shaderBatchShadersCount = 0;
+static shaderProgram_t **shaderBatchPrograms = NULL;
+static unsigned int shaderBatchProgramsCount = 0;
+
+static int shaderCompileStatus(shader_t *shader);
+static void shaderCompileIfPending(shader_t *shader);
+
 static int getShaderType(const char *filename)
 {
 	if (endsWithIgnoreCase(filename, ".vs"))
@@ -101,6 +119,7 @@ void shaderProgramAttachShader(shaderProgram_t *shaderProgram, shader_t *shader)
 	{
 		shaderProgramCreateId(shaderProgram);
 	}
+	shaderCompileIfPending(shader);
 	//debugPrintf("Shader program '%s' adding shader '%p'!",shaderProgram->name,shader);
 	if (shader->id == 0)
 	{
@@ -210,6 +229,171 @@ static int shaderProgramLinkStatus(shaderProgram_t *shaderProgram)
 	return 1;
 }
 
+#ifdef SUPPORT_GL_PROGRAM_BINARY
+/**
+ * Program binaries are cached by attached shader sources and the driver, a driver update invalidates the cache.
+ * @return cache key or 0 if the program can not be cached
+ */
+static unsigned long long shaderProgramCacheKey(shaderProgram_t *shaderProgram)
+{
+	const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+
+	unsigned long long hash = HASH_FNV1A64_INIT;
+	unsigned int i;
+	for (i = 0; i < sizeof(driverStrings)/sizeof(GLenum); i++)
+	{
+		const char *driverString = (const char*)glGetString(driverStrings[i]);
+		if (driverString)
+		{
+			hash = hashFnv1a64(driverString, strlen(driverString), hash);
+		}
+	}
+
+	for (i = 0; i < shaderProgram->attachedShadersCount; i++)
+	{
+		shader_t *shader = shaderProgram->attachedShaders[i];
+		if (shader->sourceHash == 0)
+		{
+			return 0;
+		}
+
+		hash = hashFnv1a64(&shader->sourceHash, sizeof(shader->sourceHash), hash);
+		hash = hashFnv1a64(&shader->type, sizeof(shader->type), hash);
+	}
+
+	return hash;
+}
+
+static void shaderProgramCachePath(char *path, unsigned long long key)
+{
+	snprintf(path, SHADER_CACHE_PATH_SIZE, "%s%s/%016llx.bin", getStartPath(), SHADER_CACHE_DIRECTORY, key);
+}
+#endif
+
+static int shaderProgramLoadBinary(shaderProgram_t *shaderProgram)
+{
+#ifdef SUPPORT_GL_PROGRAM_BINARY
+	if (!openGlHasProgramBinary() || shaderProgram->attachedShadersCount == 0)
+	{
+		return 0;
+	}
+
+	unsigned long long key = shaderProgramCacheKey(shaderProgram);
+	if (key == 0)
+	{
+		return 0;
+	}
+
+	char path[SHADER_CACHE_PATH_SIZE];
+	shaderProgramCachePath(path, key);
+
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		return 0;
+	}
+
+	unsigned int header[3] = {0, 0, 0}; //magic, format, length
+	void *binary = NULL;
+	if (fread(header, sizeof(header), 1, file) == 1 && header[0] == SHADER_CACHE_MAGIC && header[2] > 0)
+	{
+		binary = malloc(header[2]);
+		assert(binary);
+		if (fread(binary, header[2], 1, file) != 1)
+		{
+			free(binary);
+			binary = NULL;
+		}
+	}
+	fclose(file);
+
+	if (binary == NULL)
+	{
+		debugWarningPrintf("Shader program cache file '%s' is corrupted", path);
+		remove(path);
+		return 0;
+	}
+
+	if (shaderProgram->id == 0)
+	{
+		shaderProgramCreateId(shaderProgram);
+	}
+
+	glProgramBinary(shaderProgram->id, (GLenum)header[1], binary, (GLsizei)header[2]);
+	free(binary);
+
+	int linkStatus = GL_FALSE;
+	glGetProgramiv(shaderProgram->id, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus == GL_FALSE)
+	{
+		//driver may reject binaries even if the driver strings match
+		debugWarningPrintf("Shader program cache of '%s' was rejected, recompiling", shaderProgram->name);
+		remove(path);
+		return 0;
+	}
+
+	shaderProgramInvalidateUniforms(shaderProgram);
+	shaderProgram->ok = 1;
+
+	debugPrintf("Loaded shader program '%s' (%d) from cache '%s'", shaderProgram->name, shaderProgram->id, path);
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+static void shaderProgramSaveBinary(shaderProgram_t *shaderProgram)
+{
+#ifdef SUPPORT_GL_PROGRAM_BINARY
+	if (!openGlHasProgramBinary() || !shaderProgram->ok)
+	{
+		return;
+	}
+
+	unsigned long long key = shaderProgramCacheKey(shaderProgram);
+	if (key == 0)
+	{
+		return;
+	}
+
+	int length = 0;
+	glGetProgramiv(shaderProgram->id, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+
+	void *binary = malloc(length);
+	assert(binary);
+
+	GLsizei written = 0;
+	GLenum format = 0;
+	glGetProgramBinary(shaderProgram->id, length, &written, &format, binary);
+
+	char path[SHADER_CACHE_PATH_SIZE];
+	snprintf(path, SHADER_CACHE_PATH_SIZE, "%s%s", getStartPath(), SHADER_CACHE_DIRECTORY);
+
+	FILE *file = NULL;
+	if (written > 0 && ioMakeDirectory(path))
+	{
+		shaderProgramCachePath(path, key);
+		file = fopen(path, "wb");
+	}
+
+	if (file)
+	{
+		unsigned int header[3] = {SHADER_CACHE_MAGIC, (unsigned int)format, (unsigned int)written};
+		if (fwrite(header, sizeof(header), 1, file) != 1 || fwrite(binary, written, 1, file) != 1)
+		{
+			debugWarningPrintf("Could not write shader program cache '%s'", path);
+		}
+		fclose(file);
+	}
+
+	free(binary);
+#endif
+}
+
 void shaderProgramLink(shaderProgram_t *shaderProgram)
 {
 	if (shaderProgram == NULL)
@@ -224,8 +408,31 @@ void shaderProgramLink(shaderProgram_t *shaderProgram)
 	}
 
 	debugPrintf("Linking '%s' (%d) (attached shaders:%d)", shaderProgram->name, shaderProgram->id, shaderProgram->attachedShadersCount);
+#ifdef SUPPORT_GL_PROGRAM_BINARY
+	if (openGlHasProgramBinary())
+	{
+		glProgramParameteri(shaderProgram->id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+#endif
 	glLinkProgram(shaderProgram->id);
-	shaderProgramLinkStatus(shaderProgram);
+
+	//uniform locations are not guaranteed to survive a relink (e.g. hot reload)
+	shaderProgramInvalidateUniforms(shaderProgram);
+
+	if (shaderBatchDepth > 0)
+	{
+		//link status is checked in shaderCompileBatchEnd() so that the driver can link in parallel
+		shaderBatchProgramsCount++;
+		shaderBatchPrograms = (shaderProgram_t**)realloc(shaderBatchPrograms, sizeof(shaderProgram_t*)*shaderBatchProgramsCount);
+		assert(shaderBatchPrograms);
+		shaderBatchPrograms[shaderBatchProgramsCount-1] = shaderProgram;
+		return;
+	}
+
+	if (shaderProgramLinkStatus(shaderProgram))
+	{
+		shaderProgramSaveBinary(shaderProgram);
+	}
 
 	//glUseProgram(shaderProgram->id);
 	//printOpenGlShaderProgramInfo(shaderProgram->id);
@@ -235,16 +442,213 @@ void shaderProgramAttachAndLink(shaderProgram_t *shaderProgram)
 {
 	assert(shaderProgram);
 
+	if (shaderProgramLoadBinary(shaderProgram))
+	{
+		return;
+	}
+
 	//debugPrintf("%d Attaching %d shaders to program '%s'", i, shaderPrograms[i].attachedShadersCount, shaderPrograms[i].name);
 	shaderProgramAttachShaders(shaderProgram);
 	//debugPrintf("%d Linking shaders to program '%s'", i, shaderPrograms[i].name);
 	shaderProgramLink(shaderProgram);
-	shaderProgramDetachShaders(shaderProgram);
+	if (shaderBatchDepth == 0)
+	{
+		shaderProgramDetachShaders(shaderProgram);
+	}
+}
+
+/**
+ * Start batch compilation. Shader compiles are issued when the shaders are attached to a program
+ * and compile/link status checks are postponed to shaderCompileBatchEnd().
+ * This lets drivers with parallel shader compilation overlap the compiles.
+ * Shaders that are not attached to a program during the batch are compiled on first use.
+ */
+void shaderCompileBatchBegin(void)
+{
+	shaderBatchDepth++;
+}
+
+/**
+ * Check compile and link status of all shaders and programs issued during the batch.
+ * Batches nest, the status is checked only when the outermost batch ends.
+ */
+void shaderCompileBatchEnd(void)
+{
+	if (shaderBatchDepth == 0)
+	{
+		debugWarningPrintf("shaderCompileBatchBegin call missing!");
+		return;
+	}
+
+	shaderBatchDepth--;
+	if (shaderBatchDepth > 0)
+	{
+		return;
+	}
+
+	unsigned int i;
+	for (i = 0; i < shaderBatchShadersCount; i++)
+	{
+		shaderBatchShaders[i]->statusPending = 0;
+		shaderCompileStatus(shaderBatchShaders[i]);
+	}
+
+	for (i = 0; i < shaderBatchProgramsCount; i++)
+	{
+		shaderProgram_t *shaderProgram = shaderBatchPrograms[i];
+		if (shaderProgramLinkStatus(shaderProgram))
+		{
+			shaderProgramSaveBinary(shaderProgram);
+		}
+		shaderProgramDetachShaders(shaderProgram);
+	}
+
+	debugPrintf("Shader batch done, shaders compiled: %u, programs linked: %u", shaderBatchShadersCount, shaderBatchProgramsCount);
+
+	free(shaderBatchShaders);
+	shaderBatchShaders = NULL;
+	shaderBatchShadersCount = 0;
+	free(shaderBatchPrograms);
+	shaderBatchPrograms = NULL;
+	shaderBatchProgramsCount = 0;
 }
 
 unsigned int getUniformLocation(const char *variable)
 {
-	return glGetUniformLocation(activeShaderProgram->id, variable);
+	assert(activeShaderProgram);
+
+	return (unsigned int)shaderProgramGetUniformLocation(activeShaderProgram,
+		shaderProgramAddUniform(activeShaderProgram, variable));
+}
+
+/**
+ * Register a uniform variable to the uniform location cache of the shader program.
+ * Uniform index stays valid over relinks, the location is resolved lazily.
+ * @param shaderProgram [in] shader program
+ * @param name [in] uniform variable name
+ * @return uniform index for shaderProgramGetUniformLocation() and shaderProgramSetUniforms()
+ */
+int shaderProgramAddUniform(shaderProgram_t *shaderProgram, const char *name)
+{
+	assert(shaderProgram);
+	assert(name);
+
+	unsigned int i;
+	for (i = 0; i < shaderProgram->uniformsCount; i++)
+	{
+		if (!strcmp(shaderProgram->uniforms[i].name, name))
+		{
+			return i;
+		}
+	}
+
+	shaderProgram->uniformsCount++;
+	shaderProgram->uniforms = (shaderUniform_t*)realloc(shaderProgram->uniforms, sizeof(shaderUniform_t)*shaderProgram->uniformsCount);
+	assert(shaderProgram->uniforms);
+
+	shaderUniform_t *uniform = &shaderProgram->uniforms[shaderProgram->uniformsCount-1];
+	uniform->name = strdup(name);
+	assert(uniform->name);
+	uniform->location = UNIFORM_LOCATION_UNRESOLVED;
+
+	return shaderProgram->uniformsCount-1;
+}
+
+int shaderProgramGetUniformLocation(shaderProgram_t *shaderProgram, unsigned int uniformIndex)
+{
+	assert(shaderProgram);
+
+	if (uniformIndex >= shaderProgram->uniformsCount)
+	{
+		debugErrorPrintf("Uniform index '%u' out of bounds in shader program '%s'", uniformIndex, shaderProgram->name);
+		return -1;
+	}
+
+	shaderUniform_t *uniform = &shaderProgram->uniforms[uniformIndex];
+	if (uniform->location == UNIFORM_LOCATION_UNRESOLVED)
+	{
+		uniform->location = glGetUniformLocation(shaderProgram->id, uniform->name);
+	}
+
+	return uniform->location;
+}
+
+void shaderProgramInvalidateUniforms(shaderProgram_t *shaderProgram)
+{
+	assert(shaderProgram);
+
+	unsigned int i;
+	for (i = 0; i < shaderProgram->uniformsCount; i++)
+	{
+		shaderProgram->uniforms[i].location = UNIFORM_LOCATION_UNRESOLVED;
+	}
+}
+
+/**
+ * Set uniform values of the active shader program from packed records.
+ * Each record is SHADER_UNIFORM_RECORD_SIZE floats: uniform index, type (SHADER_UNIFORM_TYPE_FLOAT/INT),
+ * component count (1-4) and four values.
+ * @param shaderProgram [in] shader program, must be in use
+ * @param records [in] packed records
+ * @param recordsCount [in] record count
+ */
+void shaderProgramSetUniforms(shaderProgram_t *shaderProgram, const float *records, unsigned int recordsCount)
+{
+	assert(shaderProgram);
+	assert(records || recordsCount == 0);
+
+	unsigned int i;
+	for (i = 0; i < recordsCount; i++)
+	{
+		const float *record = &records[i*SHADER_UNIFORM_RECORD_SIZE];
+		int location = shaderProgramGetUniformLocation(shaderProgram, (unsigned int)record[0]);
+		if (location < 0)
+		{
+			continue;
+		}
+
+		const float *v = &record[3];
+		if ((int)record[1] == SHADER_UNIFORM_TYPE_INT)
+		{
+			switch((int)record[2])
+			{
+				case 4:
+					glUniform4i(location, (int)v[0], (int)v[1], (int)v[2], (int)v[3]);
+					break;
+				case 3:
+					glUniform3i(location, (int)v[0], (int)v[1], (int)v[2]);
+					break;
+				case 2:
+					glUniform2i(location, (int)v[0], (int)v[1]);
+					break;
+				case 1:
+					glUniform1i(location, (int)v[0]);
+					break;
+				default:
+					break;
+			}
+		}
+		else
+		{
+			switch((int)record[2])
+			{
+				case 4:
+					glUniform4f(location, v[0], v[1], v[2], v[3]);
+					break;
+				case 3:
+					glUniform3f(location, v[0], v[1], v[2]);
+					break;
+				case 2:
+					glUniform2f(location, v[0], v[1]);
+					break;
+				case 1:
+					glUniform1f(location, v[0]);
+					break;
+				default:
+					break;
+			}
+		}
+	}
 }
 
 void shaderProgramUse(shaderProgram_t *shaderProgram)
@@ -253,11 +657,11 @@ void shaderProgramUse(shaderProgram_t *shaderProgram)
 
 	if (shaderProgram == NULL)
 	{
-		glUseProgram(0); //disable shader
+		renderStateUseProgram(0); //disable shader
 		return;
 	}
 
-	glUseProgram(shaderProgram->id);
+	renderStateUseProgram(shaderProgram->id);
 }
 
 void disableShaderProgram()
@@ -346,17 +750,55 @@ int shaderCompile(shader_t *shader)
 
 	unsigned int fileSize = 0;
 	const char *shaderSource = (const char*)ioReadFileToBuffer(shader->filename, &fileSize);
-	
+	if (shaderSource == NULL)
+	{
+		debugErrorPrintf("Could not read shader '%s'", shader->filename);
+		shader->sourceHash = 0;
+		return 0;
+	}
+
+	shader->sourceHash = hashFnv1a64(shaderSource, fileSize, HASH_FNV1A64_INIT);
+
 	glShaderSource(shader->id, 1, &shaderSource, NULL);
 	free((void*)shaderSource);
-	
-	glCompileShader(shader->id);
+
+	//compile is postponed until the shader is needed, if cached program binary is found then the shader is never compiled
+	shader->compilePending = 1;
+
+	if (shaderBatchDepth == 0)
+	{
+		shaderCompileIfPending(shader);
+	}
 
 	//debugPrintf("Shader '%s' (%d) compiled! type:'%d'", shader->name, shader->id, shader->type);
 
 	return 1;
 }
 
+static void shaderCompileIfPending(shader_t *shader)
+{
+	if (!shader->compilePending)
+	{
+		return;
+	}
+
+	shader->compilePending = 0;
+	glCompileShader(shader->id);
+
+	if (shaderBatchDepth > 0)
+	{
+		shader->statusPending = 1;
+		shaderBatchShadersCount++;
+		shaderBatchShaders = (shader_t**)realloc(shaderBatchShaders, sizeof(shader_t*)*shaderBatchShadersCount);
+		assert(shaderBatchShaders);
+		shaderBatchShaders[shaderBatchShadersCount-1] = shader;
+	}
+	else
+	{
+		shaderCompileStatus(shader);
+	}
+}
+
 shader_t *shaderLoad(const char *name, const char *_filename)
 {
 	shader_t *shader = getShaderFromMemory(name);
@@ -368,12 +810,17 @@ shader_t *shaderLoad(const char *name, const char *_filename)
 		}
 		else
 		{
+			if (shaderBatchDepth == 0)
+			{
+				shaderCompileIfPending(shader);
+			}
 			return shader;
 		}
 	}
 	else
 	{
 		shader = memoryAllocateShader(NULL);
+		shader->fileChanged = 0;
 	}
 
 	shader->name = strdup(name);
@@ -383,13 +830,16 @@ shader_t *shaderLoad(const char *name, const char *_filename)
 	shader->id = 0;
 	shader->type = 0;
 	shader->ok = 0;
+	shader->compilePending = 0;
+	shader->statusPending = 0;
+	shader->sourceHash = 0;
 
 	fileModified(shader->filename, &shader->fileLastModifiedTime);
+	fileWatchAdd(shader->filename, shaderFileChanged, shader);
 
 	debugPrintf("Loading shader '%s'. filename:'%s'", shader->name, shader->filename);
 
 	shaderCompile(shader);
-	shaderCompileStatus(shader);
 
 	return shader;
 }
@@ -397,6 +847,7 @@ shader_t *shaderLoad(const char *name, const char *_filename)
 void shaderDeinit(shader_t* shader)
 {
 	assert(shader);
+	fileWatchRemove(shader);
 	glDeleteShader(shader->id);
 	shader->id = 0;
 	free(shader->name);
@@ -418,6 +869,8 @@ shaderProgram_t *shaderProgramLoad(const char *name)
 	shaderProgram->id = 0;
 	shaderProgram->attachedShaders = NULL;
 	shaderProgram->attachedShadersCount = 0;
+	shaderProgram->uniforms = NULL;
+	shaderProgram->uniformsCount = 0;
 	shaderProgram->name = strdup(name);
 	assert(shaderProgram->name);
 
@@ -436,5 +889,15 @@ void shaderProgramDeinit(shaderProgram_t* shaderProgram)
 	glDeleteProgram(shaderProgram->id);
 	shaderProgram->id = 0;
 	free(shaderProgram->attachedShaders);
+
+	unsigned int i;
+	for (i = 0; i < shaderProgram->uniformsCount; i++)
+	{
+		free(shaderProgram->uniforms[i].name);
+	}
+	free(shaderProgram->uniforms);
+	shaderProgram->uniforms = NULL;
+	shaderProgram->uniformsCount = 0;
+
 	free(shaderProgram->name);
 }
@@ -7,14 +7,31 @@ typedef struct {
 	unsigned int id;
 	int type;
 	int ok;
+	int compilePending;
+	int statusPending;
+	unsigned long long sourceHash;
 	time_t fileLastModifiedTime;
+	/* set by the file watch, the shader is reloaded on the next refresh */
+	int fileChanged;
 } shader_t;
 
+#define SHADER_UNIFORM_TYPE_FLOAT 0
+#define SHADER_UNIFORM_TYPE_INT 1
+/* packed uniform record: index, type, component count, 4 values */
+#define SHADER_UNIFORM_RECORD_SIZE 7
+
+typedef struct {
+	char *name;
+	int location;
+} shaderUniform_t;
+
 typedef struct {
 	char *name;
 	unsigned int id;
 	shader_t **attachedShaders;
 	unsigned int attachedShadersCount;
+	shaderUniform_t *uniforms;
+	unsigned int uniformsCount;
 	int ok;
 } shaderProgram_t;
 
@@ -25,6 +42,9 @@ extern void shaderProgramUse(shaderProgram_t *shaderProgram);
 
 extern void shaderProgramAttachAndLink(shaderProgram_t *shaderProgram);
 
+extern void shaderCompileBatchBegin(void);
+extern void shaderCompileBatchEnd(void);
+
 extern void shaderProgramCreateId(shaderProgram_t *shaderProgram);
 extern shaderProgram_t *shaderProgramLoad(const char *name);
 extern void shaderProgramDeinit(shaderProgram_t* shaderProgram);
@@ -32,6 +52,10 @@ extern shader_t *shaderLoad(const char *name, const char *_filename);
 extern void shaderDeinit(shader_t* shader);
 
 extern unsigned int getUniformLocation(const char *variable);
+extern int shaderProgramAddUniform(shaderProgram_t *shaderProgram, const char *name);
+extern int shaderProgramGetUniformLocation(shaderProgram_t *shaderProgram, unsigned int uniformIndex);
+extern void shaderProgramInvalidateUniforms(shaderProgram_t *shaderProgram);
+extern void shaderProgramSetUniforms(shaderProgram_t *shaderProgram, const float *records, unsigned int recordsCount);
 
 extern void disableShaderProgram();
 extern void activateShaderProgram(const char *name);
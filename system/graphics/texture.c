@@ -3,6 +3,8 @@
 #include "graphicsIncludes.h"
 #include "system/ui/window/window.h"
 #include "system/datatypes/memory.h"
+#include "system/graphics/renderState.h"
+#include "system/io/fileWatch.h"
 
 #include "texture.h"
  
@@ -68,6 +70,7 @@ texture_t* textureInit(texture_t *texture)
 void textureDeinit(texture_t *texture)
 {
 	assert(texture);
+	fileWatchRemove(texture);
 	if (texture->id == 0) {
 		return;
 	}
@@ -360,9 +363,9 @@ void setTextureDefaults(texture_t *texture)
 void drawTexture(texture_t *texture)
 {
 	//glBlendFuncSeparate(texture->srcBlend, texture->dstBlend, GL_ONE, GL_SRC_ALPHA);
-	glBlendFunc(texture->srcBlend, texture->dstBlend);
-	glEnable(GL_BLEND);
-	glEnable(GL_TEXTURE_2D);
+	renderStateBlendFunc(texture->srcBlend, texture->dstBlend);
+	renderStateEnable(GL_BLEND);
+	renderStateEnable(GL_TEXTURE_2D);
 
 	int i;
 	for(i=MAX_TEXTURE_UNITS-1; i >= 0; i--)
@@ -373,9 +376,9 @@ void drawTexture(texture_t *texture)
 			continue;
 		}
 
-		glActiveTexture(GL_TEXTURE0 + i);
-		glEnable(GL_TEXTURE_2D);
-		glBindTexture(GL_TEXTURE_2D, texture->multiTextureId[i]);
+		renderStateActiveTexture(GL_TEXTURE0 + i);
+		renderStateEnable(GL_TEXTURE_2D);
+		renderStateBindTexture(GL_TEXTURE_2D, texture->multiTextureId[i]);
 	}
 
 	//glBindTexture(GL_TEXTURE_2D, texture->id);
@@ -429,22 +432,22 @@ void drawTexture(texture_t *texture)
 		}
 	}
 	
-	glPushMatrix();
+	matrixPush();
 	double pivotX = (w/2.0+texture->pivotX/texture->scaleW);
 	double pivotY = (h/2.0+texture->pivotY/texture->scaleH);
 	double pivotZ = texture->pivotZ;
 
-	glTranslated(x, y, z);
+	matrixTranslate(x, y, z);
 
-	glScalef(texture->scaleW, texture->scaleH, 1.0);
+	matrixScale(texture->scaleW, texture->scaleH, 1.0);
 
-	glTranslated(pivotX, pivotY, pivotZ);
+	matrixTranslate(pivotX, pivotY, pivotZ);
 
-	glRotated(texture->degreesX, -texture->angleX,                0,                0);
-	glRotated(texture->degreesY,                0, -texture->angleY,                0);
-	glRotated(texture->degreesZ,                0,                0, -texture->angleZ);
+	matrixRotate(texture->degreesX, -texture->angleX,                0,                0);
+	matrixRotate(texture->degreesY,                0, -texture->angleY,                0);
+	matrixRotate(texture->degreesZ,                0,                0, -texture->angleZ);
 
-	glTranslated(-pivotX, -pivotY, -pivotZ);
+	matrixTranslate(-pivotX, -pivotY, -pivotZ);
 
 	glBegin(GL_QUADS);
 	glMultiTexCoord2f(GL_TEXTURE0, texture->uMax,texture->vMax);
@@ -456,7 +459,7 @@ void drawTexture(texture_t *texture)
 	glMultiTexCoord2f(GL_TEXTURE0, texture->uMax,texture->vMin);
 	glVertex3d(w,0,0);
 	glEnd();
-	glPopMatrix();
+	matrixPop();
 
 	if (!texture->perspective3d)
 	{
@@ -471,13 +474,13 @@ void drawTexture(texture_t *texture)
 			continue;
 		}
 
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, 0);
-		glDisable(GL_TEXTURE_2D);
+		//binding is left in place so that drawing the same texture again doesn't rebind it
+		renderStateActiveTexture(GL_TEXTURE0 + i);
+		renderStateDisable(GL_TEXTURE_2D);
 	}
 
 	//glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_SRC_ALPHA);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_BLEND);
-	glDisable(GL_TEXTURE_2D);
+	renderStateBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	renderStateDisable(GL_BLEND);
+	renderStateDisable(GL_TEXTURE_2D);
 }
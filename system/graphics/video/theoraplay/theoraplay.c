@@ -19,13 +19,16 @@
 #include <windows.h>
 #define THEORAPLAY_THREAD_T    HANDLE
 #define THEORAPLAY_MUTEX_T     HANDLE
+#define THEORAPLAY_COND_T      int
 #define sleepms(x) Sleep(x)
 #else
 #include <pthread.h>
 #include <unistd.h>
+#include <sys/time.h>
 #define sleepms(x) usleep((x) * 1000)
 #define THEORAPLAY_THREAD_T    pthread_t
 #define THEORAPLAY_MUTEX_T     pthread_mutex_t
+#define THEORAPLAY_COND_T      pthread_cond_t
 #endif
 
 #include "theoraplay.h"
@@ -39,11 +42,14 @@ typedef THEORAPLAY_AudioPacket AudioPacket;
 
 // !!! FIXME: these all count on the pixel format being TH_PF_420 for now.
 
-typedef unsigned char *(*ConvertVideoFrameFn)(const th_info *tinfo,
-                                              const th_ycbcr_buffer ycbcr);
+// Converters write to a buffer of FrameSize() bytes.
+typedef void (*ConvertVideoFrameFn)(const th_info *tinfo,
+                                    const th_ycbcr_buffer ycbcr,
+                                    unsigned char *pixels);
 
-static unsigned char *ConvertVideoFrame420ToYUVPlanar(
+static void ConvertVideoFrame420ToYUVPlanar(
                             const th_info *tinfo, const th_ycbcr_buffer ycbcr,
+                            unsigned char *yuv,
                             const int p0, const int p1, const int p2)
 {
     int i;
@@ -51,56 +57,93 @@ static unsigned char *ConvertVideoFrame420ToYUVPlanar(
     const int h = tinfo->pic_height;
     const int yoff = (tinfo->pic_x & ~1) + ycbcr[0].stride * (tinfo->pic_y & ~1);
     const int uvoff = (tinfo->pic_x / 2) + (ycbcr[1].stride) * (tinfo->pic_y / 2);
-    unsigned char *yuv = (unsigned char *) malloc(w * h * 2);
-    if (yuv)
-    {
-        unsigned char *dst = yuv;
-        for (i = 0; i < h; i++, dst += w)
-            memcpy(dst, ycbcr[p0].data + yoff + ycbcr[p0].stride * i, w);
-        for (i = 0; i < (h / 2); i++, dst += w/2)
-            memcpy(dst, ycbcr[p1].data + uvoff + ycbcr[p1].stride * i, w / 2);
-        for (i = 0; i < (h / 2); i++, dst += w/2)
-            memcpy(dst, ycbcr[p2].data + uvoff + ycbcr[p2].stride * i, w / 2);
-    } // if
-
-    return yuv;
+    unsigned char *dst = yuv;
+    for (i = 0; i < h; i++, dst += w)
+        memcpy(dst, ycbcr[p0].data + yoff + ycbcr[p0].stride * i, w);
+    for (i = 0; i < (h / 2); i++, dst += w/2)
+        memcpy(dst, ycbcr[p1].data + uvoff + ycbcr[p1].stride * i, w / 2);
+    for (i = 0; i < (h / 2); i++, dst += w/2)
+        memcpy(dst, ycbcr[p2].data + uvoff + ycbcr[p2].stride * i, w / 2);
 } // ConvertVideoFrame420ToYUVPlanar
 
 
-static unsigned char *ConvertVideoFrame420ToYV12(const th_info *tinfo,
-                                                 const th_ycbcr_buffer ycbcr)
+static void ConvertVideoFrame420ToYV12(const th_info *tinfo,
+                                       const th_ycbcr_buffer ycbcr,
+                                       unsigned char *pixels)
 {
-    return ConvertVideoFrame420ToYUVPlanar(tinfo, ycbcr, 0, 2, 1);
+    ConvertVideoFrame420ToYUVPlanar(tinfo, ycbcr, pixels, 0, 2, 1);
 } // ConvertVideoFrame420ToYV12
 
 
-static unsigned char *ConvertVideoFrame420ToIYUV(const th_info *tinfo,
-                                                 const th_ycbcr_buffer ycbcr)
+static void ConvertVideoFrame420ToIYUV(const th_info *tinfo,
+                                       const th_ycbcr_buffer ycbcr,
+                                       unsigned char *pixels)
 {
-    return ConvertVideoFrame420ToYUVPlanar(tinfo, ycbcr, 0, 1, 2);
+    ConvertVideoFrame420ToYUVPlanar(tinfo, ycbcr, pixels, 0, 1, 2);
 } // ConvertVideoFrame420ToIYUV
 
 
 // RGB
 #define THEORAPLAY_CVT_FNNAME_420 ConvertVideoFrame420ToRGB
+#define THEORAPLAY_CVT_FNNAME_420_REFERENCE ConvertVideoFrame420ToRGBReference
 #define THEORAPLAY_CVT_RGB_ALPHA 0
 #include "theoraplay_cvtrgb.h"
 #undef THEORAPLAY_CVT_RGB_ALPHA
+#undef THEORAPLAY_CVT_FNNAME_420_REFERENCE
 #undef THEORAPLAY_CVT_FNNAME_420
 
 // RGBA
 #define THEORAPLAY_CVT_FNNAME_420 ConvertVideoFrame420ToRGBA
+#define THEORAPLAY_CVT_FNNAME_420_REFERENCE ConvertVideoFrame420ToRGBAReference
 #define THEORAPLAY_CVT_RGB_ALPHA 1
 #include "theoraplay_cvtrgb.h"
 #undef THEORAPLAY_CVT_RGB_ALPHA
+#undef THEORAPLAY_CVT_FNNAME_420_REFERENCE
 #undef THEORAPLAY_CVT_FNNAME_420
 
 
+static size_t FrameSize(const THEORAPLAY_VideoFormat vidfmt,
+                        const unsigned int w, const unsigned int h)
+{
+    switch (vidfmt)
+    {
+        case THEORAPLAY_VIDFMT_RGB: return (size_t) w * h * 3;
+        case THEORAPLAY_VIDFMT_RGBA: return (size_t) w * h * 4;
+        default: return (size_t) w * h * 2;  // planar YUV.
+    } // switch
+} // FrameSize
+
+
+// Decoded frames are recycled instead of allocating the frame and its
+//  pixels for every frame. A frame and its pixels are a single allocation.
+//  The pool outlives the decoder if the app still holds frames, it is
+//  freed when the decoder and all of its frames have been released.
+#define THEORAPLAY_FRAME_POOL_SIZE 8
+
+typedef struct FramePool FramePool;
+
+typedef struct PooledVideoFrame
+{
+    VideoFrame frame;  // first, the app sees only this.
+    FramePool *pool;
+    struct PooledVideoFrame *nextfree;
+} PooledVideoFrame;
+
+struct FramePool
+{
+    THEORAPLAY_MUTEX_T lock;
+    unsigned int refcount;  // the decoder and its frames.
+    size_t pixelsize;
+    unsigned int freecount;
+    PooledVideoFrame *freelist;
+};
+
 typedef struct TheoraDecoder
 {
     // Thread wrangling...
     int thread_created;
     THEORAPLAY_MUTEX_T lock;
+    THEORAPLAY_COND_T cond;  // broadcast when any of the state below changes.
     volatile int halt;
     volatile int pause;
     int thread_done;
@@ -117,9 +160,14 @@ typedef struct TheoraDecoder
     volatile int decode_error;
     volatile long int streamdecodecursor;
     double decodetime;
+    int at_eos;  // worker is waiting for a seek at the end of the stream.
+    unsigned int seekrequest;  // incremented by THEORAPLAY_seek().
+    double seektime;
+    char *indexfname;  // cache file of the seek index, or NULL.
 
     THEORAPLAY_VideoFormat vidfmt;
     ConvertVideoFrameFn vidcvt;
+    FramePool *framepool;
 
     VideoFrame *videolist;
     VideoFrame *videolisttail;
@@ -147,22 +195,45 @@ static inline void Thread_Join(THEORAPLAY_THREAD_T thread)
     WaitForSingleObject(thread, INFINITE);
     CloseHandle(thread);
 }
-static inline int Mutex_Create(TheoraDecoder *ctx)
+static inline int Mutex_Create(THEORAPLAY_MUTEX_T *mutex)
 {
-    ctx->lock = CreateMutex(NULL, FALSE, NULL);
-    return (ctx->lock == NULL);
+    *mutex = CreateMutex(NULL, FALSE, NULL);
+    return (*mutex == NULL);
 }
-static inline void Mutex_Destroy(THEORAPLAY_MUTEX_T mutex)
+static inline void Mutex_Destroy(THEORAPLAY_MUTEX_T *mutex)
 {
-    CloseHandle(mutex);
+    CloseHandle(*mutex);
 }
-static inline void Mutex_Lock(THEORAPLAY_MUTEX_T mutex)
+static inline void Mutex_Lock(THEORAPLAY_MUTEX_T *mutex)
 {
-    WaitForSingleObject(mutex, INFINITE);
+    WaitForSingleObject(*mutex, INFINITE);
 }
-static inline void Mutex_Unlock(THEORAPLAY_MUTEX_T mutex)
+static inline void Mutex_Unlock(THEORAPLAY_MUTEX_T *mutex)
 {
-    ReleaseMutex(mutex);
+    ReleaseMutex(*mutex);
+}
+// condition variables need Vista, we still build for XP. Waits poll the
+//  state every 10ms instead, the callers check it in a loop anyway.
+static inline int Cond_Create(THEORAPLAY_COND_T *cond)
+{
+    *cond = 0;
+    return 0;
+}
+static inline void Cond_Destroy(THEORAPLAY_COND_T *cond)
+{
+}
+static inline void Cond_Broadcast(THEORAPLAY_COND_T *cond)
+{
+}
+static inline void Cond_Wait(THEORAPLAY_COND_T *cond, THEORAPLAY_MUTEX_T *mutex, const unsigned int ms)
+{
+    Mutex_Unlock(mutex);
+    Sleep(((ms == 0) || (ms > 10)) ? 10 : ms);
+    Mutex_Lock(mutex);
+}
+static inline unsigned int Ticks(void)
+{
+    return (unsigned int) GetTickCount();
 }
 #else
 static inline int Thread_Create(TheoraDecoder *ctx, void *(*routine) (void*))
@@ -173,25 +244,388 @@ static inline void Thread_Join(THEORAPLAY_THREAD_T thread)
 {
     pthread_join(thread, NULL);
 }
-static inline int Mutex_Create(TheoraDecoder *ctx)
+// the mutexes are passed by pointer, locking a copy of a pthread mutex
+//  doesn't lock anything.
+static inline int Mutex_Create(THEORAPLAY_MUTEX_T *mutex)
+{
+    return pthread_mutex_init(mutex, NULL);
+}
+static inline void Mutex_Destroy(THEORAPLAY_MUTEX_T *mutex)
+{
+    pthread_mutex_destroy(mutex);
+}
+static inline void Mutex_Lock(THEORAPLAY_MUTEX_T *mutex)
+{
+    pthread_mutex_lock(mutex);
+}
+static inline void Mutex_Unlock(THEORAPLAY_MUTEX_T *mutex)
+{
+    pthread_mutex_unlock(mutex);
+}
+static inline int Cond_Create(THEORAPLAY_COND_T *cond)
+{
+    return pthread_cond_init(cond, NULL);
+}
+static inline void Cond_Destroy(THEORAPLAY_COND_T *cond)
 {
-    return pthread_mutex_init(&ctx->lock, NULL);
+    pthread_cond_destroy(cond);
 }
-static inline void Mutex_Destroy(THEORAPLAY_MUTEX_T mutex)
+static inline void Cond_Broadcast(THEORAPLAY_COND_T *cond)
 {
-    pthread_mutex_destroy(&mutex);
+    pthread_cond_broadcast(cond);
 }
-static inline void Mutex_Lock(THEORAPLAY_MUTEX_T mutex)
+// wait at most ms milliseconds, 0 waits until woken up. Wakeups can be
+//  spurious, check the state after waiting.
+static inline void Cond_Wait(THEORAPLAY_COND_T *cond, THEORAPLAY_MUTEX_T *mutex, const unsigned int ms)
 {
-    pthread_mutex_lock(&mutex);
+    if (ms == 0)
+        pthread_cond_wait(cond, mutex);
+    else
+    {
+        // gettimeofday() instead of clock_gettime(), old OS X lacks it.
+        struct timeval now;
+        struct timespec deadline;
+        gettimeofday(&now, NULL);
+        deadline.tv_sec = now.tv_sec + (ms / 1000);
+        deadline.tv_nsec = (now.tv_usec * 1000L) + ((ms % 1000) * 1000000L);
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        } // if
+        pthread_cond_timedwait(cond, mutex, &deadline);
+    } // else
 }
-static inline void Mutex_Unlock(THEORAPLAY_MUTEX_T mutex)
+static inline unsigned int Ticks(void)
 {
-    pthread_mutex_unlock(&mutex);
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (unsigned int) ((now.tv_sec * 1000) + (now.tv_usec / 1000));
 }
 #endif
 
 
+static FramePool *FramePool_create(void)
+{
+    FramePool *pool = (FramePool *) malloc(sizeof (FramePool));
+    if (pool == NULL)
+        return NULL;
+
+    memset(pool, '\0', sizeof (FramePool));
+    if (Mutex_Create(&pool->lock) != 0)
+    {
+        free(pool);
+        return NULL;
+    } // if
+
+    pool->refcount = 1;
+    return pool;
+} // FramePool_create
+
+static void FramePool_freeList(PooledVideoFrame *item)
+{
+    while (item)
+    {
+        PooledVideoFrame *next = item->nextfree;
+        free(item);
+        item = next;
+    } // while
+} // FramePool_freeList
+
+// Drop a reference, the last one frees the pool.
+static void FramePool_release(FramePool *pool)
+{
+    Mutex_Lock(&pool->lock);
+    const int destroy = (--pool->refcount == 0);
+    Mutex_Unlock(&pool->lock);
+
+    if (destroy)
+    {
+        FramePool_freeList(pool->freelist);
+        Mutex_Destroy(&pool->lock);
+        free(pool);
+    } // if
+} // FramePool_release
+
+// Get a frame with pixelsize bytes of pixels, reused if possible.
+static VideoFrame *FramePool_get(FramePool *pool, const size_t pixelsize)
+{
+    PooledVideoFrame *item = NULL;
+    PooledVideoFrame *stale = NULL;
+
+    Mutex_Lock(&pool->lock);
+    if (pool->pixelsize != pixelsize)
+    {
+        // frame size changed, the free frames are useless now.
+        stale = pool->freelist;
+        pool->freelist = NULL;
+        pool->freecount = 0;
+        pool->pixelsize = pixelsize;
+    } // if
+
+    item = pool->freelist;
+    if (item)
+    {
+        pool->freelist = item->nextfree;
+        pool->freecount--;
+    } // if
+    pool->refcount++;
+    Mutex_Unlock(&pool->lock);
+
+    FramePool_freeList(stale);
+
+    if (item == NULL)
+    {
+        item = (PooledVideoFrame *) malloc(sizeof (PooledVideoFrame) + pixelsize);
+        if (item == NULL)
+        {
+            FramePool_release(pool);
+            return NULL;
+        } // if
+        item->pool = pool;
+    } // if
+
+    item->nextfree = NULL;
+    item->frame.pixels = (unsigned char *) (item + 1);
+    item->frame.next = NULL;
+    return &item->frame;
+} // FramePool_get
+
+// Return a frame to its pool.
+static void FramePool_put(VideoFrame *frame)
+{
+    PooledVideoFrame *item = (PooledVideoFrame *) frame;
+    FramePool *pool = item->pool;
+    const size_t pixelsize = FrameSize(frame->format, frame->width, frame->height);
+
+    Mutex_Lock(&pool->lock);
+    if ((pool->freecount < THEORAPLAY_FRAME_POOL_SIZE) && (pool->pixelsize == pixelsize))
+    {
+        item->nextfree = pool->freelist;
+        pool->freelist = item;
+        pool->freecount++;
+        item = NULL;
+    } // if
+    Mutex_Unlock(&pool->lock);
+
+    free(item);
+    FramePool_release(pool);
+} // FramePool_put
+
+
+// Seek index, one point per Ogg page of the video stream that finishes a
+//  frame. Seeking reads from the last page that ends before the wanted
+//  keyframe, so the decoder knows which frame every packet it gets is.
+//  Building it reads the page headers of the whole file once, so the index
+//  is cached to a file if the app names one. The cache is checked against
+//  the stream serial number and granule shift only, the app names the file
+//  after the size and modification time of the video.
+#define THEORAPLAY_INDEX_MAGIC 0x58444954  // "TIDX"
+#define THEORAPLAY_INDEX_VERSION 1
+
+typedef struct SeekPoint
+{
+    long long offset;  // file offset of the page.
+    long long frame;  // last frame finished on the page.
+    long long keyframe;  // keyframe that frame depends on.
+    long long firstframe;  // first frame returned after seeking to the page.
+} SeekPoint;
+
+typedef struct SeekIndex
+{
+    SeekPoint *points;
+    unsigned int count;
+    unsigned int capacity;
+} SeekIndex;
+
+static void SeekIndex_clear(SeekIndex *index)
+{
+    free(index->points);
+    memset(index, '\0', sizeof (SeekIndex));
+} // SeekIndex_clear
+
+static int SeekIndex_add(SeekIndex *index, const SeekPoint *point)
+{
+    if (index->count == index->capacity)
+    {
+        const unsigned int capacity = index->capacity ? index->capacity * 2 : 256;
+        void *ptr = realloc(index->points, sizeof (SeekPoint) * capacity);
+        if (ptr == NULL)
+            return 0;
+        index->points = (SeekPoint *) ptr;
+        index->capacity = capacity;
+    } // if
+
+    index->points[index->count++] = *point;
+    return 1;
+} // SeekIndex_add
+
+static int ReadFully(THEORAPLAY_Io *io, unsigned char *buf, const long buflen)
+{
+    long total = 0;
+    while (total < buflen)
+    {
+        const long br = io->read(io, buf + total, buflen - total);
+        if (br <= 0)
+            return 0;
+        total += br;
+    } // while
+    return 1;
+} // ReadFully
+
+// Walk the page headers from the start of the file, the page bodies are
+//  skipped. Returns 1 if the index is usable, 0 if not (seeks start from
+//  the beginning of the file then), -1 if the read position was lost.
+static int SeekIndex_build(SeekIndex *index, THEORAPLAY_Io *io, th_dec_ctx *tdec,
+                           const int serialno, const int shift)
+{
+    const long start = io->tell(io);
+    long long offset = 0;
+    unsigned char header[27];
+    unsigned char lacing[255];
+    int ok = (start >= 0) && (io->seek(io, 0, 0) == 0);
+
+    while (ok && ReadFully(io, header, sizeof (header)))
+    {
+        const int segments = header[26];
+        const int serial = (int) (header[14] | (header[15] << 8) |
+                                  (header[16] << 16) | ((unsigned int) header[17] << 24));
+        ogg_int64_t granulepos = 0;
+        long bodylen = 0;
+        int packets = 0;
+        int i;
+
+        if ((memcmp(header, "OggS", 4) != 0) || !ReadFully(io, lacing, segments))
+        {
+            ok = 0;  // damaged file.
+            break;
+        } // if
+
+        for (i = 0; i < segments; i++)
+        {
+            bodylen += lacing[i];
+            if (lacing[i] < 255)
+                packets++;  // a packet ends in this segment.
+        } // for
+
+        for (i = 7; i >= 0; i--)
+            granulepos = (granulepos << 8) | header[6 + i];
+
+        // headers have granule 0, pages that end no packet have -1.
+        if ((serial == serialno) && (granulepos > 0))
+        {
+            // a continued packet started on an earlier page is dropped
+            //  after seeking here.
+            const int continued = (header[5] & 0x01) != 0;
+            SeekPoint point;
+            point.offset = offset;
+            point.frame = th_granule_frame(tdec, granulepos);
+            point.keyframe = th_granule_frame(tdec, (granulepos >> shift) << shift);
+            point.firstframe = point.frame + 1 - (packets - continued);
+            ok = SeekIndex_add(index, &point);
+        } // if
+
+        offset += sizeof (header) + segments + bodylen;
+        if (ok && (io->seek(io, bodylen, 1) != 0))
+            ok = 0;
+    } // while
+
+    if (!ok)
+        SeekIndex_clear(index);
+
+    if ((start < 0) || (io->seek(io, start, 0) != 0))
+        return -1;
+
+    return ok && (index->count > 0);
+} // SeekIndex_build
+
+static int SeekIndex_load(SeekIndex *index, const char *fname,
+                          const int serialno, const int shift)
+{
+    unsigned int header[5];
+    int ok = 0;
+    FILE *f = fopen(fname, "rb");
+    if (f == NULL)
+        return 0;
+
+    if ((fread(header, sizeof (header), 1, f) == 1) &&
+        (header[0] == THEORAPLAY_INDEX_MAGIC) &&
+        (header[1] == THEORAPLAY_INDEX_VERSION) &&
+        (header[2] == (unsigned int) serialno) &&
+        (header[3] == (unsigned int) shift) &&
+        (header[4] > 0) && (header[4] < 0x1000000))
+    {
+        index->points = (SeekPoint *) malloc(sizeof (SeekPoint) * header[4]);
+        if (index->points != NULL)
+        {
+            index->count = index->capacity = header[4];
+            ok = (fread(index->points, sizeof (SeekPoint), index->count, f) == index->count);
+        } // if
+    } // if
+    fclose(f);
+
+    if (!ok)
+    {
+        SeekIndex_clear(index);
+        remove(fname);  // corrupt or stale, rebuilt and saved again.
+    } // if
+    return ok;
+} // SeekIndex_load
+
+static void SeekIndex_save(const SeekIndex *index, const char *fname,
+                           const int serialno, const int shift)
+{
+    unsigned int header[5];
+    int ok;
+    FILE *f = fopen(fname, "wb");
+    if (f == NULL)
+        return;
+
+    header[0] = THEORAPLAY_INDEX_MAGIC;
+    header[1] = THEORAPLAY_INDEX_VERSION;
+    header[2] = (unsigned int) serialno;
+    header[3] = (unsigned int) shift;
+    header[4] = index->count;
+    ok = (fwrite(header, sizeof (header), 1, f) == 1) &&
+         (fwrite(index->points, sizeof (SeekPoint), index->count, f) == index->count);
+    if ((fclose(f) != 0) || !ok)
+        remove(fname);
+} // SeekIndex_save
+
+// Find where to start reading to decode frame target: the page before the
+//  latest keyframe at or before target. Returns NULL to start from the
+//  beginning of the file. keyframe gets the keyframe decoding starts at.
+static const SeekPoint *SeekIndex_find(const SeekIndex *index,
+                                       const long long target,
+                                       long long *keyframe)
+{
+    // frames and keyframes only grow from page to page.
+    unsigned int lo = 0;
+    unsigned int hi = index->count;
+    while (lo < hi)
+    {
+        const unsigned int mid = lo + ((hi - lo) / 2);
+        if (index->points[mid].keyframe <= target)
+            lo = mid + 1;
+        else
+            hi = mid;
+    } // while
+    *keyframe = (lo > 0) ? index->points[lo - 1].keyframe : 0;
+
+    hi = lo;
+    lo = 0;
+    while (lo < hi)
+    {
+        const unsigned int mid = lo + ((hi - lo) / 2);
+        if (index->points[mid].frame < *keyframe)
+            lo = mid + 1;
+        else
+            hi = mid;
+    } // while
+    return (lo > 0) ? &index->points[lo - 1] : NULL;
+} // SeekIndex_find
+
+
 static int FeedMoreOggData(THEORAPLAY_Io *io, ogg_sync_state *sync)
 {
     long buflen = 4096;
@@ -222,6 +656,10 @@ static void WorkerThread(TheoraDecoder *ctx)
     double fps = 0.0;
     int was_error = 1;  // resets to 0 at the end.
     int eos = 0;  // end of stream flag.
+    SeekIndex seekindex;
+    unsigned int seekgeneration = 0;  // last seek request handled.
+    long long seekframe = 0;  // frames before this one are not returned.
+    int need_keyframe = 0;  // packets before a keyframe can't be decoded.
 
     // Too much Ogg/Vorbis/Theora state...
     ogg_packet packet;
@@ -244,6 +682,7 @@ static void WorkerThread(TheoraDecoder *ctx)
 
     int decode_audio = 0;
 
+    memset(&seekindex, '\0', sizeof (seekindex));
     ogg_sync_init(&sync);
     vorbis_info_init(&vinfo);
     vorbis_comment_init(&vcomment);
@@ -352,6 +791,17 @@ static void WorkerThread(TheoraDecoder *ctx)
         // !!! FIXME: maybe an API to set this?
         //th_decode_ctl(tdec, TH_DECCTL_GET_PPLEVEL_MAX, &pp_level_max, sizeof(pp_level_max));
         th_decode_ctl(tdec, TH_DECCTL_SET_PPLEVEL, &pp_level_max, sizeof(pp_level_max));
+
+        const int serialno = tstream.serialno;
+        const int shift = tinfo.keyframe_granule_shift;
+        if (!ctx->indexfname || !SeekIndex_load(&seekindex, ctx->indexfname, serialno, shift))
+        {
+            const int rc = SeekIndex_build(&seekindex, ctx->io, tdec, serialno, shift);
+            if (rc < 0)
+                goto cleanup;  // lost our place in the file.
+            else if ((rc > 0) && ctx->indexfname)
+                SeekIndex_save(&seekindex, ctx->indexfname, serialno, shift);
+        } // if
     } // if
 
     // Done with this now.
@@ -374,47 +824,64 @@ static void WorkerThread(TheoraDecoder *ctx)
     // Now we can start the actual decoding!
     // Note that audio and video don't _HAVE_ to start simultaneously.
 
-    Mutex_Lock(ctx->lock);
+    Mutex_Lock(&ctx->lock);
     ctx->prepped = 1;
     ctx->hasvideo = (tpackets != 0);
     ctx->hasaudio = (vpackets != 0);
     ctx->streamdecodecursor = ctx->io->tell(ctx->io);
     ctx->decodetime = 0.0;
     //float old_decodetime = ctx->decodetime;
-    Mutex_Unlock(ctx->lock);
+    Mutex_Unlock(&ctx->lock);
 
-    while (!ctx->halt && !eos)
+    while (!ctx->halt)
     {
-        if (ctx->pause)
-        {
-            //printf("sleep...\n");
-            sleepms(1);
-            continue;
-        }
-
-        /*if (old_decodetime > ctx->decodetime+0.01)
+        // Sleep while paused, at the end of the stream or ahead of the
+        //  decode time, until the app changes any of that.
+        Mutex_Lock(&ctx->lock);
+        while (!ctx->halt && (ctx->seekrequest == seekgeneration) &&
+               (ctx->pause || eos || (ctx->videolisttail &&
+                (ctx->videolisttail->playms/1000.0 > ctx->decodetime))))
         {
-            printf("cleanup now! %.3f > %.3f",old_decodetime, ctx->decodetime);
-            goto cleanup;
-        }
-
-        old_decodetime = ctx->decodetime;*/
-
-        if (ctx->videolisttail && ctx->videolisttail->playms/1000.0 > ctx->decodetime)
-        {
-            sleepms(10);
-            continue;
-            //goto cleanup;
-        }
+            if (eos && !ctx->at_eos)
+            {
+                ctx->at_eos = 1;
+                Cond_Broadcast(&ctx->cond);
+            } // if
+            Cond_Wait(&ctx->cond, &ctx->lock, 0);
+        } // while
+        const int seek = (ctx->seekrequest != seekgeneration);
+        const double seektime = ctx->seektime;
+        seekgeneration = ctx->seekrequest;
+        Mutex_Unlock(&ctx->lock);
 
+        if (ctx->halt)
+            break;
 
-        /*//we'll start from the begin
-        if (ctx->decodetime < videoframes-1)
+        if (seek && tdec)
         {
-            ctx->io->seek(ctx->io, ctx->streamdecodecursor, 0);
-            videoframes = 0;
-            continue;
-        }*/
+            long long keyframe = 0;
+            const long long target = (long long) (seektime * fps);
+            const SeekPoint *point = SeekIndex_find(&seekindex, target, &keyframe);
+            seekframe = target;
+
+            // Restart from the keyframe when going back, or when it is
+            //  ahead of the decoder. Otherwise just keep decoding.
+            if ((target < (long long) videoframes) || (keyframe > (long long) videoframes))
+            {
+                if (ctx->io->seek(ctx->io, point ? (long) point->offset : 0, 0) != 0)
+                    goto cleanup;
+                ogg_sync_reset(&sync);
+                ogg_stream_reset(&tstream);
+                if (vpackets)
+                {
+                    ogg_stream_reset(&vstream);
+                    vorbis_synthesis_restart(&vdsp);
+                } // if
+                videoframes = point ? (unsigned long) point->firstframe : 0;
+                need_keyframe = 1;
+                eos = 0;
+            } // if
+        } // if
 
         int need_pages = 0;  // need more Ogg pages?
         int saw_video_frame = 0;
@@ -459,7 +926,7 @@ static void WorkerThread(TheoraDecoder *ctx)
                 audioframes += frames;
 
                 //printf("Decoded %d frames of audio.\n", (int) frames);
-                Mutex_Lock(ctx->lock);
+                Mutex_Lock(&ctx->lock);
                 ctx->audioms += item->playms;
                 if (ctx->audiolisttail)
                 {
@@ -472,7 +939,7 @@ static void WorkerThread(TheoraDecoder *ctx)
                     ctx->audiolist = item;
                 } // else
                 ctx->audiolisttail = item;
-                Mutex_Unlock(ctx->lock);
+                Mutex_Unlock(&ctx->lock);
             } // if
 
             else  // no audio available left in current packet?
@@ -498,9 +965,14 @@ static void WorkerThread(TheoraDecoder *ctx)
             //  "one [packet] in, one [frame] out."
             if (ogg_stream_packetout(&tstream, &packet) <= 0)
                 need_pages = 1;
+            else if (th_packet_isheader(&packet))
+                ;  // seeked to the start of the file, the headers come again.
+            else if (need_keyframe && (th_packet_iskeyframe(&packet) != 1))
+                videoframes++;  // nothing to decode it against.
             else
             {
                 ogg_int64_t granulepos = 0;
+                need_keyframe = 0;
                 const int rc = th_decode_packetin(tdec, &packet, &granulepos);
 
                 if (rc == TH_DUPFRAME)
@@ -510,12 +982,12 @@ static void WorkerThread(TheoraDecoder *ctx)
                     //if (videoframes < ctx->decodetime-1)
                     {
                         unsigned int playms = (fps == 0) ? 0 : (unsigned int) ((((double) videoframes) / fps) * 1000.0);
-                        if (abs(ctx->decodetime-playms/1000.0) < 0.1 || !ctx->videolisttail)
+                        if ((((long long) videoframes) >= seekframe) && (abs(ctx->decodetime-playms/1000.0) < 0.1 || !ctx->videolisttail))
                         {
                             th_ycbcr_buffer ycbcr;
                             if (th_decode_ycbcr_out(tdec, ycbcr) == 0)
                             {
-                                VideoFrame *item = (VideoFrame *) malloc(sizeof (VideoFrame));
+                                VideoFrame *item = FramePool_get(ctx->framepool, FrameSize(ctx->vidfmt, tinfo.pic_width, tinfo.pic_height));
                                 assert(item);
                                 if (item == NULL) goto cleanup;
                                 item->filecursor = ctx->io->tell(ctx->io);
@@ -524,17 +996,19 @@ static void WorkerThread(TheoraDecoder *ctx)
                                 item->width = tinfo.pic_width;
                                 item->height = tinfo.pic_height;
                                 item->format = ctx->vidfmt;
-                                item->pixels = ctx->vidcvt(&tinfo, ycbcr);
-                                item->next = NULL;
+                                ctx->vidcvt(&tinfo, ycbcr, item->pixels);
 
-                                if (item->pixels == NULL)
+                                //printf("Decoded another video frame.\n");
+                                Mutex_Lock(&ctx->lock);
+                                if (ctx->seekrequest != seekgeneration)
                                 {
-                                    free(item);
-                                    goto cleanup;
+                                    // stale, the app seeked while we decoded.
+                                    Mutex_Unlock(&ctx->lock);
+                                    FramePool_put(item);
+                                    videoframes++;
+                                    continue;
                                 } // if
 
-                                //printf("Decoded another video frame.\n");
-                                Mutex_Lock(ctx->lock);
                                 if (ctx->videolisttail)
                                 {
                                     assert(ctx->videolist);
@@ -548,7 +1022,8 @@ static void WorkerThread(TheoraDecoder *ctx)
                                 ctx->videolisttail = item;
 
                                 ctx->videocount++;
-                                Mutex_Unlock(ctx->lock);
+                                Cond_Broadcast(&ctx->cond);
+                                Mutex_Unlock(&ctx->lock);
 
                                 saw_video_frame = 1;
                             } // if
@@ -585,18 +1060,11 @@ static void WorkerThread(TheoraDecoder *ctx)
         // Sleep the process until we have space for more frames.
         if (saw_video_frame)
         {
-            int go_on = !ctx->halt;
-            //printf("Sleeping.\n");
-            while (go_on)
-            {
-                // !!! FIXME: This is stupid. I should use a semaphore for this.
-                Mutex_Lock(ctx->lock);
-                go_on = !ctx->halt && (ctx->videocount >= ctx->maxframes);
-                Mutex_Unlock(ctx->lock);
-                if (go_on)
-                    sleepms(10);
-            } // while
-            //printf("Awake!\n");
+            Mutex_Lock(&ctx->lock);
+            while (!ctx->halt && (ctx->seekrequest == seekgeneration) &&
+                   (ctx->videocount >= ctx->maxframes))
+                Cond_Wait(&ctx->cond, &ctx->lock, 0);
+            Mutex_Unlock(&ctx->lock);
         } // if
     } // while
 
@@ -615,8 +1083,13 @@ cleanup:
     vorbis_comment_clear(&vcomment);
     vorbis_info_clear(&vinfo);
     ogg_sync_clear(&sync);
+    SeekIndex_clear(&seekindex);
     ctx->io->close(ctx->io);
+
+    Mutex_Lock(&ctx->lock);
     ctx->thread_done = 1;
+    Cond_Broadcast(&ctx->cond);
+    Mutex_Unlock(&ctx->lock);
 } // WorkerThread
 
 
@@ -670,9 +1143,23 @@ static void IoFopenClose(THEORAPLAY_Io *io)
 } // IoFopenClose
 
 
+static THEORAPLAY_Decoder *StartDecode(THEORAPLAY_Io *io,
+                                       const char *indexfname,
+                                       const unsigned int maxframes,
+                                       THEORAPLAY_VideoFormat vidfmt);
+
 THEORAPLAY_Decoder *THEORAPLAY_startDecodeFile(const char *fname,
                                                const unsigned int maxframes,
                                                THEORAPLAY_VideoFormat vidfmt)
+{
+    return THEORAPLAY_startDecodeFileIndexed(fname, NULL, maxframes, vidfmt);
+} // THEORAPLAY_startDecodeFile
+
+
+THEORAPLAY_Decoder *THEORAPLAY_startDecodeFileIndexed(const char *fname,
+                                                      const char *indexfname,
+                                                      const unsigned int maxframes,
+                                                      THEORAPLAY_VideoFormat vidfmt)
 {
     THEORAPLAY_Io *io = (THEORAPLAY_Io *) malloc(sizeof (THEORAPLAY_Io));
     if (io == NULL)
@@ -690,13 +1177,22 @@ THEORAPLAY_Decoder *THEORAPLAY_startDecodeFile(const char *fname,
     io->close = IoFopenClose;
     io->tell = IoFopenCurrentCursor;
     io->userdata = f;
-    return THEORAPLAY_startDecode(io, maxframes, vidfmt);
-} // THEORAPLAY_startDecodeFile
+    return StartDecode(io, indexfname, maxframes, vidfmt);
+} // THEORAPLAY_startDecodeFileIndexed
 
 
 THEORAPLAY_Decoder *THEORAPLAY_startDecode(THEORAPLAY_Io *io,
                                            const unsigned int maxframes,
                                            THEORAPLAY_VideoFormat vidfmt)
+{
+    return StartDecode(io, NULL, maxframes, vidfmt);
+} // THEORAPLAY_startDecode
+
+
+static THEORAPLAY_Decoder *StartDecode(THEORAPLAY_Io *io,
+                                       const char *indexfname,
+                                       const unsigned int maxframes,
+                                       THEORAPLAY_VideoFormat vidfmt)
 {
     TheoraDecoder *ctx = NULL;
     ConvertVideoFrameFn vidcvt = NULL;
@@ -722,21 +1218,38 @@ THEORAPLAY_Decoder *THEORAPLAY_startDecode(THEORAPLAY_Io *io,
     ctx->vidfmt = vidfmt;
     ctx->vidcvt = vidcvt;
     ctx->io = io;
+    if (indexfname != NULL)
+    {
+        ctx->indexfname = strdup(indexfname);
+        if (ctx->indexfname == NULL)
+            goto startdecode_failed;
+    } // if
 
-    if (Mutex_Create(ctx) == 0)
+    ctx->framepool = FramePool_create();
+    if (ctx->framepool == NULL)
+        goto startdecode_failed;
+
+    if (Mutex_Create(&ctx->lock) == 0)
     {
-        ctx->thread_created = (Thread_Create(ctx, WorkerThreadEntry) == 0);
-        if (ctx->thread_created)
-            return (THEORAPLAY_Decoder *) ctx;
+        if (Cond_Create(&ctx->cond) == 0)
+        {
+            ctx->thread_created = (Thread_Create(ctx, WorkerThreadEntry) == 0);
+            if (ctx->thread_created)
+                return (THEORAPLAY_Decoder *) ctx;
+            Cond_Destroy(&ctx->cond);
+        } // if
+        Mutex_Destroy(&ctx->lock);
     } // if
 
-    Mutex_Destroy(ctx->lock);
+    FramePool_release(ctx->framepool);
 
 startdecode_failed:
     io->close(io);
+    if (ctx)
+        free(ctx->indexfname);
     free(ctx);
     return NULL;
-} // THEORAPLAY_startDecode
+} // StartDecode
 
 void THEORAPLAY_pauseDecode(THEORAPLAY_Decoder *decoder)
 {
@@ -746,7 +1259,10 @@ void THEORAPLAY_pauseDecode(THEORAPLAY_Decoder *decoder)
 
     if (ctx->thread_created)
     {
+        Mutex_Lock(&ctx->lock);
         ctx->pause = !ctx->pause;
+        Cond_Broadcast(&ctx->cond);
+        Mutex_Unlock(&ctx->lock);
     } // if
 } // THEORAPLAY_pauseDecode
 
@@ -758,24 +1274,26 @@ void THEORAPLAY_stopDecode(THEORAPLAY_Decoder *decoder)
 
     if (ctx->thread_created)
     {
+        Mutex_Lock(&ctx->lock);
         ctx->halt = 1;
+        Cond_Broadcast(&ctx->cond);
+        Mutex_Unlock(&ctx->lock);
         Thread_Join(ctx->worker);
-        Mutex_Destroy(ctx->lock);
+        Cond_Destroy(&ctx->cond);
+        Mutex_Destroy(&ctx->lock);
     } // if
 
     VideoFrame *videolist = ctx->videolist;
     while (videolist)
     {
         VideoFrame *next = videolist->next;
-        if (videolist->pixels != NULL)
-        {
-            free(videolist->pixels);
-            videolist->pixels = NULL;
-        }
-        free(videolist);
+        FramePool_put(videolist);
         videolist = next;
     } // while
 
+    // frames the app still holds keep the pool alive.
+    FramePool_release(ctx->framepool);
+
     AudioPacket *audiolist = ctx->audiolist;
     while (audiolist)
     {
@@ -785,6 +1303,7 @@ void THEORAPLAY_stopDecode(THEORAPLAY_Decoder *decoder)
         audiolist = next;
     } // while
 
+    free(ctx->indexfname);
     free(ctx);
 } // THEORAPLAY_stopDecode
 
@@ -795,11 +1314,11 @@ int THEORAPLAY_isDecoding(THEORAPLAY_Decoder *decoder)
     int retval = 0;
     if (ctx)
     {
-        Mutex_Lock(ctx->lock);
+        Mutex_Lock(&ctx->lock);
         /*retval = ( ctx && (ctx->audiolist || ctx->videolist ||
                    (ctx->thread_created && !ctx->thread_done)) );*/
-        retval = (ctx && !ctx->thread_done);
-        Mutex_Unlock(ctx->lock);
+        retval = (ctx && !ctx->thread_done && !ctx->at_eos);
+        Mutex_Unlock(&ctx->lock);
     } // if
     return retval;
 } // THEORAPLAY_isDecoding
@@ -809,9 +1328,9 @@ int THEORAPLAY_isDecoding(THEORAPLAY_Decoder *decoder)
     TheoraDecoder *ctx = (TheoraDecoder *) decoder; \
     typ retval = defval; \
     if (ctx) { \
-        Mutex_Lock(ctx->lock); \
+        Mutex_Lock(&ctx->lock); \
         retval = ctx->member; \
-        Mutex_Unlock(ctx->lock); \
+        Mutex_Unlock(&ctx->lock); \
     } \
     return retval;
 
@@ -853,15 +1372,57 @@ int THEORAPLAY_decodingError(THEORAPLAY_Decoder *decoder)
 void THEORAPLAY_setDecodeTime(THEORAPLAY_Decoder *decoder, const double time)
 {
     TheoraDecoder *ctx = (TheoraDecoder *) decoder;
-    ctx->decodetime = time;
-}
+    Mutex_Lock(&ctx->lock);
+    if (ctx->decodetime != time)
+    {
+        ctx->decodetime = time;
+        Cond_Broadcast(&ctx->cond);
+    } // if
+    Mutex_Unlock(&ctx->lock);
+} // THEORAPLAY_setDecodeTime
+
+void THEORAPLAY_seek(THEORAPLAY_Decoder *decoder, const double time)
+{
+    TheoraDecoder *ctx = (TheoraDecoder *) decoder;
+    VideoFrame *videolist;
+    AudioPacket *audiolist;
+
+    Mutex_Lock(&ctx->lock);
+    videolist = ctx->videolist;
+    audiolist = ctx->audiolist;
+    ctx->videolist = ctx->videolisttail = NULL;
+    ctx->audiolist = ctx->audiolisttail = NULL;
+    ctx->videocount = 0;
+    ctx->audioms = 0;
+    ctx->seektime = (time > 0.0) ? time : 0.0;
+    ctx->decodetime = ctx->seektime;
+    ctx->seekrequest++;
+    ctx->at_eos = 0;
+    Cond_Broadcast(&ctx->cond);
+    Mutex_Unlock(&ctx->lock);
+
+    while (videolist)
+    {
+        VideoFrame *next = videolist->next;
+        FramePool_put(videolist);
+        videolist = next;
+    } // while
+
+    while (audiolist)
+    {
+        AudioPacket *next = audiolist->next;
+        free(audiolist->samples);
+        free(audiolist);
+        audiolist = next;
+    } // while
+} // THEORAPLAY_seek
 
 const THEORAPLAY_AudioPacket *THEORAPLAY_getAudio(THEORAPLAY_Decoder *decoder)
 {
     TheoraDecoder *ctx = (TheoraDecoder *) decoder;
     AudioPacket *retval;
 
-    Mutex_Lock(ctx->lock);
+    Mutex_Lock(&ctx->lock);
     retval = ctx->audiolist;
     if (retval)
     {
@@ -871,7 +1432,7 @@ const THEORAPLAY_AudioPacket *THEORAPLAY_getAudio(THEORAPLAY_Decoder *decoder)
         if (ctx->audiolist == NULL)
             ctx->audiolisttail = NULL;
     } // if
-    Mutex_Unlock(ctx->lock);
+    Mutex_Unlock(&ctx->lock);
 
     return retval;
 } // THEORAPLAY_getAudio
@@ -889,13 +1450,10 @@ void THEORAPLAY_freeAudio(const THEORAPLAY_AudioPacket *_item)
 } // THEORAPLAY_freeAudio
 
 
-const THEORAPLAY_VideoFrame *THEORAPLAY_getVideo(THEORAPLAY_Decoder *decoder)
+// call with the lock held.
+static VideoFrame *PopVideo(TheoraDecoder *ctx)
 {
-    TheoraDecoder *ctx = (TheoraDecoder *) decoder;
-    VideoFrame *retval;
-
-    Mutex_Lock(ctx->lock);
-    retval = ctx->videolist;
+    VideoFrame *retval = ctx->videolist;
     if (retval)
     {
         ctx->videolist = retval->next;
@@ -904,12 +1462,43 @@ const THEORAPLAY_VideoFrame *THEORAPLAY_getVideo(THEORAPLAY_Decoder *decoder)
             ctx->videolisttail = NULL;
         assert(ctx->videocount > 0);
         ctx->videocount--;
+        Cond_Broadcast(&ctx->cond);  // room for another frame.
     } // if
-    Mutex_Unlock(ctx->lock);
+    return retval;
+} // PopVideo
+
+const THEORAPLAY_VideoFrame *THEORAPLAY_getVideo(THEORAPLAY_Decoder *decoder)
+{
+    TheoraDecoder *ctx = (TheoraDecoder *) decoder;
+    VideoFrame *retval;
+
+    Mutex_Lock(&ctx->lock);
+    retval = PopVideo(ctx);
+    Mutex_Unlock(&ctx->lock);
 
     return retval;
 } // THEORAPLAY_getVideo
 
+const THEORAPLAY_VideoFrame *THEORAPLAY_waitVideo(THEORAPLAY_Decoder *decoder,
+                                                  const unsigned int timeoutms)
+{
+    TheoraDecoder *ctx = (TheoraDecoder *) decoder;
+    const unsigned int start = Ticks();
+    VideoFrame *retval;
+
+    Mutex_Lock(&ctx->lock);
+    while (((retval = PopVideo(ctx)) == NULL) && !ctx->thread_done && !ctx->at_eos)
+    {
+        const unsigned int elapsed = Ticks() - start;
+        if (elapsed >= timeoutms)
+            break;
+        Cond_Wait(&ctx->cond, &ctx->lock, timeoutms - elapsed);
+    } // while
+    Mutex_Unlock(&ctx->lock);
+
+    return retval;
+} // THEORAPLAY_waitVideo
+
 
 void THEORAPLAY_freeVideo(const THEORAPLAY_VideoFrame *_item)
 {
@@ -917,14 +1506,54 @@ void THEORAPLAY_freeVideo(const THEORAPLAY_VideoFrame *_item)
     if (item != NULL)
     {
         assert(item->next == NULL);
-        if (item->pixels != NULL)
-        {
-            free(item->pixels);
-            item->pixels = NULL;
-        }
-        free(item);
+        FramePool_put(item);
     } // if
 } // THEORAPLAY_freeVideo
 
+
+int THEORAPLAY_convertFrame(const unsigned char *planes[3],
+                            const int strides[3],
+                            const unsigned int width,
+                            const unsigned int height,
+                            THEORAPLAY_VideoFormat vidfmt,
+                            const int reference,
+                            unsigned char *pixels)
+{
+    ConvertVideoFrameFn vidcvt = NULL;
+    th_info tinfo;
+    th_ycbcr_buffer ycbcr;
+    int i;
+
+    switch (vidfmt)
+    {
+        case THEORAPLAY_VIDFMT_RGB:
+            vidcvt = reference ? ConvertVideoFrame420ToRGBReference : ConvertVideoFrame420ToRGB;
+            break;
+        case THEORAPLAY_VIDFMT_RGBA:
+            vidcvt = reference ? ConvertVideoFrame420ToRGBAReference : ConvertVideoFrame420ToRGBA;
+            break;
+        default:
+            return 0;  // only the RGB conversions are exposed.
+    } // switch
+
+    memset(&tinfo, '\0', sizeof (tinfo));
+    tinfo.pic_width = width;
+    tinfo.pic_height = height;
+    tinfo.frame_width = width;
+    tinfo.frame_height = height;
+    tinfo.pixel_fmt = TH_PF_420;
+
+    for (i = 0; i < 3; i++)
+    {
+        ycbcr[i].width = (i == 0) ? width : (width + 1) / 2;
+        ycbcr[i].height = (i == 0) ? height : (height + 1) / 2;
+        ycbcr[i].stride = strides[i];
+        ycbcr[i].data = (unsigned char *) planes[i];
+    } // for
+
+    vidcvt(&tinfo, ycbcr, pixels);
+    return 1;
+} // THEORAPLAY_convertFrame
+
 // end of theoraplay.cpp ...
 
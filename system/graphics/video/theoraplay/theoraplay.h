@@ -59,6 +59,12 @@ typedef struct THEORAPLAY_AudioPacket
 THEORAPLAY_Decoder *THEORAPLAY_startDecodeFile(const char *fname,
                                                const unsigned int maxframes,
                                                THEORAPLAY_VideoFormat vidfmt);
+/* Like THEORAPLAY_startDecodeFile(), the seek index is loaded from
+   indexfname, or built and saved there if the file is missing or stale. */
+THEORAPLAY_Decoder *THEORAPLAY_startDecodeFileIndexed(const char *fname,
+                                                      const char *indexfname,
+                                                      const unsigned int maxframes,
+                                                      THEORAPLAY_VideoFormat vidfmt);
 THEORAPLAY_Decoder *THEORAPLAY_startDecode(THEORAPLAY_Io *io,
                                            const unsigned int maxframes,
                                            THEORAPLAY_VideoFormat vidfmt);
@@ -75,12 +81,33 @@ unsigned int THEORAPLAY_availableAudio(THEORAPLAY_Decoder *decoder);
 
 void THEORAPLAY_setDecodeTime(THEORAPLAY_Decoder *decoder, const double time);
 
+/* Drop the buffered frames and continue decoding from time (seconds). The
+   decoder restarts from the nearest keyframe before it, only the frames
+   from time on are returned. Also restarts a decoder at the end of the
+   stream, THEORAPLAY_isDecoding() returns 0 there. */
+void THEORAPLAY_seek(THEORAPLAY_Decoder *decoder, const double time);
+
 const THEORAPLAY_AudioPacket *THEORAPLAY_getAudio(THEORAPLAY_Decoder *decoder);
 void THEORAPLAY_freeAudio(const THEORAPLAY_AudioPacket *item);
 
 const THEORAPLAY_VideoFrame *THEORAPLAY_getVideo(THEORAPLAY_Decoder *decoder);
+/* Like THEORAPLAY_getVideo(), but blocks up to timeoutms milliseconds for a
+   frame. Returns NULL at once if decoding has ended. */
+const THEORAPLAY_VideoFrame *THEORAPLAY_waitVideo(THEORAPLAY_Decoder *decoder,
+                                                  const unsigned int timeoutms);
 void THEORAPLAY_freeVideo(const THEORAPLAY_VideoFrame *item);
 
+/* Convert 4:2:0 planes to RGB or RGBA like the decoder does, pixels must
+   hold width*height*3 or *4 bytes. reference selects the original floating
+   point converter, for comparison. Returns 0 for other formats. */
+int THEORAPLAY_convertFrame(const unsigned char *planes[3],
+                            const int strides[3],
+                            unsigned int width,
+                            unsigned int height,
+                            THEORAPLAY_VideoFormat vidfmt,
+                            int reference,
+                            unsigned char *pixels);
+
 #ifdef __cplusplus
 }
 #endif
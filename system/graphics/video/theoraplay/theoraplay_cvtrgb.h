@@ -10,65 +10,309 @@
 #error Do not include this in your app. It is used internally by TheoraPlay.
 #endif
 
-static unsigned char *THEORAPLAY_CVT_FNNAME_420(const th_info *tinfo,
-                                                const th_ycbcr_buffer ycbcr)
+#ifndef THEORAPLAY_CVT_KERNELS
+#define THEORAPLAY_CVT_KERNELS 1
+
+// http://www.theora.org/doc/Theora.pdf, 1.1 spec,
+//  chapter 4.2 (Y'CbCr -> Y'PbPr -> R'G'B')
+// The floating point conversion below folded into 13 bit fixed point
+//  coefficients, kr = 0.299, kb = 0.114:
+//  R = 255/219 * (Y-16) + 255/224 * 2(1-kr) * (Cr-128)
+//  G = 255/219 * (Y-16) - 255/224 * 2(1-kb)kb/(1-kb-kr) * (Cb-128)
+//                       - 255/224 * 2(1-kr)kr/(1-kb-kr) * (Cr-128)
+//  B = 255/219 * (Y-16) + 255/224 * 2(1-kb) * (Cb-128)
+#define THEORAPLAY_CVT_SHIFT 13
+#define THEORAPLAY_CVT_Y 9539      // 1.164384
+#define THEORAPLAY_CVT_R_CR 13075  // 1.596027
+#define THEORAPLAY_CVT_G_CB 3209   // 0.391762
+#define THEORAPLAY_CVT_G_CR 6660   // 0.812968
+#define THEORAPLAY_CVT_B_CB 16525  // 2.017232
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define THEORAPLAY_CVT_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define THEORAPLAY_CVT_NEON 1
+#endif
+
+static inline unsigned char ClampPixel(const int value)
+{
+    return (unsigned char) ((value < 0) ? 0 : (value > 255) ? 255 : value);
+} // ClampPixel
+
+#if THEORAPLAY_CVT_SSE2
+// Sum the luma term of 4 pixels with the chroma term of 2 chroma samples.
+static inline __m128i AddChroma(const __m128i y, const __m128i c)
+{
+    return _mm_srai_epi32(_mm_add_epi32(y, c), THEORAPLAY_CVT_SHIFT);
+} // AddChroma
+
+// 16 pixels of one channel, y0..y3 are the luma terms of pixels 0-3 ... 12-15
+//  and c0, c1 the chroma terms of chroma samples 0-3 and 4-7.
+static inline __m128i ConvertChannel16(const __m128i y0, const __m128i y1,
+                                       const __m128i y2, const __m128i y3,
+                                       const __m128i c0, const __m128i c1)
+{
+    const __m128i p0 = AddChroma(y0, _mm_shuffle_epi32(c0, _MM_SHUFFLE(1, 1, 0, 0)));
+    const __m128i p1 = AddChroma(y1, _mm_shuffle_epi32(c0, _MM_SHUFFLE(3, 3, 2, 2)));
+    const __m128i p2 = AddChroma(y2, _mm_shuffle_epi32(c1, _MM_SHUFFLE(1, 1, 0, 0)));
+    const __m128i p3 = AddChroma(y3, _mm_shuffle_epi32(c1, _MM_SHUFFLE(3, 3, 2, 2)));
+    // saturating packs clamp to 0-255.
+    return _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+} // ConvertChannel16
+
+// Drop the alpha bytes of 4 RGBA pixels and store the 12 bytes of RGB.
+//  Each 8 byte store writes 2 bytes too much, the last one is copied exactly.
+static inline void StoreRGB4(unsigned char *dst, const __m128i rgba, const int last)
+{
+    const __m128i rgb = _mm_or_si128(
+        _mm_and_si128(rgba, _mm_set_epi32(0, 0x00FFFFFF, 0, 0x00FFFFFF)),
+        _mm_srli_epi64(_mm_and_si128(rgba, _mm_set_epi32(0x00FFFFFF, 0, 0x00FFFFFF, 0)), 8));
+    _mm_storel_epi64((__m128i *) dst, rgb);
+    if (last)
+    {
+        unsigned char tail[8];
+        _mm_storel_epi64((__m128i *) tail, _mm_srli_si128(rgb, 8));
+        memcpy(dst + 6, tail, 6);
+    } // if
+    else
+    {
+        _mm_storel_epi64((__m128i *) (dst + 6), _mm_srli_si128(rgb, 8));
+    } // else
+} // StoreRGB4
+#endif
+
+// Convert one row of 4:2:0 to RGB or RGBA. pcb and pcr are the chroma rows
+//  of the luma row, chroma sample x/2 is shared by pixels x and x+1.
+static inline void ConvertRow420(const unsigned char *py,
+                                 const unsigned char *pcb,
+                                 const unsigned char *pcr,
+                                 unsigned char *dst, const int w,
+                                 const int alpha)
+{
+    const int bpp = alpha ? 4 : 3;
+    int posx = 0;
+
+#if THEORAPLAY_CVT_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i yoffset = _mm_set1_epi16(16);
+    const __m128i coffset = _mm_set1_epi16(128);
+    const __m128i ycoef = _mm_set1_epi16(THEORAPLAY_CVT_Y);
+    // _mm_madd_epi16 coefficients for (cb, cr) pairs.
+    const __m128i rcoef = _mm_set1_epi32(THEORAPLAY_CVT_R_CR << 16);
+    const __m128i gcoef = _mm_set1_epi32((int) (((unsigned int) -THEORAPLAY_CVT_G_CR << 16) | ((unsigned int) -THEORAPLAY_CVT_G_CB & 0xFFFF)));
+    const __m128i bcoef = _mm_set1_epi32(THEORAPLAY_CVT_B_CB);
+    const __m128i a8 = alpha ? _mm_set1_epi8((char) 0xFF) : zero;
+
+    for (; posx + 16 <= w; posx += 16)
+    {
+        const __m128i y8 = _mm_loadu_si128((const __m128i *) (py + posx));
+        const __m128i cb8 = _mm_loadl_epi64((const __m128i *) (pcb + posx / 2));
+        const __m128i cr8 = _mm_loadl_epi64((const __m128i *) (pcr + posx / 2));
+
+        const __m128i ylo = _mm_sub_epi16(_mm_unpacklo_epi8(y8, zero), yoffset);
+        const __m128i yhi = _mm_sub_epi16(_mm_unpackhi_epi8(y8, zero), yoffset);
+        const __m128i ylomul = _mm_mullo_epi16(ylo, ycoef);
+        const __m128i ylomulhi = _mm_mulhi_epi16(ylo, ycoef);
+        const __m128i yhimul = _mm_mullo_epi16(yhi, ycoef);
+        const __m128i yhimulhi = _mm_mulhi_epi16(yhi, ycoef);
+        const __m128i y0 = _mm_unpacklo_epi16(ylomul, ylomulhi);
+        const __m128i y1 = _mm_unpackhi_epi16(ylomul, ylomulhi);
+        const __m128i y2 = _mm_unpacklo_epi16(yhimul, yhimulhi);
+        const __m128i y3 = _mm_unpackhi_epi16(yhimul, yhimulhi);
+
+        const __m128i cb = _mm_sub_epi16(_mm_unpacklo_epi8(cb8, zero), coffset);
+        const __m128i cr = _mm_sub_epi16(_mm_unpacklo_epi8(cr8, zero), coffset);
+        const __m128i c0 = _mm_unpacklo_epi16(cb, cr);
+        const __m128i c1 = _mm_unpackhi_epi16(cb, cr);
+
+        const __m128i r8 = ConvertChannel16(y0, y1, y2, y3, _mm_madd_epi16(c0, rcoef), _mm_madd_epi16(c1, rcoef));
+        const __m128i g8 = ConvertChannel16(y0, y1, y2, y3, _mm_madd_epi16(c0, gcoef), _mm_madd_epi16(c1, gcoef));
+        const __m128i b8 = ConvertChannel16(y0, y1, y2, y3, _mm_madd_epi16(c0, bcoef), _mm_madd_epi16(c1, bcoef));
+
+        const __m128i rglo = _mm_unpacklo_epi8(r8, g8);
+        const __m128i rghi = _mm_unpackhi_epi8(r8, g8);
+        const __m128i balo = _mm_unpacklo_epi8(b8, a8);
+        const __m128i bahi = _mm_unpackhi_epi8(b8, a8);
+        const __m128i p0 = _mm_unpacklo_epi16(rglo, balo);
+        const __m128i p1 = _mm_unpackhi_epi16(rglo, balo);
+        const __m128i p2 = _mm_unpacklo_epi16(rghi, bahi);
+        const __m128i p3 = _mm_unpackhi_epi16(rghi, bahi);
+
+        unsigned char *out = dst + posx * bpp;
+        if (alpha)
+        {
+            _mm_storeu_si128((__m128i *) out, p0);
+            _mm_storeu_si128((__m128i *) (out + 16), p1);
+            _mm_storeu_si128((__m128i *) (out + 32), p2);
+            _mm_storeu_si128((__m128i *) (out + 48), p3);
+        } // if
+        else
+        {
+            StoreRGB4(out, p0, 0);
+            StoreRGB4(out + 12, p1, 0);
+            StoreRGB4(out + 24, p2, 0);
+            StoreRGB4(out + 36, p3, 1);
+        } // else
+    } // for
+#elif THEORAPLAY_CVT_NEON
+    const uint8x8_t yoffset = vdup_n_u8(16);
+    const uint8x8_t coffset = vdup_n_u8(128);
+
+    for (; posx + 16 <= w; posx += 16)
+    {
+        const uint8x16_t y8 = vld1q_u8(py + posx);
+        // the wrapping unsigned subtraction is the signed difference.
+        const int16x8_t ylo = vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(y8), yoffset));
+        const int16x8_t yhi = vreinterpretq_s16_u16(vsubl_u8(vget_high_u8(y8), yoffset));
+        const int16x8_t cb = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(pcb + posx / 2), coffset));
+        const int16x8_t cr = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(pcr + posx / 2), coffset));
+
+        const int32x4_t y0 = vmull_n_s16(vget_low_s16(ylo), THEORAPLAY_CVT_Y);
+        const int32x4_t y1 = vmull_n_s16(vget_high_s16(ylo), THEORAPLAY_CVT_Y);
+        const int32x4_t y2 = vmull_n_s16(vget_low_s16(yhi), THEORAPLAY_CVT_Y);
+        const int32x4_t y3 = vmull_n_s16(vget_high_s16(yhi), THEORAPLAY_CVT_Y);
+
+        // chroma terms of samples 0-3 and 4-7, zipped to pixels 0-7 and 8-15.
+        const int32x4x2_t r0 = vzipq_s32(vmull_n_s16(vget_low_s16(cr), THEORAPLAY_CVT_R_CR), vmull_n_s16(vget_low_s16(cr), THEORAPLAY_CVT_R_CR));
+        const int32x4x2_t r1 = vzipq_s32(vmull_n_s16(vget_high_s16(cr), THEORAPLAY_CVT_R_CR), vmull_n_s16(vget_high_s16(cr), THEORAPLAY_CVT_R_CR));
+        const int32x4_t glo = vmlal_n_s16(vmull_n_s16(vget_low_s16(cb), -THEORAPLAY_CVT_G_CB), vget_low_s16(cr), -THEORAPLAY_CVT_G_CR);
+        const int32x4_t ghi = vmlal_n_s16(vmull_n_s16(vget_high_s16(cb), -THEORAPLAY_CVT_G_CB), vget_high_s16(cr), -THEORAPLAY_CVT_G_CR);
+        const int32x4x2_t g0 = vzipq_s32(glo, glo);
+        const int32x4x2_t g1 = vzipq_s32(ghi, ghi);
+        const int32x4x2_t b0 = vzipq_s32(vmull_n_s16(vget_low_s16(cb), THEORAPLAY_CVT_B_CB), vmull_n_s16(vget_low_s16(cb), THEORAPLAY_CVT_B_CB));
+        const int32x4x2_t b1 = vzipq_s32(vmull_n_s16(vget_high_s16(cb), THEORAPLAY_CVT_B_CB), vmull_n_s16(vget_high_s16(cb), THEORAPLAY_CVT_B_CB));
+
+        // saturating narrowing shifts clamp to 0-255.
+        #define THEORAPLAY_CVT_NEON_CHANNEL(c0, c1) vcombine_u8( \
+            vqmovn_u16(vcombine_u16(vqshrun_n_s32(vaddq_s32(y0, c0.val[0]), THEORAPLAY_CVT_SHIFT), \
+                                    vqshrun_n_s32(vaddq_s32(y1, c0.val[1]), THEORAPLAY_CVT_SHIFT))), \
+            vqmovn_u16(vcombine_u16(vqshrun_n_s32(vaddq_s32(y2, c1.val[0]), THEORAPLAY_CVT_SHIFT), \
+                                    vqshrun_n_s32(vaddq_s32(y3, c1.val[1]), THEORAPLAY_CVT_SHIFT))))
+        const uint8x16_t r8 = THEORAPLAY_CVT_NEON_CHANNEL(r0, r1);
+        const uint8x16_t g8 = THEORAPLAY_CVT_NEON_CHANNEL(g0, g1);
+        const uint8x16_t b8 = THEORAPLAY_CVT_NEON_CHANNEL(b0, b1);
+        #undef THEORAPLAY_CVT_NEON_CHANNEL
+
+        if (alpha)
+        {
+            uint8x16x4_t rgba;
+            rgba.val[0] = r8;
+            rgba.val[1] = g8;
+            rgba.val[2] = b8;
+            rgba.val[3] = vdupq_n_u8(0xFF);
+            vst4q_u8(dst + posx * 4, rgba);
+        } // if
+        else
+        {
+            uint8x16x3_t rgb;
+            rgb.val[0] = r8;
+            rgb.val[1] = g8;
+            rgb.val[2] = b8;
+            vst3q_u8(dst + posx * 3, rgb);
+        } // else
+    } // for
+#endif
+
+    // scalar version of the same fixed point math, also the tail of a SIMD row.
+    dst += posx * bpp;
+    for (; posx < w; posx++)
+    {
+        const int y = (((int) py[posx]) - 16) * THEORAPLAY_CVT_Y;
+        const int cb = ((int) pcb[posx / 2]) - 128;
+        const int cr = ((int) pcr[posx / 2]) - 128;
+        *(dst++) = ClampPixel((y + THEORAPLAY_CVT_R_CR * cr) >> THEORAPLAY_CVT_SHIFT);
+        *(dst++) = ClampPixel((y - THEORAPLAY_CVT_G_CB * cb - THEORAPLAY_CVT_G_CR * cr) >> THEORAPLAY_CVT_SHIFT);
+        *(dst++) = ClampPixel((y + THEORAPLAY_CVT_B_CB * cb) >> THEORAPLAY_CVT_SHIFT);
+        if (alpha)
+            *(dst++) = 0xFF;
+    } // for
+} // ConvertRow420
+#endif // THEORAPLAY_CVT_KERNELS
+
+static void THEORAPLAY_CVT_FNNAME_420(const th_info *tinfo,
+                                      const th_ycbcr_buffer ycbcr,
+                                      unsigned char *pixels)
 {
     const int w = tinfo->pic_width;
     const int h = tinfo->pic_height;
-    unsigned char *pixels = (unsigned char *) malloc(w * h * 4);
-    if (pixels)
+    const int ystride = ycbcr[0].stride;
+    const int cbstride = ycbcr[1].stride;
+    const int crstride = ycbcr[2].stride;
+    const int yoff = (tinfo->pic_x & ~1) + ystride * (tinfo->pic_y & ~1);
+    const int cboff = (tinfo->pic_x / 2) + (cbstride) * (tinfo->pic_y / 2);
+    const unsigned char *py = ycbcr[0].data + yoff;
+    const unsigned char *pcb = ycbcr[1].data + cboff;
+    const unsigned char *pcr = ycbcr[2].data + cboff;
+    const int pitch = w * (THEORAPLAY_CVT_RGB_ALPHA ? 4 : 3);
+    int posy;
+
+    for (posy = 0; posy < h; posy++, pixels += pitch)
     {
-        unsigned char *dst = pixels;
-        const int ystride = ycbcr[0].stride;
-        const int cbstride = ycbcr[1].stride;
-        const int crstride = ycbcr[2].stride;
-        const int yoff = (tinfo->pic_x & ~1) + ystride * (tinfo->pic_y & ~1);
-        const int cboff = (tinfo->pic_x / 2) + (cbstride) * (tinfo->pic_y / 2);
-        const unsigned char *py = ycbcr[0].data + yoff;
-        const unsigned char *pcb = ycbcr[1].data + cboff;
-        const unsigned char *pcr = ycbcr[2].data + cboff;
-        int posx, posy;
-
-        for (posy = 0; posy < h; posy++)
+        ConvertRow420(py, pcb, pcr, pixels, w, THEORAPLAY_CVT_RGB_ALPHA);
+
+        // adjust to the start of the next line.
+        py += ystride;
+        pcb += cbstride * (posy % 2);
+        pcr += crstride * (posy % 2);
+    } // for
+} // THEORAPLAY_CVT_FNNAME_420
+
+// The original floating point converter, kept as the reference for
+//  THEORAPLAY_convertFrame().
+static void THEORAPLAY_CVT_FNNAME_420_REFERENCE(const th_info *tinfo,
+                                                const th_ycbcr_buffer ycbcr,
+                                                unsigned char *pixels)
+{
+    const int w = tinfo->pic_width;
+    const int h = tinfo->pic_height;
+    unsigned char *dst = pixels;
+    const int ystride = ycbcr[0].stride;
+    const int cbstride = ycbcr[1].stride;
+    const int crstride = ycbcr[2].stride;
+    const int yoff = (tinfo->pic_x & ~1) + ystride * (tinfo->pic_y & ~1);
+    const int cboff = (tinfo->pic_x / 2) + (cbstride) * (tinfo->pic_y / 2);
+    const unsigned char *py = ycbcr[0].data + yoff;
+    const unsigned char *pcb = ycbcr[1].data + cboff;
+    const unsigned char *pcr = ycbcr[2].data + cboff;
+    int posx, posy;
+
+    for (posy = 0; posy < h; posy++)
+    {
+        for (posx = 0; posx < w; posx++)
         {
-            for (posx = 0; posx < w; posx++)
-            {
-                // http://www.theora.org/doc/Theora.pdf, 1.1 spec,
-                //  chapter 4.2 (Y'CbCr -> Y'PbPr -> R'G'B')
-                // These constants apparently work for NTSC _and_ PAL/SECAM.
-                const float yoffset = 16.0f;
-                const float yexcursion = 219.0f;
-                const float cboffset = 128.0f;
-                const float cbexcursion = 224.0f;
-                const float croffset = 128.0f;
-                const float crexcursion = 224.0f;
-                const float kr = 0.299f;
-                const float kb = 0.114f;
-
-                const float y = (((float) py[posx]) - yoffset) / yexcursion;
-                const float pb = (((float) pcb[posx / 2]) - cboffset) / cbexcursion;
-                const float pr = (((float) pcr[posx / 2]) - croffset) / crexcursion;
-                const float r = (y + (2.0f * (1.0f - kr) * pr)) * 255.0f;
-                const float g = (y - ((2.0f * (((1.0f - kb) * kb) / ((1.0f - kb) - kr))) * pb) - ((2.0f * (((1.0f - kr) * kr) / ((1.0f - kb) - kr))) * pr)) * 255.0f;
-                const float b = (y + (2.0f * (1.0f - kb) * pb)) * 255.0f;
-
-                *(dst++) = (unsigned char) ((r < 0.0f) ? 0.0f : (r > 255.0f) ? 255.0f : r);
-                *(dst++) = (unsigned char) ((g < 0.0f) ? 0.0f : (g > 255.0f) ? 255.0f : g);
-                *(dst++) = (unsigned char) ((b < 0.0f) ? 0.0f : (b > 255.0f) ? 255.0f : b);
-                #if THEORAPLAY_CVT_RGB_ALPHA
-                *(dst++) = 0xFF;
-                #endif
-            } // for
-
-            // adjust to the start of the next line.
-            py += ystride;
-            pcb += cbstride * (posy % 2);
-            pcr += crstride * (posy % 2);
+            // These constants apparently work for NTSC _and_ PAL/SECAM.
+            const float yoffset = 16.0f;
+            const float yexcursion = 219.0f;
+            const float cboffset = 128.0f;
+            const float cbexcursion = 224.0f;
+            const float croffset = 128.0f;
+            const float crexcursion = 224.0f;
+            const float kr = 0.299f;
+            const float kb = 0.114f;
+
+            const float y = (((float) py[posx]) - yoffset) / yexcursion;
+            const float pb = (((float) pcb[posx / 2]) - cboffset) / cbexcursion;
+            const float pr = (((float) pcr[posx / 2]) - croffset) / crexcursion;
+            const float r = (y + (2.0f * (1.0f - kr) * pr)) * 255.0f;
+            const float g = (y - ((2.0f * (((1.0f - kb) * kb) / ((1.0f - kb) - kr))) * pb) - ((2.0f * (((1.0f - kr) * kr) / ((1.0f - kb) - kr))) * pr)) * 255.0f;
+            const float b = (y + (2.0f * (1.0f - kb) * pb)) * 255.0f;
+
+            *(dst++) = (unsigned char) ((r < 0.0f) ? 0.0f : (r > 255.0f) ? 255.0f : r);
+            *(dst++) = (unsigned char) ((g < 0.0f) ? 0.0f : (g > 255.0f) ? 255.0f : g);
+            *(dst++) = (unsigned char) ((b < 0.0f) ? 0.0f : (b > 255.0f) ? 255.0f : b);
+            #if THEORAPLAY_CVT_RGB_ALPHA
+            *(dst++) = 0xFF;
+            #endif
         } // for
-    } // if
 
-    return pixels;
-} // THEORAPLAY_CVT_FNNAME_420
+        // adjust to the start of the next line.
+        py += ystride;
+        pcb += cbstride * (posy % 2);
+        pcr += crstride * (posy % 2);
+    } // for
+} // THEORAPLAY_CVT_FNNAME_420_REFERENCE
 
 // end of theoraplay_cvtrgb.h ...
 
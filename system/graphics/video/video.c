@@ -2,6 +2,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <assert.h>
+#include <sys/stat.h>
 
 #include <graphicsIncludes.h>
 
@@ -9,12 +10,15 @@
 
 #include "system/graphics/video/theoraplay/theoraplay.h"
 #include "system/debug/debug.h"
+#include "system/debug/profiler.h"
 #include "system/datatypes/datatypes.h"
 #include "system/datatypes/memory.h"
+#include "system/datatypes/string.h"
 #include "system/timer/timer.h"
 #include "system/io/io.h"
 #include "system/ui/input/input.h"
 #include "system/ui/window/window.h"
+#include "system/graphics/renderState.h"
 
 
 
@@ -129,10 +133,26 @@ typedef struct video_theora_frame_t {
 	long int fileCursor;
 } video_theora_frame_t;
 
+#if defined(SUPPORT_GLSL) && defined(SUPPORT_GL_FBO)
+/* Frames are decoded to YUV planes and converted to RGB on the GPU. The planes are uploaded as
+ * three luminance textures, half the bytes of an RGB frame, and drawn to the frame texture with
+ * a shader, so users of the frame texture see an RGB texture as before. A video falls back to
+ * converting frames on the CPU if the shader or the framebuffer can't be created or if the frame
+ * dimensions are odd. */
+#define VIDEO_GPU_YUV
+#endif
+
 typedef struct video_theora_t {
 	THEORAPLAY_Decoder *decoder;
 	video_theora_frame_t *currentFrame;
 	SDL_AudioSpec audioSpec;
+	THEORAPLAY_VideoFormat format;
+	/* the frame texture shows currentFrame */
+	int textureCurrent;
+#ifdef VIDEO_GPU_YUV
+	GLuint planeTextures[3];
+	GLuint framebuffer;
+#endif
 } video_theora_t;
 
 
@@ -143,6 +163,114 @@ static void freeFrameTheora(video_theora_frame_t **frame);
 //static int freeVideoFramesTheora(video_t *video);
 
 #define MAXFRAMES 0xFFFF
+/* seek index cache, named after the file path, size and modification time */
+#define VIDEO_INDEX_CACHE_DIRECTORY "videocache"
+#define VIDEO_INDEX_CACHE_PATH_SIZE 1024
+/* forward jumps longer than this seek instead of decoding through */
+#define VIDEO_SEEK_FORWARD_THRESHOLD 1.0
+#define VIDEO_DECODE_WAIT_SLICE_MS 100
+
+/*
+ * Theoraplay io reading a file mapped with ioMapFile(), used for videos that are only in the data archive.
+ */
+typedef struct {
+	THEORAPLAY_Io io;
+	unsigned char *data;
+	size_t size;
+	long position;
+} video_memory_io_t;
+
+static long videoMemoryIoRead(THEORAPLAY_Io *io, void *buf, long buflen)
+{
+	video_memory_io_t *memoryIo = (video_memory_io_t*)io;
+	long left = (long)memoryIo->size - memoryIo->position;
+	if (buflen > left)
+	{
+		buflen = left;
+	}
+	memcpy(buf, memoryIo->data + memoryIo->position, (size_t)buflen);
+	memoryIo->position += buflen;
+	return buflen;
+}
+
+static long videoMemoryIoSeek(THEORAPLAY_Io *io, long offset, int relative)
+{
+	video_memory_io_t *memoryIo = (video_memory_io_t*)io;
+	long position = relative == 1 ? memoryIo->position + offset : offset;
+	if (position < 0 || position > (long)memoryIo->size)
+	{
+		return -1;
+	}
+	memoryIo->position = position;
+	return 0;
+}
+
+static long int videoMemoryIoTell(THEORAPLAY_Io *io)
+{
+	return ((video_memory_io_t*)io)->position;
+}
+
+static void videoMemoryIoClose(THEORAPLAY_Io *io)
+{
+	video_memory_io_t *memoryIo = (video_memory_io_t*)io;
+	ioUnmapFile(memoryIo->data, memoryIo->size);
+	free(memoryIo);
+}
+
+static THEORAPLAY_Decoder* videoTheoraStartDecodeMapped(video_t *video)
+{
+	video_theora_t *codec = (video_theora_t*)video->codec;
+
+	size_t size = 0;
+	void *data = ioMapFile(video->filename, &size);
+	if (data == NULL)
+	{
+		return NULL;
+	}
+
+	video_memory_io_t *memoryIo = (video_memory_io_t*)malloc(sizeof(video_memory_io_t));
+	assert(memoryIo);
+	memoryIo->io.read = videoMemoryIoRead;
+	memoryIo->io.seek = videoMemoryIoSeek;
+	memoryIo->io.tell = videoMemoryIoTell;
+	memoryIo->io.close = videoMemoryIoClose;
+	memoryIo->io.userdata = NULL;
+	memoryIo->data = (unsigned char*)data;
+	memoryIo->size = size;
+	memoryIo->position = 0;
+
+	//the seek index is not cached for archived videos, it is built when the video is opened
+	return THEORAPLAY_startDecode(&memoryIo->io, MAXFRAMES, codec->format);
+}
+
+static THEORAPLAY_Decoder* videoTheoraStartDecode(video_t *video)
+{
+	video_theora_t *codec = (video_theora_t*)video->codec;
+
+	char path[VIDEO_INDEX_CACHE_PATH_SIZE];
+	const char *indexPath = NULL;
+	struct stat buffer;
+	if (stat(video->filename, &buffer) == 0)
+	{
+		snprintf(path, VIDEO_INDEX_CACHE_PATH_SIZE, "%s%s", getStartPath(), VIDEO_INDEX_CACHE_DIRECTORY);
+		if (ioMakeDirectory(path))
+		{
+			unsigned long long size = (unsigned long long)buffer.st_size;
+			unsigned long long modified = (unsigned long long)buffer.st_mtime;
+			unsigned long long key = hashFnv1a64(video->filename, strlen(video->filename), HASH_FNV1A64_INIT);
+			key = hashFnv1a64(&size, sizeof(size), key);
+			key = hashFnv1a64(&modified, sizeof(modified), key);
+			snprintf(path, VIDEO_INDEX_CACHE_PATH_SIZE, "%s%s/%016llx.idx", getStartPath(), VIDEO_INDEX_CACHE_DIRECTORY, key);
+			indexPath = path;
+		}
+	}
+	else
+	{
+		return videoTheoraStartDecodeMapped(video);
+	}
+
+	return THEORAPLAY_startDecodeFileIndexed(video->filename, indexPath, MAXFRAMES, codec->format);
+}
 
 static int loadVideoTheoraFrame(video_t *video, double time)
 {
@@ -155,33 +283,31 @@ static int loadVideoTheoraFrame(video_t *video, double time)
 		return 1;
 	}
 
-	if (codec->currentFrame != NULL && codec->currentFrame->video->playms/1000.0 > time+0.5)
-	{
-		THEORAPLAY_stopDecode(codec->decoder);
-		codec->decoder = NULL;
-	}
-
 	if (codec->decoder == NULL)
 	{
-		if (codec->decoder)
-		{
-			THEORAPLAY_stopDecode(codec->decoder);
-		}
-
 		debugPrintf("Start decode again '%s'",video->filename);
-		codec->decoder = THEORAPLAY_startDecodeFile(video->filename, MAXFRAMES, THEORAPLAY_VIDFMT_RGB);
+		codec->decoder = videoTheoraStartDecode(video);
 		if (!codec->decoder)
 		{
-			debugErrorPrintf("Could not decode file! '%s'");
+			debugErrorPrintf("Could not decode file! '%s'", video->filename);
 			return 0;
 		}
 
-		//freeVideoFramesTheora(video);
-
-		//THEORAPLAY_setDecodeTime(codec->decoder, 0.0);
+		if (time > VIDEO_SEEK_FORWARD_THRESHOLD)
+		{
+			THEORAPLAY_seek(codec->decoder, time);
+		}
+	}
+	else if (codec->currentFrame != NULL)
+	{
+		//decoding restarts from the nearest keyframe instead of the beginning of the file
+		double frameTime = codec->currentFrame->video->playms/1000.0;
+		if (frameTime > time+0.5 || time > frameTime+VIDEO_SEEK_FORWARD_THRESHOLD)
+		{
+			THEORAPLAY_seek(codec->decoder, time);
+		}
 	}
 
-	//unsigned int frame = time*video->fps;
 	THEORAPLAY_setDecodeTime(codec->decoder, time);
 
 	//loadVideoTheoraFrame(video, 0);
@@ -198,7 +324,7 @@ static int loadVideoTheoraFrame(video_t *video, double time)
 	int pauseWait = 0;
 	while(1)
 	{
-		video_frame = THEORAPLAY_getVideo(codec->decoder);
+		video_frame = THEORAPLAY_waitVideo(codec->decoder, VIDEO_DECODE_WAIT_SLICE_MS);
 
 		unsigned int wait_sum = SDL_GetTicks()-loadStart;
 		if (wait_sum > MAX_DECODE_WAIT_MS && pauseWait == 0)
@@ -275,6 +401,7 @@ static int loadVideoTheoraFrame(video_t *video, double time)
 		freeFrameTheora(&codec->currentFrame);
 	}
 	codec->currentFrame = frame;
+	codec->textureCurrent = 0;
 
 	assert(codec->currentFrame->video != NULL);
 	//debugPrintf("Loaded frame '%s'! dimensions:%dx%d, fps:%.2f, length:%.2f, time:%.3f", video->filename, codec->currentFrame->video->width, codec->currentFrame->video->height, codec->currentFrame->video->fps, codec->currentFrame->video->playms/1000.0, time);
@@ -379,6 +506,245 @@ static void freeFrameTheora(video_theora_frame_t **frame)
 	free(*frame);
 }
 
+#ifdef VIDEO_GPU_YUV
+static const char *videoYuvVertexShader =
+	"varying vec2 uv;\n"
+	"void main()\n"
+	"{\n"
+	"	uv = gl_Vertex.xy * 0.5 + 0.5;\n"
+	"	gl_Position = gl_Vertex;\n"
+	"}\n";
+
+/* same coefficients as the CPU conversion of theoraplay */
+static const char *videoYuvFragmentShader =
+	"uniform sampler2D yPlane;\n"
+	"uniform sampler2D cbPlane;\n"
+	"uniform sampler2D crPlane;\n"
+	"varying vec2 uv;\n"
+	"void main()\n"
+	"{\n"
+	"	float y = 1.164384 * (texture2D(yPlane, uv).r - 0.062745);\n"
+	"	float cb = texture2D(cbPlane, uv).r - 0.501961;\n"
+	"	float cr = texture2D(crPlane, uv).r - 0.501961;\n"
+	"	gl_FragColor = vec4(y + 1.596027 * cr, y - 0.391762 * cb - 0.812968 * cr, y + 2.017232 * cb, 1.0);\n"
+	"}\n";
+
+/* shared by all videos, created on first use */
+static GLuint videoYuvProgram = 0;
+static int videoYuvProgramFailed = 0;
+
+static GLuint videoYuvCompileShader(GLenum type, const char *source)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+
+	GLint status = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (!status)
+	{
+		char log[1024] = {'\0'};
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		debugWarningPrintf("Could not compile video YUV shader: %s", log);
+		glDeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+}
+
+static GLuint videoYuvGetProgram(void)
+{
+	if (videoYuvProgram != 0 || videoYuvProgramFailed)
+	{
+		return videoYuvProgram;
+	}
+
+	videoYuvProgramFailed = 1;
+	GLuint vertexShader = videoYuvCompileShader(GL_VERTEX_SHADER, videoYuvVertexShader);
+	GLuint fragmentShader = videoYuvCompileShader(GL_FRAGMENT_SHADER, videoYuvFragmentShader);
+	if (vertexShader != 0 && fragmentShader != 0)
+	{
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		glLinkProgram(program);
+
+		GLint status = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (status)
+		{
+			GLuint previousProgram = renderStateGetProgram();
+			renderStateUseProgram(program);
+			glUniform1i(glGetUniformLocation(program, "yPlane"), 0);
+			glUniform1i(glGetUniformLocation(program, "cbPlane"), 1);
+			glUniform1i(glGetUniformLocation(program, "crPlane"), 2);
+			renderStateUseProgram(previousProgram);
+
+			videoYuvProgram = program;
+			videoYuvProgramFailed = 0;
+		}
+		else
+		{
+			debugWarningPrintf("Could not link video YUV shader program");
+			glDeleteProgram(program);
+		}
+	}
+
+	//shaders are freed with the program
+	if (vertexShader != 0)
+	{
+		glDeleteShader(vertexShader);
+	}
+	if (fragmentShader != 0)
+	{
+		glDeleteShader(fragmentShader);
+	}
+
+	return videoYuvProgram;
+}
+
+static void videoTheoraGpuYuvDeinit(video_theora_t *codec)
+{
+	assert(codec);
+
+	if (codec->framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &codec->framebuffer);
+		codec->framebuffer = 0;
+	}
+	if (codec->planeTextures[0] != 0)
+	{
+		glDeleteTextures(3, codec->planeTextures);
+		memset(codec->planeTextures, 0, sizeof(codec->planeTextures));
+		renderStateInvalidateTextures();
+	}
+}
+
+/* Created on the first refresh instead of videoLoad() because videos may be loaded on a loader
+ * thread and framebuffers are not shared between contexts. */
+static int videoTheoraGpuYuvInit(video_t *video, unsigned int w, unsigned int h)
+{
+	assert(video);
+	video_theora_t *codec = (video_theora_t*)video->codec;
+
+	if (w % 2 != 0 || h % 2 != 0)
+	{
+		debugPrintf("Video '%s' has odd dimensions %dx%d, converting frames on the CPU", video->filename, w, h);
+		return 0;
+	}
+
+	if (videoYuvGetProgram() == 0)
+	{
+		return 0;
+	}
+
+	glGenTextures(3, codec->planeTextures);
+	int i;
+	for (i = 0; i < 3; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, codec->planeTextures[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, i ? w/2 : w, i ? h/2 : h, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	renderStateInvalidateTextures();
+
+	GLuint previousFramebuffer = renderStateGetFramebuffer();
+	glGenFramebuffers(1, &codec->framebuffer);
+	renderStateBindFramebuffer(GL_FRAMEBUFFER, codec->framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, video->frameTexture->id, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	renderStateBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		debugWarningPrintf("Could not render to the frame texture of video '%s' ('%X'), converting frames on the CPU", video->filename, status);
+		videoTheoraGpuYuvDeinit(codec);
+		return 0;
+	}
+
+	return 1;
+}
+
+/* restart decoding with RGB frames from the given time */
+static void videoTheoraUseCpuConversion(video_t *video, double time)
+{
+	assert(video);
+	video_theora_t *codec = (video_theora_t*)video->codec;
+
+	videoTheoraGpuYuvDeinit(codec);
+	codec->format = THEORAPLAY_VIDFMT_RGB;
+
+	if (codec->currentFrame)
+	{
+		freeFrameTheora(&codec->currentFrame);
+		codec->currentFrame = NULL;
+	}
+	if (codec->decoder)
+	{
+		THEORAPLAY_stopDecode(codec->decoder);
+		codec->decoder = NULL;
+	}
+
+	loadVideoTheoraFrame(video, time);
+}
+
+static void videoRefreshFrameGpuYuv(video_t *video, const THEORAPLAY_VideoFrame *videoFrame)
+{
+	video_theora_t *codec = (video_theora_t*)video->codec;
+
+	const unsigned int w = videoFrame->width;
+	const unsigned int h = videoFrame->height;
+	const unsigned char *planes[3] = {
+		videoFrame->pixels,
+		videoFrame->pixels + w*h,
+		videoFrame->pixels + w*h + (w/2)*(h/2)
+	};
+
+	profilerZoneBegin("videoUpload");
+	renderStatePushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	//chroma rows are not 4 byte aligned
+	glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	int i;
+	for (i = 2; i >= 0; i--)
+	{
+		renderStateActiveTexture(GL_TEXTURE0 + i);
+		renderStateBindTexture(GL_TEXTURE_2D, codec->planeTextures[i]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, i ? w/2 : w, i ? h/2 : h, GL_LUMINANCE, GL_UNSIGNED_BYTE, (const void*)planes[i]);
+	}
+	glPopClientAttrib();
+
+	GLuint previousFramebuffer = renderStateGetFramebuffer();
+	GLuint previousProgram = renderStateGetProgram();
+	renderStateBindFramebuffer(GL_FRAMEBUFFER, codec->framebuffer);
+	renderStateUseProgram(videoYuvProgram);
+	renderStateDisable(GL_BLEND);
+	renderStateDisable(GL_ALPHA_TEST);
+	renderStateDisable(GL_DEPTH_TEST);
+	renderStateDisable(GL_CULL_FACE);
+	glViewport(0, 0, w, h);
+
+	//the vertex shader ignores the matrices
+	glBegin(GL_QUADS);
+	glVertex2f(-1.0f, -1.0f);
+	glVertex2f( 1.0f, -1.0f);
+	glVertex2f( 1.0f,  1.0f);
+	glVertex2f(-1.0f,  1.0f);
+	glEnd();
+
+	renderStateUseProgram(previousProgram);
+	renderStateBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	renderStatePopAttrib();
+	profilerZoneEnd();
+}
+#endif
+
 static int freeVideoTheora(video_t *video)
 {
 	assert(video);
@@ -386,6 +752,10 @@ static int freeVideoTheora(video_t *video)
 
 	video_theora_t *codec = (video_theora_t*)video->codec;
 
+#ifdef VIDEO_GPU_YUV
+	videoTheoraGpuYuvDeinit(codec);
+#endif
+
 	//freeVideoFramesTheora(video);
 	if (codec->currentFrame)
 	{
@@ -427,6 +797,9 @@ video_t* videoInit(video_t *video)
 	video->freeVideo = NULL;
 	video->useAudio = 0;
 	video->loop = 0;
+	video->active = 0;
+	video->preroll = 0;
+	video->activityTracked = 0;
 	video->startTime = 0.0f;
 	video->pauseTime = 0.0f;
 	video->length = 0.0f;
@@ -479,6 +852,14 @@ video_t *videoLoad(const char *filename)
 		video_theora_t *codec = (video_theora_t*)video->codec;
 		codec->currentFrame = NULL;
 		codec->decoder = NULL;
+		codec->textureCurrent = 0;
+#ifdef VIDEO_GPU_YUV
+		codec->format = THEORAPLAY_VIDFMT_IYUV;
+		memset(codec->planeTextures, 0, sizeof(codec->planeTextures));
+		codec->framebuffer = 0;
+#else
+		codec->format = THEORAPLAY_VIDFMT_RGB;
+#endif
 	}
 	else
 	{
@@ -618,16 +999,38 @@ static void videoRefreshFrame(video_t *video)
 	const THEORAPLAY_VideoFrame *videoFrame = codec->currentFrame->video;
 	assert(videoFrame);
 
+#ifdef VIDEO_GPU_YUV
+	if (codec->format == THEORAPLAY_VIDFMT_IYUV)
+	{
+		if (codec->framebuffer != 0 || videoTheoraGpuYuvInit(video, videoFrame->width, videoFrame->height))
+		{
+			videoRefreshFrameGpuYuv(video, videoFrame);
+			codec->textureCurrent = 1;
+			return;
+		}
+
+		videoTheoraUseCpuConversion(video, videoFrame->playms/1000.0);
+		if (codec->currentFrame == NULL || codec->currentFrame->video == NULL)
+		{
+			return;
+		}
+		videoFrame = codec->currentFrame->video;
+	}
+#endif
+
 	const unsigned int w = videoFrame->width;
 	const unsigned int h = videoFrame->height;
 
-	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, video->frameTexture->id);
+	profilerZoneBegin("videoUpload");
+	renderStateEnable(GL_TEXTURE_2D);
+	renderStateBindTexture(GL_TEXTURE_2D, video->frameTexture->id);
 
 	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, (const void *)videoFrame->pixels);
 
-	glDisable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	renderStateDisable(GL_TEXTURE_2D);
+	renderStateBindTexture(GL_TEXTURE_2D, 0);
+	profilerZoneEnd();
+	codec->textureCurrent = 1;
 }
 
 void videoDraw(video_t *video)
@@ -681,9 +1084,86 @@ void videoDraw(video_t *video)
 		videoRefreshFrame(video);
 	}
 
-	if (codec->currentFrame->audio)
+	//CPU conversion fallback may have restarted decoding without a frame
+	if (codec->currentFrame && codec->currentFrame->audio)
 	{
 		while ((codec->currentFrame->audio = THEORAPLAY_getAudio(codec->decoder)) != NULL)
 			queue_audio(codec->currentFrame->audio);
 	}
 }
+
+/**
+ * Mark the video shown by an active animation. Once a video has been marked, videoUpdate()
+ * decodes it only in the frames after it has been marked or prerolled.
+ */
+void videoSetActive(video_t *video)
+{
+	assert(video);
+	video->active = 1;
+	video->activityTracked = 1;
+}
+
+/**
+ * Mark the video starting soon, videoUpdate() decodes its first frame ahead of time.
+ */
+void videoPreroll(video_t *video)
+{
+	assert(video);
+	video->preroll = 1;
+	video->activityTracked = 1;
+}
+
+static void videoPrerollFrame(video_t *video)
+{
+	assert(video->codecType == CODEC_THEORA);
+	video_theora_t *codec = (video_theora_t*)video->codec;
+
+	if (codec->currentFrame == NULL || codec->currentFrame->video == NULL || codec->currentFrame->video->playms != 0)
+	{
+		video->currentFrame = 0;
+		loadVideoTheoraFrame(video, 0.0);
+	}
+
+	if (codec->currentFrame && codec->currentFrame->video && !codec->textureCurrent)
+	{
+		videoRefreshFrame(video);
+	}
+}
+
+/* stop the decoder thread, the texture keeps the last frame and decoding seeks back when resumed */
+static void videoSuspend(video_t *video)
+{
+	assert(video->codecType == CODEC_THEORA);
+	video_theora_t *codec = (video_theora_t*)video->codec;
+
+	if (codec->decoder)
+	{
+		THEORAPLAY_stopDecode(codec->decoder);
+		codec->decoder = NULL;
+	}
+}
+
+/**
+ * Per frame update of a loaded video. Videos that have never been marked with videoSetActive() or
+ * videoPreroll() are always drawn, others only while animations use them.
+ */
+void videoUpdate(video_t *video)
+{
+	assert(video);
+
+	if (!video->activityTracked || video->active)
+	{
+		videoDraw(video);
+	}
+	else if (video->preroll)
+	{
+		videoPrerollFrame(video);
+	}
+	else
+	{
+		videoSuspend(video);
+	}
+
+	video->active = 0;
+	video->preroll = 0;
+}
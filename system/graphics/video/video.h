@@ -22,6 +22,10 @@ struct video_t {
 	int paused;
 	int useAudio;
 	int loop;
+	/* set by videoSetActive() and videoPreroll(), consumed by videoUpdate() */
+	int active;
+	int preroll;
+	int activityTracked;
 	texture_t *frameTexture;
 	int codecType;
 	void *codec;
@@ -44,6 +48,9 @@ extern void videoSetTime(video_t *video, float time);
 extern void videoStop(video_t *video);
 extern void videoPause(video_t *video);
 extern void videoDraw(video_t *video);
+extern void videoSetActive(video_t *video);
+extern void videoPreroll(video_t *video);
+extern void videoUpdate(video_t *video);
 
 #ifdef __cplusplus
 /* end 'extern "C"' wrapper */
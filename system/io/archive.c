@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#ifdef SUPPORT_LZ4
+#include <lz4.h>
+#endif
+
+#include "system/debug/debug.h"
+#include "system/thread/thread.h"
+#include "io.h"
+
+#include "archive.h"
+
+/**
+ * @defgroup archive Packed asset archive
+ * Read-only archive of data files built with the archive tool ("make archive").
+ * The archive is mapped to memory once and files are returned as views to the mapping, so reading
+ * an uncompressed file doesn't copy it. LZ4 compressed files are decompressed on the first access
+ * and kept until the archive is closed. The file functions of the io module look for files
+ * from the archive first, so loaders use it without changes.
+ * @ingroup io
+ */
+
+#define ARCHIVE_PATH_SIZE 2048
+
+static const char *archiveData = NULL;
+static size_t archiveSize = 0;
+static const archiveHeader_t *archiveHeader = NULL;
+static const archiveEntry_t *archiveEntries = NULL;
+static const uint32_t *archiveHash = NULL;
+static uint32_t archiveFileCount = 0;
+static uint32_t archiveHashSize = 0;
+/* decompressed data of compressed files, by entry index */
+static void **archiveDecompressed = NULL;
+
+static int archiveValidate(void)
+{
+	if (archiveSize < sizeof(archiveHeader_t))
+	{
+		return 0;
+	}
+
+	archiveHeader = (const archiveHeader_t*)archiveData;
+	if (ARCHIVE_U32(archiveHeader->magic) != ARCHIVE_MAGIC || ARCHIVE_U32(archiveHeader->version) != ARCHIVE_VERSION)
+	{
+		return 0;
+	}
+
+	archiveFileCount = ARCHIVE_U32(archiveHeader->fileCount);
+	archiveHashSize = ARCHIVE_U32(archiveHeader->hashSize);
+	if (archiveHashSize == 0 || (archiveHashSize & (archiveHashSize - 1)) != 0 || archiveFileCount >= archiveHashSize)
+	{
+		return 0;
+	}
+
+	size_t indexSize = sizeof(archiveHeader_t) + sizeof(archiveEntry_t) * (size_t)archiveFileCount + sizeof(uint32_t) * (size_t)archiveHashSize;
+	if (indexSize > archiveSize)
+	{
+		return 0;
+	}
+
+	archiveEntries = (const archiveEntry_t*)(archiveHeader + 1);
+	archiveHash = (const uint32_t*)(archiveEntries + archiveFileCount);
+
+	uint32_t i;
+	for (i = 0; i < archiveFileCount; i++)
+	{
+		const archiveEntry_t *entry = &archiveEntries[i];
+		//uncompressed files are returned as views of size bytes, so the stored data must be exactly that long
+		if (ARCHIVE_U32(entry->name) >= archiveSize
+			|| memchr(archiveData + ARCHIVE_U32(entry->name), '\0', archiveSize - ARCHIVE_U32(entry->name)) == NULL
+			|| (size_t)ARCHIVE_U32(entry->offset) + ARCHIVE_U32(entry->storedSize) > archiveSize
+			|| (!(ARCHIVE_U32(entry->flags) & ARCHIVE_FLAG_LZ4) && ARCHIVE_U32(entry->size) != ARCHIVE_U32(entry->storedSize)))
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * Map an archive to memory. A previously opened archive is closed.
+ * @param filename [in] archive path relative to the start path
+ * @return 1 on success, 0 if the file doesn't exist or is not a valid archive
+ * @ingroup archive
+ */
+int archiveOpen(const char *filename)
+{
+	archiveClose();
+
+	char path[ARCHIVE_PATH_SIZE];
+	snprintf(path, ARCHIVE_PATH_SIZE, "%s%s", getStartPath(), filename);
+	if (!fileExists(path))
+	{
+		return 0;
+	}
+
+	size_t size = 0;
+	void *data = ioMapFile(path, &size);
+	if (data == NULL)
+	{
+		return 0;
+	}
+
+	archiveData = (const char*)data;
+	archiveSize = size;
+	if (!archiveValidate())
+	{
+		debugErrorPrintf("Invalid archive '%s'", filename);
+		archiveData = NULL;
+		archiveSize = 0;
+		ioUnmapFile(data, size);
+		return 0;
+	}
+
+	archiveDecompressed = (void**)calloc(archiveFileCount ? archiveFileCount : 1, sizeof(void*));
+	assert(archiveDecompressed);
+
+	//paths resolved before may now be found from the archive
+	ioPathCacheInvalidate();
+
+	debugPrintf("Opened archive '%s', files: %u", filename, archiveFileCount);
+
+	return 1;
+}
+
+/**
+ * Unmap the archive. Views to the archive files are invalid after this.
+ * @ingroup archive
+ */
+void archiveClose(void)
+{
+	if (archiveData == NULL)
+	{
+		return;
+	}
+
+	uint32_t i;
+	for (i = 0; i < archiveFileCount; i++)
+	{
+		free(archiveDecompressed[i]);
+	}
+	free(archiveDecompressed);
+	archiveDecompressed = NULL;
+
+	//mark the archive closed first so that the mapping is not taken as an archive view
+	void *data = (void*)archiveData;
+	size_t size = archiveSize;
+	archiveData = NULL;
+	archiveSize = 0;
+	archiveFileCount = 0;
+	archiveHashSize = 0;
+	ioUnmapFile(data, size);
+}
+
+int archiveIsOpen(void)
+{
+	return archiveData != NULL;
+}
+
+/* archive names are relative to the start path */
+static const char* archiveGetName(const char *filename)
+{
+	const char *startPath = getStartPath();
+	size_t startPathLength = strlen(startPath);
+	if (startPathLength > 0 && !strncmp(filename, startPath, startPathLength))
+	{
+		filename += startPathLength;
+	}
+
+	while (filename[0] == '.' && filename[1] == '/')
+	{
+		filename += 2;
+	}
+
+	return filename;
+}
+
+static const archiveEntry_t* archiveFind(const char *filename)
+{
+	if (archiveData == NULL || filename == NULL)
+	{
+		return NULL;
+	}
+
+	const char *name = archiveGetName(filename);
+	uint32_t hash = archiveHashName(name);
+	uint32_t mask = archiveHashSize - 1;
+	uint32_t slot, probes;
+	for (slot = hash & mask, probes = 0; probes < archiveHashSize; slot = (slot + 1) & mask, probes++)
+	{
+		uint32_t index = ARCHIVE_U32(archiveHash[slot]);
+		if (index == 0 || index > archiveFileCount)
+		{
+			break;
+		}
+
+		const archiveEntry_t *entry = &archiveEntries[index - 1];
+		if (ARCHIVE_U32(entry->hash) == hash && !strcmp(archiveData + ARCHIVE_U32(entry->name), name))
+		{
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Check if the archive has a file.
+ * @param filename [in] file path, relative or starting with the start path
+ * @ingroup archive
+ */
+int archiveContains(const char *filename)
+{
+	return archiveFind(filename) != NULL;
+}
+
+/**
+ * Check if a pointer points to the archive mapping or to data decompressed from it.
+ * @ingroup archive
+ */
+int archiveIsArchiveData(const void *data)
+{
+	if (archiveData == NULL || data == NULL)
+	{
+		return 0;
+	}
+
+	if ((const char*)data >= archiveData && (const char*)data < archiveData + archiveSize)
+	{
+		return 1;
+	}
+
+	uint32_t i;
+	for (i = 0; i < archiveFileCount; i++)
+	{
+		if (archiveDecompressed[i] == data)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Get a read-only view of an archived file.
+ * @param filename [in] file path, relative or starting with the start path
+ * @param size [out] file size
+ * @return file data, valid until archiveClose(), or NULL if the file is not in the archive
+ * @ingroup archive
+ */
+const void* archiveGetFile(const char *filename, size_t *size)
+{
+	const archiveEntry_t *entry = archiveFind(filename);
+	if (entry == NULL)
+	{
+		return NULL;
+	}
+
+	const char *stored = archiveData + ARCHIVE_U32(entry->offset);
+	uint32_t fileSize = ARCHIVE_U32(entry->size);
+	*size = fileSize;
+	if (!(ARCHIVE_U32(entry->flags) & ARCHIVE_FLAG_LZ4))
+	{
+		return stored;
+	}
+
+#ifdef SUPPORT_LZ4
+	uint32_t index = (uint32_t)(entry - archiveEntries);
+	threadGlobalMutexLock();
+	if (archiveDecompressed[index] == NULL)
+	{
+		char *data = (char*)malloc(fileSize ? fileSize : 1);
+		assert(data);
+		int decompressedSize = LZ4_decompress_safe(stored, data, (int)ARCHIVE_U32(entry->storedSize), (int)fileSize);
+		if (decompressedSize != (int)fileSize)
+		{
+			debugErrorPrintf("Could not decompress '%s' from the archive", filename);
+			free(data);
+			data = NULL;
+		}
+		archiveDecompressed[index] = data;
+	}
+	const void *data = archiveDecompressed[index];
+	threadGlobalMutexUnlock();
+
+	return data;
+#else
+	debugErrorPrintf("File '%s' is LZ4 compressed in the archive but LZ4 support is not compiled in", filename);
+	return NULL;
+#endif
+}
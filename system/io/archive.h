@@ -0,0 +1,73 @@
+#ifndef SYSTEM_IO_ARCHIVE_H_
+#define SYSTEM_IO_ARCHIVE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARCHIVE_DEFAULT_FILE "data.pak"
+#define ARCHIVE_MAGIC 0x4B504544 /* "DEPK" */
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_DATA_ALIGN 16
+#define ARCHIVE_FLAG_LZ4 0x1
+
+#ifdef ENGINE_BIG_ENDIAN
+#define ARCHIVE_U32(value) ((((value) & 0xFF) << 24) | (((value) & 0xFF00) << 8) | (((value) >> 8) & 0xFF00) | (((value) >> 24) & 0xFF))
+#else
+#define ARCHIVE_U32(value) (value)
+#endif
+
+/*
+ * Archive layout, all values little endian:
+ * archiveHeader_t, archiveEntry_t[fileCount] sorted by name,
+ * uint32_t hash[hashSize] (entry index + 1, 0 = empty slot), NUL terminated names,
+ * file data aligned to ARCHIVE_DATA_ALIGN.
+ * Names are paths relative to the start path, e.g. "data/texture.png".
+ */
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t fileCount;
+	/* power of 2 */
+	uint32_t hashSize;
+} archiveHeader_t;
+
+typedef struct {
+	uint32_t name;
+	/* FNV-1a hash of the name */
+	uint32_t hash;
+	uint32_t flags;
+	uint32_t offset;
+	uint32_t storedSize;
+	uint32_t size;
+} archiveEntry_t;
+
+/* FNV-1a */
+static inline uint32_t archiveHashName(const char *name)
+{
+	uint32_t hash = 2166136261U;
+	for (; *name; name++)
+	{
+		hash ^= (unsigned char)*name;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+extern int archiveOpen(const char *filename);
+extern void archiveClose(void);
+extern int archiveIsOpen(void);
+extern int archiveContains(const char *filename);
+extern int archiveIsArchiveData(const void *data);
+extern const void* archiveGetFile(const char *filename, size_t *size);
+
+#ifdef __cplusplus
+/* end 'extern "C"' wrapper */
+}
+#endif
+
+#endif /* SYSTEM_IO_ARCHIVE_H_ */
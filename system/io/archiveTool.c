@@ -0,0 +1,309 @@
+/*
+ * Data archive tool. Packs data files into the archive that the engine maps at startup,
+ * see archive.h for the format. Built and run with "make archive".
+ *
+ * Usage: archiveTool [-lz4] <root directory> <output file> [directory...]
+ * Directories (default "data") are relative to the root directory, which is the engine start path.
+ * Music files are left out, SDL_mixer can only load music from a file on disk.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef SUPPORT_LZ4
+#include <lz4.h>
+#endif
+
+#include "archive.h"
+
+#define ARCHIVE_TOOL_PATH_SIZE 2048
+/* compressed data is stored only if it saves at least 1/8 of the size */
+#define ARCHIVE_TOOL_MIN_SAVING 8
+
+typedef struct {
+	char *name;
+	uint32_t size;
+} archiveToolFile_t;
+
+static archiveToolFile_t *files = NULL;
+static uint32_t fileCount = 0;
+static uint32_t fileCapacity = 0;
+static const char *outputName = NULL;
+
+static const char *diskOnlyExtensions[] = {".ogg", ".mp3", ".wav", ".mod", ".xm", ".s3m", ".it", NULL};
+
+static int isDiskOnlyFile(const char *name)
+{
+	size_t length = strlen(name);
+	int i;
+	for (i = 0; diskOnlyExtensions[i] != NULL; i++)
+	{
+		size_t extensionLength = strlen(diskOnlyExtensions[i]);
+		if (length >= extensionLength && !strcasecmp(name + length - extensionLength, diskOnlyExtensions[i]))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void addFile(const char *name, uint32_t size)
+{
+	if (fileCount == fileCapacity)
+	{
+		fileCapacity = fileCapacity ? fileCapacity * 2 : 256;
+		files = (archiveToolFile_t*)realloc(files, sizeof(archiveToolFile_t) * fileCapacity);
+		if (files == NULL)
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	files[fileCount].name = strdup(name);
+	files[fileCount].size = size;
+	fileCount++;
+}
+
+static void addDirectory(const char *directory)
+{
+	DIR *dir = opendir(directory);
+	if (dir == NULL)
+	{
+		fprintf(stderr, "Could not open directory '%s'\n", directory);
+		return;
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (entry->d_name[0] == '.')
+		{
+			continue;
+		}
+
+		char path[ARCHIVE_TOOL_PATH_SIZE];
+		snprintf(path, ARCHIVE_TOOL_PATH_SIZE, "%s/%s", directory, entry->d_name);
+
+		struct stat buffer;
+		if (stat(path, &buffer) != 0)
+		{
+			continue;
+		}
+
+		if (S_ISDIR(buffer.st_mode))
+		{
+			addDirectory(path);
+		}
+		else if (S_ISREG(buffer.st_mode) && strcmp(path, outputName))
+		{
+			if ((unsigned long long)buffer.st_size > 0xFFFFFFFFULL)
+			{
+				fprintf(stderr, "File '%s' is too large, skipped\n", path);
+				continue;
+			}
+			if (isDiskOnlyFile(path))
+			{
+				printf("File '%s' is kept on disk\n", path);
+				continue;
+			}
+			addFile(path, (uint32_t)buffer.st_size);
+		}
+	}
+
+	closedir(dir);
+}
+
+static int compareFiles(const void *a, const void *b)
+{
+	return strcmp(((const archiveToolFile_t*)a)->name, ((const archiveToolFile_t*)b)->name);
+}
+
+static char* readFile(const char *name, uint32_t size)
+{
+	char *data = (char*)malloc(size ? size : 1);
+	FILE *f = fopen(name, "rb");
+	if (data == NULL || f == NULL || fread(data, 1, size, f) != size)
+	{
+		fprintf(stderr, "Could not read file '%s'\n", name);
+		exit(EXIT_FAILURE);
+	}
+	fclose(f);
+
+	return data;
+}
+
+static void writeData(FILE *f, const void *data, size_t size)
+{
+	if (size > 0 && fwrite(data, size, 1, f) != 1)
+	{
+		fprintf(stderr, "Could not write to '%s'\n", outputName);
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int compress = 0;
+	int argument = 1;
+	if (argument < argc && !strcmp(argv[argument], "-lz4"))
+	{
+#ifdef SUPPORT_LZ4
+		compress = 1;
+#else
+		fprintf(stderr, "LZ4 support is not compiled in, files are stored uncompressed\n");
+#endif
+		argument++;
+	}
+
+	if (argc - argument < 2)
+	{
+		printf("Usage: %s [-lz4] <root directory> <output file> [directory...]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (chdir(argv[argument]) != 0)
+	{
+		fprintf(stderr, "Could not change to directory '%s'\n", argv[argument]);
+		return EXIT_FAILURE;
+	}
+	outputName = argv[argument + 1];
+	argument += 2;
+
+	if (argument == argc)
+	{
+		addDirectory("data");
+	}
+	for (; argument < argc; argument++)
+	{
+		addDirectory(argv[argument]);
+	}
+	qsort(files, fileCount, sizeof(archiveToolFile_t), compareFiles);
+
+	uint32_t hashSize = 16;
+	while (hashSize < fileCount * 2)
+	{
+		hashSize *= 2;
+	}
+
+	archiveEntry_t *entries = (archiveEntry_t*)calloc(fileCount ? fileCount : 1, sizeof(archiveEntry_t));
+	uint32_t *hash = (uint32_t*)calloc(hashSize, sizeof(uint32_t));
+	if (entries == NULL || hash == NULL)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return EXIT_FAILURE;
+	}
+
+	//names follow the index
+	uint32_t offset = sizeof(archiveHeader_t) + sizeof(archiveEntry_t) * fileCount + sizeof(uint32_t) * hashSize;
+	uint32_t i;
+	for (i = 0; i < fileCount; i++)
+	{
+		uint32_t nameHash = archiveHashName(files[i].name);
+		entries[i].name = ARCHIVE_U32(offset);
+		entries[i].hash = ARCHIVE_U32(nameHash);
+		offset += (uint32_t)strlen(files[i].name) + 1;
+
+		uint32_t slot = nameHash & (hashSize - 1);
+		while (hash[slot])
+		{
+			slot = (slot + 1) & (hashSize - 1);
+		}
+		hash[slot] = ARCHIVE_U32(i + 1);
+	}
+
+	FILE *f = fopen(outputName, "wb");
+	if (f == NULL)
+	{
+		fprintf(stderr, "Could not open '%s' for writing\n", outputName);
+		return EXIT_FAILURE;
+	}
+
+	//the index is written again when the data offsets are known
+	archiveHeader_t header;
+	header.magic = ARCHIVE_U32(ARCHIVE_MAGIC);
+	header.version = ARCHIVE_U32(ARCHIVE_VERSION);
+	header.fileCount = ARCHIVE_U32(fileCount);
+	header.hashSize = ARCHIVE_U32(hashSize);
+	writeData(f, &header, sizeof(header));
+	writeData(f, entries, sizeof(archiveEntry_t) * fileCount);
+	writeData(f, hash, sizeof(uint32_t) * hashSize);
+	for (i = 0; i < fileCount; i++)
+	{
+		writeData(f, files[i].name, strlen(files[i].name) + 1);
+	}
+
+	unsigned long long storedTotal = 0, sizeTotal = 0;
+	const char padding[ARCHIVE_DATA_ALIGN] = {0};
+	for (i = 0; i < fileCount; i++)
+	{
+		uint32_t align = (ARCHIVE_DATA_ALIGN - offset % ARCHIVE_DATA_ALIGN) % ARCHIVE_DATA_ALIGN;
+		writeData(f, padding, align);
+		offset += align;
+
+		char *data = readFile(files[i].name, files[i].size);
+		const char *stored = data;
+		uint32_t storedSize = files[i].size;
+		uint32_t flags = 0;
+#ifdef SUPPORT_LZ4
+		char *compressed = NULL;
+		if (compress && files[i].size > 0)
+		{
+			int bound = LZ4_compressBound((int)files[i].size);
+			compressed = (char*)malloc((size_t)bound);
+			int compressedSize = compressed ? LZ4_compress_default(data, compressed, (int)files[i].size, bound) : 0;
+			if (compressedSize > 0 && (uint32_t)compressedSize < files[i].size - files[i].size / ARCHIVE_TOOL_MIN_SAVING)
+			{
+				stored = compressed;
+				storedSize = (uint32_t)compressedSize;
+				flags |= ARCHIVE_FLAG_LZ4;
+			}
+		}
+#endif
+		writeData(f, stored, storedSize);
+
+		if ((unsigned long long)offset + storedSize > 0xFFFFFFFFULL)
+		{
+			fprintf(stderr, "Archive exceeds 4 GB\n");
+			return EXIT_FAILURE;
+		}
+
+		entries[i].flags = ARCHIVE_U32(flags);
+		entries[i].offset = ARCHIVE_U32(offset);
+		entries[i].storedSize = ARCHIVE_U32(storedSize);
+		entries[i].size = ARCHIVE_U32(files[i].size);
+		offset += storedSize;
+		storedTotal += storedSize;
+		sizeTotal += files[i].size;
+
+#ifdef SUPPORT_LZ4
+		free(compressed);
+#endif
+		free(data);
+	}
+
+	if (fseek(f, sizeof(archiveHeader_t), SEEK_SET) != 0)
+	{
+		fprintf(stderr, "Could not write the index of '%s'\n", outputName);
+		return EXIT_FAILURE;
+	}
+	writeData(f, entries, sizeof(archiveEntry_t) * fileCount);
+	fclose(f);
+
+	printf("Archived %u files to '%s': %llu bytes, stored %llu bytes%s\n",
+		fileCount, outputName, sizeTotal, storedTotal, compress ? " (LZ4)" : "");
+
+	for (i = 0; i < fileCount; i++)
+	{
+		free(files[i].name);
+	}
+	free(files);
+	free(entries);
+	free(hash);
+
+	return EXIT_SUCCESS;
+}
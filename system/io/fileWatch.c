@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <errno.h>
+#include <sys/inotify.h>
+#define FILE_WATCH_INOTIFY
+#endif
+
+#include "system/debug/debug.h"
+#include "system/thread/thread.h"
+#include "system/timer/timer.h"
+#include "io.h"
+
+#include "fileWatch.h"
+
+/**
+ * @defgroup fileWatch File change notifications
+ * Hot reload of the editor mode. Loaders register the files they load with a callback that
+ * reloads the resource, fileWatchUpdate() delivers the changes once per frame.
+ * On Linux the changes are read from inotify, which costs a single non-blocking read per frame
+ * regardless of the amount of watched files. The directories of the files are watched instead of
+ * the files themselves, so that editors which save by replacing the file are noticed.
+ * Elsewhere, or if inotify can't be initialized, the files are polled with fileModified()
+ * every FILE_WATCH_POLL_INTERVAL seconds.
+ * @ingroup io
+ */
+
+#define FILE_WATCH_POLL_INTERVAL 0.1
+
+typedef struct {
+	char *filename;
+	/* file name without the directory, compared to the inotify event names */
+	const char *basename;
+	fileWatchCallback_t callback;
+	void *userData;
+	int directoryWatch;
+	time_t fileLastModifiedTime;
+	int changed;
+} fileWatch_t;
+
+static fileWatch_t *fileWatches = NULL;
+static unsigned int fileWatchesCount = 0;
+static unsigned int fileWatchesCapacity = 0;
+static int fileWatchEnabled = 0;
+static double fileWatchLastPoll = 0.0;
+
+#ifdef FILE_WATCH_INOTIFY
+#define FILE_WATCH_EVENT_MASK (IN_CLOSE_WRITE | IN_MOVED_TO)
+#define FILE_WATCH_BUFFER_SIZE 4096
+
+static int fileWatchFd = -1;
+
+static int fileWatchAddDirectory(const char *filename)
+{
+	char directory[2048];
+	const char *separator = strrchr(filename, '/');
+	if (separator == NULL)
+	{
+		snprintf(directory, sizeof(directory), ".");
+	}
+	else
+	{
+		snprintf(directory, sizeof(directory), "%.*s", (int)(separator - filename + 1), filename);
+	}
+
+	//inotify returns the existing watch descriptor if the directory is already watched
+	int directoryWatch = inotify_add_watch(fileWatchFd, directory, FILE_WATCH_EVENT_MASK);
+	if (directoryWatch < 0)
+	{
+		debugWarningPrintf("Could not watch directory '%s', file '%s' is polled", directory, filename);
+	}
+
+	return directoryWatch;
+}
+
+static void fileWatchMarkChanged(int directoryWatch, const char *name)
+{
+	unsigned int i;
+	for (i = 0; i < fileWatchesCount; i++)
+	{
+		fileWatch_t *fileWatch = &fileWatches[i];
+		if (fileWatch->directoryWatch == directoryWatch && (name == NULL || !strcmp(fileWatch->basename, name)))
+		{
+			fileWatch->changed = 1;
+		}
+	}
+}
+
+static void fileWatchReadEvents(void)
+{
+	char buffer[FILE_WATCH_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+	for (;;)
+	{
+		ssize_t length = read(fileWatchFd, buffer, sizeof(buffer));
+		if (length <= 0)
+		{
+			if (length < 0 && errno != EAGAIN && errno != EINTR)
+			{
+				debugWarningPrintf("Could not read file change events");
+			}
+			break;
+		}
+
+		char *position = buffer;
+		while (position < buffer + length)
+		{
+			const struct inotify_event *event = (const struct inotify_event*)position;
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				//events were lost, reload everything to be safe
+				unsigned int i;
+				for (i = 0; i < fileWatchesCount; i++)
+				{
+					fileWatches[i].changed = 1;
+				}
+			}
+			else if (event->mask & IN_IGNORED)
+			{
+				//directory was removed, fall back to polling its files
+				unsigned int i;
+				for (i = 0; i < fileWatchesCount; i++)
+				{
+					if (fileWatches[i].directoryWatch == event->wd)
+					{
+						fileWatches[i].directoryWatch = -1;
+					}
+				}
+			}
+			else if (event->len > 0)
+			{
+				fileWatchMarkChanged(event->wd, event->name);
+			}
+
+			position += sizeof(struct inotify_event) + event->len;
+		}
+	}
+}
+#endif
+
+/**
+ * Start delivering file changes. Without this fileWatchAdd() doesn't do anything.
+ * @return 1 if changes are event driven, 0 if files are polled
+ * @ingroup fileWatch
+ */
+int fileWatchInit(void)
+{
+	fileWatchEnabled = 1;
+	fileWatchLastPoll = timerGetSeconds();
+
+#ifdef FILE_WATCH_INOTIFY
+	fileWatchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fileWatchFd < 0)
+	{
+		debugWarningPrintf("Could not initialize inotify, modified files are polled");
+	}
+#endif
+
+	debugPrintf("File watch initialized, %s", fileWatchIsEventDriven() ? "event driven" : "polling");
+
+	return fileWatchIsEventDriven();
+}
+
+void fileWatchDeinit(void)
+{
+	threadGlobalMutexLock();
+
+	unsigned int i;
+	for (i = 0; i < fileWatchesCount; i++)
+	{
+		free(fileWatches[i].filename);
+	}
+	free(fileWatches);
+	fileWatches = NULL;
+	fileWatchesCount = fileWatchesCapacity = 0;
+
+#ifdef FILE_WATCH_INOTIFY
+	if (fileWatchFd >= 0)
+	{
+		close(fileWatchFd);
+		fileWatchFd = -1;
+	}
+#endif
+	fileWatchEnabled = 0;
+
+	threadGlobalMutexUnlock();
+}
+
+int fileWatchIsEnabled(void)
+{
+	return fileWatchEnabled;
+}
+
+int fileWatchIsEventDriven(void)
+{
+#ifdef FILE_WATCH_INOTIFY
+	return fileWatchFd >= 0;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Watch a file for modifications. The same callback and user data are registered only once per file.
+ * @param filename [in] file path, copied
+ * @param callback [in] called from fileWatchUpdate() when the file has been modified
+ * @param userData [in] passed to the callback, also identifies the watch for fileWatchRemove()
+ * @ingroup fileWatch
+ */
+void fileWatchAdd(const char *filename, fileWatchCallback_t callback, void *userData)
+{
+	assert(callback);
+	if (!fileWatchEnabled || filename == NULL)
+	{
+		return;
+	}
+
+	threadGlobalMutexLock();
+
+	unsigned int i;
+	for (i = 0; i < fileWatchesCount; i++)
+	{
+		fileWatch_t *fileWatch = &fileWatches[i];
+		if (fileWatch->callback == callback && fileWatch->userData == userData && !strcmp(fileWatch->filename, filename))
+		{
+			threadGlobalMutexUnlock();
+			return;
+		}
+	}
+
+	if (fileWatchesCount == fileWatchesCapacity)
+	{
+		fileWatchesCapacity = fileWatchesCapacity ? fileWatchesCapacity * 2 : 64;
+		fileWatches = (fileWatch_t*)realloc(fileWatches, sizeof(fileWatch_t) * fileWatchesCapacity);
+		assert(fileWatches);
+	}
+
+	fileWatch_t *fileWatch = &fileWatches[fileWatchesCount++];
+	fileWatch->filename = strdup(filename);
+	assert(fileWatch->filename);
+	const char *separator = strrchr(fileWatch->filename, '/');
+	fileWatch->basename = separator ? separator + 1 : fileWatch->filename;
+	fileWatch->callback = callback;
+	fileWatch->userData = userData;
+	fileWatch->directoryWatch = -1;
+	fileWatch->changed = 0;
+	fileWatch->fileLastModifiedTime = 0;
+	fileModified(fileWatch->filename, &fileWatch->fileLastModifiedTime);
+
+#ifdef FILE_WATCH_INOTIFY
+	if (fileWatchFd >= 0)
+	{
+		fileWatch->directoryWatch = fileWatchAddDirectory(fileWatch->filename);
+	}
+#endif
+
+	threadGlobalMutexUnlock();
+}
+
+/**
+ * Stop watching all files registered with the user data, e.g. when the resource is freed.
+ * @ingroup fileWatch
+ */
+void fileWatchRemove(void *userData)
+{
+	threadGlobalMutexLock();
+
+	unsigned int i, count = 0;
+	for (i = 0; i < fileWatchesCount; i++)
+	{
+		if (fileWatches[i].userData == userData)
+		{
+			free(fileWatches[i].filename);
+		}
+		else
+		{
+			fileWatches[count++] = fileWatches[i];
+		}
+	}
+	fileWatchesCount = count;
+
+	threadGlobalMutexUnlock();
+}
+
+/**
+ * Deliver the file changes since the previous call. Callbacks are called from the calling thread,
+ * they must not remove watches.
+ * @ingroup fileWatch
+ */
+void fileWatchUpdate(void)
+{
+	if (!fileWatchEnabled)
+	{
+		return;
+	}
+
+	threadGlobalMutexLock();
+
+	int poll = 0;
+#ifdef FILE_WATCH_INOTIFY
+	if (fileWatchFd >= 0)
+	{
+		fileWatchReadEvents();
+	}
+#endif
+
+	double now = timerGetSeconds();
+	if (now > fileWatchLastPoll + FILE_WATCH_POLL_INTERVAL)
+	{
+		poll = 1;
+		fileWatchLastPoll = now;
+	}
+
+	unsigned int i;
+	for (i = 0; i < fileWatchesCount; i++)
+	{
+		fileWatch_t *fileWatch = &fileWatches[i];
+		if (fileWatch->changed)
+		{
+			//keep the time up to date for the polling fallback
+			fileModified(fileWatch->filename, &fileWatch->fileLastModifiedTime);
+		}
+		else if (poll && fileWatch->directoryWatch < 0)
+		{
+			if (fileModified(fileWatch->filename, &fileWatch->fileLastModifiedTime) == 1)
+			{
+				fileWatch->changed = 1;
+			}
+		}
+	}
+
+	//callbacks may add watches, so the array is indexed again on every round
+	for (i = 0; i < fileWatchesCount; i++)
+	{
+		if (fileWatches[i].changed)
+		{
+			fileWatches[i].changed = 0;
+			debugPrintf("File '%s' has been modified", fileWatches[i].filename);
+			fileWatches[i].callback(fileWatches[i].filename, fileWatches[i].userData);
+		}
+	}
+
+	threadGlobalMutexUnlock();
+}
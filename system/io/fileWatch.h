@@ -0,0 +1,28 @@
+#ifndef SYSTEM_IO_FILEWATCH_H_
+#define SYSTEM_IO_FILEWATCH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Called from fileWatchUpdate() when a watched file has been modified.
+ * @param filename [in] path of the file as it was given to fileWatchAdd()
+ * @param userData [in] pointer given to fileWatchAdd()
+ */
+typedef void (*fileWatchCallback_t)(const char *filename, void *userData);
+
+extern int fileWatchInit(void);
+extern void fileWatchDeinit(void);
+extern int fileWatchIsEnabled(void);
+extern int fileWatchIsEventDriven(void);
+extern void fileWatchAdd(const char *filename, fileWatchCallback_t callback, void *userData);
+extern void fileWatchRemove(void *userData);
+extern void fileWatchUpdate(void);
+
+#ifdef __cplusplus
+/* end 'extern "C"' wrapper */
+}
+#endif
+
+#endif /* SYSTEM_IO_FILEWATCH_H_ */
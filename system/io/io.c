@@ -6,10 +6,20 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#ifdef WINDOWS
+#include <direct.h>
+#elif !defined(MORPHOS)
+#include <sys/mman.h>
+#define IO_MMAP
+#endif
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
 
 #include "system/debug/debug.h"
-#include "system/datatypes/memory.h"
+#include "system/thread/thread.h"
 #include "system/datatypes/datatypes.h"
+#include "archive.h"
 #include "io.h"
 
 #define PATH_SIZE 2048
@@ -36,10 +46,38 @@ void setStartPath(const char *executablePath)
 	debugPrintf("Start path: '%s'", startPath);
 }
 
+/**
+ * Check if a file exists in the data archive or on disk.
+ */
 int fileExists(const char *filename)
 {
 	struct stat buffer;   
-	return (filename && stat(filename, &buffer) == 0);
+	return (filename && (archiveContains(filename) || stat(filename, &buffer) == 0));
+}
+
+/**
+ * Create a directory if it does not exist.
+ * @param path [in] directory path
+ * @return 1 if the directory exists or was created, 0 otherwise
+ */
+int ioMakeDirectory(const char *path)
+{
+	if (fileExists(path))
+	{
+		return 1;
+	}
+
+#ifdef WINDOWS
+	if (_mkdir(path) != 0)
+#else
+	if (mkdir(path, 0755) != 0)
+#endif
+	{
+		debugWarningPrintf("Could not create directory '%s'", path);
+		return 0;
+	}
+
+	return 1;
 }
 
 int fileModified(const char *filename, time_t *fileLastModifiedTime)
@@ -61,11 +99,122 @@ int fileModified(const char *filename, time_t *fileLastModifiedTime)
 	return -1;
 }
 
-const char* getFilePath(const char *filename)
+/**
+ * @defgroup ioPath File path resolving
+ * Resolved file paths are cached by the requested name, also the paths of missing files so that
+ * failed lookups don't stat again. Paths are interned: the same path is always returned as the
+ * same string that stays valid until ioDeinit(), callers must not free it.
+ * The cache must be invalidated with ioPathCacheInvalidate() when files may have been added,
+ * removed or renamed, e.g. when hot reload notices a modified file.
+ */
+
+typedef struct {
+	const char *key;
+	/* resolved path, unused in the intern table */
+	const char *path;
+	unsigned int hash;
+} ioStringEntry_t;
+
+typedef struct {
+	ioStringEntry_t *entries;
+	unsigned int size;
+	unsigned int count;
+} ioStringTable_t;
+
+#define IO_STRING_TABLE_INITIAL_SIZE 64
+
+static ioStringTable_t ioPathCache = {NULL, 0, 0};
+static ioStringTable_t ioInternedStrings = {NULL, 0, 0};
+
+/* FNV-1a */
+static unsigned int ioHashString(const char *string)
+{
+	unsigned int hash = 2166136261U;
+	for (; *string; string++)
+	{
+		hash ^= (unsigned char)*string;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+static void ioStringTableResize(ioStringTable_t *table, unsigned int size)
+{
+	ioStringEntry_t *entries = (ioStringEntry_t*)calloc(size, sizeof(ioStringEntry_t));
+	assert(entries);
+
+	unsigned int i;
+	for (i = 0; i < table->size; i++)
+	{
+		if (table->entries[i].key)
+		{
+			unsigned int slot = table->entries[i].hash & (size - 1);
+			while (entries[slot].key)
+			{
+				slot = (slot + 1) & (size - 1);
+			}
+			entries[slot] = table->entries[i];
+		}
+	}
+
+	free(table->entries);
+	table->entries = entries;
+	table->size = size;
+}
+
+/**
+ * Find the entry of the key or the empty entry where the key can be inserted.
+ * The table is kept at most half full.
+ */
+static ioStringEntry_t* ioStringTableFind(ioStringTable_t *table, const char *key, unsigned int hash)
+{
+	if ((table->count + 1) * 2 > table->size)
+	{
+		ioStringTableResize(table, table->size ? table->size * 2 : IO_STRING_TABLE_INITIAL_SIZE);
+	}
+
+	unsigned int slot = hash & (table->size - 1);
+	while (table->entries[slot].key)
+	{
+		if (table->entries[slot].hash == hash && !strcmp(table->entries[slot].key, key))
+		{
+			break;
+		}
+		slot = (slot + 1) & (table->size - 1);
+	}
+
+	return &table->entries[slot];
+}
+
+static void ioStringTableFree(ioStringTable_t *table)
+{
+	free(table->entries);
+	table->entries = NULL;
+	table->size = 0;
+	table->count = 0;
+}
+
+static const char* ioInternString(const char *string)
+{
+	unsigned int hash = ioHashString(string);
+	ioStringEntry_t *entry = ioStringTableFind(&ioInternedStrings, string, hash);
+	if (entry->key == NULL)
+	{
+		entry->key = strdup(string);
+		assert(entry->key);
+		entry->hash = hash;
+		ioInternedStrings.count++;
+	}
+
+	return entry->key;
+}
+
+static const char* ioResolveFilePath(const char *filename)
 {
 	if (fileExists(filename))
 	{
-		return filename;
+		return ioInternString(filename);
 	}
 
 	//Windows hooligans away!
@@ -75,15 +224,14 @@ const char* getFilePath(const char *filename)
 		assert(strchr((const char*)filename, '\\') == NULL);
 	}
 	
-	char *file = (char*)memoryAllocateGeneral(NULL, PATH_SIZE*sizeof(char), NULL);
-	
+	char file[PATH_SIZE];
 	snprintf(file, PATH_SIZE, "%s", filename);
 	if (strchr((const char*)file, '/') == NULL)
 	{
 		snprintf(file, PATH_SIZE, "data/%s", filename);
 	}
-	char fullPath[PATH_SIZE];
-	snprintf(fullPath, PATH_SIZE, "%s%s", startPath, file);
+	char fullPath[PATH_SIZE * 2];
+	snprintf(fullPath, sizeof(fullPath), "%s%s", startPath, file);
 
 	if (!fileExists((const char*)fullPath))
 	{
@@ -98,49 +246,231 @@ const char* getFilePath(const char *filename)
 			file[strlen((const char*)file)-4] = '\0';
 			strncat(file, ".png", PATH_SIZE-strlen(file)-1);
 		}
+
+		snprintf(fullPath, sizeof(fullPath), "%s%s", startPath, file);
+		if (!fileExists((const char*)fullPath))
+		{
+			debugWarningPrintf("Couldn't find file '%s'!", filename);
+		}
 	}
 
-	snprintf(fullPath, PATH_SIZE, "%s%s", startPath, file);
-	snprintf(file, PATH_SIZE, "%s", fullPath);
-	if (!fileExists((const char*)file))
+	return ioInternString(fullPath);
+}
+
+/**
+ * Resolve the path of a data file: the name as is, under "data/" if it has no directory,
+ * relative to the start path and finally in lower case.
+ * @param filename [in] file name
+ * @return interned path, valid until ioDeinit()
+ * @ingroup ioPath
+ */
+const char* getFilePath(const char *filename)
+{
+	assert(filename);
+
+	threadGlobalMutexLock();
+
+	unsigned int hash = ioHashString(filename);
+	ioStringEntry_t *entry = ioStringTableFind(&ioPathCache, filename, hash);
+	if (entry->key == NULL)
 	{
-		debugWarningPrintf("Couldn't find file '%s'!", filename);
+		entry->path = ioResolveFilePath(filename);
+		entry->key = ioInternString(filename);
+		entry->hash = hash;
+		ioPathCache.count++;
 	}
-	
-	file = (char*)memoryAllocateGeneral((void*)file, sizeof(char)*(strlen(file)+1), NULL);
-	
-	return (const char*)file;
+	const char *path = entry->path;
+
+	threadGlobalMutexUnlock();
+
+	return path;
+}
+
+/**
+ * Forget resolved paths so that the next getFilePath() calls look for the files again.
+ * Interned paths stay valid.
+ * @ingroup ioPath
+ */
+void ioPathCacheInvalidate(void)
+{
+	threadGlobalMutexLock();
+
+	if (ioPathCache.entries)
+	{
+		memset(ioPathCache.entries, 0, sizeof(ioStringEntry_t) * ioPathCache.size);
+	}
+	ioPathCache.count = 0;
+
+	threadGlobalMutexUnlock();
+}
+
+/**
+ * Release the path cache and the interned paths.
+ * @ingroup ioPath
+ */
+void ioDeinit(void)
+{
+	archiveClose();
+	ioStringTableFree(&ioPathCache);
+
+	unsigned int i;
+	for (i = 0; i < ioInternedStrings.size; i++)
+	{
+		free((void*)ioInternedStrings.entries[i].key);
+	}
+	ioStringTableFree(&ioInternedStrings);
 }
 
 char *ioReadFileToBuffer(const char *file, unsigned int *count)
 {
 	const char *filePath = getFilePath(file);
 	char *content = NULL;
-	
-	int f;
-	f = open(filePath, O_RDONLY);
-	*count = lseek(f, 0, SEEK_END);
-	close(f);
-	
-	if (file != NULL)
+	*count = 0;
+
+	size_t archivedSize = 0;
+	const void *archived = archiveGetFile(filePath, &archivedSize);
+	if (archived != NULL)
 	{
-		FILE *fp = fopen(filePath,"rt");
-		
-		if (fp != NULL)
+		content = (char *)malloc(sizeof(char) * (archivedSize+1));
+		assert(content);
+		memcpy(content, archived, archivedSize);
+		content[archivedSize] = '\0';
+		*count = (unsigned int)archivedSize;
+		return content;
+	}
+
+	FILE *fp = fopen(filePath,"rt");
+	if (fp != NULL)
+	{
+		long size = 0;
+		if (fseek(fp, 0, SEEK_END) == 0)
 		{
-			if (*count > 0)
-			{
-				content = (char *)malloc(sizeof(char) * (*count+1));
-				*count = fread(content,sizeof(char),*count,fp);
-				content[*count] = '\0';
-			}
-			fclose(fp);
+			size = ftell(fp);
+			fseek(fp, 0, SEEK_SET);
 		}
+
+		if (size > 0)
+		{
+			content = (char *)malloc(sizeof(char) * (size+1));
+			assert(content);
+			*count = fread(content,sizeof(char),(size_t)size,fp);
+			content[*count] = '\0';
+		}
+		fclose(fp);
 	}
 
 	return content;
 }
 
+/**
+ * Map a file read-only to memory. Files in the data archive are returned as views to the archive,
+ * platforms without mmap read the file to a heap buffer instead.
+ * @param filename [in] file path, not resolved with getFilePath
+ * @param size [out] file size in bytes
+ * @return pointer to the file contents or NULL on failure, release with ioUnmapFile
+ */
+void* ioMapFile(const char *filename, size_t *size)
+{
+	*size = 0;
+
+	const void *archived = archiveGetFile(filename, size);
+	if (archived != NULL)
+	{
+		return (void*)archived;
+	}
+	*size = 0;
+
+	int f = open(filename, O_RDONLY | O_BINARY);
+	if (f < 0)
+	{
+		return NULL;
+	}
+
+	struct stat buffer;
+	if (fstat(f, &buffer) != 0 || buffer.st_size <= 0)
+	{
+		close(f);
+		return NULL;
+	}
+
+	void *data = NULL;
+#ifdef IO_MMAP
+	data = mmap(NULL, (size_t)buffer.st_size, PROT_READ, MAP_PRIVATE, f, 0);
+	if (data == MAP_FAILED)
+	{
+		data = NULL;
+	}
+#else
+	data = malloc((size_t)buffer.st_size);
+	if (data != NULL && read(f, data, (size_t)buffer.st_size) != (ssize_t)buffer.st_size)
+	{
+		free(data);
+		data = NULL;
+	}
+#endif
+	close(f);
+
+	if (data == NULL)
+	{
+		debugWarningPrintf("Could not map file '%s'", filename);
+		return NULL;
+	}
+
+	*size = (size_t)buffer.st_size;
+	return data;
+}
+
+/**
+ * Release a file mapped with ioMapFile
+ */
+void ioUnmapFile(void *data, size_t size)
+{
+	if (data == NULL || archiveIsArchiveData(data))
+	{
+		return;
+	}
+
+#ifdef IO_MMAP
+	munmap(data, size);
+#else
+	free(data);
+#endif
+}
+
+/**
+ * Read a line from memory like fgets() reads it from a file.
+ * @param line [out] line including the newline character
+ * @param size [in] size of the line buffer
+ * @param cursor [in,out] read position, moved past the returned line
+ * @param end [in] end of the data
+ * @return line or NULL if there's no data left
+ */
+char* ioGetLine(char *line, size_t size, const char **cursor, const char *end)
+{
+	if (*cursor >= end || size < 2)
+	{
+		return NULL;
+	}
+
+	size_t length = (size_t)(end - *cursor);
+	if (length > size - 1)
+	{
+		length = size - 1;
+	}
+
+	const char *newline = (const char*)memchr(*cursor, '\n', length);
+	if (newline)
+	{
+		length = (size_t)(newline - *cursor) + 1;
+	}
+
+	memcpy(line, *cursor, length);
+	line[length] = '\0';
+	*cursor += length;
+
+	return line;
+}
+
 char* strtok_reentrant(char *str, const char *delim, char **nextp)
 {
 	char *ret;
@@ -6,13 +6,20 @@ extern "C" {
 #endif
 
 #include <time.h>
+#include <stddef.h>
 
 extern const char *getStartPath(void);
 extern void setStartPath(const char *executablePath);
 extern int fileExists(const char *filename);
+extern int ioMakeDirectory(const char *path);
 extern int fileModified(const char *filename, time_t *fileLastModifiedTime);
 extern const char* getFilePath(const char *filename);
+extern void ioPathCacheInvalidate(void);
+extern void ioDeinit(void);
 extern char *ioReadFileToBuffer(const char *file, unsigned int *count);
+extern void* ioMapFile(const char *filename, size_t *size);
+extern void ioUnmapFile(void *data, size_t size);
+extern char* ioGetLine(char *line, size_t size, const char **cursor, const char *end);
 extern char* strtok_reentrant(char *str, const char *delim, char **nextp);
 
 #ifdef __cplusplus
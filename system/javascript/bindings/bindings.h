@@ -80,6 +80,9 @@ DUK_LOCAL duk_ret_t duk_gl_##c_function_name(duk_context *ctx) \
 
 extern void bindJsMiscellaneousFunctions(duk_context *ctx);
 extern void bindJsOpenGlFunctions(duk_context *ctx);
+extern void bindJsOpenGlMatrixFunctions(duk_context *ctx);
+extern void bindJsOpenGlStateFunctions(duk_context *ctx);
+extern void bindJsOpenGlBufferFunctions(duk_context *ctx);
 extern void bindJsAntTweakBarFunctions(duk_context *ctx);
 extern void bindJsAudioFunctions(duk_context *ctx);
 extern void bindJsGraphicsFunctions(duk_context *ctx);
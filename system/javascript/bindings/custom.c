@@ -20,25 +20,10 @@
 #include "system/math/splines/spline.h"
 #include "system/ui/window/window.h"
 #include "system/timer/timer.h"
+#include "system/thread/thread.h"
 
 #include "bindings.h"
 
-/*
-#ifdef ALTIVEC
-#include <altivec.h>
-
-#define av_float altivec float
-#define av_mul vec_mul
-#define av_div vec_div
-#define av_add vec_add
-#define av_sub vec_sub
-#define av_sqrt vec_sqrt
-#define av_max vec_max
-#define av_abs vec_abs
-
-#else
-*/
-
 #define av_float float
 #define av_mul(a,b) ((a)*(b))
 #define av_div(a,b) ((a)/(b))
@@ -48,7 +33,139 @@
 #define av_max(a,b) getMax((a),(b))
 #define av_abs(a) fabs((a))
 
-//#endif
+/*
+ * 4-wide packets for tracing adjacent rays together.
+ * av4_mask lanes are all bits set for true and zero for false.
+ */
+#define AV4_LANES 4
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+typedef __m128 av4_float;
+typedef __m128 av4_mask;
+
+#define av4_set1(a) _mm_set1_ps((a))
+#define av4_load(p) _mm_loadu_ps((p))
+#define av4_store(p,a) _mm_storeu_ps((p),(a))
+#define av4_mul(a,b) _mm_mul_ps((a),(b))
+#define av4_add(a,b) _mm_add_ps((a),(b))
+#define av4_sub(a,b) _mm_sub_ps((a),(b))
+#define av4_sqrt(a) _mm_sqrt_ps((a))
+#define av4_max(a,b) _mm_max_ps((a),(b))
+#define av4_abs(a) _mm_andnot_ps(_mm_set1_ps(-0.0f),(a))
+#define av4_lt(a,b) _mm_cmplt_ps((a),(b))
+#define av4_and(a,b) _mm_and_ps((a),(b))
+#define av4_andNot(a,b) _mm_andnot_ps((b),(a))
+#define av4_select(m,a,b) _mm_or_ps(_mm_and_ps((m),(a)), _mm_andnot_ps((m),(b)))
+#define av4_any(m) (_mm_movemask_ps((m)) != 0)
+#define av4_true() _mm_castsi128_ps(_mm_set1_epi32(-1))
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+
+typedef float32x4_t av4_float;
+typedef uint32x4_t av4_mask;
+
+#define av4_set1(a) vdupq_n_f32((a))
+#define av4_load(p) vld1q_f32((p))
+#define av4_store(p,a) vst1q_f32((p),(a))
+#define av4_mul(a,b) vmulq_f32((a),(b))
+#define av4_add(a,b) vaddq_f32((a),(b))
+#define av4_sub(a,b) vsubq_f32((a),(b))
+#define av4_max(a,b) vmaxq_f32((a),(b))
+#define av4_abs(a) vabsq_f32((a))
+#define av4_lt(a,b) vcltq_f32((a),(b))
+#define av4_and(a,b) vandq_u32((a),(b))
+#define av4_andNot(a,b) vbicq_u32((a),(b))
+#define av4_select(m,a,b) vbslq_f32((m),(a),(b))
+#define av4_true() vdupq_n_u32(0xFFFFFFFF)
+
+static inline int av4_any(av4_mask m) {
+    uint32x2_t r = vorr_u32(vget_low_u32(m), vget_high_u32(m));
+    return (vget_lane_u32(r, 0) | vget_lane_u32(r, 1)) != 0;
+}
+
+#ifdef __aarch64__
+#define av4_sqrt(a) vsqrtq_f32((a))
+#else
+static inline av4_float av4_sqrt(av4_float a) {
+    float f[AV4_LANES];
+    vst1q_f32(f, a);
+    for(int i = 0; i < AV4_LANES; i++) {
+        f[i] = sqrtf(f[i]);
+    }
+    return vld1q_f32(f);
+}
+#endif
+
+#else
+
+typedef struct {
+    float f[AV4_LANES];
+} av4_float;
+
+typedef struct {
+    int m[AV4_LANES];
+} av4_mask;
+
+#define AV4_OP(name, expression) \
+    static inline av4_float name(av4_float a, av4_float b) { \
+        av4_float r; \
+        for(int i = 0; i < AV4_LANES; i++) { r.f[i] = (expression); } \
+        return r; \
+    }
+
+AV4_OP(av4_mul, a.f[i]*b.f[i])
+AV4_OP(av4_add, a.f[i]+b.f[i])
+AV4_OP(av4_sub, a.f[i]-b.f[i])
+AV4_OP(av4_max, a.f[i] > b.f[i] ? a.f[i] : b.f[i])
+
+static inline av4_float av4_set1(float a) {
+    av4_float r = {{a, a, a, a}};
+    return r;
+}
+static inline av4_float av4_load(const float *p) {
+    av4_float r = {{p[0], p[1], p[2], p[3]}};
+    return r;
+}
+static inline void av4_store(float *p, av4_float a) {
+    for(int i = 0; i < AV4_LANES; i++) { p[i] = a.f[i]; }
+}
+static inline av4_float av4_sqrt(av4_float a) {
+    for(int i = 0; i < AV4_LANES; i++) { a.f[i] = sqrtf(a.f[i]); }
+    return a;
+}
+static inline av4_float av4_abs(av4_float a) {
+    for(int i = 0; i < AV4_LANES; i++) { a.f[i] = fabsf(a.f[i]); }
+    return a;
+}
+static inline av4_mask av4_lt(av4_float a, av4_float b) {
+    av4_mask r;
+    for(int i = 0; i < AV4_LANES; i++) { r.m[i] = a.f[i] < b.f[i]; }
+    return r;
+}
+static inline av4_mask av4_and(av4_mask a, av4_mask b) {
+    for(int i = 0; i < AV4_LANES; i++) { a.m[i] = a.m[i] && b.m[i]; }
+    return a;
+}
+static inline av4_mask av4_andNot(av4_mask a, av4_mask b) {
+    for(int i = 0; i < AV4_LANES; i++) { a.m[i] = a.m[i] && !b.m[i]; }
+    return a;
+}
+static inline av4_float av4_select(av4_mask m, av4_float a, av4_float b) {
+    for(int i = 0; i < AV4_LANES; i++) { a.f[i] = m.m[i] ? a.f[i] : b.f[i]; }
+    return a;
+}
+static inline int av4_any(av4_mask m) {
+    return m.m[0] || m.m[1] || m.m[2] || m.m[3];
+}
+static inline av4_mask av4_true(void) {
+    av4_mask r = {{1, 1, 1, 1}};
+    return r;
+}
+
+#endif
 
 //#version 120
 
@@ -98,55 +215,6 @@ static inline float calcCos(int index) {
     return cosTable[index];
 }
 
-static inline void traceRotateY(vec3_t* v, float radians)
-{
-    //radians = fmodf(radians, M_PI*2);
-    //float radians = degrees*(M_PI/180.0);
-
-    int index = getTableIndex(radians);
-    av_float cosrad = calcCos(index);
-    av_float sinrad = calcSin(index);
-
-    av_float x = v->f[0];
-    //av_float y = v->f[1];
-    av_float z = v->f[2];
-
-    v->f[0] = av_add(av_mul(x, cosrad), av_mul(z, sinrad));
-    v->f[2] = av_add(av_mul(-x, sinrad), av_mul(z, cosrad));
-}
-
-static inline void traceRotateX(vec3_t* v, float radians)
-{
-    //float radians = degrees*(M_PI/180.0);
-    int index = getTableIndex(radians);
-    av_float cosrad = calcCos(index);
-    av_float sinrad = calcSin(index);
-
-    //av_float x = v->f[0];
-    av_float y = v->f[1];
-    av_float z = v->f[2];
-
-    v->f[1] = av_sub(av_mul(y, cosrad), av_mul(z, sinrad));
-    v->f[2] = av_add(av_mul(y, sinrad), av_mul(z, cosrad));
-}
-
-/*
-//doesn't seem to halp with speed
-static float sqrtQuake3(const float x)
-{
-    const float xhalf = 0.5f*x;
-
-    union // get bits for floating value
-    {
-        float x;
-        int i;
-    } u;
-    u.x = x;
-    u.i = 0x5f3759df - (u.i >> 1);  // gives initial guess y0
-    return x*u.x*(1.5f - xhalf*u.x*u.x);// Newton step, repeating increases accuracy 
-}   
-*/
-
 //https://www.codeproject.com/Articles/69941/Best-Square-Root-Method-Algorithm-Function-Precisi
 static inline av_float vecLength (vec3_t* p) {
     return av_sqrt(av_add(av_add(av_mul(p->f[0], p->f[0]), av_mul(p->f[1], p->f[1])), av_mul(p->f[2], p->f[2])));
@@ -161,85 +229,80 @@ static inline vec3_t* vecNormalize (vec3_t* p) {
     return p;
 }
 
-static inline vec3_t* vecMax (vec3_t* p, av_float value) {
-    p->f[0] = av_max(p->f[0], value);
-    p->f[1] = av_max(p->f[1], value);
-    p->f[2] = av_max(p->f[2], value);
-    return p;
+// sine table lookup is scalar per lane, same quantization as in the scalar version
+static inline void traceSinCos(av4_float radians, av4_float *sinrad, av4_float *cosrad)
+{
+    float r[AV4_LANES], s[AV4_LANES], c[AV4_LANES];
+    av4_store(r, radians);
+    for(int i = 0; i < AV4_LANES; i++) {
+        int index = getTableIndex(r[i]);
+        s[i] = calcSin(index);
+        c[i] = calcCos(index);
+    }
+    *sinrad = av4_load(s);
+    *cosrad = av4_load(c);
 }
 
-static inline vec3_t* vecAbs (vec3_t* p) {
-    p->f[0] = av_abs(p->f[0]);
-    p->f[1] = av_abs(p->f[1]);
-    p->f[2] = av_abs(p->f[2]);
-    return p;
-}
+static inline av4_float calculateDistanceMap(av4_float x, av4_float y, av4_float z)
+{
+    av4_float twists = av4_set1(twisterTwists);
+    av4_float sinrad, cosrad;
 
-static inline vec3_t* vecSub (vec3_t* p1, vec3_t* p2) {
-    p1->f[0] = av_sub(p1->f[0], p2->f[0]);
-    p1->f[1] = av_sub(p1->f[1], p2->f[1]);
-    p1->f[2] = av_sub(p1->f[2], p2->f[2]);
-    return p1;
-}
+    // rotate Y
+    traceSinCos(av4_add(av4_set1(twisterRotateY), av4_mul(y, twists)), &sinrad, &cosrad);
+    av4_float rx = av4_add(av4_mul(x, cosrad), av4_mul(z, sinrad));
+    av4_float rz = av4_sub(av4_mul(z, cosrad), av4_mul(x, sinrad));
 
-/*static inline float udBox( vec3_t *p, vec3_t *b )
-{
-    return vecLength(vecMax(vecSub(vecAbs(p), b), 0.0));
-}*/
-static inline float udBox( vec3_t *p )
-{
-    p->f[0] = av_sub(av_abs(p->f[0]), 1.0f);
-    p->f[1] = av_sub(av_abs(p->f[1]), 1.0f);
-    p->f[2] = av_sub(av_abs(p->f[2]), 1.0f);
+    // rotate X
+    traceSinCos(av4_add(av4_set1(twisterRotateX), av4_mul(rx, twists)), &sinrad, &cosrad);
+    av4_float ry = av4_sub(av4_mul(y, cosrad), av4_mul(rz, sinrad));
+    rz = av4_add(av4_mul(y, sinrad), av4_mul(rz, cosrad));
 
-    return vecLength(vecMax(p, 0.0));
-}
+    // udBox with size 1.0
+    av4_float one = av4_set1(1.0f);
+    av4_float zero = av4_set1(0.0f);
+    rx = av4_max(av4_sub(av4_abs(rx), one), zero);
+    ry = av4_max(av4_sub(av4_abs(ry), one), zero);
+    rz = av4_max(av4_sub(av4_abs(rz), one), zero);
 
-static inline float calculateDistanceMap(vec3_t* p)
-{
-    traceRotateY(p, twisterRotateY+p->f[1]*twisterTwists);
-    traceRotateX(p, twisterRotateX+p->f[0]*twisterTwists);
-    //vec3_t size = {1.0, 1.0, 1.0};
-    //return udBox(p, &size);
-    return udBox(p);
+    return av4_sqrt(av4_add(av4_add(av4_mul(rx, rx), av4_mul(ry, ry)), av4_mul(rz, rz)));
 }
 
-static vec3_t *cameraLookUp = NULL;
+/*
+ * Camera directions are stored as separate x, y and z planes
+ * so that adjacent rays can be loaded directly into packets.
+ */
+static float *cameraLookUp = NULL;
 
-#define PASS_TRACE_INIT 1
-static int passTrace = PASS_TRACE_INIT;
-static vec3_t raymarch(vec3_t* cameraTarget)
+static av4_float raymarch(const float *targetX, const float *targetY, const float *targetZ)
 {
-    //twisterTwists = getSceneTimeFromStart();
-    //vec3_t coord = {u,v,1.0};
-    //vec3_t* cameraTarget = vecNormalize(&coord);
-
-    vec3_t color = {{0.0f,0.0f,0.0f}};
-
-    float rayDistance = 1.0f;
-    vec3_t rayPosition;
+    av4_float cameraTargetX = av4_load(targetX);
+    av4_float cameraTargetY = av4_load(targetY);
+    av4_float cameraTargetZ = av4_load(targetZ);
+    av4_float eyeZ = av4_set1(cameraEye.f[2]);
+    av4_float hitThreshold = av4_set1(rayHitThreshold);
+    av4_float farPlane = av4_set1(zFar);
+    av4_float colorScale = av4_set1(2.1f/zFar);
+
+    av4_float color = av4_set1(0.0f);
+    av4_float rayDistance = av4_set1(1.0f);
+    av4_mask active = av4_true();
     for(int i = 0; i < rayMaxSteps; i++)
     {
-        rayPosition.f[0] = /*cameraEye.f[0]+*/cameraTarget->f[0]*rayDistance;
-        rayPosition.f[1] = /*cameraEye.f[1]+*/cameraTarget->f[1]*rayDistance;
-        rayPosition.f[2] = cameraEye.f[2]+cameraTarget->f[2]*rayDistance;
-        float zetaa = rayPosition.f[2];
-
-        float distanceToSolid = calculateDistanceMap(&rayPosition);
-        if (distanceToSolid < rayHitThreshold)
+        av4_float zetaa = av4_add(eyeZ, av4_mul(cameraTargetZ, rayDistance));
+        av4_float distanceToSolid = calculateDistanceMap(
+            av4_mul(cameraTargetX, rayDistance),
+            av4_mul(cameraTargetY, rayDistance),
+            zetaa);
+
+        av4_mask hit = av4_and(active, av4_lt(distanceToSolid, hitThreshold));
+        color = av4_select(hit, av4_mul(av4_abs(zetaa), colorScale), color);
+        active = av4_andNot(active, hit);
+
+        rayDistance = av4_select(active, av4_add(rayDistance, distanceToSolid), rayDistance);
+        active = av4_and(active, av4_lt(rayDistance, farPlane));
+        if (!av4_any(active))
         {
-            passTrace = PASS_TRACE_INIT;
-            float val = fabs(zetaa/zFar)*2.1;            
-            color.f[0] = val;
-            color.f[1] = val;
-            color.f[2] = val;
-            break;
-        }
-
-        rayDistance += distanceToSolid;
-        if (rayDistance >= zFar)
-        {
-            passTrace=PASS_TRACE_INIT*3;
             break;
         }
     }
@@ -262,7 +325,7 @@ static int duk_initRayMarching(duk_context *ctx)
     texData = (unsigned char*)malloc(sizeof(unsigned char)*(TEX_HEIGHT*TEX_WIDTH*TEX_CHANNELS+TEX_CHANNELS));
     assert(texData);
 
-    cameraLookUp = (vec3_t*)malloc(TEX_HEIGHT*TEX_WIDTH*sizeof(vec3_t));
+    cameraLookUp = (float*)malloc(TEX_HEIGHT*TEX_WIDTH*3*sizeof(float));
     assert(cameraLookUp);
     for(int y = 0; y < TEX_HEIGHT; y++)
     {
@@ -271,11 +334,13 @@ static int duk_initRayMarching(duk_context *ctx)
         {
             float u = (x/(float)TEX_WIDTH)*2.0-1.0;
 
-            vec3_t *p = &cameraLookUp[y*TEX_WIDTH+x];
-            p->f[0] = u;
-            p->f[1] = v;
-            p->f[2] = 1.0;
-            vecNormalize(p);
+            vec3_t p = {{u, v, 1.0f}};
+            vecNormalize(&p);
+
+            int i = y*TEX_WIDTH+x;
+            cameraLookUp[i] = p.f[0];
+            cameraLookUp[i + TEX_WIDTH*TEX_HEIGHT] = p.f[1];
+            cameraLookUp[i + TEX_WIDTH*TEX_HEIGHT*2] = p.f[2];
         }
     }
 
@@ -310,68 +375,63 @@ static int duk_deinitRayMarching(duk_context *ctx)
     return 0;
 }
 
-static void renderRayMarchingToTexture()
+#define RAY_TILE_HEIGHT 8
+#define RAY_TILES ((TEX_HEIGHT + RAY_TILE_HEIGHT - 1) / RAY_TILE_HEIGHT)
+
+#if TEX_WIDTH % AV4_LANES != 0
+#error "Texture width must be a multiple of the packet width"
+#endif
+
+static void renderRayMarchingTile(void *data, unsigned int tile)
 {
-    int y1 = 0;
-    int x1 = 0;
-    static int drawPass = 0;
-    #define INTERLACES 3
-    for(int y = ((drawPass++)%INTERLACES); y < TEX_HEIGHT; y+=INTERLACES)
+    const float *lookUpX = cameraLookUp;
+    const float *lookUpY = cameraLookUp + TEX_WIDTH*TEX_HEIGHT;
+    const float *lookUpZ = cameraLookUp + TEX_WIDTH*TEX_HEIGHT*2;
+
+    int y1 = tile*RAY_TILE_HEIGHT;
+    int y2 = y1 + RAY_TILE_HEIGHT < TEX_HEIGHT ? y1 + RAY_TILE_HEIGHT : TEX_HEIGHT;
+    for(int y = y1; y < y2; y++)
     {
-        for(int x = x1; x < TEX_WIDTH-2; x+=passTrace)
+        for(int x = 0; x < TEX_WIDTH; x+=AV4_LANES)
         {
-            int ti = (y*TEX_WIDTH + x) * TEX_CHANNELS;
+            int i = y*TEX_WIDTH + x;
 
-            vec3_t color = raymarch(&cameraLookUp[y*TEX_WIDTH+x]);
-            if (color.f[0] == 0.0) {
-                for (int i = ti; i < ti + passTrace*TEX_CHANNELS; i+=TEX_CHANNELS)
-                {
-                    texData[i + 0] = 0x00;
-#if TEX_CHANNELS == 2
-                    texData[i + 1] = 0x00;
-#elif TEX_CHANNELS == 4
-                    texData[i + 1] = 0x00;
-                    texData[i + 2] = 0x00;
-                    texData[i + 3] = 0x00;
-#endif
-                }
-                continue;
-            }
+            float color[AV4_LANES];
+            av4_store(color, raymarch(&lookUpX[i], &lookUpY[i], &lookUpZ[i]));
 
-            x++;
-            texData[ti + 0] = color.f[0] * 0xFF;
-#if TEX_CHANNELS == 1
-            texData[ti + 1] = texData[ti + 0];
-#elif TEX_CHANNELS == 2
-            texData[ti + 1] = 0xFF;
-            texData[ti + 2] = texData[ti + 0];
-            texData[ti + 3] = 0xFF;
+            for(int lane = 0; lane < AV4_LANES; lane++)
+            {
+                int ti = (i + lane) * TEX_CHANNELS;
+                // overflowing values wrap around as in the original effect
+                unsigned char value = (unsigned char)(int)(color[lane] * 0xFF);
+#if TEX_CHANNELS == 2
+                texData[ti + 0] = value;
+                texData[ti + 1] = color[lane] == 0.0f ? 0x00 : 0xFF;
 #elif TEX_CHANNELS == 4
-            texData[ti + 1] = color.f[1] * 0xFF;
-            texData[ti + 2] = color.f[2] * 0xFF;
-            texData[ti + 3] = 0xFF;
-            texData[ti + 4] = texData[ti + 0];
-            texData[ti + 5] = texData[ti + 1];
-            texData[ti + 6] = texData[ti + 2];
-            texData[ti + 7] = texData[ti + 3];
+                texData[ti + 0] = value;
+                texData[ti + 1] = value;
+                texData[ti + 2] = value;
+                texData[ti + 3] = color[lane] == 0.0f ? 0x00 : 0xFF;
 #else
-            #error "Channel amount not supported you fucking fucker"
+                #error "Channel amount not supported you fucking fucker"
 #endif
+            }
         }
     }
+}
+
+static void renderRayMarchingToTexture()
+{
+    // rows are traced in tiles across the worker threads, each tile fully in packets
+    threadParallelFor(renderRayMarchingTile, NULL, RAY_TILES);
 
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, rayMarcherTexture->id);
+    renderStateEnable(GL_TEXTURE_2D);
+    renderStateBindTexture(GL_TEXTURE_2D, rayMarcherTexture->id);
 
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, rayMarcherTexture->w, rayMarcherTexture->h, TEX_FORMAT, GL_UNSIGNED_BYTE, (const void *)texData);
 
-    glDisable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    if (drawPass < INTERLACES-1) {
-        // prebake the first rounds of interlacing
-        renderRayMarchingToTexture();
-    }
+    renderStateDisable(GL_TEXTURE_2D);
+    renderStateBindTexture(GL_TEXTURE_2D, 0);
 }
 
 
@@ -387,9 +447,9 @@ static int duk_drawRayMarching(duk_context *ctx)
     float sh = 288.0f*0.83f;
     perspective2dBegin(sw,sh);
 
-    glEnable(GL_TEXTURE_2D);
-    glEnable(GL_BLEND);
-    glBindTexture(GL_TEXTURE_2D, rayMarcherTexture->id);
+    renderStateEnable(GL_TEXTURE_2D);
+    renderStateEnable(GL_BLEND);
+    renderStateBindTexture(GL_TEXTURE_2D, rayMarcherTexture->id);
 
     float x=sw/2.0f - rayMarcherTexture->w/2.0f;
     float y=sh/2.0f - rayMarcherTexture->h/2.0f;
@@ -405,9 +465,9 @@ static int duk_drawRayMarching(duk_context *ctx)
     glVertex3f(x+rayMarcherTexture->w,y,0);
     glEnd();
 
-    glDisable(GL_BLEND);
-    glDisable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    renderStateDisable(GL_BLEND);
+    renderStateDisable(GL_TEXTURE_2D);
+    renderStateBindTexture(GL_TEXTURE_2D, 0);
 
     perspective2dEnd();
 
@@ -614,13 +674,13 @@ static int duk_initNoise(duk_context *ctx)
         noiseTexData[i] = (rand()%0xFF);
     }
 
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, noiseTexture->id);
+    renderStateEnable(GL_TEXTURE_2D);
+    renderStateBindTexture(GL_TEXTURE_2D, noiseTexture->id);
 
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, noiseTexture->w, noiseTexture->h, NOISE_TEX_FORMAT, GL_UNSIGNED_BYTE, (const void *)noiseTexData);
 
-    glDisable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    renderStateDisable(GL_TEXTURE_2D);
+    renderStateBindTexture(GL_TEXTURE_2D, 0);
 
     free(noiseTexData);
 
@@ -649,9 +709,9 @@ static int duk_drawNoise(duk_context *ctx)
     float h = getScreenHeight();
     perspective2dBegin(w, h);
 
-    glEnable(GL_BLEND);
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, noiseTexture->id);
+    renderStateEnable(GL_BLEND);
+    renderStateEnable(GL_TEXTURE_2D);
+    renderStateBindTexture(GL_TEXTURE_2D, noiseTexture->id);
 
     glColor4f(1.0f,1.0f,1.0f,alpha);
     const float x=0.0f;
@@ -675,9 +735,9 @@ static int duk_drawNoise(duk_context *ctx)
     glVertex3f(x+w,y,0);
     glEnd();
 
-    glDisable(GL_TEXTURE_2D);
-    glDisable(GL_BLEND);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    renderStateDisable(GL_TEXTURE_2D);
+    renderStateDisable(GL_BLEND);
+    renderStateBindTexture(GL_TEXTURE_2D, 0);
 
     perspective2dEnd();
 
@@ -722,12 +782,12 @@ static int duk_renderToTexture(duk_context *ctx)
 
     texture_t* rttTexture = rttTextures[rttIndex];
 
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, rttTexture->id);
+    renderStateEnable(GL_TEXTURE_2D);
+    renderStateBindTexture(GL_TEXTURE_2D, rttTexture->id);
     //glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, getScreenPositionX(), getScreenPositionY(), width,height);
     glCopyTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 0, 0, width,height,0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glDisable(GL_TEXTURE_2D);
+    renderStateBindTexture(GL_TEXTURE_2D, 0);
+    renderStateDisable(GL_TEXTURE_2D);
 
     return 0;
 }
@@ -750,9 +810,9 @@ static int duk_drawRtt(duk_context *ctx)
     rttTexture->vMin = 0.0f;
     rttTexture->vMax = 1.0f;//getScreenHeight()/2.0f/512.0f;
 
-    glEnable(GL_BLEND);
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, rttTexture->id);
+    renderStateEnable(GL_BLEND);
+    renderStateEnable(GL_TEXTURE_2D);
+    renderStateBindTexture(GL_TEXTURE_2D, rttTexture->id);
 
     glColor4f(1.0f,1.0f,1.0f,alpha);
     const float x=0.0f;
@@ -770,9 +830,9 @@ static int duk_drawRtt(duk_context *ctx)
     glVertex3f(x+w,y,0);
     glEnd();
 
-    glDisable(GL_TEXTURE_2D);
-    glDisable(GL_BLEND);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    renderStateDisable(GL_TEXTURE_2D);
+    renderStateDisable(GL_BLEND);
+    renderStateBindTexture(GL_TEXTURE_2D, 0);
 
     perspective2dEnd();
 
@@ -797,21 +857,55 @@ static int duk_objectSetVertexTransformVariables(duk_context *ctx)
     return 0;
 }
 
-void vertexTransformCustom(float* x, float* y, float* z) {
+// s = 1 + (sin(now*ySpeed + y*yMag) + cos(now*xSpeed + x*xMag)) / 4 * globalMag, x and z scaled by s
+static int vertexDeformCustom(const float *positions, float *deformed, float *colors, unsigned int count) {
     double now = timerGetTime();
+    av4_float ySpeed = av4_set1((float)(now*vtYSpeed));
+    av4_float xSpeed = av4_set1((float)(now*vtXSpeed));
+    av4_float yMag = av4_set1(vtYMag);
+    av4_float xMag = av4_set1(vtXMag);
+    av4_float magnitude = av4_set1(vtGlobalMag/4.0f);
+    av4_float one = av4_set1(1.0f);
+    av4_float two = av4_set1(2.0f);
+
+    for(unsigned int first = 0; first < count; first += AV4_LANES) {
+        unsigned int lanes = count - first < AV4_LANES ? count - first : AV4_LANES;
+        const float *p = &positions[first*3];
+        float *d = &deformed[first*3];
+
+        float x[AV4_LANES] = {0}, y[AV4_LANES] = {0}, z[AV4_LANES] = {0};
+        for(unsigned int i = 0; i < lanes; i++) {
+            x[i] = p[i*3 + 0];
+            y[i] = p[i*3 + 1];
+            z[i] = p[i*3 + 2];
+        }
 
-    float s = 1.0+(((calcSin(getTableIndex(now*vtYSpeed+(*y)*vtYMag)))+(calcCos(getTableIndex(now*vtXSpeed+(*x)*vtXMag)))))/4.0f*vtGlobalMag;
-    
-    *x *= s;
-    *z *= s;
-
-    if (vtColor) {
-        float c = 2.0-s;
-        float color[4]={c, c, c, 1.0};
-        glMaterialfv(GL_FRONT, GL_AMBIENT, color);
-        glMaterialfv(GL_FRONT, GL_DIFFUSE, color);
-        glMaterialfv(GL_FRONT, GL_SPECULAR, color);
+        av4_float sinY, cosY, sinX, cosX;
+        traceSinCos(av4_add(ySpeed, av4_mul(av4_load(y), yMag)), &sinY, &cosY);
+        traceSinCos(av4_add(xSpeed, av4_mul(av4_load(x), xMag)), &sinX, &cosX);
+        av4_float s = av4_add(one, av4_mul(av4_add(sinY, cosX), magnitude));
+
+        float scale[AV4_LANES], c[AV4_LANES];
+        av4_store(scale, s);
+        av4_store(c, av4_sub(two, s));
+        for(unsigned int i = 0; i < lanes; i++) {
+            d[i*3 + 0] = x[i]*scale[i];
+            d[i*3 + 1] = y[i];
+            d[i*3 + 2] = z[i]*scale[i];
+        }
+
+        if (vtColor && colors) {
+            float *color = &colors[first*4];
+            for(unsigned int i = 0; i < lanes; i++) {
+                color[i*4 + 0] = c[i];
+                color[i*4 + 1] = c[i];
+                color[i*4 + 2] = c[i];
+                color[i*4 + 3] = 1.0f;
+            }
+        }
     }
+
+    return vtColor && colors;
 }
 
 
@@ -822,11 +916,11 @@ static int duk_objectSetVertexTransform(duk_context *ctx)
 
     switch(type) {
         case 1:
-            object->vertexTransform = vertexTransformCustom;
+            setObjectVertexDeformer(object, vertexDeformCustom);
             break;
         case 0:
         default:
-            object->vertexTransform = NULL;
+            setObjectVertexDeformer(object, NULL);
             break;
     }
 
@@ -848,8 +942,8 @@ static int duk_drawRttPostProc(duk_context *ctx)
     perspective2dBegin(w, h);
 
     //glEnable(GL_BLEND);
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, rttTexture->id);
+    renderStateEnable(GL_TEXTURE_2D);
+    renderStateBindTexture(GL_TEXTURE_2D, rttTexture->id);
 
     glColor4f(1.0f,1.0f,1.0f,alpha);
     static int noiseTexCoordIter = 0;
@@ -887,9 +981,9 @@ static int duk_drawRttPostProc(duk_context *ctx)
     }
     glEnd();
 
-    glDisable(GL_TEXTURE_2D);
+    renderStateDisable(GL_TEXTURE_2D);
     //glDisable(GL_BLEND);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    renderStateBindTexture(GL_TEXTURE_2D, 0);
 
     perspective2dEnd();
 
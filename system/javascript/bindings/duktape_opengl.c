@@ -7,6 +7,7 @@
  *  OpenGL API reference: https://www.opengl.org/registry/
  */
 
+#include <string.h>
 #include <duktape.h>
 
 #ifdef __APPLE__
@@ -115,10 +116,39 @@ DUK_LOCAL size_t duk_gl_determine_array_length(duk_context *ctx, duk_idx_t obj_i
 	return array_length;
 }
 
-#define DUK_GL_ARRAY_GET_FUNCTION(argtypedef1, arg1) \
+/*
+ *  Typed arrays are passed to OpenGL as is, without copying them through the value stack,
+ *  if the typed array type matches the OpenGL type, e.g. Float32Array for GLfloat, and the
+ *  backing storage holds at least the sz elements that OpenGL accesses.
+ *  sz == 0 means that the count is not known, those are always copied.
+ *  Returns NULL if the value is not a buffer.
+ */
+DUK_LOCAL void *duk_gl_get_buffer_array(duk_context *ctx, duk_idx_t obj_index, duk_size_t sz, size_t element_size, const char *typed_array, duk_bool_t *direct)
+{
+	duk_size_t size = 0;
+	void *data = duk_get_buffer_data(ctx, obj_index, &size);
+	*direct = 0;
+	if (data != NULL && sz > 0 && size >= sz * element_size)
+	{
+		obj_index = duk_normalize_index(ctx, obj_index);
+		duk_get_global_string(ctx, typed_array);
+		*direct = duk_instanceof(ctx, obj_index, -1);
+		duk_pop(ctx);
+	}
+	return data;
+}
+
+#define DUK_GL_ARRAY_GET_FUNCTION(argtypedef1, arg1, typed_array) \
 DUK_LOCAL argtypedef1 *duk_gl_get_##argtypedef1##_array(duk_context *ctx, duk_idx_t obj_index, duk_size_t sz, argtypedef1 *array, size_t num) \
 { \
-	if (duk_is_array(ctx, obj_index)) \
+	duk_bool_t direct = 0; \
+	void *buffer = duk_gl_get_buffer_array(ctx, obj_index, sz, sizeof(argtypedef1), typed_array, &direct); \
+	if (direct) \
+	{ \
+		return (argtypedef1*)buffer; \
+	} \
+	/* other buffers are converted per element like arrays */ \
+	if (buffer != NULL || duk_is_array(ctx, obj_index)) \
 	{ \
 		size_t array_length = duk_gl_determine_array_length(ctx, obj_index, sz, num); \
 		unsigned int i = 0; \
@@ -133,10 +163,17 @@ DUK_LOCAL argtypedef1 *duk_gl_get_##argtypedef1##_array(duk_context *ctx, duk_id
 	return NULL; \
 }
 
-#define DUK_GL_ARRAY_PUT_FUNCTION(argtypedef1, arg1) \
+#define DUK_GL_ARRAY_PUT_FUNCTION(argtypedef1, arg1, typed_array) \
 DUK_LOCAL duk_bool_t duk_gl_put_##argtypedef1##_array(duk_context *ctx, duk_idx_t obj_index, duk_size_t sz, argtypedef1 *array, size_t num) \
 { \
-	if (duk_is_array(ctx, obj_index)) \
+	duk_bool_t direct = 0; \
+	void *buffer = duk_gl_get_buffer_array(ctx, obj_index, sz, sizeof(argtypedef1), typed_array, &direct); \
+	if (direct) \
+	{ \
+		/* OpenGL has written directly to the backing storage */ \
+		return 1; \
+	} \
+	if (buffer != NULL || duk_is_array(ctx, obj_index)) \
 	{ \
 		duk_get_prop(ctx, obj_index); \
 		size_t array_length = duk_gl_determine_array_length(ctx, obj_index, sz, num); \
@@ -152,23 +189,23 @@ DUK_LOCAL duk_bool_t duk_gl_put_##argtypedef1##_array(duk_context *ctx, duk_idx_
 	return 0; \
 }
 
-DUK_GL_ARRAY_GET_FUNCTION(GLboolean, number)
-DUK_GL_ARRAY_PUT_FUNCTION(GLboolean, number)
-DUK_GL_ARRAY_GET_FUNCTION(GLbyte, number)
-DUK_GL_ARRAY_GET_FUNCTION(GLubyte, number)
-DUK_GL_ARRAY_PUT_FUNCTION(GLubyte, number)
-DUK_GL_ARRAY_GET_FUNCTION(GLdouble, number)
-DUK_GL_ARRAY_PUT_FUNCTION(GLdouble, number)
-DUK_GL_ARRAY_GET_FUNCTION(GLfloat, number)
-DUK_GL_ARRAY_PUT_FUNCTION(GLfloat, number)
-DUK_GL_ARRAY_GET_FUNCTION(GLclampf, number)
-DUK_GL_ARRAY_GET_FUNCTION(GLint, number)
-DUK_GL_ARRAY_PUT_FUNCTION(GLint, number)
-DUK_GL_ARRAY_GET_FUNCTION(GLuint, number)
-DUK_GL_ARRAY_PUT_FUNCTION(GLuint, number)
-DUK_GL_ARRAY_GET_FUNCTION(GLshort, number)
-DUK_GL_ARRAY_GET_FUNCTION(GLushort, number)
-DUK_GL_ARRAY_PUT_FUNCTION(GLushort, number)
+DUK_GL_ARRAY_GET_FUNCTION(GLboolean, number, "Uint8Array")
+DUK_GL_ARRAY_PUT_FUNCTION(GLboolean, number, "Uint8Array")
+DUK_GL_ARRAY_GET_FUNCTION(GLbyte, number, "Int8Array")
+DUK_GL_ARRAY_GET_FUNCTION(GLubyte, number, "Uint8Array")
+DUK_GL_ARRAY_PUT_FUNCTION(GLubyte, number, "Uint8Array")
+DUK_GL_ARRAY_GET_FUNCTION(GLdouble, number, "Float64Array")
+DUK_GL_ARRAY_PUT_FUNCTION(GLdouble, number, "Float64Array")
+DUK_GL_ARRAY_GET_FUNCTION(GLfloat, number, "Float32Array")
+DUK_GL_ARRAY_PUT_FUNCTION(GLfloat, number, "Float32Array")
+DUK_GL_ARRAY_GET_FUNCTION(GLclampf, number, "Float32Array")
+DUK_GL_ARRAY_GET_FUNCTION(GLint, number, "Int32Array")
+DUK_GL_ARRAY_PUT_FUNCTION(GLint, number, "Int32Array")
+DUK_GL_ARRAY_GET_FUNCTION(GLuint, number, "Uint32Array")
+DUK_GL_ARRAY_PUT_FUNCTION(GLuint, number, "Uint32Array")
+DUK_GL_ARRAY_GET_FUNCTION(GLshort, number, "Int16Array")
+DUK_GL_ARRAY_GET_FUNCTION(GLushort, number, "Uint16Array")
+DUK_GL_ARRAY_PUT_FUNCTION(GLushort, number, "Uint16Array")
 
 /*
  *  Wrapper macros for OpenGL C functions.
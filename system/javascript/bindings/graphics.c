@@ -15,6 +15,7 @@
 #include "system/graphics/object/basic3dshapes.h"
 #include "system/graphics/object/lighting.h"
 #include "system/graphics/particle/particle.h"
+#include "system/graphics/object/commandBuffer.h"
 #include "system/datatypes/memory.h"
 #include "system/math/splines/spline.h"
 #include "system/ui/window/window.h"
@@ -468,6 +469,22 @@ static int duk_fboBind(duk_context *ctx)
 
 	return 0;
 }
+static int duk_fboGpuZoneBegin(duk_context *ctx)
+{
+	fbo_t* fbo = (fbo_t*)duk_get_pointer(ctx, 0);
+
+	fboGpuZoneBegin(fbo);
+
+	return 0;
+}
+static int duk_fboGpuZoneEnd(duk_context *ctx)
+{
+	fbo_t* fbo = (fbo_t*)duk_get_pointer(ctx, 0);
+
+	fboGpuZoneEnd(fbo);
+
+	return 0;
+}
 static int duk_fboDeinit(duk_context *ctx)
 {
 	fbo_t* fbo = (fbo_t*)duk_get_pointer(ctx, 0);
@@ -864,6 +881,24 @@ static int duk_videoDraw(duk_context *ctx)
 
 	return 0;
 }
+
+static int duk_videoSetActive(duk_context *ctx)
+{
+	video_t *video = (video_t*)duk_get_pointer(ctx, 0);
+
+	videoSetActive(video);
+
+	return 0;
+}
+
+static int duk_videoPreroll(duk_context *ctx)
+{
+	video_t *video = (video_t*)duk_get_pointer(ctx, 0);
+
+	videoPreroll(video);
+
+	return 0;
+}
 #endif
 
 static int duk_perspective2dBegin(duk_context *ctx)
@@ -1589,6 +1624,111 @@ static int duk_setParticlePivot(duk_context *ctx)
 	return 0;
 }
 
+static int duk_commandBufferInit(duk_context *ctx)
+{
+	commandBuffer_t *commandBuffer = commandBufferInit(NULL);
+
+	duk_idx_t commandBuffer_obj = duk_push_object(ctx);
+	duk_push_pointer(ctx, commandBuffer);
+	duk_put_prop_string(ctx, commandBuffer_obj, "ptr");
+
+	return 1;
+}
+
+static int duk_commandBufferBegin(duk_context *ctx)
+{
+	commandBuffer_t *commandBuffer = (commandBuffer_t*)duk_get_pointer(ctx, 0);
+
+	commandBufferBegin(commandBuffer);
+
+	return 0;
+}
+
+static int duk_commandBufferEnd(duk_context *ctx)
+{
+	commandBuffer_t *commandBuffer = (commandBuffer_t*)duk_get_pointer(ctx, 0);
+
+	commandBufferEnd(commandBuffer);
+
+	return 0;
+}
+
+static int duk_commandBufferPrimitiveBegin(duk_context *ctx)
+{
+	commandBuffer_t *commandBuffer = (commandBuffer_t*)duk_get_pointer(ctx, 0);
+	GLenum mode = (GLenum)duk_get_uint(ctx, 1);
+
+	commandBufferPrimitiveBegin(commandBuffer, mode);
+
+	return 0;
+}
+
+static int duk_commandBufferPrimitiveEnd(duk_context *ctx)
+{
+	commandBuffer_t *commandBuffer = (commandBuffer_t*)duk_get_pointer(ctx, 0);
+
+	commandBufferPrimitiveEnd(commandBuffer);
+
+	return 0;
+}
+
+static int duk_commandBufferVertex(duk_context *ctx)
+{
+	commandBuffer_t *commandBuffer = (commandBuffer_t*)duk_get_pointer(ctx, 0);
+	float x = (float)duk_get_number(ctx, 1);
+	float y = (float)duk_get_number(ctx, 2);
+	float z = (float)duk_get_number(ctx, 3);
+
+	commandBufferVertex(commandBuffer, x, y, z);
+
+	return 0;
+}
+
+static int duk_commandBufferNormal(duk_context *ctx)
+{
+	commandBuffer_t *commandBuffer = (commandBuffer_t*)duk_get_pointer(ctx, 0);
+	float x = (float)duk_get_number(ctx, 1);
+	float y = (float)duk_get_number(ctx, 2);
+	float z = (float)duk_get_number(ctx, 3);
+
+	commandBufferNormal(commandBuffer, x, y, z);
+
+	return 0;
+}
+
+static int duk_commandBufferTexCoord(duk_context *ctx)
+{
+	commandBuffer_t *commandBuffer = (commandBuffer_t*)duk_get_pointer(ctx, 0);
+	float u = (float)duk_get_number(ctx, 1);
+	float v = (float)duk_get_number(ctx, 2);
+
+	commandBufferTexCoord(commandBuffer, u, v);
+
+	return 0;
+}
+
+static int duk_commandBufferColor(duk_context *ctx)
+{
+	commandBuffer_t *commandBuffer = (commandBuffer_t*)duk_get_pointer(ctx, 0);
+	float r = (float)duk_get_number(ctx, 1);
+	float g = (float)duk_get_number(ctx, 2);
+	float b = (float)duk_get_number(ctx, 3);
+	float a = (float)duk_get_number(ctx, 4);
+
+	commandBufferColor(commandBuffer, r, g, b, a);
+
+	return 0;
+}
+
+static int duk_commandBufferDraw(duk_context *ctx)
+{
+	commandBuffer_t *commandBuffer = (commandBuffer_t*)duk_get_pointer(ctx, 0);
+
+	commandBufferDraw(commandBuffer);
+
+	return 0;
+}
+
 void bindJsGraphicsFunctions(duk_context *ctx)
 {
 	bindCFunctionToJs(setClearColor, 4);
@@ -1621,6 +1761,8 @@ void bindJsGraphicsFunctions(duk_context *ctx)
 #ifdef SUPPORT_GL_FBO
 	bindCFunctionToJs(fboInit, 1);
 	bindCFunctionToJs(fboBind, DUK_VARARGS);
+	bindCFunctionToJs(fboGpuZoneBegin, 1);
+	bindCFunctionToJs(fboGpuZoneEnd, 1);
 	bindCFunctionToJs(fboDeinit, 1);
 	bindCFunctionToJs(fboStoreDepth, 2);
 	bindCFunctionToJs(fboSetDimensions, 3);
@@ -1660,6 +1802,8 @@ void bindJsGraphicsFunctions(duk_context *ctx)
 	bindCFunctionToJs(videoStop, 1);
 	bindCFunctionToJs(videoPause, 1);
 	bindCFunctionToJs(videoDraw, 1);
+	bindCFunctionToJs(videoSetActive, 1);
+	bindCFunctionToJs(videoPreroll, 1);
 #endif
 
 	bindCFunctionToJs(perspective2dBegin, 2);
@@ -1726,4 +1870,15 @@ void bindJsGraphicsFunctions(duk_context *ctx)
 	bindCFunctionToJs(setParticleAngleRange, 7);
 	bindCFunctionToJs(setParticlePivot, 4);
 	bindCFunctionToJs(setParticleColor, 5);
+
+	bindCFunctionToJs(commandBufferInit, 0);
+	bindCFunctionToJs(commandBufferBegin, 1);
+	bindCFunctionToJs(commandBufferEnd, 1);
+	bindCFunctionToJs(commandBufferPrimitiveBegin, 2);
+	bindCFunctionToJs(commandBufferPrimitiveEnd, 1);
+	bindCFunctionToJs(commandBufferVertex, 4);
+	bindCFunctionToJs(commandBufferNormal, 4);
+	bindCFunctionToJs(commandBufferTexCoord, 3);
+	bindCFunctionToJs(commandBufferColor, 5);
+	bindCFunctionToJs(commandBufferDraw, 1);
 }
@@ -4,6 +4,7 @@
 #include <duktape.h>
 
 #include "system/debug/debug.h"
+#include "system/debug/profiler.h"
 
 #include "graphicsIncludes.h"
 #include "system/math/general/general.h"
@@ -172,6 +173,34 @@ static int duk_debugErrorPrint(duk_context *ctx)
 	return 0;  // no return value
 }
 
+static int duk_profilerZoneBegin(duk_context *ctx)
+{
+	profilerZoneBegin(duk_get_string(ctx, 0));
+
+	return 0;
+}
+
+static int duk_profilerZoneEnd(duk_context *ctx)
+{
+	profilerZoneEnd();
+
+	return 0;
+}
+
+static int duk_profilerGpuZoneBegin(duk_context *ctx)
+{
+	profilerGpuZoneBegin(duk_get_string(ctx, 0));
+
+	return 0;
+}
+
+static int duk_profilerGpuZoneEnd(duk_context *ctx)
+{
+	profilerGpuZoneEnd();
+
+	return 0;
+}
+
 static int duk_threadWaitAsyncCalls(duk_context *ctx)
 {
 	threadWaitAsyncCalls();
@@ -201,6 +230,10 @@ void bindJsMiscellaneousFunctions(duk_context *ctx)
 	bindCFunctionToJs(debugPrint, DUK_VARARGS);
 	bindCFunctionToJs(debugWarningPrint, DUK_VARARGS);
 	bindCFunctionToJs(debugErrorPrint, DUK_VARARGS);
+	bindCFunctionToJs(profilerZoneBegin, 1);
+	bindCFunctionToJs(profilerZoneEnd, 0);
+	bindCFunctionToJs(profilerGpuZoneBegin, 1);
+	bindCFunctionToJs(profilerGpuZoneEnd, 0);
 	bindCFunctionToJs(readFile, 1);
 	bindCFunctionToJs(evalFile, 1);
 
@@ -13,6 +13,8 @@
 
 #include "graphicsIncludes.h"
 #include "system/graphics/shader/shader.h"
+#include "system/graphics/matrix.h"
+#include "system/graphics/renderState.h"
  #include "system/datatypes/memory.h"
 
 #include "bindings.h"
@@ -27,6 +29,53 @@ static int duk_getUniformLocation(duk_context *ctx)
 	return 1;
 }
 
+static int duk_shaderCompileBatchBegin(duk_context *ctx)
+{
+	shaderCompileBatchBegin();
+
+	return 0;
+}
+
+static int duk_shaderCompileBatchEnd(duk_context *ctx)
+{
+	shaderCompileBatchEnd();
+
+	return 0;
+}
+
+static int duk_shaderProgramAddUniform(duk_context *ctx)
+{
+	shaderProgram_t *shaderProgram = (shaderProgram_t*)duk_get_pointer(ctx, 0);
+	const char* name = (const char*)duk_get_string(ctx, 1);
+
+	if (shaderProgram == NULL || name == NULL)
+	{
+		debugErrorPrintf("Shader program '%p' and uniform name must be given!", shaderProgram);
+		duk_push_int(ctx, -1);
+		return 1;
+	}
+
+	duk_push_int(ctx, shaderProgramAddUniform(shaderProgram, name));
+
+	return 1;
+}
+
+static int duk_shaderProgramSetUniforms(duk_context *ctx)
+{
+	shaderProgram_t *shaderProgram = (shaderProgram_t*)duk_get_pointer(ctx, 0);
+	duk_size_t size = 0;
+	const float *records = (const float*)duk_get_buffer_data(ctx, 1, &size);
+
+	if (shaderProgram == NULL || records == NULL)
+	{
+		return 0;
+	}
+
+	shaderProgramSetUniforms(shaderProgram, records, size/(sizeof(float)*SHADER_UNIFORM_RECORD_SIZE));
+
+	return 0;
+}
+
 static int duk_glUniformf(duk_context *ctx)
 {
 	int argc = duk_get_top(ctx);
@@ -196,6 +245,8 @@ static duk_idx_t duk_push_shader_object(duk_context *ctx, shader_t *shader)
 	duk_put_prop_string(ctx, shader_obj, "id");
 	duk_push_int(ctx, shader->ok);
 	duk_put_prop_string(ctx, shader_obj, "ok");
+	duk_push_int(ctx, shader->compilePending || shader->statusPending);
+	duk_put_prop_string(ctx, shader_obj, "pending");
 
 	return shader_obj;
 }
@@ -251,7 +302,6 @@ static int duk_shaderProgramAttachAndLink(duk_context *ctx)
 	return 0;
 }
 
-DUK_GL_C_WRAPPER_FUNCTION_RET0_ARG1(/*EMPTY*/,/*EMPTY*/,glActiveTexture, GLenum, duk_get_uint(ctx, 0))
 DUK_GL_C_WRAPPER_FUNCTION_RET0_ARG2(/*EMPTY*/,/*EMPTY*/,glUniform1f, GLint, duk_get_int(ctx, 0), GLfloat, duk_get_number(ctx, 1))
 DUK_GL_C_WRAPPER_FUNCTION_RET0_ARG2(/*EMPTY*/,/*EMPTY*/,glUniform1i, GLint, duk_get_int(ctx, 0), GLint, duk_get_int(ctx, 1))
 DUK_GL_C_WRAPPER_FUNCTION_RET0_ARG3(/*EMPTY*/,/*EMPTY*/,glUniform2f, GLint, duk_get_int(ctx, 0), GLfloat, duk_get_number(ctx, 1), GLfloat, duk_get_number(ctx, 2))
@@ -261,6 +311,397 @@ DUK_GL_C_WRAPPER_FUNCTION_RET0_ARG4(/*EMPTY*/,/*EMPTY*/,glUniform3i, GLint, duk_
 DUK_GL_C_WRAPPER_FUNCTION_RET0_ARG5(/*EMPTY*/,/*EMPTY*/,glUniform4f, GLint, duk_get_int(ctx, 0), GLfloat, duk_get_number(ctx, 1), GLfloat, duk_get_number(ctx, 2), GLfloat, duk_get_number(ctx, 3), GLfloat, duk_get_number(ctx, 4))
 DUK_GL_C_WRAPPER_FUNCTION_RET0_ARG5(/*EMPTY*/,/*EMPTY*/,glUniform4i, GLint, duk_get_int(ctx, 0), GLint, duk_get_int(ctx, 1), GLint, duk_get_int(ctx, 2), GLint, duk_get_int(ctx, 3), GLint, duk_get_int(ctx, 4))
 
+/*
+ * Get the backing storage of a typed array of the given type, e.g. "Float32Array", that holds at least
+ * count elements of elementSize bytes. Other typed arrays and plain buffers have different element types.
+ */
+static void *duk_getTypedArrayData(duk_context *ctx, duk_idx_t index, const char *type, size_t count, size_t elementSize)
+{
+	duk_size_t size = 0;
+	void *data = duk_get_buffer_data(ctx, index, &size);
+	if (data == NULL || size < count * elementSize)
+	{
+		return NULL;
+	}
+
+	index = duk_normalize_index(ctx, index);
+	duk_get_global_string(ctx, type);
+	int isType = duk_instanceof(ctx, index, -1);
+	duk_pop(ctx);
+
+	return isType ? data : NULL;
+}
+
+/*
+ * A Float32Array of at least 16 elements is used directly, other arrays and typed arrays are converted to m.
+ */
+static const float *duk_getMatrix(duk_context *ctx, duk_idx_t index, float *m)
+{
+	const float *data = (const float*)duk_getTypedArrayData(ctx, index, "Float32Array", 16, sizeof(float));
+	if (data != NULL)
+	{
+		return data;
+	}
+
+	int i;
+	for (i = 0; i < 16; i++)
+	{
+		duk_get_prop_index(ctx, index, i);
+		m[i] = (float)duk_get_number(ctx, -1);
+		duk_pop(ctx);
+	}
+
+	return m;
+}
+
+/*
+ * Matrix functions go through the engine matrix stack so that the CPU copy of the matrices stays valid.
+ */
+static int duk_glMatrixMode(duk_context *ctx)
+{
+	matrixMode((GLenum)duk_get_uint(ctx, 0));
+	return 0;
+}
+static int duk_glPushMatrix(duk_context *ctx)
+{
+	matrixPush();
+	return 0;
+}
+static int duk_glPopMatrix(duk_context *ctx)
+{
+	matrixPop();
+	return 0;
+}
+static int duk_glLoadIdentity(duk_context *ctx)
+{
+	matrixLoadIdentity();
+	return 0;
+}
+static int duk_glLoadMatrixf(duk_context *ctx)
+{
+	float m[16];
+	matrixLoad(duk_getMatrix(ctx, 0, m));
+	return 0;
+}
+static int duk_glMultMatrixf(duk_context *ctx)
+{
+	float m[16];
+	matrixMultiply(duk_getMatrix(ctx, 0, m));
+	return 0;
+}
+static int duk_glTranslatef(duk_context *ctx)
+{
+	matrixTranslate((float)duk_get_number(ctx, 0), (float)duk_get_number(ctx, 1), (float)duk_get_number(ctx, 2));
+	return 0;
+}
+static int duk_glRotatef(duk_context *ctx)
+{
+	matrixRotate((float)duk_get_number(ctx, 0), (float)duk_get_number(ctx, 1), (float)duk_get_number(ctx, 2), (float)duk_get_number(ctx, 3));
+	return 0;
+}
+static int duk_glScalef(duk_context *ctx)
+{
+	matrixScale((float)duk_get_number(ctx, 0), (float)duk_get_number(ctx, 1), (float)duk_get_number(ctx, 2));
+	return 0;
+}
+static int duk_glOrtho(duk_context *ctx)
+{
+	matrixOrtho((float)duk_get_number(ctx, 0), (float)duk_get_number(ctx, 1), (float)duk_get_number(ctx, 2),
+		(float)duk_get_number(ctx, 3), (float)duk_get_number(ctx, 4), (float)duk_get_number(ctx, 5));
+	return 0;
+}
+static int duk_glFrustum(duk_context *ctx)
+{
+	matrixFrustum((float)duk_get_number(ctx, 0), (float)duk_get_number(ctx, 1), (float)duk_get_number(ctx, 2),
+		(float)duk_get_number(ctx, 3), (float)duk_get_number(ctx, 4), (float)duk_get_number(ctx, 5));
+	return 0;
+}
+static int duk_glViewport(duk_context *ctx)
+{
+	matrixSetViewport(duk_get_int(ctx, 0), duk_get_int(ctx, 1), duk_get_int(ctx, 2), duk_get_int(ctx, 3));
+	return 0;
+}
+
+/**
+ * Replace the generated OpenGL matrix bindings with the engine matrix stack.
+ * Must be called after duk_gl_push_opengl_bindings().
+ */
+void bindJsOpenGlMatrixFunctions(duk_context *ctx)
+{
+	bindCFunctionToJs(glMatrixMode, 1);
+	bindCFunctionToJs(glPushMatrix, 0);
+	bindCFunctionToJs(glPopMatrix, 0);
+	bindCFunctionToJs(glLoadIdentity, 0);
+	bindCFunctionToJs(glLoadMatrixf, 1);
+	bindCFunctionToJs(glMultMatrixf, 1);
+	bindCFunctionToJs(glTranslatef, 3);
+	bindCFunctionToJs(glRotatef, 4);
+	bindCFunctionToJs(glScalef, 3);
+	bindCFunctionToJs(glOrtho, 6);
+	bindCFunctionToJs(glFrustum, 6);
+	bindCFunctionToJs(glViewport, 4);
+
+	duk_push_c_function(ctx, duk_glTranslatef, 3);
+	duk_put_prop_string(ctx, -2, "glTranslated");
+	duk_push_c_function(ctx, duk_glRotatef, 4);
+	duk_put_prop_string(ctx, -2, "glRotated");
+	duk_push_c_function(ctx, duk_glScalef, 3);
+	duk_put_prop_string(ctx, -2, "glScaled");
+}
+
+/*
+ * State changes go through the engine state cache so that the cached state stays valid.
+ */
+static int duk_glEnable(duk_context *ctx)
+{
+	renderStateEnable((GLenum)duk_get_uint(ctx, 0));
+	return 0;
+}
+static int duk_glDisable(duk_context *ctx)
+{
+	renderStateDisable((GLenum)duk_get_uint(ctx, 0));
+	return 0;
+}
+static int duk_glBlendFunc(duk_context *ctx)
+{
+	renderStateBlendFunc((GLenum)duk_get_uint(ctx, 0), (GLenum)duk_get_uint(ctx, 1));
+	return 0;
+}
+static int duk_glActiveTexture(duk_context *ctx)
+{
+	renderStateActiveTexture((GLenum)duk_get_uint(ctx, 0));
+	return 0;
+}
+static int duk_glBindTexture(duk_context *ctx)
+{
+	renderStateBindTexture((GLenum)duk_get_uint(ctx, 0), (GLuint)duk_get_uint(ctx, 1));
+	return 0;
+}
+static int duk_glUseProgram(duk_context *ctx)
+{
+	renderStateUseProgram((GLuint)duk_get_uint(ctx, 0));
+	return 0;
+}
+#ifdef SUPPORT_GL_FBO
+static int duk_glBindFramebuffer(duk_context *ctx)
+{
+	renderStateBindFramebuffer((GLenum)duk_get_uint(ctx, 0), (GLuint)duk_get_uint(ctx, 1));
+	return 0;
+}
+#endif
+static int duk_glPushAttrib(duk_context *ctx)
+{
+	renderStatePushAttrib((GLbitfield)duk_get_uint(ctx, 0));
+	return 0;
+}
+static int duk_glPopAttrib(duk_context *ctx)
+{
+	renderStatePopAttrib();
+	return 0;
+}
+
+/**
+ * Replace the generated OpenGL state bindings with the engine state cache.
+ * Must be called after duk_gl_push_opengl_bindings().
+ */
+void bindJsOpenGlStateFunctions(duk_context *ctx)
+{
+	bindCFunctionToJs(glEnable, 1);
+	bindCFunctionToJs(glDisable, 1);
+	bindCFunctionToJs(glBlendFunc, 2);
+	bindCFunctionToJs(glActiveTexture, 1);
+	bindCFunctionToJs(glBindTexture, 2);
+	bindCFunctionToJs(glUseProgram, 1);
+#ifdef SUPPORT_GL_FBO
+	bindCFunctionToJs(glBindFramebuffer, 2);
+#endif
+	bindCFunctionToJs(glPushAttrib, 1);
+	bindCFunctionToJs(glPopAttrib, 0);
+}
+
+#ifdef SUPPORT_GL_VBO
+/*
+ * Bulk uploads of vertex data generated in JavaScript. The data is a buffer object or a typed array
+ * whose backing storage is given to OpenGL without copying it. The pointer functions take a byte
+ * offset to the bound GL_ARRAY_BUFFER, client side arrays are not supported as the JavaScript heap
+ * may free the data before it's drawn.
+ */
+/*
+ * glGenBuffers(n, names) writes the buffer names to names, a Uint32Array of at least n elements or an array.
+ * Without names a new Uint32Array is created. Returns the names.
+ * The generated binding can't be used, it has no storage for a count given at run time.
+ */
+static int duk_glGenBuffers(duk_context *ctx)
+{
+	GLsizei n = (GLsizei)duk_get_int(ctx, 0);
+	if (n <= 0)
+	{
+		return 0;
+	}
+
+	if (duk_is_undefined(ctx, 1))
+	{
+		duk_push_fixed_buffer(ctx, sizeof(GLuint) * (size_t)n);
+		duk_push_buffer_object(ctx, -1, 0, sizeof(GLuint) * (size_t)n, DUK_BUFOBJ_UINT32ARRAY);
+		duk_replace(ctx, 1);
+	}
+
+	GLuint *names = (GLuint*)duk_getTypedArrayData(ctx, 1, "Uint32Array", (size_t)n, sizeof(GLuint));
+	if (names != NULL)
+	{
+		glGenBuffers(n, names);
+	}
+	else if (duk_is_array(ctx, 1))
+	{
+		names = (GLuint*)malloc(sizeof(GLuint) * (size_t)n);
+		assert(names);
+		glGenBuffers(n, names);
+
+		GLsizei i;
+		for (i = 0; i < n; i++)
+		{
+			duk_push_uint(ctx, names[i]);
+			duk_put_prop_index(ctx, 1, (duk_uarridx_t)i);
+		}
+		free(names);
+	}
+	else
+	{
+		debugWarningPrintf("glGenBuffers requires a Uint32Array of %d elements or an array", n);
+		return 0;
+	}
+
+	duk_dup(ctx, 1);
+	return 1;
+}
+/*
+ * glDeleteBuffers(n, names) deletes the first n names of a Uint32Array or an array.
+ */
+static int duk_glDeleteBuffers(duk_context *ctx)
+{
+	GLsizei n = (GLsizei)duk_get_int(ctx, 0);
+	if (n <= 0)
+	{
+		return 0;
+	}
+
+	GLuint *names = (GLuint*)duk_getTypedArrayData(ctx, 1, "Uint32Array", (size_t)n, sizeof(GLuint));
+	if (names != NULL)
+	{
+		glDeleteBuffers(n, names);
+		return 0;
+	}
+
+	if (!duk_is_array(ctx, 1) && duk_get_buffer_data(ctx, 1, NULL) == NULL)
+	{
+		debugWarningPrintf("glDeleteBuffers requires a Uint32Array or an array");
+		return 0;
+	}
+
+	//other typed arrays and short arrays are converted, missing names are 0 which GL ignores
+	names = (GLuint*)malloc(sizeof(GLuint) * (size_t)n);
+	assert(names);
+	GLsizei i;
+	for (i = 0; i < n; i++)
+	{
+		duk_get_prop_index(ctx, 1, (duk_uarridx_t)i);
+		names[i] = (GLuint)duk_get_uint(ctx, -1);
+		duk_pop(ctx);
+	}
+	glDeleteBuffers(n, names);
+	free(names);
+
+	return 0;
+}
+static int duk_glBufferData(duk_context *ctx)
+{
+	GLenum target = (GLenum)duk_get_uint(ctx, 0);
+	GLenum usage = (GLenum)duk_get_uint(ctx, 2);
+	if (duk_is_number(ctx, 1))
+	{
+		//allocate only, filled with glBufferSubData
+		glBufferData(target, (GLsizeiptr)duk_get_uint(ctx, 1), NULL, usage);
+		return 0;
+	}
+
+	duk_size_t size = 0;
+	void *data = duk_get_buffer_data(ctx, 1, &size);
+	if (data == NULL)
+	{
+		debugWarningPrintf("glBufferData requires a buffer, a typed array or a size");
+		return 0;
+	}
+
+	glBufferData(target, (GLsizeiptr)size, data, usage);
+	return 0;
+}
+static int duk_glBufferSubData(duk_context *ctx)
+{
+	duk_size_t size = 0;
+	void *data = duk_get_buffer_data(ctx, 2, &size);
+	if (data == NULL)
+	{
+		debugWarningPrintf("glBufferSubData requires a buffer or a typed array");
+		return 0;
+	}
+
+	glBufferSubData((GLenum)duk_get_uint(ctx, 0), (GLintptr)duk_get_uint(ctx, 1), (GLsizeiptr)size, data);
+	return 0;
+}
+static const GLvoid *duk_getBufferOffset(duk_context *ctx, duk_idx_t index)
+{
+	return (const GLvoid*)(size_t)duk_get_uint(ctx, index);
+}
+static int duk_glVertexPointer(duk_context *ctx)
+{
+	glVertexPointer((GLint)duk_get_int(ctx, 0), (GLenum)duk_get_uint(ctx, 1), (GLsizei)duk_get_int(ctx, 2), duk_getBufferOffset(ctx, 3));
+	return 0;
+}
+static int duk_glNormalPointer(duk_context *ctx)
+{
+	glNormalPointer((GLenum)duk_get_uint(ctx, 0), (GLsizei)duk_get_int(ctx, 1), duk_getBufferOffset(ctx, 2));
+	return 0;
+}
+static int duk_glTexCoordPointer(duk_context *ctx)
+{
+	glTexCoordPointer((GLint)duk_get_int(ctx, 0), (GLenum)duk_get_uint(ctx, 1), (GLsizei)duk_get_int(ctx, 2), duk_getBufferOffset(ctx, 3));
+	return 0;
+}
+static int duk_glColorPointer(duk_context *ctx)
+{
+	glColorPointer((GLint)duk_get_int(ctx, 0), (GLenum)duk_get_uint(ctx, 1), (GLsizei)duk_get_int(ctx, 2), duk_getBufferOffset(ctx, 3));
+	return 0;
+}
+static int duk_glDrawElements(duk_context *ctx)
+{
+	glDrawElements((GLenum)duk_get_uint(ctx, 0), (GLsizei)duk_get_int(ctx, 1), (GLenum)duk_get_uint(ctx, 2), duk_getBufferOffset(ctx, 3));
+	return 0;
+}
+#endif
+
+/**
+ * Bind the buffer name, upload and vertex pointer functions, which the generated bindings lack or can't handle.
+ * Must be called after duk_gl_push_opengl_bindings().
+ */
+void bindJsOpenGlBufferFunctions(duk_context *ctx)
+{
+#ifdef SUPPORT_GL_VBO
+	bindCFunctionToJs(glGenBuffers, 2);
+	bindCFunctionToJs(glDeleteBuffers, 2);
+	duk_push_c_function(ctx, duk_glGenBuffers, 2);
+	duk_put_prop_string(ctx, -2, "glGenBuffersARB");
+	duk_push_c_function(ctx, duk_glDeleteBuffers, 2);
+	duk_put_prop_string(ctx, -2, "glDeleteBuffersARB");
+	bindCFunctionToJs(glBufferData, 3);
+	bindCFunctionToJs(glBufferSubData, 3);
+	bindCFunctionToJs(glVertexPointer, 4);
+	bindCFunctionToJs(glNormalPointer, 3);
+	bindCFunctionToJs(glTexCoordPointer, 4);
+	bindCFunctionToJs(glColorPointer, 4);
+	bindCFunctionToJs(glDrawElements, 4);
+#endif
+}
+
 void bindJsOpenGlFunctions(duk_context *ctx)
 {
 	//engine function binding
@@ -269,9 +710,13 @@ void bindJsOpenGlFunctions(duk_context *ctx)
 	bindCFunctionToJs(shaderLoad, 2);
 	bindCFunctionToJs(shaderProgramAddShaderByName, 2);
 	bindCFunctionToJs(shaderProgramAttachAndLink, 1);
+	bindCFunctionToJs(shaderCompileBatchBegin, 0);
+	bindCFunctionToJs(shaderCompileBatchEnd, 0);
 
 	//OpenGL external function binding
 	bindCFunctionToJs(getUniformLocation, 1);
+	bindCFunctionToJs(shaderProgramAddUniform, 2);
+	bindCFunctionToJs(shaderProgramSetUniforms, 2);
 	bindCFunctionToJs(glUniformf, DUK_VARARGS);
 	bindCFunctionToJs(glUniformi, DUK_VARARGS);
 	bindCFunctionToJs(disableShaderProgram, 0);
@@ -279,7 +724,6 @@ void bindJsOpenGlFunctions(duk_context *ctx)
 	bindCFunctionToJs(shaderProgramUse, 1);
 	
 	//Some stolen bindings from Duktape OpenGL
-	duk_gl_bind_opengl_wrapper(ctx, glActiveTexture, 1);
 	duk_gl_bind_opengl_wrapper(ctx, glUniform1f, 2);
 	duk_gl_bind_opengl_wrapper(ctx, glUniform1i, 2);
 	duk_gl_bind_opengl_wrapper(ctx, glUniform2f, 3);
@@ -1,11 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <duktape.h>
 
+#include "graphicsIncludes.h"
 #include "system/debug/debug.h"
+#include "system/debug/profiler.h"
+#include "system/graphics/graphics.h"
 
 #include "system/player/player.h"
+#include "system/player/animationEngine.h"
 
 #include "bindings.h"
 
@@ -83,6 +88,604 @@ static int duk_addPlayerScene(duk_context *ctx) {
 }
 
 
+/* keyframe value names of the animation tracks, in the order of animationKeyframe_t.value */
+static const char *animationCoordinateChannels[] = {"x", "y", "z"};
+static const char *animationAngleChannels[] = {"degreesX", "degreesY", "degreesZ", "x", "y", "z"};
+static const char *animationColorChannels[] = {"r", "g", "b", "a"};
+static const char *animationPerspectiveChannels[] = {"fov", "aspect", "near", "far"};
+
+static int duk_animationIsDefined(duk_context *ctx, duk_idx_t index, const char *name)
+{
+	duk_get_prop_string(ctx, index, name);
+	int defined = !duk_is_undefined(ctx, -1);
+	duk_pop(ctx);
+
+	return defined;
+}
+
+static int duk_animationIsTrue(duk_context *ctx, duk_idx_t index, const char *name)
+{
+	if (!duk_is_object(ctx, index))
+	{
+		return 0;
+	}
+
+	duk_get_prop_string(ctx, index, name);
+	int value = duk_is_boolean(ctx, -1) && duk_get_boolean(ctx, -1);
+	duk_pop(ctx);
+
+	return value;
+}
+
+static int duk_animationIsString(duk_context *ctx, duk_idx_t index, const char *name, const char *string)
+{
+	duk_get_prop_string(ctx, index, name);
+	int equals = duk_is_string(ctx, -1) && !strcmp(duk_get_string(ctx, -1), string);
+	duk_pop(ctx);
+
+	return equals;
+}
+
+static double duk_animationGetNumber(duk_context *ctx, duk_idx_t index, const char *name)
+{
+	duk_get_prop_string(ctx, index, name);
+	double value = (double)duk_get_number(ctx, -1);
+	duk_pop(ctx);
+
+	return value;
+}
+
+static char *duk_animationGetString(duk_context *ctx, duk_idx_t index, const char *name)
+{
+	char *string = NULL;
+	duk_get_prop_string(ctx, index, name);
+	if (duk_is_string(ctx, -1))
+	{
+		duk_size_t length = 0;
+		const char *value = duk_get_lstring(ctx, -1, &length);
+		string = (char*)malloc(length + 1);
+		assert(string);
+		memcpy(string, value, length + 1);
+	}
+	duk_pop(ctx);
+
+	return string;
+}
+
+/* pointer of the native reference object ({ptr}) in property name */
+static void *duk_animationGetRef(duk_context *ctx, duk_idx_t index, const char *name)
+{
+	void *ptr = NULL;
+	duk_get_prop_string(ctx, index, name);
+	if (duk_is_object(ctx, -1))
+	{
+		duk_get_prop_string(ctx, -1, "ptr");
+		ptr = duk_get_pointer(ctx, -1);
+		duk_pop(ctx);
+	}
+	duk_pop(ctx);
+
+	return ptr;
+}
+
+static int duk_animationGetAction(duk_context *ctx, duk_idx_t index)
+{
+	int action = ANIMATION_ACTION_NONE;
+	if (duk_animationIsString(ctx, index, "action", "begin"))
+	{
+		action = ANIMATION_ACTION_BEGIN;
+	}
+	else if (duk_animationIsString(ctx, index, "action", "end"))
+	{
+		action = ANIMATION_ACTION_END;
+	}
+	else if (duk_animationIsString(ctx, index, "action", "unbind"))
+	{
+		action = ANIMATION_ACTION_UNBIND;
+	}
+	else if (duk_animationIsString(ctx, index, "action", "draw"))
+	{
+		action = ANIMATION_ACTION_DRAW;
+	}
+
+	return action;
+}
+
+/**
+ * Read the keyframe array in property name of the object at index.
+ * @return 0 if the track can't be evaluated natively, e.g. a keyframe value is a function variable
+ */
+static int duk_animationGetTrack(duk_context *ctx, duk_idx_t index, const char *name,
+	animationTrack_t *track, const char **channels, unsigned int channelCount)
+{
+	int valid = 1;
+	duk_get_prop_string(ctx, index, name);
+	if (!duk_is_undefined(ctx, -1))
+	{
+		duk_size_t keyframeCount = duk_is_array(ctx, -1) ? duk_get_length(ctx, -1) : 0;
+		if (keyframeCount == 0)
+		{
+			valid = 0;
+		}
+		else
+		{
+			animationKeyframe_t *keyframes = animationEngineTrackInit(track, (unsigned int)keyframeCount, channelCount);
+
+			duk_uarridx_t i;
+			for (i = 0; i < (duk_uarridx_t)keyframeCount && valid; i++)
+			{
+				duk_get_prop_index(ctx, -1, i);
+				if (!duk_is_object(ctx, -1))
+				{
+					valid = 0;
+				}
+				else
+				{
+					keyframes[i].start = duk_animationGetNumber(ctx, -1, "start");
+					keyframes[i].duration = duk_animationGetNumber(ctx, -1, "duration");
+
+					unsigned int channel;
+					for (channel = 0; channel < channelCount; channel++)
+					{
+						duk_get_prop_string(ctx, -1, channels[channel]);
+						if (!duk_is_number(ctx, -1))
+						{
+							valid = 0;
+						}
+						keyframes[i].value[channel] = (double)duk_get_number(ctx, -1);
+						duk_pop(ctx);
+					}
+				}
+				duk_pop(ctx);
+			}
+		}
+	}
+	duk_pop(ctx);
+
+	return valid;
+}
+
+static int duk_animationGetTransformTracks(duk_context *ctx, duk_idx_t index, animationEngineAnimation_t *animation)
+{
+	return duk_animationGetTrack(ctx, index, "position", &animation->tracks[ANIMATION_TRACK_POSITION], animationCoordinateChannels, 3)
+		&& duk_animationGetTrack(ctx, index, "pivot", &animation->tracks[ANIMATION_TRACK_PIVOT], animationCoordinateChannels, 3)
+		&& duk_animationGetTrack(ctx, index, "angle", &animation->tracks[ANIMATION_TRACK_ANGLE], animationAngleChannels, 6)
+		&& duk_animationGetTrack(ctx, index, "scale", &animation->tracks[ANIMATION_TRACK_SCALE], animationCoordinateChannels, 3)
+		&& duk_animationGetTrack(ctx, index, "color", &animation->tracks[ANIMATION_TRACK_COLOR], animationColorChannels, 4);
+}
+
+static unsigned int duk_animationGetSyncFunctions(duk_context *ctx, duk_idx_t index)
+{
+	unsigned int functions = 0;
+	if (duk_animationIsDefined(ctx, index, "syncStartFunction"))
+	{
+		functions |= ANIMATION_SYNC_START_FUNCTION;
+	}
+	if (duk_animationIsDefined(ctx, index, "syncRunFunction"))
+	{
+		functions |= ANIMATION_SYNC_RUN_FUNCTION;
+	}
+	if (duk_animationIsDefined(ctx, index, "syncEndFunction"))
+	{
+		functions |= ANIMATION_SYNC_END_FUNCTION;
+	}
+
+	return functions;
+}
+
+/**
+ * Add the sync definition from Sync.syncDefinitions, the current pattern state is taken over.
+ * @return index of the sync definition, -1 if it can't be evaluated natively
+ */
+static int duk_animationGetSync(duk_context *ctx, animationEngine_t *animationEngine, duk_idx_t syncDefinitions, const char *name)
+{
+	int sync = animationEngineFindSync(animationEngine, name);
+	if (sync >= 0)
+	{
+		return sync;
+	}
+
+	duk_get_prop_string(ctx, syncDefinitions, name);
+	duk_idx_t definition = duk_get_top_index(ctx);
+	if (duk_is_object(ctx, definition))
+	{
+		// GNU Rocket sync definitions without a track are left to JavaScript
+		void *track = duk_animationGetRef(ctx, definition, "ref");
+		if (duk_animationIsDefined(ctx, definition, "ref") && track == NULL)
+		{
+			duk_pop(ctx);
+			return -1;
+		}
+
+		duk_get_prop_string(ctx, definition, "pattern");
+		duk_size_t patternCount = duk_is_array(ctx, -1) ? duk_get_length(ctx, -1) : 0;
+
+		sync = animationEngineAddSync(animationEngine, name, track,
+			duk_animationGetNumber(ctx, definition, "end"), (unsigned int)patternCount);
+		animationSync_t *animationSync = &animationEngine->syncs[sync];
+		animationSync->started = duk_animationIsDefined(ctx, definition, "started");
+		animationSync->functions = duk_animationGetSyncFunctions(ctx, definition);
+
+		duk_uarridx_t i;
+		for (i = 0; i < (duk_uarridx_t)patternCount; i++)
+		{
+			duk_get_prop_index(ctx, -1, i);
+			if (duk_is_object(ctx, -1))
+			{
+				animationSyncPattern_t *pattern = &animationSync->patterns[i];
+				pattern->start = duk_animationGetNumber(ctx, -1, "start");
+				pattern->end = duk_animationGetNumber(ctx, -1, "end");
+				pattern->duration = duk_animationGetNumber(ctx, -1, "duration");
+				pattern->startTime = duk_animationGetNumber(ctx, -1, "startTime");
+				pattern->started = duk_animationIsTrue(ctx, -1, "started");
+				pattern->functions = duk_animationGetSyncFunctions(ctx, -1);
+			}
+			duk_pop(ctx);
+		}
+		duk_pop(ctx);
+	}
+	duk_pop(ctx);
+
+	return sync;
+}
+
+/* ingest the animation at index, the parts that can't be evaluated natively are left to JavaScript */
+static void duk_animationEngineAddAnimationDefinition(duk_context *ctx, animationEngine_t *animationEngine,
+	duk_idx_t index, duk_idx_t syncDefinitions, int kanttuCompatibility)
+{
+	animationEngineAnimation_t *animation = animationEngineAddAnimation(animationEngine);
+	animation->start = duk_animationGetNumber(ctx, index, "start");
+	animation->end = duk_animationGetNumber(ctx, index, "end");
+	animation->duration = duk_animationGetNumber(ctx, index, "duration");
+
+	int native = 1;
+	unsigned int flags = 0;
+
+	duk_get_prop_string(ctx, index, "sync");
+	duk_idx_t sync = duk_get_top_index(ctx);
+	if (duk_is_object(ctx, sync))
+	{
+		duk_get_prop_string(ctx, sync, "name");
+		if (duk_is_string(ctx, -1))
+		{
+			animation->sync = duk_animationGetSync(ctx, animationEngine, syncDefinitions, duk_get_string(ctx, -1));
+		}
+		duk_pop(ctx);
+
+		// without sync definition the progress is never calculated
+		native = animation->sync >= 0;
+	}
+
+	// like Player.calculate3dCoordinateAnimation() the coordinate tracks don't follow the sync
+	animation->tracks[ANIMATION_TRACK_ANGLE].sync = duk_animationIsTrue(ctx, sync, "angle");
+	animation->tracks[ANIMATION_TRACK_COLOR].sync = duk_animationIsTrue(ctx, sync, "color");
+	animation->tracks[ANIMATION_TRACK_AMBIENT].sync = animation->tracks[ANIMATION_TRACK_COLOR].sync;
+	animation->tracks[ANIMATION_TRACK_DIFFUSE].sync = animation->tracks[ANIMATION_TRACK_COLOR].sync;
+	animation->tracks[ANIMATION_TRACK_SPECULAR].sync = animation->tracks[ANIMATION_TRACK_COLOR].sync;
+	animation->tracks[ANIMATION_TRACK_PERSPECTIVE].sync = duk_animationIsTrue(ctx, sync, "perspective");
+	duk_pop(ctx);
+
+	if (duk_animationIsString(ctx, index, "type", "image"))
+	{
+		animation->type = ANIMATION_TYPE_IMAGE;
+		animation->ref = duk_animationGetRef(ctx, index, "ref");
+
+		duk_get_prop_string(ctx, index, "multiTexRef");
+		if (duk_is_array(ctx, -1))
+		{
+			animation->textureCount = (unsigned int)duk_get_length(ctx, -1);
+			animation->textures = (texture_t**)calloc(animation->textureCount + 1, sizeof(texture_t*));
+			assert(animation->textures);
+
+			unsigned int i;
+			for (i = 0; i < animation->textureCount; i++)
+			{
+				duk_get_prop_index(ctx, -1, (duk_uarridx_t)i);
+				if (duk_is_object(ctx, -1))
+				{
+					if (duk_animationIsDefined(ctx, -1, "video"))
+					{
+						native = 0;
+					}
+					duk_get_prop_string(ctx, -1, "ptr");
+					animation->textures[i] = (texture_t*)duk_get_pointer(ctx, -1);
+					duk_pop(ctx);
+				}
+				duk_pop(ctx);
+			}
+		}
+		duk_pop(ctx);
+
+		duk_get_prop_string(ctx, index, "blend");
+		if (!duk_is_undefined(ctx, -1))
+		{
+			flags |= ANIMATION_FLAG_BLEND;
+			duk_get_prop_string(ctx, -1, "src");
+			animation->blendSrc = (unsigned int)duk_get_uint(ctx, -1);
+			duk_get_prop_string(ctx, -2, "dst");
+			animation->blendDst = (unsigned int)duk_get_uint(ctx, -1);
+			duk_pop_2(ctx);
+		}
+		duk_pop(ctx);
+
+		if (duk_animationIsString(ctx, index, "perspective", "3d"))
+		{
+			flags |= ANIMATION_FLAG_PERSPECTIVE_3D;
+		}
+
+		if (duk_animationIsDefined(ctx, index, "canvasWidth") && duk_animationIsDefined(ctx, index, "canvasHeight"))
+		{
+			flags |= ANIMATION_FLAG_CANVAS;
+			duk_get_prop_string(ctx, index, "canvasWidth");
+			duk_get_prop_string(ctx, index, "canvasHeight");
+			native = native && duk_is_number(ctx, -2) && duk_is_number(ctx, -1);
+			animation->canvasWidth = (int)duk_get_int(ctx, -2);
+			animation->canvasHeight = (int)duk_get_int(ctx, -1);
+			duk_pop_2(ctx);
+		}
+
+		duk_get_prop_string(ctx, index, "uv");
+		if (!duk_is_undefined(ctx, -1))
+		{
+			flags |= ANIMATION_FLAG_UV;
+			const char *uvNames[] = {"uMin", "vMin", "uMax", "vMax"};
+			unsigned int i;
+			for (i = 0; i < 4; i++)
+			{
+				duk_get_prop_string(ctx, -1, uvNames[i]);
+				native = native && duk_is_number(ctx, -1);
+				animation->uv[i] = (double)duk_get_number(ctx, -1);
+				duk_pop(ctx);
+			}
+		}
+		duk_pop(ctx);
+
+		if (kanttuCompatibility)
+		{
+			flags |= ANIMATION_FLAG_KANTTU;
+		}
+
+		native = native && duk_animationGetTransformTracks(ctx, index, animation)
+			&& animation->tracks[ANIMATION_TRACK_SCALE].keyframeCount > 0;
+	}
+	else if (duk_animationIsString(ctx, index, "type", "text"))
+	{
+		animation->type = ANIMATION_TYPE_TEXT;
+
+		duk_get_prop_string(ctx, index, "text");
+		animation->string = duk_animationGetString(ctx, -1, "string");
+		animation->font = duk_animationGetString(ctx, -1, "name");
+		native = animation->string != NULL && (animation->font != NULL || !duk_animationIsDefined(ctx, -1, "name"));
+		if (!duk_animationIsString(ctx, -1, "perspective", "2d"))
+		{
+			flags |= ANIMATION_FLAG_PERSPECTIVE_3D;
+		}
+		else if (kanttuCompatibility && duk_animationIsDefined(ctx, index, "position"))
+		{
+			// Player.drawTextAnimation() kanttu coordinates are left to JavaScript
+			native = 0;
+		}
+		duk_pop(ctx);
+
+		native = native && duk_animationGetTransformTracks(ctx, index, animation)
+			&& animation->tracks[ANIMATION_TRACK_SCALE].keyframeCount > 0;
+	}
+	else if (duk_animationIsString(ctx, index, "type", "object"))
+	{
+		animation->type = ANIMATION_TYPE_OBJECT;
+		animation->ref = duk_animationGetRef(ctx, index, "ref");
+		animation->camera = duk_animationGetString(ctx, index, "camera");
+		animation->fps = duk_animationGetNumber(ctx, index, "fps");
+		if (duk_animationIsDefined(ctx, index, "frame"))
+		{
+			flags |= ANIMATION_FLAG_FRAME;
+			animation->frame = duk_animationGetNumber(ctx, index, "frame");
+		}
+
+		duk_get_prop_string(ctx, index, "shape");
+		if (duk_is_object(ctx, -1) && duk_animationIsString(ctx, -1, "type", "CUSTOM"))
+		{
+			flags |= ANIMATION_FLAG_PUSH_MATRIX;
+		}
+		duk_pop(ctx);
+
+		if (duk_animationIsDefined(ctx, index, "objectFunction"))
+		{
+			flags |= ANIMATION_FLAG_OBJECT_FUNCTION;
+		}
+
+		native = native && duk_animationGetTransformTracks(ctx, index, animation);
+	}
+	else if (duk_animationIsString(ctx, index, "type", "fbo"))
+	{
+		animation->type = ANIMATION_TYPE_FBO;
+		animation->ref = duk_animationGetRef(ctx, index, "ref");
+
+		duk_get_prop_string(ctx, index, "fbo");
+		animation->name = duk_animationGetString(ctx, -1, "name");
+		animation->action = duk_animationGetAction(ctx, -1);
+		native = native && duk_animationGetTrack(ctx, -1, "dimension",
+			&animation->tracks[ANIMATION_TRACK_DIMENSION], animationCoordinateChannels, 3);
+		duk_pop(ctx);
+	}
+	else if (duk_animationIsString(ctx, index, "type", "light"))
+	{
+		animation->type = ANIMATION_TYPE_LIGHT;
+
+		duk_get_prop_string(ctx, index, "light");
+		duk_get_prop_string(ctx, -1, "index");
+		animation->light = (unsigned int)duk_get_uint(ctx, -1);
+		duk_pop(ctx);
+		animation->action = duk_animationGetAction(ctx, -1);
+		duk_pop(ctx);
+
+		animation->relativePosition = duk_animationGetString(ctx, index, "lightRelativePosition");
+		animation->positionObject = (object3d_t*)duk_animationGetRef(ctx, index, "positionObject");
+		animation->positionObjectResolved = animation->positionObject != NULL;
+
+		native = native
+			&& duk_animationGetTrack(ctx, index, "ambientColor", &animation->tracks[ANIMATION_TRACK_AMBIENT], animationColorChannels, 4)
+			&& duk_animationGetTrack(ctx, index, "diffuseColor", &animation->tracks[ANIMATION_TRACK_DIFFUSE], animationColorChannels, 4)
+			&& duk_animationGetTrack(ctx, index, "specularColor", &animation->tracks[ANIMATION_TRACK_SPECULAR], animationColorChannels, 4)
+			&& duk_animationGetTrack(ctx, index, "position", &animation->tracks[ANIMATION_TRACK_POSITION], animationCoordinateChannels, 3);
+	}
+	else if (duk_animationIsString(ctx, index, "type", "camera"))
+	{
+		animation->type = ANIMATION_TYPE_CAMERA;
+
+		animation->relativePosition = duk_animationGetString(ctx, index, "cameraRelativePosition");
+		animation->relativeTarget = duk_animationGetString(ctx, index, "cameraRelativeTarget");
+		animation->positionObject = (object3d_t*)duk_animationGetRef(ctx, index, "positionObject");
+		animation->positionObjectResolved = animation->positionObject != NULL;
+		animation->targetObject = (object3d_t*)duk_animationGetRef(ctx, index, "targetObject");
+		animation->targetObjectResolved = animation->targetObject != NULL;
+
+		native = native
+			&& duk_animationGetTrack(ctx, index, "perspective", &animation->tracks[ANIMATION_TRACK_PERSPECTIVE], animationPerspectiveChannels, 4)
+			&& duk_animationGetTrack(ctx, index, "position", &animation->tracks[ANIMATION_TRACK_POSITION], animationCoordinateChannels, 3)
+			&& duk_animationGetTrack(ctx, index, "target", &animation->tracks[ANIMATION_TRACK_TARGET], animationCoordinateChannels, 3)
+			&& duk_animationGetTrack(ctx, index, "up", &animation->tracks[ANIMATION_TRACK_UP], animationCoordinateChannels, 3);
+	}
+	else
+	{
+		animation->type = ANIMATION_TYPE_NONE;
+	}
+
+	duk_get_prop_string(ctx, index, "clearDepthBuffer");
+	if (duk_to_boolean(ctx, -1))
+	{
+		flags |= ANIMATION_FLAG_CLEAR_DEPTH;
+	}
+	duk_pop(ctx);
+
+	if (duk_animationIsDefined(ctx, index, "align"))
+	{
+		flags |= ANIMATION_FLAG_ALIGN;
+		duk_get_prop_string(ctx, index, "align");
+		animation->align = (int)duk_get_int(ctx, -1);
+		duk_pop(ctx);
+	}
+
+	if (!native)
+	{
+		// drawn by Player.drawActiveAnimation(), image animations may need to preroll their videos
+		flags = animation->type == ANIMATION_TYPE_IMAGE ? ANIMATION_FLAG_PREROLL : 0;
+		animation->type = ANIMATION_TYPE_SCRIPT;
+	}
+
+	if (duk_animationIsDefined(ctx, index, "runFunction"))
+	{
+		flags |= ANIMATION_FLAG_RUN_FUNCTION;
+	}
+	if (duk_animationIsDefined(ctx, index, "shader"))
+	{
+		flags |= ANIMATION_FLAG_SHADER;
+	}
+	animation->flags = flags;
+}
+
+/**
+ * Ingest the preprocessed animation layers of Loader.processAnimation() to a native animation engine.
+ * Animations in error state are skipped.
+ * @return {ptr, animations} where animations are the animation definitions in the engine order
+ */
+static int duk_animationEngineInit(duk_context *ctx)
+{
+	duk_idx_t syncDefinitions = 1;
+	int kanttuCompatibility = (int)duk_to_boolean(ctx, 2);
+	animationEngine_t *animationEngine = animationEngineInit(NULL);
+
+	duk_idx_t engineObj = duk_push_object(ctx);
+	duk_push_pointer(ctx, animationEngine);
+	duk_put_prop_string(ctx, engineObj, "ptr");
+	duk_idx_t animations = duk_push_array(ctx);
+
+	duk_enum(ctx, 0, DUK_ENUM_OWN_PROPERTIES_ONLY);
+	while (duk_next(ctx, -1, 1))
+	{
+		animationEngineAddLayer(animationEngine, duk_to_string(ctx, -2));
+
+		duk_size_t length = duk_is_array(ctx, -1) ? duk_get_length(ctx, -1) : 0;
+		duk_uarridx_t i;
+		for (i = 0; i < (duk_uarridx_t)length; i++)
+		{
+			duk_get_prop_index(ctx, -1, i);
+			duk_idx_t animation = duk_get_top_index(ctx);
+			if (duk_is_object(ctx, animation) && !duk_animationIsDefined(ctx, animation, "error"))
+			{
+				duk_animationEngineAddAnimationDefinition(ctx, animationEngine, animation, syncDefinitions, kanttuCompatibility);
+				duk_dup(ctx, animation);
+				duk_put_prop_index(ctx, animations, (duk_uarridx_t)(animationEngine->animationCount - 1));
+			}
+			duk_pop(ctx);
+		}
+		duk_pop_2(ctx);
+	}
+	duk_pop(ctx);
+
+	duk_put_prop_string(ctx, engineObj, "animations");
+
+	return 1;
+}
+
+typedef struct {
+	duk_context *ctx;
+	animationEngine_t *animationEngine;
+} jsAnimationEngineCallback_t;
+
+/* calls the JavaScript callback(animation, event, pattern, progress) at stack index 2 */
+static void duk_animationEngineCallback(void *userData, unsigned int animation, int event, int pattern)
+{
+	jsAnimationEngineCallback_t *callback = (jsAnimationEngineCallback_t*)userData;
+	duk_context *ctx = callback->ctx;
+	const animationEngineAnimation_t *animationEngineAnimation = &callback->animationEngine->animations[animation];
+
+	duk_dup(ctx, 2);
+	duk_push_uint(ctx, animation);
+	duk_push_int(ctx, event);
+	duk_push_int(ctx, pattern);
+	if (animationEngineAnimation->sync >= 0)
+	{
+		duk_push_number(ctx, animationEngineAnimation->syncProgress);
+	}
+	else
+	{
+		duk_push_undefined(ctx);
+	}
+
+	profilerCountJsTransition();
+	if (duk_pcall(ctx, 4) != DUK_EXEC_SUCCESS)
+	{
+		//the engine skips the animation from now on, the current frame completes the calls already started
+		callback->animationEngine->animations[animation].flags |= ANIMATION_FLAG_ERROR;
+		debugErrorPrintf("Animation callback failed, animation disabled: %s", duk_safe_to_string(ctx, -1));
+	}
+	duk_pop(ctx);
+}
+
+static int duk_animationEngineDraw(duk_context *ctx)
+{
+	animationEngine_t *animationEngine = (animationEngine_t*)duk_get_pointer(ctx, 0);
+	double time = (double)duk_get_number(ctx, 1);
+
+	jsAnimationEngineCallback_t callback;
+	callback.ctx = ctx;
+	callback.animationEngine = animationEngine;
+	animationEngineDraw(animationEngine, time, duk_animationEngineCallback, &callback);
+
+	return 0;
+}
+
+static int duk_animationEngineDeinit(duk_context *ctx)
+{
+	animationEngine_t *animationEngine = (animationEngine_t*)duk_get_pointer(ctx, 0);
+
+	animationEngineDeinit(animationEngine);
+
+	return 0;
+}
+
+
 int duk_setPlayerAutoClear(duk_context *ctx)
 {
 	int autoClear = (int)duk_get_boolean(ctx, 0);
@@ -107,4 +710,8 @@ void bindJsPlayerFunctions(duk_context *ctx)
 
 	bindCFunctionToJs(addPlayerEffect, 2);
 	bindCFunctionToJs(addPlayerScene, 5);
+
+	bindCFunctionToJs(animationEngineInit, 3);
+	bindCFunctionToJs(animationEngineDraw, 3);
+	bindCFunctionToJs(animationEngineDeinit, 1);
 }
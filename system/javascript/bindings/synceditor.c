@@ -34,6 +34,8 @@ static int duk_syncEditorGetTrack(duk_context *ctx)
 	duk_put_prop_string(ctx, sync_track_obj, "ptr");
 	duk_push_string(ctx, trackName);
 	duk_put_prop_string(ctx, sync_track_obj, "name");
+	duk_push_int(ctx, syncEditorGetTrackIndex(ptr));
+	duk_put_prop_string(ctx, sync_track_obj, "index");
 	
 	return 1;
 }
@@ -48,10 +50,46 @@ static int duk_syncEditorGetTrackCurrentValue(duk_context *ctx)
 	return 1;
 }
 
+/*
+ * Sample all tracks in one call. The Float64Array given as the argument is filled
+ * and returned if it is large enough, otherwise a new array is returned.
+ */
+static int duk_syncEditorGetTrackValues(duk_context *ctx)
+{
+	int count = syncEditorGetTrackCount();
+	size_t size = sizeof(double) * count;
+
+	duk_size_t arraySize = 0;
+	double *values = (double*)duk_get_buffer_data(ctx, 0, &arraySize);
+
+	if (values == NULL || arraySize < size)
+	{
+		values = (double*)duk_push_fixed_buffer(ctx, size);
+		duk_push_buffer_object(ctx, -1, 0, size, DUK_BUFOBJ_FLOAT64ARRAY);
+	}
+	else
+	{
+		duk_dup(ctx, 0);
+	}
+
+	syncEditorGetTrackValues(values);
+
+	return 1;
+}
+
+static int duk_syncEditorSetBakeResolution(duk_context *ctx)
+{
+	syncEditorSetBakeResolution((int)duk_get_int(ctx, 0));
+
+	return 0;
+}
+
 void bindJsSyncEditorFunctions(duk_context *ctx)
 {
 	bindCFunctionToJs(syncEditorSetRowsPerBeat, 1);
 	bindCFunctionToJs(syncEditorGetRowsPerBeat, 0);
 	bindCFunctionToJs(syncEditorGetTrack, 1);
 	bindCFunctionToJs(syncEditorGetTrackCurrentValue, 1);
+	bindCFunctionToJs(syncEditorGetTrackValues, 1);
+	bindCFunctionToJs(syncEditorSetBakeResolution, 1);
 }
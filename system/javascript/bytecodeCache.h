@@ -0,0 +1,107 @@
+#ifndef SYSTEM_JAVASCRIPT_BYTECODECACHE_H_
+#define SYSTEM_JAVASCRIPT_BYTECODECACHE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <duktape.h>
+
+#define JS_BYTECODE_CACHE_DIRECTORY "jscache"
+#define JS_BYTECODE_CACHE_MAGIC 0x43424A44 /* "DJBC" */
+#define JS_BYTECODE_CACHE_VERSION 1
+#define JS_BYTECODE_CACHE_PATH_SIZE 1024
+
+/*
+ * Cache file layout, all values little endian:
+ * uint32_t magic, format version, DUK_VERSION, bytecode size, FNV-1a of the bytecode,
+ * uint64_t cache key, followed by the duk_dump_function() bytecode.
+ * Files are named "<start path>jscache/<cache key>.jsc". The key is a hash of the script path
+ * relative to the start path, the source and the Duktape version, so edited scripts and engine
+ * upgrades never load stale bytecode, and files with the same source don't share bytecode that
+ * carries the other file's name.
+ */
+#define JS_BYTECODE_CACHE_HEADER_SIZE 28
+
+/* FNV-1a */
+static inline uint64_t jsBytecodeCacheHash(const void *data, size_t size, uint64_t hash)
+{
+	const unsigned char *bytes = (const unsigned char*)data;
+	size_t i;
+	for (i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+static inline uint64_t jsBytecodeCacheKey(const char *name, const void *source, size_t size)
+{
+	const unsigned char version[4] = {
+		(unsigned char)(DUK_VERSION & 0xFF), (unsigned char)((DUK_VERSION >> 8) & 0xFF),
+		(unsigned char)((DUK_VERSION >> 16) & 0xFF), (unsigned char)((DUK_VERSION >> 24) & 0xFF)
+	};
+	while (name[0] == '.' && name[1] == '/')
+	{
+		name += 2;
+	}
+	//the terminator separates the name from the source
+	uint64_t hash = jsBytecodeCacheHash(name, strlen(name) + 1, 14695981039346656037ULL);
+	hash = jsBytecodeCacheHash(source, size, hash);
+	return jsBytecodeCacheHash(version, sizeof(version), hash);
+}
+
+static inline void jsBytecodeCachePutU32(unsigned char *p, uint32_t value)
+{
+	p[0] = (unsigned char)(value & 0xFF);
+	p[1] = (unsigned char)((value >> 8) & 0xFF);
+	p[2] = (unsigned char)((value >> 16) & 0xFF);
+	p[3] = (unsigned char)((value >> 24) & 0xFF);
+}
+
+static inline uint32_t jsBytecodeCacheGetU32(const unsigned char *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void jsBytecodeCacheWriteHeader(unsigned char *header, uint64_t key, const void *bytecode, size_t size)
+{
+	jsBytecodeCachePutU32(header, JS_BYTECODE_CACHE_MAGIC);
+	jsBytecodeCachePutU32(header + 4, JS_BYTECODE_CACHE_VERSION);
+	jsBytecodeCachePutU32(header + 8, (uint32_t)DUK_VERSION);
+	jsBytecodeCachePutU32(header + 12, (uint32_t)size);
+	jsBytecodeCachePutU32(header + 16, (uint32_t)jsBytecodeCacheHash(bytecode, size, 14695981039346656037ULL));
+	jsBytecodeCachePutU32(header + 20, (uint32_t)(key & 0xFFFFFFFFU));
+	jsBytecodeCachePutU32(header + 24, (uint32_t)(key >> 32));
+}
+
+/* Duktape doesn't validate bytecode, so a truncated or corrupt file must never reach duk_load_function() */
+static inline int jsBytecodeCacheIsValid(const unsigned char *data, size_t size, uint64_t key)
+{
+	if (size <= JS_BYTECODE_CACHE_HEADER_SIZE)
+	{
+		return 0;
+	}
+
+	const unsigned char *bytecode = data + JS_BYTECODE_CACHE_HEADER_SIZE;
+	size_t bytecodeSize = size - JS_BYTECODE_CACHE_HEADER_SIZE;
+	uint64_t fileKey = (uint64_t)jsBytecodeCacheGetU32(data + 20) | ((uint64_t)jsBytecodeCacheGetU32(data + 24) << 32);
+	return jsBytecodeCacheGetU32(data) == JS_BYTECODE_CACHE_MAGIC
+		&& jsBytecodeCacheGetU32(data + 4) == JS_BYTECODE_CACHE_VERSION
+		&& jsBytecodeCacheGetU32(data + 8) == (uint32_t)DUK_VERSION
+		&& jsBytecodeCacheGetU32(data + 12) == bytecodeSize
+		&& jsBytecodeCacheGetU32(data + 16) == (uint32_t)jsBytecodeCacheHash(bytecode, bytecodeSize, 14695981039346656037ULL)
+		&& fileKey == key;
+}
+
+#ifdef __cplusplus
+/* end 'extern "C"' wrapper */
+}
+#endif
+
+#endif /* SYSTEM_JAVASCRIPT_BYTECODECACHE_H_ */
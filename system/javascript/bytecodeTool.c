@@ -0,0 +1,209 @@
+/*
+ * JavaScript bytecode tool. Precompiles scripts to the bytecode cache that jsEvalFile() loads,
+ * see bytecodeCache.h for the format. Built and run with "make jsbytecode".
+ *
+ * Usage: bytecodeTool <root directory> [file or directory...]
+ * Paths (default "engine.js" and "data") are relative to the root directory, which is the engine
+ * start path. Directories are searched recursively for .js files.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "duktape.h"
+#include "bytecodeCache.h"
+
+static duk_context *ctx = NULL;
+static unsigned int compiledCount = 0;
+static unsigned int failedCount = 0;
+static unsigned long long sourceTotal = 0, bytecodeTotal = 0;
+
+static char* readFile(const char *name, size_t *size)
+{
+	FILE *f = fopen(name, "rb");
+	if (f == NULL)
+	{
+		return NULL;
+	}
+
+	char *data = NULL;
+	long length = -1;
+	if (fseek(f, 0, SEEK_END) == 0 && (length = ftell(f)) >= 0 && fseek(f, 0, SEEK_SET) == 0)
+	{
+		data = (char*)malloc((size_t)length + 1);
+		if (data && fread(data, 1, (size_t)length, f) != (size_t)length)
+		{
+			free(data);
+			data = NULL;
+		}
+	}
+	fclose(f);
+
+	*size = (size_t)length;
+	return data;
+}
+
+static int writeBytecode(uint64_t key, const void *bytecode, size_t size)
+{
+	char path[JS_BYTECODE_CACHE_PATH_SIZE];
+	snprintf(path, JS_BYTECODE_CACHE_PATH_SIZE, "%s/%016llx.jsc", JS_BYTECODE_CACHE_DIRECTORY, (unsigned long long)key);
+
+	unsigned char header[JS_BYTECODE_CACHE_HEADER_SIZE];
+	jsBytecodeCacheWriteHeader(header, key, bytecode, size);
+
+	FILE *f = fopen(path, "wb");
+	if (f == NULL)
+	{
+		fprintf(stderr, "Could not open '%s' for writing\n", path);
+		return 0;
+	}
+	int written = fwrite(header, sizeof(header), 1, f) == 1 && fwrite(bytecode, size, 1, f) == 1;
+	if (fclose(f) != 0 || !written)
+	{
+		fprintf(stderr, "Could not write to '%s'\n", path);
+		remove(path);
+		return 0;
+	}
+
+	return 1;
+}
+
+static void compileFile(const char *name)
+{
+	size_t size = 0;
+	char *source = readFile(name, &size);
+	if (source == NULL)
+	{
+		fprintf(stderr, "Could not read file '%s'\n", name);
+		failedCount++;
+		return;
+	}
+
+	//compiled the same way as in jsEvalFile()
+	duk_push_lstring(ctx, source, size);
+	duk_push_string(ctx, name);
+	if (duk_pcompile(ctx, DUK_COMPILE_EVAL) != DUK_EXEC_SUCCESS)
+	{
+		fprintf(stderr, "Could not compile '%s': %s\n", name, duk_safe_to_string(ctx, -1));
+		failedCount++;
+	}
+	else
+	{
+		duk_dump_function(ctx);
+		duk_size_t bytecodeSize = 0;
+		const void *bytecode = duk_get_buffer(ctx, -1, &bytecodeSize);
+		if (writeBytecode(jsBytecodeCacheKey(name, source, size), bytecode, bytecodeSize))
+		{
+			compiledCount++;
+			sourceTotal += size;
+			bytecodeTotal += bytecodeSize;
+		}
+		else
+		{
+			failedCount++;
+		}
+	}
+	duk_pop(ctx);
+	free(source);
+}
+
+static void compilePath(const char *path)
+{
+	struct stat buffer;
+	if (stat(path, &buffer) != 0)
+	{
+		fprintf(stderr, "Could not find '%s'\n", path);
+		return;
+	}
+
+	if (S_ISREG(buffer.st_mode))
+	{
+		compileFile(path);
+		return;
+	}
+
+	DIR *dir = opendir(path);
+	if (dir == NULL)
+	{
+		fprintf(stderr, "Could not open directory '%s'\n", path);
+		return;
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (entry->d_name[0] == '.')
+		{
+			continue;
+		}
+
+		char child[JS_BYTECODE_CACHE_PATH_SIZE];
+		snprintf(child, JS_BYTECODE_CACHE_PATH_SIZE, "%s/%s", path, entry->d_name);
+		if (stat(child, &buffer) != 0)
+		{
+			continue;
+		}
+
+		size_t length = strlen(entry->d_name);
+		if (S_ISDIR(buffer.st_mode))
+		{
+			compilePath(child);
+		}
+		else if (S_ISREG(buffer.st_mode) && length > 3 && !strcmp(entry->d_name + length - 3, ".js"))
+		{
+			compileFile(child);
+		}
+	}
+
+	closedir(dir);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s <root directory> [file or directory...]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (chdir(argv[1]) != 0)
+	{
+		fprintf(stderr, "Could not change to directory '%s'\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	struct stat buffer;
+	if (stat(JS_BYTECODE_CACHE_DIRECTORY, &buffer) != 0 && mkdir(JS_BYTECODE_CACHE_DIRECTORY, 0755) != 0)
+	{
+		fprintf(stderr, "Could not create directory '%s'\n", JS_BYTECODE_CACHE_DIRECTORY);
+		return EXIT_FAILURE;
+	}
+
+	ctx = duk_create_heap_default();
+	if (ctx == NULL)
+	{
+		fprintf(stderr, "Could not create the JavaScript heap\n");
+		return EXIT_FAILURE;
+	}
+
+	if (argc == 2)
+	{
+		compilePath("engine.js");
+		compilePath("data");
+	}
+	int i;
+	for (i = 2; i < argc; i++)
+	{
+		compilePath(argv[i]);
+	}
+
+	duk_destroy_heap(ctx);
+
+	printf("Compiled %u scripts to '%s': %llu bytes of source, %llu bytes of bytecode\n",
+		compiledCount, JS_BYTECODE_CACHE_DIRECTORY, sourceTotal, bytecodeTotal);
+
+	return failedCount ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "heapAllocator.h"
+
+/**
+ * @defgroup heapAllocator JavaScript heap allocator
+ * Size class pool allocator for the Duktape heap. Most Duktape allocations are small strings,
+ * objects and property tables, which are served from per size class free lists carved out of
+ * JS_HEAP_CHUNK_SIZE chunks. Freed blocks are kept in the free lists for reuse and the chunks are
+ * returned to the system only in jsHeapDeinit(). Allocations larger than the largest size class use malloc().
+ * The heap is used only from the main thread, so the allocator is not thread safe.
+ * @ingroup javascript
+ */
+
+#define JS_HEAP_CLASSES 8
+#define JS_HEAP_MIN_CLASS_SIZE 16
+#define JS_HEAP_MAX_CLASS_SIZE (JS_HEAP_MIN_CLASS_SIZE << (JS_HEAP_CLASSES - 1))
+#define JS_HEAP_CHUNK_SIZE 65536
+/* chunk header is padded so that the blocks stay aligned for doubles on 32 bit targets too */
+#define JS_HEAP_CHUNK_HEADER_SIZE 16
+/* size class of allocations that are passed to malloc() */
+#define JS_HEAP_LARGE JS_HEAP_CLASSES
+
+/* 8 bytes, keeps the data aligned for doubles */
+typedef struct {
+	uint32_t sizeClass;
+	uint32_t size;
+} jsHeapHeader_t;
+
+typedef struct jsHeapChunk_t {
+	struct jsHeapChunk_t *next;
+} jsHeapChunk_t;
+
+typedef struct jsHeapBlock_t {
+	struct jsHeapBlock_t *next;
+} jsHeapBlock_t;
+
+typedef struct {
+	jsHeapBlock_t *freeList;
+	/* unused end of the newest chunk of the class */
+	char *bump;
+	char *bumpEnd;
+} jsHeapClass_t;
+
+static jsHeapClass_t classes[JS_HEAP_CLASSES];
+static jsHeapChunk_t *chunks = NULL;
+static jsHeapStats_t heapStats = {0, 0, 0, 0};
+
+static unsigned int jsHeapGetSizeClass(size_t size)
+{
+	unsigned int sizeClass = 0;
+	size_t classSize = JS_HEAP_MIN_CLASS_SIZE;
+	while (classSize < size && sizeClass < JS_HEAP_LARGE)
+	{
+		classSize <<= 1;
+		sizeClass++;
+	}
+
+	return sizeClass;
+}
+
+static size_t jsHeapGetBlockSize(unsigned int sizeClass)
+{
+	return sizeof(jsHeapHeader_t) + ((size_t)JS_HEAP_MIN_CLASS_SIZE << sizeClass);
+}
+
+static jsHeapHeader_t *jsHeapAllocateBlock(unsigned int sizeClass)
+{
+	jsHeapClass_t *heapClass = &classes[sizeClass];
+	if (heapClass->freeList)
+	{
+		jsHeapBlock_t *block = heapClass->freeList;
+		heapClass->freeList = block->next;
+		return (jsHeapHeader_t*)block;
+	}
+
+	size_t blockSize = jsHeapGetBlockSize(sizeClass);
+	if (heapClass->bump == NULL || heapClass->bump + blockSize > heapClass->bumpEnd)
+	{
+		jsHeapChunk_t *chunk = (jsHeapChunk_t*)malloc(JS_HEAP_CHUNK_SIZE);
+		if (chunk == NULL)
+		{
+			return NULL;
+		}
+		chunk->next = chunks;
+		chunks = chunk;
+		heapStats.pooledBytes += JS_HEAP_CHUNK_SIZE;
+
+		//the rest of the previous chunk is too small for the class and stays unused
+		heapClass->bump = (char*)chunk + JS_HEAP_CHUNK_HEADER_SIZE;
+		heapClass->bumpEnd = (char*)chunk + JS_HEAP_CHUNK_SIZE;
+	}
+
+	jsHeapHeader_t *header = (jsHeapHeader_t*)heapClass->bump;
+	heapClass->bump += blockSize;
+	return header;
+}
+
+/**
+ * Duktape allocation function, see duk_create_heap().
+ * @ingroup heapAllocator
+ */
+void *jsHeapAlloc(void *userData, size_t size)
+{
+	if (size == 0 || size > UINT32_MAX - sizeof(jsHeapHeader_t))
+	{
+		return NULL;
+	}
+
+	unsigned int sizeClass = jsHeapGetSizeClass(size);
+	jsHeapHeader_t *header;
+	if (sizeClass == JS_HEAP_LARGE)
+	{
+		header = (jsHeapHeader_t*)malloc(sizeof(jsHeapHeader_t) + size);
+		if (header)
+		{
+			heapStats.largeBytes += size;
+		}
+	}
+	else
+	{
+		header = jsHeapAllocateBlock(sizeClass);
+	}
+
+	if (header == NULL)
+	{
+		return NULL;
+	}
+
+	header->sizeClass = sizeClass;
+	header->size = (uint32_t)size;
+	heapStats.usedBytes += size;
+	heapStats.allocations++;
+
+	return header + 1;
+}
+
+/**
+ * Duktape free function, see duk_create_heap().
+ * @ingroup heapAllocator
+ */
+void jsHeapFree(void *userData, void *ptr)
+{
+	if (ptr == NULL)
+	{
+		return;
+	}
+
+	jsHeapHeader_t *header = (jsHeapHeader_t*)ptr - 1;
+	assert(header->sizeClass <= JS_HEAP_LARGE);
+	heapStats.usedBytes -= header->size;
+	heapStats.allocations--;
+
+	if (header->sizeClass == JS_HEAP_LARGE)
+	{
+		heapStats.largeBytes -= header->size;
+		free(header);
+	}
+	else
+	{
+		//the free list link overwrites the header
+		jsHeapClass_t *heapClass = &classes[header->sizeClass];
+		jsHeapBlock_t *block = (jsHeapBlock_t*)header;
+		block->next = heapClass->freeList;
+		heapClass->freeList = block;
+	}
+}
+
+/**
+ * Duktape reallocation function, see duk_create_heap(). Blocks are resized in place when the
+ * new size fits the same size class.
+ * @ingroup heapAllocator
+ */
+void *jsHeapRealloc(void *userData, void *ptr, size_t size)
+{
+	if (ptr == NULL)
+	{
+		return jsHeapAlloc(userData, size);
+	}
+	if (size == 0)
+	{
+		jsHeapFree(userData, ptr);
+		return NULL;
+	}
+	if (size > UINT32_MAX - sizeof(jsHeapHeader_t))
+	{
+		return NULL;
+	}
+
+	jsHeapHeader_t *header = (jsHeapHeader_t*)ptr - 1;
+	unsigned int sizeClass = jsHeapGetSizeClass(size);
+	if (sizeClass == header->sizeClass)
+	{
+		if (sizeClass == JS_HEAP_LARGE)
+		{
+			size_t oldSize = header->size;
+			jsHeapHeader_t *resized = (jsHeapHeader_t*)realloc(header, sizeof(jsHeapHeader_t) + size);
+			if (resized == NULL)
+			{
+				return NULL;
+			}
+			header = resized;
+			heapStats.largeBytes = heapStats.largeBytes - oldSize + size;
+		}
+
+		heapStats.usedBytes = heapStats.usedBytes - header->size + size;
+		header->size = (uint32_t)size;
+		return header + 1;
+	}
+
+	void *resized = jsHeapAlloc(userData, size);
+	if (resized == NULL)
+	{
+		return NULL;
+	}
+	memcpy(resized, ptr, header->size < size ? header->size : size);
+	jsHeapFree(userData, ptr);
+
+	return resized;
+}
+
+/**
+ * Get the current allocation statistics.
+ * @ingroup heapAllocator
+ */
+void jsHeapGetStats(jsHeapStats_t *stats)
+{
+	assert(stats);
+	memcpy(stats, &heapStats, sizeof(jsHeapStats_t));
+}
+
+/**
+ * Return the pools to the system. Must be called only after the Duktape heap has been destroyed.
+ * @ingroup heapAllocator
+ */
+void jsHeapDeinit(void)
+{
+	while (chunks)
+	{
+		jsHeapChunk_t *next = chunks->next;
+		free(chunks);
+		chunks = next;
+	}
+
+	memset(classes, 0, sizeof(classes));
+	memset(&heapStats, 0, sizeof(heapStats));
+}
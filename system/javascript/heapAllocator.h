@@ -0,0 +1,31 @@
+#ifndef SYSTEM_JAVASCRIPT_HEAPALLOCATOR_H_
+#define SYSTEM_JAVASCRIPT_HEAPALLOCATOR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+typedef struct {
+	/* bytes requested by Duktape that haven't been freed */
+	size_t usedBytes;
+	/* bytes reserved from the system for the size class pools */
+	size_t pooledBytes;
+	/* bytes of allocations larger than the largest size class */
+	size_t largeBytes;
+	unsigned int allocations;
+} jsHeapStats_t;
+
+extern void *jsHeapAlloc(void *userData, size_t size);
+extern void *jsHeapRealloc(void *userData, void *ptr, size_t size);
+extern void jsHeapFree(void *userData, void *ptr);
+extern void jsHeapGetStats(jsHeapStats_t *stats);
+extern void jsHeapDeinit(void);
+
+#ifdef __cplusplus
+/* end 'extern "C"' wrapper */
+}
+#endif
+
+#endif /* SYSTEM_JAVASCRIPT_HEAPALLOCATOR_H_ */
@@ -6,14 +6,18 @@
  
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include "javascript.h"
 #include "system/timer/timer.h"
 #include "system/debug/debug.h"
+#include "system/debug/profiler.h"
 #include <duktape.h>
 #include <duktape_opengl.h>
 
 #include "system/javascript/bindings/bindings.h"
+#include "system/javascript/bytecodeCache.h"
+#include "system/javascript/heapAllocator.h"
 
 #include "graphicsIncludes.h"
 #include "system/graphics/graphics.h"
@@ -57,6 +61,12 @@ static void duk_jsDefineGlobalFunctions()
 	
 	
 	duk_gl_push_opengl_bindings(ctx);
+
+	duk_push_global_object(ctx);
+	bindJsOpenGlMatrixFunctions(ctx);
+	bindJsOpenGlStateFunctions(ctx);
+	bindJsOpenGlBufferFunctions(ctx);
+	duk_pop(ctx);
 }
 
 static int stackTraceCalled = 0;
@@ -114,6 +124,7 @@ void jsAddInputEvent(void* eventPtr)
 	const char *class = "Input";
 	const char *method = "addEvent";
 
+	profilerZoneBegin("Input.addEvent");
 	duk_push_global_object(ctx);
 	duk_push_string(ctx, class);
 	duk_get_prop(ctx, -2);
@@ -121,6 +132,7 @@ void jsAddInputEvent(void* eventPtr)
 	duk_get_prop(ctx, -2);
 	jsSdlEventToObject(ctx, event);
 
+	profilerCountJsTransition();
 	duk_int_t returnValue = duk_pcall(ctx, 1); //calls: Input.addEvent(inputEventObject)
 
 	if (returnValue != DUK_EXEC_SUCCESS)
@@ -135,6 +147,7 @@ void jsAddInputEvent(void* eventPtr)
 		jsEvalString("Utils.debugPrintStackTrace();");
 		stackTraceCalled = 1;
 	}
+	profilerZoneEnd();
 }
 
 static int useInput = 0;
@@ -150,6 +163,7 @@ int jsIsUseInput(void)
 
 void jsCallClassMethod(const char *class, const char *method, const char *effectClassName)
 {
+	profilerZoneBegin(method);
 	duk_push_global_object(ctx);
 	duk_push_string(ctx, class);
 	duk_get_prop(ctx, -2);
@@ -157,6 +171,7 @@ void jsCallClassMethod(const char *class, const char *method, const char *effect
 	duk_get_prop(ctx, -2);
 	duk_push_string(ctx, effectClassName);
 	
+	profilerCountJsTransition();
 	duk_int_t returnValue = duk_pcall(ctx, 1); //calls: class.method("effectClassName")
 
 	if (returnValue != DUK_EXEC_SUCCESS)
@@ -171,12 +186,119 @@ void jsCallClassMethod(const char *class, const char *method, const char *effect
 		jsEvalString("Utils.debugPrintStackTrace();");
 		stackTraceCalled = 1;
 	}
+	profilerZoneEnd();
+}
+
+/* push the heap stash array of the functions referenced from native code */
+static void jsPushReferences(void)
+{
+	duk_push_heap_stash(ctx);
+	if (!duk_get_prop_string(ctx, -1, "references"))
+	{
+		duk_pop(ctx);
+		duk_push_array(ctx);
+		duk_dup_top(ctx);
+		duk_put_prop_string(ctx, -3, "references");
+	}
+	duk_remove(ctx, -2);
+}
+
+/**
+ * Call class.method("effectClassName") and keep the returned function in the heap stash.
+ * Calling the reference skips the lookups of jsCallClassMethod(), e.g. for per frame calls.
+ * @return reference for jsCallReference(), -1 if the call failed or didn't return a function
+ */
+int jsReferenceClassMethod(const char *class, const char *method, const char *effectClassName)
+{
+	int reference = -1;
+	duk_push_global_object(ctx);
+	duk_get_prop_string(ctx, -1, class);
+	duk_get_prop_string(ctx, -1, method);
+	duk_push_string(ctx, effectClassName);
+
+	profilerCountJsTransition();
+	if (duk_pcall(ctx, 1) != DUK_EXEC_SUCCESS)
+	{
+		debugErrorPrintf("eval failed for '%s.%s(\"%s\")': %s\n", class, method, effectClassName, duk_safe_to_string(ctx, -1));
+	}
+	else if (duk_is_function(ctx, -1))
+	{
+		jsPushReferences();
+
+		//reuse the first released slot
+		duk_uarridx_t length = (duk_uarridx_t)duk_get_length(ctx, -1);
+		duk_uarridx_t i;
+		for (i = 0; i < length; i++)
+		{
+			duk_get_prop_index(ctx, -1, i);
+			int released = duk_is_undefined(ctx, -1);
+			duk_pop(ctx);
+			if (released)
+			{
+				break;
+			}
+		}
+
+		duk_dup(ctx, -2);
+		duk_put_prop_index(ctx, -2, i);
+		duk_pop(ctx);
+		reference = (int)i;
+	}
+	duk_pop_n(ctx, 3);
+
+	return reference;
+}
+
+/**
+ * Call a function referenced with jsReferenceClassMethod() without arguments.
+ * @param reference [in] reference returned by jsReferenceClassMethod()
+ * @param name [in] name used in the profiler zone and error messages
+ */
+void jsCallReference(int reference, const char *name)
+{
+	assert(reference >= 0);
+	profilerZoneBegin(name);
+	jsPushReferences();
+	duk_get_prop_index(ctx, -1, (duk_uarridx_t)reference);
+
+	profilerCountJsTransition();
+	duk_int_t returnValue = duk_pcall(ctx, 0);
+	if (returnValue != DUK_EXEC_SUCCESS)
+	{
+		debugErrorPrintf("eval failed for '%s': %s\n", name, duk_safe_to_string(ctx, -1));
+		windowSetTitle("JS ERROR");
+	}
+	duk_pop_n(ctx, 2);
+
+	if (returnValue != DUK_EXEC_SUCCESS && !stackTraceCalled)
+	{
+		jsEvalString("Utils.debugPrintStackTrace();");
+		stackTraceCalled = 1;
+	}
+	profilerZoneEnd();
+}
+
+/**
+ * Release a reference so that the function can be garbage collected.
+ */
+void jsReleaseReference(int reference)
+{
+	if (reference < 0)
+	{
+		return;
+	}
+
+	jsPushReferences();
+	duk_push_undefined(ctx);
+	duk_put_prop_index(ctx, -2, (duk_uarridx_t)reference);
+	duk_pop(ctx);
 }
 
 void jsEvalString(const char *string)
 {
-	
+	profilerZoneBegin("jsEvalString");
 	duk_push_string(ctx, string);
+	profilerCountJsTransition();
 	duk_int_t returnValue = duk_peval(ctx);
 	if (returnValue != DUK_EXEC_SUCCESS)
 	{
@@ -190,12 +312,140 @@ void jsEvalString(const char *string)
 		jsEvalString("Utils.debugPrintStackTrace();");
 		stackTraceCalled = 1;
 	}
+	profilerZoneEnd();
+}
+
+static void jsBytecodeCachePath(char *path, uint64_t key)
+{
+	snprintf(path, JS_BYTECODE_CACHE_PATH_SIZE, "%s%s/%016llx.jsc", getStartPath(), JS_BYTECODE_CACHE_DIRECTORY, (unsigned long long)key);
 }
 
+static duk_ret_t jsBytecodeCacheLoadFunction(duk_context *ctx)
+{
+	duk_load_function(ctx);
+	return 1;
+}
+
+/* push the function compiled from the source with the given key, returns 0 if it's not cached */
+static int jsBytecodeCacheLoad(uint64_t key)
+{
+	char path[JS_BYTECODE_CACHE_PATH_SIZE];
+	jsBytecodeCachePath(path, key);
+	if (!fileExists(path))
+	{
+		return 0;
+	}
+
+	size_t size = 0;
+	const unsigned char *data = (const unsigned char*)ioMapFile(path, &size);
+	if (data == NULL)
+	{
+		return 0;
+	}
+
+	int valid = jsBytecodeCacheIsValid(data, size, key);
+	if (valid)
+	{
+		size_t bytecodeSize = size - JS_BYTECODE_CACHE_HEADER_SIZE;
+		void *bytecode = duk_push_fixed_buffer(ctx, bytecodeSize);
+		memcpy(bytecode, data + JS_BYTECODE_CACHE_HEADER_SIZE, bytecodeSize);
+		if (duk_safe_call(ctx, jsBytecodeCacheLoadFunction, 1, 1) != DUK_EXEC_SUCCESS)
+		{
+			duk_pop(ctx);
+			valid = 0;
+		}
+	}
+	ioUnmapFile((void*)data, size);
+
+	if (!valid)
+	{
+		debugWarningPrintf("Invalid bytecode cache file '%s', removed", path);
+		remove(path);
+	}
+
+	return valid;
+}
+
+/* write the compiled function on top of the stack to the cache */
+static void jsBytecodeCacheSave(uint64_t key)
+{
+	char path[JS_BYTECODE_CACHE_PATH_SIZE];
+	snprintf(path, JS_BYTECODE_CACHE_PATH_SIZE, "%s%s", getStartPath(), JS_BYTECODE_CACHE_DIRECTORY);
+	if (!ioMakeDirectory(path))
+	{
+		return;
+	}
+	jsBytecodeCachePath(path, key);
+
+	duk_dup_top(ctx);
+	duk_dump_function(ctx);
+	duk_size_t size = 0;
+	const void *bytecode = duk_get_buffer(ctx, -1, &size);
+
+	unsigned char header[JS_BYTECODE_CACHE_HEADER_SIZE];
+	jsBytecodeCacheWriteHeader(header, key, bytecode, size);
+
+	FILE *file = fopen(path, "wb");
+	if (file)
+	{
+		int written = fwrite(header, sizeof(header), 1, file) == 1 && fwrite(bytecode, size, 1, file) == 1;
+		if (fclose(file) != 0 || !written)
+		{
+			debugWarningPrintf("Could not write bytecode cache file '%s'", path);
+			remove(path);
+		}
+	}
+	duk_pop(ctx);
+}
+
+/**
+ * Evaluate a JavaScript file. The compiled bytecode is cached to the start path by the hash of the
+ * path and the source, so unchanged files are compiled only once. "make jsbytecode" precompiles release scripts.
+ */
 void jsEvalFile(const char *file)
 {
+	profilerZoneBegin(file);
 	const char *filePath = getFilePath(file);
-	duk_int_t returnValue = duk_peval_file(ctx, filePath);
+
+	//same as duk_peval_file() but the source is read through the io module, e.g. from the data archive
+	duk_int_t returnValue = DUK_EXEC_SUCCESS;
+	size_t size = 0;
+	void *source = ioMapFile(filePath, &size);
+	if (source)
+	{
+		//keyed by the path relative to the start path, like the names in "make jsbytecode"
+		const char *name = filePath;
+		size_t startPathLength = strlen(getStartPath());
+		if (startPathLength > 0 && !strncmp(name, getStartPath(), startPathLength))
+		{
+			name += startPathLength;
+		}
+		uint64_t key = jsBytecodeCacheKey(name, source, size);
+		if (!jsBytecodeCacheLoad(key))
+		{
+			duk_push_lstring(ctx, (const char*)source, size);
+			duk_push_string(ctx, filePath);
+			returnValue = duk_pcompile(ctx, DUK_COMPILE_EVAL);
+			if (returnValue == DUK_EXEC_SUCCESS)
+			{
+				jsBytecodeCacheSave(key);
+			}
+		}
+		ioUnmapFile(source, size);
+	}
+	else
+	{
+		duk_push_undefined(ctx);
+		duk_push_string(ctx, filePath);
+		returnValue = duk_pcompile(ctx, DUK_COMPILE_EVAL);
+	}
+
+	if (returnValue == DUK_EXEC_SUCCESS)
+	{
+		duk_push_global_object(ctx); //explicit 'this' binding like duk_eval_raw()
+		profilerCountJsTransition();
+		returnValue = duk_pcall_method(ctx, 0);
+	}
 	if (returnValue != DUK_EXEC_SUCCESS)
 	{
 		debugErrorPrintf("Error in '%s': %s\n", filePath, duk_safe_to_string(ctx, -1));
@@ -208,6 +458,7 @@ void jsEvalFile(const char *file)
 		jsEvalString("Utils.debugPrintStackTrace();");
 		stackTraceCalled = 1;
 	}
+	profilerZoneEnd();
 }
 
 static void jsPreInitEngine()
@@ -226,7 +477,7 @@ static void jsPreInitEngine()
 int jsInit()
 {
 	debugPrintf("Initializing scripting.");
-	ctx = duk_create_heap_default();
+	ctx = duk_create_heap(jsHeapAlloc, jsHeapRealloc, jsHeapFree, NULL, NULL);
 	if (!ctx) {
 		debugErrorPrintf("Failed to create heap.");
 		return -1;
@@ -239,10 +490,68 @@ int jsInit()
 	return 0;
 }
 
+/* heap growth since the previous collection that is collected in idle time */
+#define JS_GC_IDLE_GROWTH (1024*1024)
+/* heap growth that is collected even if the frames don't leave idle time */
+#define JS_GC_FORCE_GROWTH (32*1024*1024)
+/* idle time must exceed the estimated collection time by this factor */
+#define JS_GC_IDLE_MARGIN 1.5
+
+static size_t gcUsedBytes = 0;
+static double gcSeconds = 0.002;
+static unsigned int gcCollections = 0;
+
+static void jsCollect(int passes)
+{
+	unsigned long long start = timerGetNanoseconds();
+	int i;
+	for (i = 0; i < passes; i++)
+	{
+		duk_gc(ctx, 0);
+	}
+	double seconds = (timerGetNanoseconds() - start) / 1e9 / passes;
+
+	//estimate stays pessimistic, slow collections count at once and fast ones decay slowly
+	gcSeconds = seconds > gcSeconds ? seconds : gcSeconds * 0.75 + seconds * 0.25;
+	gcCollections += passes;
+
+	jsHeapStats_t stats;
+	jsHeapGetStats(&stats);
+	gcUsedBytes = stats.usedBytes;
+}
+
 void jsGarbageCollect()
 {
-	duk_gc(ctx, 0);
-	duk_gc(ctx, 0);
+	jsCollect(2);
+}
+
+/**
+ * Collect garbage in the idle time of the frame. Duktape's mark and sweep can't be split into steps,
+ * so a full collection is run only when the heap has grown enough and the estimated collection
+ * time fits into the idle time. Heap statistics are reported to the profiler.
+ * @param idleSeconds [in] time left before the next frame is due
+ */
+void jsIdleGarbageCollect(double idleSeconds)
+{
+	jsHeapStats_t stats;
+	jsHeapGetStats(&stats);
+
+	//reference counting frees most garbage right away, growth is measured from the smallest heap
+	if (stats.usedBytes < gcUsedBytes)
+	{
+		gcUsedBytes = stats.usedBytes;
+	}
+
+	size_t growth = stats.usedBytes - gcUsedBytes;
+	if (growth >= JS_GC_FORCE_GROWTH || (growth >= JS_GC_IDLE_GROWTH && idleSeconds > gcSeconds * JS_GC_IDLE_MARGIN))
+	{
+		profilerZoneBegin("jsIdleGarbageCollect");
+		jsCollect(1);
+		profilerZoneEnd();
+		jsHeapGetStats(&stats);
+	}
+
+	profilerSetJsHeap(stats.usedBytes, stats.pooledBytes + stats.largeBytes, gcCollections);
 }
 
 void jsInitEngine()
@@ -257,6 +566,7 @@ int jsDeinit()
 	debugPrintf("Deinitializing scripting.");
 
 	duk_destroy_heap(ctx);
+	jsHeapDeinit();
 
 	return 0;
 }
@@ -5,9 +5,13 @@
 
 extern int jsInit();
 extern void jsCallClassMethod(const char *class, const char *method, const char *effectClassName);
+extern int jsReferenceClassMethod(const char *class, const char *method, const char *effectClassName);
+extern void jsCallReference(int reference, const char *name);
+extern void jsReleaseReference(int reference);
 extern void jsEvalString(const char *string);
 extern void jsEvalFile(const char *file);
 extern void jsGarbageCollect();
+extern void jsIdleGarbageCollect(double idleSeconds);
 extern void jsInitEngine();
 extern int jsDeinit();
 
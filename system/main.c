@@ -9,6 +9,8 @@
 #include "graphicsIncludes.h"
 #include "version.h"
 #include "system/graphics/graphics.h"
+#include "system/graphics/matrix.h"
+#include "system/graphics/renderState.h"
 #include "system/ui/window/window.h"
 #include "system/ui/window/menu.h"
 #include "system/ui/input/input.h"
@@ -18,10 +20,14 @@
 #include "system/thread/thread.h"
 #include "system/timer/timer.h"
 #include "system/debug/debug.h"
+#include "system/debug/benchmark.h"
+#include "system/debug/profiler.h"
 #include "system/javascript/javascript.h"
 #include "system/datatypes/memory.h"
 #include "system/rocket/synceditor.h"
 #include "system/io/io.h"
+#include "system/io/archive.h"
+#include "system/io/fileWatch.h"
 #include "effects/scene_globals.h"
 #include "effects/playlist.h"
 
@@ -52,7 +58,13 @@ static int handleCommandLineArguments(int argc, char **argv)
 	const int THREAD_COUNT    = 9;
 	const int VERSION         = 10;
 	const int DEMO_PATH       = 11;
-	const char commandSwitches[12][256] =
+	const int BENCHMARK       = 12;
+	const int BENCHMARK_FPS   = 13;
+	const int BENCHMARK_FILE  = 14;
+	const int PROFILE         = 15;
+	const int BENCHMARK_XML   = 16;
+	const int BENCHMARK_YUV   = 17;
+	const char commandSwitches[18][256] =
 	{
 		"--muteSound\0",
 		"--changePosition\0",
@@ -65,7 +77,13 @@ static int handleCommandLineArguments(int argc, char **argv)
 		"--file\0",
 		"--threadCount\0",
 		"--version\0",
-		"--demoPath\0"
+		"--demoPath\0",
+		"--benchmark\0",
+		"--benchmarkFps\0",
+		"--benchmarkOutput\0",
+		"--profile\0",
+		"--benchmarkXml\0",
+		"--benchmarkYuv\0"
 	};
 
 	int i;
@@ -126,6 +144,41 @@ static int handleCommandLineArguments(int argc, char **argv)
 		{
 			setStartPath(argv[++i]);
 		}
+		else if (!strcmp(argv[i], commandSwitches[BENCHMARK]) && i + 2 < argc)
+		{
+			double start = convertTimeToSeconds(argv[++i]);
+			double end = convertTimeToSeconds(argv[++i]);
+			debugPrintf("Benchmark requested: %.3f - %.3f", start, end);
+			benchmarkSetTimeRange(start, end);
+
+			timerPosition = benchmarkGetStartTime();
+			showMenu = 0;
+			soundMute(1);
+		}
+		else if (!strcmp(argv[i], commandSwitches[BENCHMARK_FPS]) && ++i < argc)
+		{
+			double fps = 0.0;
+			sscanf(argv[i], "%lf", &fps);
+			benchmarkSetFps(fps);
+		}
+		else if (!strcmp(argv[i], commandSwitches[BENCHMARK_FILE]) && ++i < argc)
+		{
+			benchmarkSetOutputFile(argv[i]);
+		}
+		else if (!strcmp(argv[i], commandSwitches[PROFILE]) && ++i < argc)
+		{
+			profilerSetOutputFile(argv[i]);
+		}
+		else if (!strcmp(argv[i], commandSwitches[BENCHMARK_XML]) && ++i < argc)
+		{
+			benchmarkXml(argv[i]);
+			return 0;
+		}
+		else if (!strcmp(argv[i], commandSwitches[BENCHMARK_YUV]) && ++i < argc)
+		{
+			benchmarkYuv(argv[i]);
+			return 0;
+		}
 		else if (!strcmp(argv[i], commandSwitches[FILE]) && ++i < argc)
 		{
 			splineEditorLoad(argv[i]);
@@ -138,6 +191,12 @@ static int handleCommandLineArguments(int argc, char **argv)
 			printf("%s <SECONDS> - Jumps to following position in the demo\n", commandSwitches[CHANGE_POSITION]);
 			printf("%s <WIDTH>x<HEIGHT> - Sets width and height of the window\n", commandSwitches[RESOLUTION]);
 			printf("%s <0|1> - 1=fullscreen, 0=windowed\n", commandSwitches[FULLSCREEN]);
+			printf("%s <START> <END> - Plays the time range with fixed timestep and writes frame timings and checksums\n", commandSwitches[BENCHMARK]);
+			printf("%s <FPS> - Fixed timestep frame rate of the benchmark\n", commandSwitches[BENCHMARK_FPS]);
+			printf("%s <FILE> - Benchmark output CSV file\n", commandSwitches[BENCHMARK_FILE]);
+			printf("%s <FILE> - Records profiler zones and exports them as Chrome trace JSON\n", commandSwitches[PROFILE]);
+			printf("%s <FILE> - Measures parsing of an XML file, e.g. a Rocket export, and exits\n", commandSwitches[BENCHMARK_XML]);
+			printf("%s <WIDTH>x<HEIGHT> - Measures video frame YUV to RGB conversion against the reference converter, and exits\n", commandSwitches[BENCHMARK_YUV]);
 
 			//exit the engine
 			return 0;
@@ -159,11 +218,23 @@ static void systemPreinit(int argc, char **argv)
 		exit(EXIT_FAILURE);
 	}
 
+	profilerInit();
+
 	if (strlen(getStartPath()) == 0)
 	{
 		setStartPath(argv[0]);
 	}
 
+	//the editor works on the loose data files so that they can be reloaded
+	if (!isPlayerEditor())
+	{
+		archiveOpen(ARCHIVE_DEFAULT_FILE);
+	}
+	else
+	{
+		fileWatchInit();
+	}
+
 	setClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	memoryInit();
 
@@ -207,6 +278,14 @@ static void systemInit()
 		printOpenGlErrors();
 	}
 
+	matrixInit();
+	renderStateInit();
+
+	if (profilerIsEnabled() || isPlayerEditor())
+	{
+		profilerGpuInit();
+	}
+
 	if (syncEditorInit() == -1)
 	{
 		exit(EXIT_FAILURE);
@@ -237,6 +316,8 @@ static void systemInit()
 		soundPlaySong(0);
 	}
 	
+	benchmarkInit();
+
 	timerInit(getPlaylistLength());
 	timerAddTime(timerPosition);
 
@@ -263,6 +344,26 @@ static void systemRun()
 		}
 		debugPrintf("Demo ended, deinitialization started.");
 	}
+	else if (benchmarkIsEnabled())
+	{
+		debugPrintf("Benchmark started.");
+		while(!benchmarkIsEnd() && !isUserExit())
+		{
+			timerUpdate();
+
+			benchmarkFrameBegin();
+			profilerZoneBegin("frame");
+
+			syncEditorRun();
+
+			playerDraw();
+
+			profilerZoneEnd();
+
+			timerAdjustFramerate();
+		}
+		debugPrintf("Benchmark ended, deinitialization started.");
+	}
 	else
 	{
 		debugPrintf("Demo started.");
@@ -270,9 +371,13 @@ static void systemRun()
 		{
 			timerUpdate();
 
+			profilerZoneBegin("frame");
+
 			syncEditorRun();
 
 			playerDraw();
+
+			profilerZoneEnd();
 			
 			timerAdjustFramerate();
 		}
@@ -297,12 +402,19 @@ static void systemDeinit()
 		splineEditorDeinit();
 	}
 
+	benchmarkDeinit();
+
+	profilerGpuDeinit();
+	profilerDeinit();
+
 	playerDeinit();
 
 	syncEditorDeinit();
 
 	memoryDeinit();
 
+	fileWatchDeinit();
+
 	threadDeinit();
 
 	windowDeinit();
@@ -311,6 +423,8 @@ static void systemDeinit()
 	jsDeinit();
 #endif
 
+	ioDeinit();
+
 	debugPrintf("System deinitialized successfully");
 }
 
@@ -8,6 +8,7 @@
 
 #include "graphicsIncludes.h"
 #include "system/ui/window/window.h"
+#include "system/graphics/matrix.h"
 #include "system/debug/debug.h"
 
 #include "general.h"
@@ -154,29 +155,29 @@ void rotateX(point3d_t *point3d, float angle)
 	point3d->z = point3d->y * sa + point3d->z * ca;
 }
 
-#ifndef TINYGL
 //Converts 3D point to screen 2D coordinate
 point2d_t getScreenCoordinateFrom3dCoordinate(point3d_t point3d)
 {
 	point2d_t screenPoint2d;
-	
-	double x,y,z;
-	double model_view[16];
-	double projection[16];
-	int viewport[4];
-	
-	glGetDoublev(GL_PROJECTION_MATRIX, projection);
-	glGetIntegerv(GL_VIEWPORT, viewport);
-	glGetDoublev(GL_MODELVIEW_MATRIX, model_view);
-	
-	gluProject(point3d.x, point3d.y, point3d.z,
-			   model_view, projection, viewport,
-			   &x, &y, &z);
-	
-	screenPoint2d.x = x;
-	screenPoint2d.y = y;
-	
+
+	//matrices are read from the CPU side matrix stack to avoid stalling on glGet
+	mat4x4 modelViewProjection;
+	mat4x4_mul(modelViewProjection, (vec4*)matrixGetProjection(), (vec4*)matrixGetModelView());
+	const int *viewport = matrixGetViewport();
+
+	vec4 in = {point3d.x, point3d.y, point3d.z, 1.0f};
+	vec4 out;
+	mat4x4_mul_vec4(out, modelViewProjection, in);
+	if (out[3] == 0.0f)
+	{
+		screenPoint2d.x = 0;
+		screenPoint2d.y = 0;
+		return screenPoint2d;
+	}
+
+	screenPoint2d.x = viewport[0] + (out[0] / out[3] + 1.0f) * 0.5f * viewport[2];
+	screenPoint2d.y = viewport[1] + (out[1] / out[3] + 1.0f) * 0.5f * viewport[3];
+
 	return screenPoint2d;
 }
-#endif
 
@@ -22,8 +22,6 @@ extern void rotateZ(point3d_t *point3d, float angle);
 extern void rotateY(point3d_t *point3d, float angle);
 extern void rotateX(point3d_t *point3d, float angle);
 
-#ifndef TINYGL
 extern point2d_t getScreenCoordinateFrom3dCoordinate(point3d_t point_3d);
-#endif
 
 #endif /*EXH_SYSTEM_MATH_SORT_INSERTSORT_H_*/
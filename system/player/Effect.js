@@ -49,6 +49,46 @@ Effect.run = function(effectName)
     }
 };
 
+/**
+ * Resolve the per frame call of the effect once, the player keeps the returned function and
+ * calls it instead of Effect.run().
+ */
+Effect.getRunFunction = function(effectName)
+{
+    var effect = Effect.effects[effectName];
+
+    if (effect.run !== void null)
+    {
+        return function()
+        {
+            effect.run();
+        };
+    }
+
+    return function()
+    {
+        effect.player.drawAnimation(effect.loader.animationLayers);
+    };
+};
+
+Effect.preroll = function(effectName)
+{
+    var effect = Effect.effects[effectName];
+    if (effect === void null)
+    {
+        return;
+    }
+
+    if (effect.preroll !== void null)
+    {
+        effect.preroll();
+    }
+    else if (effect.run === void null)
+    {
+        effect.player.prerollAnimation(effect.loader.animationLayers);
+    }
+};
+
 Effect.deinit = function(effectName)
 {
     var effect = Effect.effects[effectName];
@@ -58,5 +98,10 @@ Effect.deinit = function(effectName)
         effect.deinit();
     }
 
+    if (effect.player !== void null && effect.player.deinit !== void null)
+    {
+        effect.player.deinit();
+    }
+
     delete Effect.effects[effectName];
 }
@@ -1,6 +1,20 @@
 /** @constructor */
 var Player = function()
 {
+    this.native = void null;
+};
+
+/** events of the native animation engine, must match ANIMATION_EVENT_* in animationEngine.h */
+Player.NativeEvent = {
+    'DRAW': 0,
+    'PREROLL': 1,
+    'RUN_FUNCTION': 2,
+    'OBJECT_FUNCTION': 3,
+    'SHADER_ENABLE': 4,
+    'SHADER_DISABLE': 5,
+    'SYNC_START': 6,
+    'SYNC_RUN': 7,
+    'SYNC_END': 8
 };
 
 Player.prototype.calculate3dCoordinateAnimation = function(time, animation, defaults)
@@ -311,6 +325,7 @@ Player.prototype.drawImageAnimation = function(time, animation)
         if (multiTexRef.video !== void null)
         {
             loggerInfo(JSON.stringify(animation),null,2);
+            videoSetActive(multiTexRef.video.ref.ptr);
             videoSetStartTime(multiTexRef.video.ref.ptr, animation.start);
 
             if (multiTexRef.video.speed !== void null)
@@ -345,6 +360,32 @@ Player.prototype.drawImageAnimation = function(time, animation)
     setTextureDefaults(animation.ref.ptr);
 };
 
+Player.videoPrerollTime = 1.0;
+
+// decode the first frames of the videos of an image animation that starts soon
+Player.prototype.prerollImageAnimation = function(time, animation)
+{
+    var prerollTime = Player.videoPrerollTime;
+    if (Settings.demoScript.videoPrerollTime !== void null)
+    {
+        prerollTime = Settings.demoScript.videoPrerollTime;
+    }
+
+    if (time >= animation.start || time < animation.start - prerollTime)
+    {
+        return;
+    }
+
+    for (var videoI = 0; videoI < animation.multiTexRef.length; videoI++)
+    {
+        var multiTexRef = animation.multiTexRef[videoI];
+        if (multiTexRef.video !== void null)
+        {
+            videoPreroll(multiTexRef.video.ref.ptr);
+        }
+    }
+};
+
 Player.prototype.drawTextAnimation = function(time, animation)
 {
     setTextDefaults();
@@ -508,12 +549,14 @@ Player.prototype.drawFboAnimation = function(time, animation)
 
     if (animation.fbo.action === 'begin')
     {
+        fboGpuZoneBegin(animation.ref.ptr); // the open zone is tracked per FBO, also for the native animation engine
         fboBind(animation.ref.ptr);
         fboUpdateViewport(animation.ref.ptr);
     }
     else if (animation.fbo.action === 'end')
     {
         fboBind();
+        fboGpuZoneEnd(animation.ref.ptr);
         fboUpdateViewport();
 
         fboBindTextures(animation.ref.ptr);
@@ -534,6 +577,7 @@ Player.prototype.drawFboAnimation = function(time, animation)
     else if (animation.fbo.action === 'unbind')
     {
         fboBind();
+        fboGpuZoneEnd(animation.ref.ptr);
         fboUpdateViewport();
     }
     else if (animation.fbo.action === 'draw')
@@ -648,12 +692,163 @@ Player.prototype.drawCameraAnimation = function(time, animation)
     viewReset();
 };
 
+// called before the scene starts, scene time is negative
+Player.prototype.prerollAnimation = function(animationLayers)
+{
+    var time = getSceneTimeFromStart();
+
+    for (var key in animationLayers)
+    {
+        if (animationLayers.hasOwnProperty(key))
+        {
+            var animationLayersLength = animationLayers[key].length;
+            for (var animationI = 0; animationI < animationLayersLength; animationI++)
+            {
+                var animation = animationLayers[key][animationI];
+                if (animation.error === void null && animation.type === 'image')
+                {
+                    this.prerollImageAnimation(time, animation);
+                }
+            }
+        }
+    }
+};
+
+Player.prototype.drawActiveAnimation = function(time, animation)
+{
+    if (animation.type === 'image')
+    {
+        this.drawImageAnimation(time, animation);
+    }
+    else if (animation.type === 'text')
+    {
+        this.drawTextAnimation(time, animation);
+    }
+    else if (animation.type === 'object')
+    {
+        this.drawObjectAnimation(time, animation);
+    }
+    else if (animation.type === 'fbo')
+    {
+        this.drawFboAnimation(time, animation);
+    }
+    else if (animation.type === 'light')
+    {
+        this.drawLightAnimation(time, animation);
+    }
+    else if (animation.type === 'camera')
+    {
+        this.drawCameraAnimation(time, animation);
+    }
+};
+
+/**
+ * Ingest the animation layers to the native animation engine. Keyframe interpolation, sync progress
+ * and drawing are then evaluated natively, handleNativeEvent() is called for the JavaScript parts.
+ */
+Player.prototype.initNativeAnimation = function(animationLayers)
+{
+    this.deinit();
+
+    var player = this;
+    this.native = animationEngineInit(animationLayers, Sync.syncDefinitions, Settings.demoScript.kanttuCompatibility);
+    this.native.animationLayers = animationLayers;
+    this.native.time = 0;
+    this.native.callback = function(index, event, pattern, progress)
+    {
+        player.handleNativeEvent(index, event, pattern, progress);
+    };
+};
+
+Player.prototype.handleNativeEvent = function(index, event, pattern, progress)
+{
+    var animation = this.native.animations[index];
+    var time = this.native.time;
+
+    if (progress !== void null)
+    {
+        animation.sync.progress = progress;
+    }
+
+    if (event === Player.NativeEvent.DRAW)
+    {
+        this.drawActiveAnimation(time, animation);
+    }
+    else if (event === Player.NativeEvent.PREROLL)
+    {
+        this.prerollImageAnimation(time, animation);
+    }
+    else if (event === Player.NativeEvent.RUN_FUNCTION)
+    {
+        Utils.evaluateVariable(animation, animation.runFunction);
+    }
+    else if (event === Player.NativeEvent.OBJECT_FUNCTION)
+    {
+        Utils.evaluateVariable(animation, animation.objectFunction);
+    }
+    else if (event === Player.NativeEvent.SHADER_ENABLE)
+    {
+        Shader.enableShader(animation);
+    }
+    else if (event === Player.NativeEvent.SHADER_DISABLE)
+    {
+        Shader.disableShader(animation);
+    }
+    else
+    {
+        var sync = Sync.syncDefinitions[animation.sync.name];
+        var syncPattern = pattern >= 0 ? sync.pattern[pattern] : void null;
+        if (event === Player.NativeEvent.SYNC_START)
+        {
+            Sync.callFunction(animation, sync, syncPattern, 'syncStartFunction');
+        }
+        else if (event === Player.NativeEvent.SYNC_RUN)
+        {
+            Sync.callFunction(animation, sync, syncPattern, 'syncRunFunction');
+        }
+        else if (event === Player.NativeEvent.SYNC_END)
+        {
+            Sync.callFunction(animation, sync, syncPattern, 'syncEndFunction');
+        }
+    }
+};
+
+Player.prototype.drawNativeAnimation = function(animationLayers)
+{
+    if (this.native === void null || this.native.animationLayers !== animationLayers)
+    {
+        this.initNativeAnimation(animationLayers);
+    }
+
+    this.native.time = getSceneTimeFromStart();
+    Sync.update();
+
+    animationEngineDraw(this.native.ptr, this.native.time, this.native.callback);
+};
+
+Player.prototype.deinit = function()
+{
+    if (this.native !== void null)
+    {
+        animationEngineDeinit(this.native.ptr);
+        this.native = void null;
+    }
+};
+
 Player.prototype.drawAnimation = function(animationLayers)
 {
+    if (Settings.demoScript.nativeAnimation === true)
+    {
+        this.drawNativeAnimation(animationLayers);
+        return;
+    }
+
     var time = getSceneTimeFromStart();
+    Sync.update();
 
     for (var key in animationLayers)
     {
+        profilerZoneBegin(key);
         glPushMatrix();
 
         if (animationLayers.hasOwnProperty(key))
@@ -661,7 +856,6 @@ Player.prototype.drawAnimation = function(animationLayers)
             var animationLayersLength = animationLayers[key].length;
             for (var animationI = 0; animationI < animationLayersLength; animationI++)
             {
-                glPushAttrib(GL_CURRENT_BIT);
                 var animation = animationLayers[key][animationI];
                 if (animation.error !== void null)
                 {
@@ -670,6 +864,8 @@ Player.prototype.drawAnimation = function(animationLayers)
 
                 if (time >= animation.start && time < animation.end)
                 {
+                    // only active animations save the current color
+                    glPushAttrib(GL_CURRENT_BIT);
                     Sync.calculateAnimationSync(time, animation);
 
                     if (animation.shader !== void null)
@@ -677,30 +873,7 @@ Player.prototype.drawAnimation = function(animationLayers)
                         Shader.enableShader(animation);
                     }
 
-                    if (animation.type === 'image')
-                    {
-                        this.drawImageAnimation(time, animation);
-                    }
-                    else if (animation.type === 'text')
-                    {
-                        this.drawTextAnimation(time, animation);
-                    }
-                    else if (animation.type === 'object')
-                    {
-                        this.drawObjectAnimation(time, animation);
-                    }
-                    else if (animation.type === 'fbo')
-                    {
-                        this.drawFboAnimation(time, animation);
-                    }
-                    else if (animation.type === 'light')
-                    {
-                        this.drawLightAnimation(time, animation);
-                    }
-                    else if (animation.type === 'camera')
-                    {
-                        this.drawCameraAnimation(time, animation);
-                    }
+                    this.drawActiveAnimation(time, animation);
 
                     if (animation.runFunction !== void null)
                     {
@@ -711,11 +884,16 @@ Player.prototype.drawAnimation = function(animationLayers)
                     {
                         Shader.disableShader(animation);
                     }
+                    glPopAttrib();
+                }
+                else if (animation.type === 'image')
+                {
+                    this.prerollImageAnimation(time, animation);
                 }
-                glPopAttrib();
             }
         }
 
         glPopMatrix();
+        profilerZoneEnd();
     }
 }
@@ -20,6 +20,14 @@ Shader.compileAndLinkShaders = function()
 {
     Shader.increaseLoaderResourceCountWithShaders();
 
+    // compile and link everything before checking any status so that the driver can work in parallel
+    shaderCompileBatchBegin();
+    Shader.loadAndLinkShaders();
+    shaderCompileBatchEnd();
+};
+
+Shader.loadAndLinkShaders = function()
+{
     if (Settings.demoScript.shaders !== void null)
     {
         for (var shaderI = 0; shaderI < Settings.demoScript.shaders.length; shaderI++)
@@ -78,7 +86,8 @@ Shader.load = function(shader)
         {
             var shaderFilename = shader.name[i];
             var loadedShader = shaderLoad(shaderFilename, shaderFilename);
-            if (loadedShader.ok == 1)
+            // status of a batch compiled shader is known only after shaderCompileBatchEnd
+            if (loadedShader.ok == 1 || loadedShader.pending == 1)
             {
                 shaderProgramAddShaderByName(shader.programName, shaderFilename);
             }
@@ -86,69 +95,116 @@ Shader.load = function(shader)
         shaderProgramAttachAndLink(shaderProgram.ptr);
     }
 
+    Shader.compileVariables(shader, shaderProgram);
+
     return shaderProgram;
 };
 
+// must match SHADER_UNIFORM_RECORD_SIZE and SHADER_UNIFORM_TYPE_* in shader.h
+Shader.UNIFORM_RECORD_SIZE = 7;
+Shader.UNIFORM_TYPE_FLOAT = 0;
+Shader.UNIFORM_TYPE_INT = 1;
+
+/**
+ * Precompile shader variables to uniform bindings so that enableShader
+ * does not need to do uniform location lookups or compile functions per frame.
+ */
+Shader.compileVariables = function(shader, shaderProgram)
+{
+    shader.bindings = [];
+    shader.uniformRecords = void null;
+
+    if (shader.variable === void null || shaderProgram.ptr === void null)
+    {
+        return;
+    }
+
+    var length = shader.variable.length;
+    for (var i = 0; i < length; i++)
+    {
+        var variable = shader.variable[i];
+
+        var binding = {
+            'index': shaderProgramAddUniform(shaderProgram.ptr, variable.name),
+            'type': (variable.type === 'int') ? Shader.UNIFORM_TYPE_INT : Shader.UNIFORM_TYPE_FLOAT,
+            'func': null,
+            'value': []
+        };
+
+        if (Utils.isString(variable.value) === true)
+        {
+            binding.func = Utils.compileVariable(variable.value);
+            if (binding.func === null)
+            {
+                binding.value = [variable.value];
+            }
+        }
+        else
+        {
+            var valueLength = variable.value.length;
+            for (var j = 0; j < valueLength; j++)
+            {
+                var func = Utils.compileVariable(variable.value[j]);
+                binding.value.push(func !== null ? func : variable.value[j]);
+            }
+        }
+
+        shader.bindings.push(binding);
+    }
+
+    shader.uniformRecords = new Float32Array(shader.bindings.length * Shader.UNIFORM_RECORD_SIZE);
+    for (var i = 0; i < shader.bindings.length; i++)
+    {
+        shader.uniformRecords[i * Shader.UNIFORM_RECORD_SIZE] = shader.bindings[i].index;
+        shader.uniformRecords[i * Shader.UNIFORM_RECORD_SIZE + 1] = shader.bindings[i].type;
+    }
+};
+
 Shader.enableShader = function(animation)
 {
     if (animation.shader !== void null)
     {
         shaderProgramUse(animation.shader.ref.ptr);
 
-        if (animation.shader.variable !== void null)
+        if (animation.shader.bindings === void null)
         {
-            var _getUniformLocation = getUniformLocation;
-            var _glUniformi = glUniformi;
-            var _glUniformf = glUniformf;
-            var _setUniformFunction;
-
-            var length = animation.shader.variable.length;
-            for (var i = 0; i < length; i++)
-            {
-                var variable = animation.shader.variable[i];
-                var name = _getUniformLocation(variable.name);
+            Shader.compileVariables(animation.shader, animation.shader.ref);
+        }
 
-                _setUniformFunction = _glUniformf;
-                if (variable.type === 'int')
-                {
-                    _setUniformFunction = _glUniformi;
-                }
+        var records = animation.shader.uniformRecords;
+        if (records === void null)
+        {
+            return;
+        }
 
-                var value = [];
-                if (Utils.isString(variable.value) === true)
-                {
-                    value = Utils.evaluateVariable(animation, variable.value);
-                }
-                else
-                {
-                    var valueLength = variable.value.length;
-                    for (var j = 0; j < valueLength; j++)
-                    {
-                        value.push(Utils.evaluateVariable(animation, variable.value[j]));
-                    }
-                }
+        var bindings = animation.shader.bindings;
+        var length = bindings.length;
+        for (var i = 0; i < length; i++)
+        {
+            var binding = bindings[i];
+            var offset = i * Shader.UNIFORM_RECORD_SIZE + 2;
 
-                var valueLength = value.length;
+            var value = binding.value;
+            if (binding.func !== null)
+            {
+                value = binding.func(animation);
+            }
 
-                switch (valueLength)
+            var valueLength = (value.length !== void null) ? Math.min(value.length, 4) : 0;
+            records[offset] = valueLength;
+            for (var j = 0; j < valueLength; j++)
+            {
+                var component = value[j];
+                if (typeof component === 'function')
                 {
-                    case 1:
-                        _setUniformFunction(name, value[0]);
-                        break;
-                    case 2:
-                        _setUniformFunction(name, value[0], value[1]);
-                        break;
-                    case 3:
-                        _setUniformFunction(name, value[0], value[1], value[2]);
-                        break;
-                    case 4:
-                        _setUniformFunction(name, value[0], value[1], value[2], value[3]);
-                        break;
-                    default:
-                        break;
+                    component = component(animation);
                 }
+
+                records[offset + 1 + j] = component;
             }
         }
+
+        shaderProgramSetUniforms(animation.shader.ref.ptr, records);
     }
 };
 
@@ -4,6 +4,23 @@ var Sync = function()
 };
 
 Sync.syncDefinitions = {};
+Sync.trackValues = void null;
+
+Sync.update = function()
+{
+    // samples all GNU Rocket tracks of the current row in one call
+    Sync.trackValues = syncEditorGetTrackValues(Sync.trackValues);
+};
+
+Sync.getTrackValue = function(ref)
+{
+    if (Sync.trackValues !== void null && ref.index < Sync.trackValues.length)
+    {
+        return Sync.trackValues[ref.index];
+    }
+
+    return syncEditorGetTrackCurrentValue(ref.ptr);
+};
 
 Sync.addSync = function(syncDefinitions)
 {
@@ -55,14 +72,26 @@ Sync.getSyncValue = function(name)
     {
         if (sync.ref !== void null)
         {
-            var value = syncEditorGetTrackCurrentValue(sync.ref.ptr);
-            return value;
+            return Sync.getTrackValue(sync.ref);
         }
     }
 
     return 0;
 };
 
+// evaluate the function of the sync pattern, or of the sync definition if the pattern doesn't have it
+Sync.callFunction = function(animation, sync, pattern, functionName)
+{
+    if (pattern !== void null && pattern[functionName] !== void null)
+    {
+        Utils.evaluateVariable(animation, pattern[functionName]);
+    }
+    else if (sync[functionName] !== void null)
+    {
+        Utils.evaluateVariable(animation, sync[functionName]);
+    }
+};
+
 Sync.calculateAnimationSync = function(time, animation)
 {
     if (animation.sync !== void null)
@@ -76,7 +105,7 @@ Sync.calculateAnimationSync = function(time, animation)
             if (sync.ref !== void null)
             {
                 //GNU Rocket sync
-                animation.sync.progress = syncEditorGetTrackCurrentValue(sync.ref.ptr);
+                animation.sync.progress = Sync.getTrackValue(sync.ref);
 
                 if (sync.syncStartFunction !== void null && sync.started === void null)
                 {
@@ -110,24 +139,10 @@ Sync.calculateAnimationSync = function(time, animation)
                         pattern.started = true;
                         pattern.startTime = time;
 
-                        if (pattern.syncStartFunction !== void null)
-                        {
-                            Utils.evaluateVariable(animation, pattern.syncStartFunction);
-                        }
-                        else if (sync.syncStartFunction !== void null)
-                        {
-                            Utils.evaluateVariable(animation, sync.syncStartFunction);
-                        }
+                        Sync.callFunction(animation, sync, pattern, 'syncStartFunction');
                     }
 
-                    if (pattern.syncRunFunction !== void null)
-                    {
-                        Utils.evaluateVariable(animation, pattern.syncRunFunction);
-                    }
-                    else if (sync.syncRunFunction !== void null)
-                    {
-                        Utils.evaluateVariable(animation, sync.syncRunFunction);
-                    }
+                    Sync.callFunction(animation, sync, pattern, 'syncRunFunction');
                 }
 
                 if (pattern.started &&
@@ -137,14 +152,7 @@ Sync.calculateAnimationSync = function(time, animation)
                     pattern.started = false;
                     animation.sync.progress = 0;
 
-                    if (pattern.syncEndFunction !== void null)
-                    {
-                        Utils.evaluateVariable(animation, pattern.syncEndFunction);
-                    }
-                    else if (sync.syncEndFunction !== void null)
-                    {
-                        Utils.evaluateVariable(animation, sync.syncEndFunction);
-                    }
+                    Sync.callFunction(animation, sync, pattern, 'syncEndFunction');
                 }
             }
         }
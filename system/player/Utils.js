@@ -90,11 +90,34 @@ Utils.isVideo = function(filename)
     return false;
 };
 
-Utils.evaluateVariable = function(animation, variable)
+Utils.compiledVariables = {};
+
+/**
+ * Compile a function string variable once and cache it by its source.
+ * @return compiled function or null if the variable is not a function string
+ */
+Utils.compileVariable = function(variable)
 {
     if (Utils.isString(variable) && variable.charAt(0) === '{')
     {
-        var func = new Function('animation', variable);
+        var func = Utils.compiledVariables[variable];
+        if (func === void null)
+        {
+            func = new Function('animation', variable);
+            Utils.compiledVariables[variable] = func;
+        }
+
+        return func;
+    }
+
+    return null;
+};
+
+Utils.evaluateVariable = function(animation, variable)
+{
+    var func = Utils.compileVariable(variable);
+    if (func !== null)
+    {
         return func(animation);
     }
 
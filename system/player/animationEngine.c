@@ -0,0 +1,785 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "graphicsIncludes.h"
+#include "system/graphics/graphics.h"
+#include "system/graphics/matrix.h"
+#include "system/graphics/renderState.h"
+#include "system/graphics/object/lighting.h"
+#include "system/datatypes/memory.h"
+#include "system/debug/debug.h"
+#include "system/debug/profiler.h"
+#include "system/rocket/synceditor.h"
+#include "system/ui/window/window.h"
+#include "animationEngine.h"
+
+/**
+ * @defgroup animationEngine Native animation evaluation
+ * Evaluates the animation layers of the JSON demo script natively. The preprocessed animation
+ * layers are ingested once after Loader.processAnimation(), after which keyframe interpolation,
+ * sync progress and the drawing of image, text, object, fbo, light and camera animations run
+ * without the JavaScript interpreter. JavaScript is called back only for the function variables
+ * (runFunction, objectFunction, shader variables and sync functions) and for the animations that
+ * can't be represented natively, e.g. videos or function keyframe values.
+ * The evaluation follows the JavaScript player (Player.js and Sync.js) so that both draw the same frames.
+ * @ingroup player
+ */
+
+/**
+ * Free the engine contents, called by the memory garbage collection.
+ * @ingroup animationEngine
+ */
+void animationEngineDeinit(void *animationEnginePointer)
+{
+	assert(animationEnginePointer);
+	animationEngine_t *animationEngine = (animationEngine_t*)animationEnginePointer;
+
+	unsigned int i;
+	for (i = 0; i < animationEngine->animationCount; i++)
+	{
+		animationEngineAnimation_t *animation = &animationEngine->animations[i];
+		unsigned int track;
+		for (track = 0; track < ANIMATION_TRACK_COUNT; track++)
+		{
+			free(animation->tracks[track].keyframes);
+		}
+		free(animation->textures);
+		free(animation->string);
+		free(animation->font);
+		free(animation->camera);
+		free(animation->name);
+		free(animation->relativePosition);
+		free(animation->relativeTarget);
+	}
+	free(animationEngine->animations);
+	animationEngine->animations = NULL;
+	animationEngine->animationCount = animationEngine->animationCapacity = 0;
+
+	for (i = 0; i < animationEngine->layerCount; i++)
+	{
+		free(animationEngine->layers[i].name);
+	}
+	free(animationEngine->layers);
+	animationEngine->layers = NULL;
+	animationEngine->layerCount = animationEngine->layerCapacity = 0;
+
+	for (i = 0; i < animationEngine->syncCount; i++)
+	{
+		free(animationEngine->syncs[i].name);
+		free(animationEngine->syncs[i].patterns);
+	}
+	free(animationEngine->syncs);
+	animationEngine->syncs = NULL;
+	animationEngine->syncCount = animationEngine->syncCapacity = 0;
+}
+
+/**
+ * Initialize an empty animation engine
+ * @param animationEngine [in] Pointer to animation engine. NULL creates a new animation engine.
+ * @return pointer to animation engine
+ * @ingroup animationEngine
+ * @ref JSAPI
+ */
+animationEngine_t* animationEngineInit(animationEngine_t *animationEngine)
+{
+	if (animationEngine == NULL)
+	{
+		animationEngine = memoryAllocateGeneral(NULL, sizeof(animationEngine_t), animationEngineDeinit);
+	}
+	assert(animationEngine);
+
+	memset(animationEngine, 0, sizeof(animationEngine_t));
+	return animationEngine;
+}
+
+/**
+ * Start a new layer, the animations added after this belong to the layer.
+ * @ingroup animationEngine
+ */
+void animationEngineAddLayer(animationEngine_t *animationEngine, const char *name)
+{
+	assert(animationEngine && name);
+
+	if (animationEngine->layerCount == animationEngine->layerCapacity)
+	{
+		animationEngine->layerCapacity = animationEngine->layerCapacity ? animationEngine->layerCapacity * 2 : 16;
+		animationEngine->layers = (animationLayer_t*)realloc(animationEngine->layers, sizeof(animationLayer_t) * animationEngine->layerCapacity);
+		assert(animationEngine->layers);
+	}
+
+	animationLayer_t *layer = &animationEngine->layers[animationEngine->layerCount++];
+	layer->name = strdup(name);
+	assert(layer->name);
+	layer->first = animationEngine->animationCount;
+	layer->count = 0;
+}
+
+/**
+ * Add an animation to the current layer.
+ * @return zero initialized animation of ANIMATION_TYPE_SCRIPT, valid until the next added animation
+ * @ingroup animationEngine
+ */
+animationEngineAnimation_t* animationEngineAddAnimation(animationEngine_t *animationEngine)
+{
+	assert(animationEngine && animationEngine->layerCount > 0);
+
+	if (animationEngine->animationCount == animationEngine->animationCapacity)
+	{
+		animationEngine->animationCapacity = animationEngine->animationCapacity ? animationEngine->animationCapacity * 2 : 64;
+		animationEngine->animations = (animationEngineAnimation_t*)realloc(animationEngine->animations,
+			sizeof(animationEngineAnimation_t) * animationEngine->animationCapacity);
+		assert(animationEngine->animations);
+	}
+
+	animationEngineAnimation_t *animation = &animationEngine->animations[animationEngine->animationCount++];
+	memset(animation, 0, sizeof(animationEngineAnimation_t));
+	animation->type = ANIMATION_TYPE_SCRIPT;
+	animation->sync = -1;
+	animationEngine->layers[animationEngine->layerCount - 1].count++;
+
+	return animation;
+}
+
+/**
+ * Allocate the keyframes of a track, the caller fills them in.
+ * @ingroup animationEngine
+ */
+animationKeyframe_t* animationEngineTrackInit(animationTrack_t *track, unsigned int keyframeCount, unsigned int channelCount)
+{
+	assert(track && keyframeCount > 0 && channelCount <= ANIMATION_TRACK_CHANNELS);
+
+	free(track->keyframes);
+	track->keyframes = (animationKeyframe_t*)calloc(keyframeCount, sizeof(animationKeyframe_t));
+	assert(track->keyframes);
+	track->keyframeCount = keyframeCount;
+	track->channelCount = channelCount;
+
+	return track->keyframes;
+}
+
+/**
+ * @return index of the sync definition, -1 if it hasn't been added
+ * @ingroup animationEngine
+ */
+int animationEngineFindSync(animationEngine_t *animationEngine, const char *name)
+{
+	assert(animationEngine && name);
+
+	unsigned int i;
+	for (i = 0; i < animationEngine->syncCount; i++)
+	{
+		if (!strcmp(animationEngine->syncs[i].name, name))
+		{
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * Add a sync definition, the caller fills in the patterns and the functions.
+ * @param track [in] GNU Rocket track or NULL for pattern syncs
+ * @return index of the sync definition
+ * @ingroup animationEngine
+ */
+int animationEngineAddSync(animationEngine_t *animationEngine, const char *name, void *track, double end, unsigned int patternCount)
+{
+	assert(animationEngine && name);
+
+	if (animationEngine->syncCount == animationEngine->syncCapacity)
+	{
+		animationEngine->syncCapacity = animationEngine->syncCapacity ? animationEngine->syncCapacity * 2 : 16;
+		animationEngine->syncs = (animationSync_t*)realloc(animationEngine->syncs, sizeof(animationSync_t) * animationEngine->syncCapacity);
+		assert(animationEngine->syncs);
+	}
+
+	animationSync_t *sync = &animationEngine->syncs[animationEngine->syncCount];
+	memset(sync, 0, sizeof(animationSync_t));
+	sync->name = strdup(name);
+	assert(sync->name);
+	sync->track = track;
+	sync->end = end;
+	if (patternCount > 0)
+	{
+		sync->patterns = (animationSyncPattern_t*)calloc(patternCount, sizeof(animationSyncPattern_t));
+		assert(sync->patterns);
+		sync->patternCount = patternCount;
+	}
+
+	return (int)animationEngine->syncCount++;
+}
+
+/* like Sync.calculateAnimationSync() */
+static void animationEngineCalculateSync(animationEngine_t *animationEngine, unsigned int index, double time,
+	animationEngineCallback_t callback, void *userData)
+{
+	animationEngineAnimation_t *animation = &animationEngine->animations[index];
+	if (animation->sync < 0)
+	{
+		return;
+	}
+
+	animationSync_t *sync = &animationEngine->syncs[animation->sync];
+	double syncTime = fmod(time, sync->end);
+
+	animation->syncProgress = 0.0;
+	if (sync->track != NULL)
+	{
+		//GNU Rocket sync
+		animation->syncProgress = syncEditorGetTrackCurrentValue(sync->track);
+
+		if ((sync->functions & ANIMATION_SYNC_START_FUNCTION) && !sync->started)
+		{
+			sync->started = 1;
+			callback(userData, index, ANIMATION_EVENT_SYNC_START, -1);
+		}
+
+		if (sync->functions & ANIMATION_SYNC_RUN_FUNCTION)
+		{
+			callback(userData, index, ANIMATION_EVENT_SYNC_RUN, -1);
+		}
+
+		return;
+	}
+
+	unsigned int i;
+	for (i = 0; i < sync->patternCount; i++)
+	{
+		animationSyncPattern_t *pattern = &sync->patterns[i];
+		//the pattern functions replace the functions of the sync definition
+		int startPattern = (pattern->functions & ANIMATION_SYNC_START_FUNCTION) ? (int)i : -1;
+		int runPattern = (pattern->functions & ANIMATION_SYNC_RUN_FUNCTION) ? (int)i : -1;
+		int endPattern = (pattern->functions & ANIMATION_SYNC_END_FUNCTION) ? (int)i : -1;
+		unsigned int functions = pattern->functions | sync->functions;
+
+		if (syncTime >= pattern->start && syncTime < pattern->end)
+		{
+			animation->syncProgress = (syncTime - pattern->start) / pattern->duration;
+			if (animation->syncProgress > 1.0)
+			{
+				animation->syncProgress = 1.0;
+			}
+
+			if (!pattern->started)
+			{
+				pattern->started = 1;
+				pattern->startTime = time;
+
+				if (functions & ANIMATION_SYNC_START_FUNCTION)
+				{
+					callback(userData, index, ANIMATION_EVENT_SYNC_START, startPattern);
+				}
+			}
+
+			if (functions & ANIMATION_SYNC_RUN_FUNCTION)
+			{
+				callback(userData, index, ANIMATION_EVENT_SYNC_RUN, runPattern);
+			}
+		}
+
+		if (pattern->started && (time >= pattern->startTime + pattern->duration || pattern->startTime > time))
+		{
+			pattern->started = 0;
+			animation->syncProgress = 0.0;
+
+			if (functions & ANIMATION_SYNC_END_FUNCTION)
+			{
+				callback(userData, index, ANIMATION_EVENT_SYNC_END, endPattern);
+			}
+		}
+	}
+}
+
+/**
+ * Interpolate the track at the given time, like Player.calculate*Animation().
+ * @return 1 if the track has keyframes, 0 if value was not touched
+ */
+static int animationEngineEvaluate(const animationEngineAnimation_t *animation, int trackIndex, double time, double *value)
+{
+	const animationTrack_t *track = &animation->tracks[trackIndex];
+	if (track->keyframeCount == 0)
+	{
+		return 0;
+	}
+
+	unsigned int channel;
+	for (channel = 0; channel < track->channelCount; channel++)
+	{
+		value[channel] = track->keyframes[0].value[channel];
+	}
+
+	double timeAdjusted = time;
+	if (track->sync && animation->sync >= 0)
+	{
+		timeAdjusted = animation->start + animation->duration * animation->syncProgress;
+		if (animation->syncProgress == 0.0)
+		{
+			return 1;
+		}
+	}
+
+	unsigned int i;
+	for (i = 0; i < track->keyframeCount; i++)
+	{
+		const animationKeyframe_t *keyframe = &track->keyframes[i];
+		if (timeAdjusted >= keyframe->start)
+		{
+			double p = (timeAdjusted - keyframe->start) / keyframe->duration;
+			p = getClamp(p, 0.0, 1.0);
+
+			for (channel = 0; channel < track->channelCount; channel++)
+			{
+				value[channel] = interpolateLinear(p, value[channel], keyframe->value[channel]);
+			}
+		}
+	}
+
+	return 1;
+}
+
+/* same conversion as the glColor4ub() JavaScript binding */
+static GLubyte animationEngineColorByte(double value)
+{
+	if (!(value > 0.0))
+	{
+		return 0;
+	}
+	if (value >= 4294967295.0)
+	{
+		return (GLubyte)0xFF;
+	}
+
+	return (GLubyte)(unsigned int)value;
+}
+
+static void animationEngineSetColor(const animationEngineAnimation_t *animation, double time)
+{
+	double color[4] = {255.0, 255.0, 255.0, 255.0};
+	animationEngineEvaluate(animation, ANIMATION_TRACK_COLOR, time, color);
+	glColor4ub(animationEngineColorByte(color[0]), animationEngineColorByte(color[1]),
+		animationEngineColorByte(color[2]), animationEngineColorByte(color[3]));
+}
+
+static void animationEngineDrawImage(const animationEngineAnimation_t *animation, double time)
+{
+	texture_t *texture = (texture_t*)animation->ref;
+	double value[ANIMATION_TRACK_CHANNELS];
+
+	if (animation->flags & ANIMATION_FLAG_BLEND)
+	{
+		setTextureBlendFunc(texture, animation->blendSrc, animation->blendDst);
+	}
+
+	setTexturePerspective3d(texture, (animation->flags & ANIMATION_FLAG_PERSPECTIVE_3D) ? 1 : 0);
+
+	if (animation->flags & ANIMATION_FLAG_CANVAS)
+	{
+		setTextureCanvasDimensions(texture, animation->canvasWidth, animation->canvasHeight);
+	}
+
+	if (animation->flags & ANIMATION_FLAG_UV)
+	{
+		setTextureUvDimensions(texture, animation->uv[0], animation->uv[1], animation->uv[2], animation->uv[3]);
+	}
+
+	unsigned int i;
+	for (i = 1; i < animation->textureCount; i++)
+	{
+		setTextureUnitTexture(texture, i, animation->textures[i]);
+	}
+
+	if (animationEngineEvaluate(animation, ANIMATION_TRACK_PIVOT, time, value))
+	{
+		setTexturePivot(texture, value[0], value[1], value[2]);
+	}
+
+	if (animationEngineEvaluate(animation, ANIMATION_TRACK_ANGLE, time, value))
+	{
+		setTextureRotation(texture, value[0], value[1], value[2], value[3], value[4], value[5]);
+	}
+
+	animationEngineEvaluate(animation, ANIMATION_TRACK_SCALE, time, value);
+	setTextureScale(texture, value[0], value[1]);
+
+	if (animationEngineEvaluate(animation, ANIMATION_TRACK_POSITION, time, value))
+	{
+		double y = value[1];
+		if (animation->flags & ANIMATION_FLAG_KANTTU)
+		{
+			y = getScreenHeight() - value[1];
+		}
+		setTexturePosition(texture, value[0], y, value[2]);
+	}
+
+	if (animation->flags & ANIMATION_FLAG_ALIGN)
+	{
+		setTextureCenterAlignment(texture, animation->align);
+	}
+
+	animationEngineSetColor(animation, time);
+
+	drawTexture(texture);
+	setTextureDefaults(texture);
+}
+
+static void animationEngineDrawText(const animationEngineAnimation_t *animation, double time)
+{
+	double value[ANIMATION_TRACK_CHANNELS];
+	int perspective3d = animation->flags & ANIMATION_FLAG_PERSPECTIVE_3D;
+
+	setTextDefaults();
+
+	setDrawTextString(animation->string);
+
+	if (animationEngineEvaluate(animation, ANIMATION_TRACK_PIVOT, time, value))
+	{
+		setTextPivot(value[0], value[1], value[2]);
+	}
+
+	if (animationEngineEvaluate(animation, ANIMATION_TRACK_ANGLE, time, value))
+	{
+		setTextRotation(value[0], value[1], value[2]);
+	}
+
+	animationEngineEvaluate(animation, ANIMATION_TRACK_SCALE, time, value);
+	setTextSize(value[0], value[1]);
+
+	if (animationEngineEvaluate(animation, ANIMATION_TRACK_POSITION, time, value))
+	{
+		setTextPosition(value[0], value[1], perspective3d ? value[2] : 0.0);
+	}
+
+	if (!perspective3d && (animation->flags & ANIMATION_FLAG_ALIGN))
+	{
+		setTextCenterAlignment(animation->align);
+	}
+
+	if (animation->font != NULL)
+	{
+		setTextFont(animation->font);
+	}
+
+	animationEngineSetColor(animation, time);
+
+	if (!perspective3d)
+	{
+		drawText2d();
+	}
+	else
+	{
+		if (animation->flags & ANIMATION_FLAG_CLEAR_DEPTH)
+		{
+			glClear(GL_DEPTH_BUFFER_BIT);
+		}
+
+		drawText3d();
+	}
+
+	setTextDefaults();
+}
+
+static void animationEngineDrawObject(const animationEngineAnimation_t *animation, unsigned int index, double time,
+	animationEngineCallback_t callback, void *userData)
+{
+	object3d_t *object = (object3d_t*)animation->ref;
+	double value[ANIMATION_TRACK_CHANNELS];
+	int pushMatrix = 0;
+
+	if (object != NULL)
+	{
+		if (animationEngineEvaluate(animation, ANIMATION_TRACK_POSITION, time, value))
+		{
+			setObjectPosition(object, (float)value[0], (float)value[1], (float)value[2]);
+		}
+		if (animationEngineEvaluate(animation, ANIMATION_TRACK_PIVOT, time, value))
+		{
+			setObjectPivot(object, (float)value[0], (float)value[1], (float)value[2]);
+		}
+		if (animationEngineEvaluate(animation, ANIMATION_TRACK_ANGLE, time, value))
+		{
+			setObjectRotation(object, (float)value[0], (float)value[1], (float)value[2], (float)value[3], (float)value[4], (float)value[5]);
+		}
+		if (animationEngineEvaluate(animation, ANIMATION_TRACK_SCALE, time, value))
+		{
+			setObjectScale(object, (float)value[0], (float)value[1], (float)value[2]);
+		}
+		if (animationEngineEvaluate(animation, ANIMATION_TRACK_COLOR, time, value))
+		{
+			setObjectColor(object, (float)(value[0] / 255), (float)(value[1] / 255), (float)(value[2] / 255), (float)(value[3] / 255));
+		}
+
+		double frame = (time - animation->start) * animation->fps;
+		if (animation->flags & ANIMATION_FLAG_FRAME)
+		{
+			frame = animation->frame;
+		}
+		int clearDepthBuffer = (animation->flags & ANIMATION_FLAG_CLEAR_DEPTH) ? 1 : 0;
+
+		pushMatrix = animation->flags & ANIMATION_FLAG_PUSH_MATRIX;
+		if (pushMatrix)
+		{
+			matrixPush();
+		}
+
+		if (clearDepthBuffer)
+		{
+			glClear(GL_DEPTH_BUFFER_BIT);
+		}
+
+		drawObject(object, animation->camera, frame, clearDepthBuffer);
+	}
+
+	if (animation->flags & ANIMATION_FLAG_OBJECT_FUNCTION)
+	{
+		callback(userData, index, ANIMATION_EVENT_OBJECT_FUNCTION, -1);
+	}
+
+	if (pushMatrix)
+	{
+		matrixPop();
+	}
+}
+
+#ifdef SUPPORT_GL_FBO
+static void animationEngineDrawFboTexture(fbo_t *fbo)
+{
+	fboBindTextures(fbo);
+
+	glColor4f(1, 1, 1, 1);
+	if (fbo->color != NULL)
+	{
+		setTextureSizeToScreenSize(fbo->color);
+	}
+	if (fbo->depth != NULL)
+	{
+		setTextureSizeToScreenSize(fbo->depth);
+	}
+	drawTexture(fbo->color);
+
+	fboBindTextures(NULL);
+}
+
+static void animationEngineDrawFbo(const animationEngineAnimation_t *animation, double time)
+{
+	fbo_t *fbo = (fbo_t*)animation->ref;
+	double value[ANIMATION_TRACK_CHANNELS];
+
+	if (animationEngineEvaluate(animation, ANIMATION_TRACK_DIMENSION, time, value))
+	{
+		fboSetRenderDimensions(fbo, value[0], value[1]);
+	}
+
+	switch (animation->action)
+	{
+		case ANIMATION_ACTION_BEGIN:
+			fboGpuZoneBegin(fbo);
+			fboBind(fbo);
+			fboUpdateViewport(fbo);
+			break;
+
+		case ANIMATION_ACTION_END:
+			fboBind(NULL);
+			fboGpuZoneEnd(fbo);
+			fboUpdateViewport(NULL);
+			animationEngineDrawFboTexture(fbo);
+			break;
+
+		case ANIMATION_ACTION_UNBIND:
+			fboBind(NULL);
+			fboGpuZoneEnd(fbo);
+			fboUpdateViewport(NULL);
+			break;
+
+		case ANIMATION_ACTION_DRAW:
+			animationEngineDrawFboTexture(fbo);
+			break;
+
+		default:
+			break;
+	}
+}
+#endif
+
+/* the relative objects are looked up at their first use and used from the next frame on, like in Player.js */
+static object3d_t *animationEngineRelativeObject(const char *name, object3d_t **object, int *resolved)
+{
+	object3d_t *current = *object;
+	if (!*resolved && name != NULL)
+	{
+		*object = getObjectFromMemory(name);
+		*resolved = 1;
+		if (*object == NULL)
+		{
+			debugErrorPrintf("Could not find object by name '%s'", name);
+		}
+	}
+
+	return current;
+}
+
+static void animationEngineDrawLight(animationEngineAnimation_t *animation, double time)
+{
+	double value[ANIMATION_TRACK_CHANNELS];
+	unsigned int light = animation->light;
+
+	if (animationEngineEvaluate(animation, ANIMATION_TRACK_AMBIENT, time, value))
+	{
+		lightSetAmbientColor(light, (float)(value[0] / 255), (float)(value[1] / 255), (float)(value[2] / 255), (float)(value[3] / 255));
+	}
+
+	if (animationEngineEvaluate(animation, ANIMATION_TRACK_DIFFUSE, time, value))
+	{
+		lightSetDiffuseColor(light, (float)(value[0] / 255), (float)(value[1] / 255), (float)(value[2] / 255), (float)(value[3] / 255));
+	}
+
+	if (animationEngineEvaluate(animation, ANIMATION_TRACK_SPECULAR, time, value))
+	{
+		lightSetSpecularColor(light, (float)(value[0] / 255), (float)(value[1] / 255), (float)(value[2] / 255), (float)(value[3] / 255));
+	}
+
+	if (animationEngineEvaluate(animation, ANIMATION_TRACK_POSITION, time, value))
+	{
+		lightSetPosition(light, (float)value[0], (float)value[1], (float)value[2]);
+	}
+
+	lightSetPositionObject(light, animationEngineRelativeObject(animation->relativePosition,
+		&animation->positionObject, &animation->positionObjectResolved));
+
+	if (animation->action == ANIMATION_ACTION_BEGIN)
+	{
+		lightSetOn(light);
+	}
+	else if (animation->action == ANIMATION_ACTION_END)
+	{
+		lightSetOff(light);
+	}
+}
+
+static void animationEngineDrawCamera(animationEngineAnimation_t *animation, double time)
+{
+	double value[ANIMATION_TRACK_CHANNELS];
+
+	if (animationEngineEvaluate(animation, ANIMATION_TRACK_PERSPECTIVE, time, value))
+	{
+		setCameraPerspective(value[0], value[1], value[2], value[3]);
+	}
+	if (animationEngineEvaluate(animation, ANIMATION_TRACK_POSITION, time, value))
+	{
+		setCameraPosition((float)value[0], (float)value[1], (float)value[2]);
+	}
+	if (animationEngineEvaluate(animation, ANIMATION_TRACK_TARGET, time, value))
+	{
+		setCameraLookAt((float)value[0], (float)value[1], (float)value[2]);
+	}
+	if (animationEngineEvaluate(animation, ANIMATION_TRACK_UP, time, value))
+	{
+		setCameraUpVector((float)value[0], (float)value[1], (float)value[2]);
+	}
+
+	setCameraPositionObject(animationEngineRelativeObject(animation->relativePosition,
+		&animation->positionObject, &animation->positionObjectResolved));
+	setCameraTargetObject(animationEngineRelativeObject(animation->relativeTarget,
+		&animation->targetObject, &animation->targetObjectResolved));
+
+	resetViewport();
+	viewReset();
+}
+
+/**
+ * Draw the active animations of all layers, like Player.drawAnimation().
+ * @param time [in] scene time, see getSceneTimeFromStart()
+ * @param callback [in] evaluates the JavaScript parts of the animations
+ * @ingroup animationEngine
+ */
+void animationEngineDraw(animationEngine_t *animationEngine, double time, animationEngineCallback_t callback, void *userData)
+{
+	assert(animationEngine && callback);
+
+	unsigned int layerIndex;
+	for (layerIndex = 0; layerIndex < animationEngine->layerCount; layerIndex++)
+	{
+		const animationLayer_t *layer = &animationEngine->layers[layerIndex];
+		profilerZoneBegin(layer->name);
+		matrixPush();
+
+		unsigned int index;
+		for (index = layer->first; index < layer->first + layer->count; index++)
+		{
+			animationEngineAnimation_t *animation = &animationEngine->animations[index];
+			if (animation->flags & ANIMATION_FLAG_ERROR)
+			{
+				continue; //skip animations that are in error state
+			}
+
+			if (time >= animation->start && time < animation->end)
+			{
+				// only active animations save the current color
+				renderStatePushAttrib(GL_CURRENT_BIT);
+				animationEngineCalculateSync(animationEngine, index, time, callback, userData);
+
+				if (animation->flags & ANIMATION_FLAG_SHADER)
+				{
+					callback(userData, index, ANIMATION_EVENT_SHADER_ENABLE, -1);
+				}
+
+				switch (animation->type)
+				{
+					case ANIMATION_TYPE_IMAGE:
+						animationEngineDrawImage(animation, time);
+						break;
+
+					case ANIMATION_TYPE_TEXT:
+						animationEngineDrawText(animation, time);
+						break;
+
+					case ANIMATION_TYPE_OBJECT:
+						animationEngineDrawObject(animation, index, time, callback, userData);
+						break;
+
+#ifdef SUPPORT_GL_FBO
+					case ANIMATION_TYPE_FBO:
+						animationEngineDrawFbo(animation, time);
+						break;
+#endif
+
+					case ANIMATION_TYPE_LIGHT:
+						animationEngineDrawLight(animation, time);
+						break;
+
+					case ANIMATION_TYPE_CAMERA:
+						animationEngineDrawCamera(animation, time);
+						break;
+
+					case ANIMATION_TYPE_NONE:
+						break;
+
+					case ANIMATION_TYPE_SCRIPT:
+					default:
+						callback(userData, index, ANIMATION_EVENT_DRAW, -1);
+						break;
+				}
+
+				if (animation->flags & ANIMATION_FLAG_RUN_FUNCTION)
+				{
+					callback(userData, index, ANIMATION_EVENT_RUN_FUNCTION, -1);
+				}
+
+				if (animation->flags & ANIMATION_FLAG_SHADER)
+				{
+					callback(userData, index, ANIMATION_EVENT_SHADER_DISABLE, -1);
+				}
+				renderStatePopAttrib();
+			}
+			else if (animation->flags & ANIMATION_FLAG_PREROLL)
+			{
+				callback(userData, index, ANIMATION_EVENT_PREROLL, -1);
+			}
+		}
+
+		matrixPop();
+		profilerZoneEnd();
+	}
+}
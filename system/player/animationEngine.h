@@ -0,0 +1,188 @@
+#ifndef EXH_SYSTEM_PLAYER_ANIMATIONENGINE_H_
+#define EXH_SYSTEM_PLAYER_ANIMATIONENGINE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ANIMATION_TRACK_CHANNELS 6
+
+/* animations the engine can't represent natively are drawn by the JavaScript player */
+#define ANIMATION_TYPE_SCRIPT 0
+#define ANIMATION_TYPE_IMAGE 1
+#define ANIMATION_TYPE_TEXT 2
+#define ANIMATION_TYPE_OBJECT 3
+#define ANIMATION_TYPE_FBO 4
+#define ANIMATION_TYPE_LIGHT 5
+#define ANIMATION_TYPE_CAMERA 6
+/* nothing to draw, e.g. an animation with only a runFunction */
+#define ANIMATION_TYPE_NONE 7
+
+#define ANIMATION_TRACK_POSITION 0
+#define ANIMATION_TRACK_PIVOT 1
+#define ANIMATION_TRACK_ANGLE 2
+#define ANIMATION_TRACK_SCALE 3
+#define ANIMATION_TRACK_COLOR 4
+#define ANIMATION_TRACK_DIMENSION 5
+#define ANIMATION_TRACK_AMBIENT 6
+#define ANIMATION_TRACK_DIFFUSE 7
+#define ANIMATION_TRACK_SPECULAR 8
+#define ANIMATION_TRACK_PERSPECTIVE 9
+#define ANIMATION_TRACK_TARGET 10
+#define ANIMATION_TRACK_UP 11
+#define ANIMATION_TRACK_COUNT 12
+
+#define ANIMATION_FLAG_RUN_FUNCTION 0x1
+#define ANIMATION_FLAG_OBJECT_FUNCTION 0x2
+#define ANIMATION_FLAG_SHADER 0x4
+#define ANIMATION_FLAG_PREROLL 0x8
+#define ANIMATION_FLAG_CLEAR_DEPTH 0x10
+#define ANIMATION_FLAG_PERSPECTIVE_3D 0x20
+#define ANIMATION_FLAG_PUSH_MATRIX 0x40
+#define ANIMATION_FLAG_BLEND 0x80
+#define ANIMATION_FLAG_CANVAS 0x100
+#define ANIMATION_FLAG_UV 0x200
+#define ANIMATION_FLAG_ALIGN 0x400
+#define ANIMATION_FLAG_FRAME 0x800
+#define ANIMATION_FLAG_KANTTU 0x1000
+/* a JavaScript callback of the animation failed, the animation is skipped like animations with an error in Player.js */
+#define ANIMATION_FLAG_ERROR 0x2000
+
+#define ANIMATION_ACTION_NONE 0
+#define ANIMATION_ACTION_BEGIN 1
+#define ANIMATION_ACTION_END 2
+#define ANIMATION_ACTION_UNBIND 3
+#define ANIMATION_ACTION_DRAW 4
+
+#define ANIMATION_SYNC_START_FUNCTION 0x1
+#define ANIMATION_SYNC_RUN_FUNCTION 0x2
+#define ANIMATION_SYNC_END_FUNCTION 0x4
+
+/* events delivered to the animation engine callback, must match Player.NativeEvent in Player.js */
+#define ANIMATION_EVENT_DRAW 0
+#define ANIMATION_EVENT_PREROLL 1
+#define ANIMATION_EVENT_RUN_FUNCTION 2
+#define ANIMATION_EVENT_OBJECT_FUNCTION 3
+#define ANIMATION_EVENT_SHADER_ENABLE 4
+#define ANIMATION_EVENT_SHADER_DISABLE 5
+#define ANIMATION_EVENT_SYNC_START 6
+#define ANIMATION_EVENT_SYNC_RUN 7
+#define ANIMATION_EVENT_SYNC_END 8
+
+typedef struct {
+	double start;
+	double duration;
+	double value[ANIMATION_TRACK_CHANNELS];
+} animationKeyframe_t;
+
+typedef struct {
+	animationKeyframe_t *keyframes;
+	unsigned int keyframeCount;
+	unsigned int channelCount;
+	/* keyframe time follows the sync progress */
+	int sync;
+} animationTrack_t;
+
+typedef struct {
+	double start;
+	double end;
+	double duration;
+	double startTime;
+	int started;
+	unsigned int functions;
+} animationSyncPattern_t;
+
+typedef struct {
+	char *name;
+	/* GNU Rocket track, NULL for pattern syncs */
+	void *track;
+	double end;
+	int started;
+	unsigned int functions;
+	animationSyncPattern_t *patterns;
+	unsigned int patternCount;
+} animationSync_t;
+
+typedef struct {
+	int type;
+	unsigned int flags;
+	double start;
+	double end;
+	double duration;
+	/* index of the sync definition, -1 if not synced */
+	int sync;
+	double syncProgress;
+	animationTrack_t tracks[ANIMATION_TRACK_COUNT];
+
+	/* texture_t*, object3d_t* or fbo_t* depending on the type */
+	void *ref;
+	texture_t **textures;
+	unsigned int textureCount;
+	unsigned int blendSrc;
+	unsigned int blendDst;
+	int canvasWidth;
+	int canvasHeight;
+	double uv[4];
+	int align;
+
+	char *string;
+	char *font;
+	char *camera;
+	double fps;
+	double frame;
+
+	/* fbo name or light index */
+	char *name;
+	unsigned int light;
+	int action;
+
+	char *relativePosition;
+	char *relativeTarget;
+	int positionObjectResolved;
+	int targetObjectResolved;
+	object3d_t *positionObject;
+	object3d_t *targetObject;
+} animationEngineAnimation_t;
+
+typedef struct {
+	char *name;
+	unsigned int first;
+	unsigned int count;
+} animationLayer_t;
+
+/**
+ * Called for the parts of the animations that are evaluated in JavaScript.
+ * @param userData [in] pointer given to animationEngineDraw()
+ * @param animation [in] index of the animation in the order it was added
+ * @param event [in] ANIMATION_EVENT_*
+ * @param pattern [in] index of the sync pattern for sync events, -1 for the sync definition functions
+ */
+typedef void (*animationEngineCallback_t)(void *userData, unsigned int animation, int event, int pattern);
+
+typedef struct {
+	animationEngineAnimation_t *animations;
+	unsigned int animationCount;
+	unsigned int animationCapacity;
+	animationLayer_t *layers;
+	unsigned int layerCount;
+	unsigned int layerCapacity;
+	animationSync_t *syncs;
+	unsigned int syncCount;
+	unsigned int syncCapacity;
+} animationEngine_t;
+
+extern void animationEngineDeinit(void *animationEngine);
+extern animationEngine_t* animationEngineInit(animationEngine_t *animationEngine);
+extern void animationEngineAddLayer(animationEngine_t *animationEngine, const char *name);
+extern animationEngineAnimation_t* animationEngineAddAnimation(animationEngine_t *animationEngine);
+extern animationKeyframe_t* animationEngineTrackInit(animationTrack_t *track, unsigned int keyframeCount, unsigned int channelCount);
+extern int animationEngineFindSync(animationEngine_t *animationEngine, const char *name);
+extern int animationEngineAddSync(animationEngine_t *animationEngine, const char *name, void *track, double end, unsigned int patternCount);
+extern void animationEngineDraw(animationEngine_t *animationEngine, double time, animationEngineCallback_t callback, void *userData);
+
+#ifdef __cplusplus
+/* end 'extern "C"' wrapper */
+}
+#endif
+
+#endif /*EXH_SYSTEM_PLAYER_ANIMATIONENGINE_H_*/
@@ -6,6 +6,8 @@
 #include "system/graphics/graphics.h"
 #include "system/graphics/object/lighting.h"
 #include "system/debug/debug.h"
+#include "system/debug/benchmark.h"
+#include "system/debug/profiler.h"
 #include "system/timer/timer.h"
 #include "system/thread/thread.h"
 #include "system/datatypes/datatypes.h"
@@ -13,6 +15,7 @@
 #include "system/ui/input/input.h"
 #include "system/ui/window/window.h"
 #include "system/io/io.h"
+#include "system/io/fileWatch.h"
 #include "system/javascript/javascript.h"
 #include "system/datatypes/memory.h"
 #include "effects/playlist.h"
@@ -24,6 +27,9 @@
 #define PLAYER_LOADING 2
 #define PLAYER_RUNNING 3
 
+/* seconds before a scene starts that its effect is asked to preroll, e.g. decode video frames */
+#define PLAYER_SCENE_PREROLL_TIME 1.0
+
 #define EFFECT_TYPE_C 0
 #define EFFECT_TYPE_JS 1
 #define EFFECT_TYPE_SHADER 2
@@ -139,6 +145,7 @@ static void initEffect(playerEffect *effect, playerScene *playerScene)
 				jsEvalString(jsCall);
 				jsEvalFile(effect->reference);
 				jsCallClassMethod("Effect", "init", effect->name);
+				effect->jsRun = jsReferenceClassMethod("Effect", "getRunFunction", effect->name);
 				break;
 #endif
 		}
@@ -169,6 +176,8 @@ static void deinitEffect(playerEffect *effect, playerScene *playerScene)
 				break;
 #ifdef JAVASCRIPT
 			case EFFECT_TYPE_JS:
+				jsReleaseReference(effect->jsRun);
+				effect->jsRun = -1;
 				jsCallClassMethod("Effect", "deinit", effect->name);
 				jsGarbageCollect();
 				break;
@@ -230,6 +239,7 @@ void playerForceRedraw()
 static void runEffect(playerEffect *effect, playerScene *playerScene)
 {
 	playerEffectCurrentScene = playerScene;
+	profilerZoneBegin(effect->name);
 	switch(effect->type)
 	{
 		case EFFECT_TYPE_C:
@@ -243,9 +253,11 @@ static void runEffect(playerEffect *effect, playerScene *playerScene)
 			if (isPlayerEditor())
 			{
 				//if file has been modified, refresh it
-				if (fileModified(effect->reference, &effect->fileLastModifiedTime) == 1)
+				if (effect->fileChanged)
 				{
+					effect->fileChanged = 0;
 					debugPrintf("File '%s' has been modified, effect will be refreshed", effect->reference);
+					ioPathCacheInvalidate();
 
 					refreshEffect(effect, playerScene);
 				}
@@ -253,11 +265,35 @@ static void runEffect(playerEffect *effect, playerScene *playerScene)
 
 			if (!timerIsPause() || forceRedrawHandling)
 			{
-				jsCallClassMethod("Effect", "run", effect->name);
+				if (effect->jsRun >= 0)
+				{
+					jsCallReference(effect->jsRun, "run");
+				}
+				else
+				{
+					jsCallClassMethod("Effect", "run", effect->name);
+				}
 			}
 			break;
 #endif
 	}
+	profilerZoneEnd();
+}
+
+static void prerollEffect(playerEffect *effect, playerScene *playerScene)
+{
+#ifdef JAVASCRIPT
+	if (effect->type == EFFECT_TYPE_JS && (!timerIsPause() || forceRedrawHandling))
+	{
+		playerEffectCurrentScene = playerScene;
+		jsCallClassMethod("Effect", "preroll", effect->name);
+	}
+#endif
+}
+
+static void playerEffectFileChanged(const char *filename, void *effect)
+{
+	((playerEffect*)effect)->fileChanged = 1;
 }
 
 static int playerEffectSize = 0;
@@ -294,8 +330,12 @@ playerEffect *addPlayerEffect(const char *name, const char *reference,
 		pe->run = run;
 		pe->deinit = deinit;
 		pe->next = NULL;
-		pe->fileLastModifiedTime = 0;
-		fileModified(pe->reference, &pe->fileLastModifiedTime);
+		pe->fileChanged = 0;
+		pe->jsRun = -1;
+		if (pe->type != EFFECT_TYPE_C)
+		{
+			fileWatchAdd(pe->reference, playerEffectFileChanged, pe);
+		}
 	
 		if (playerEffectHead == NULL)
 		{
@@ -442,6 +482,7 @@ static void cleanPlayerEffect(void)
 	{
 		playerEffect *next = (playerEffect*)playerEffectCurrent->next;
 
+		fileWatchRemove(playerEffectCurrent);
 		free(playerEffectCurrent->name);
 		free(playerEffectCurrent->reference);
 		free(playerEffectCurrent);
@@ -584,8 +625,8 @@ static void playerDrawLoadingBarPercent(double percent)
 		fade_out = 0.0;
 	}
 
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glEnable(GL_BLEND);
+	renderStateBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	renderStateEnable(GL_BLEND);
 	
 	glColor4d(0.6,0.6,0.6,fade_out);
 	glBegin(GL_LINE_STRIP);
@@ -604,7 +645,7 @@ static void playerDrawLoadingBarPercent(double percent)
 		glVertex3f( sx, ey , 0);
 	glEnd();
 	
-	glDisable(GL_BLEND);
+	renderStateDisable(GL_BLEND);
 
 	glColor4d(1.0,1.0,1.0,1.0);
 
@@ -665,6 +706,17 @@ void playerShowScreenLog(int show)
 	}
 }
 
+static int showProfilerOverlay = 0;
+void playerShowProfilerOverlay(int show)
+{
+	showProfilerOverlay = show;
+	if (show && !profilerGpuIsEnabled())
+	{
+		debugWarningPrintf("GPU zones not available, overlay is empty");
+	}
+	playerForceRedraw();
+}
+
 void playerInit(void)
 {
 	timerCounter_t *counter = timerCounterStart(__func__);
@@ -694,10 +746,10 @@ void playerInit(void)
 	lightingInit();
 
 	//Enable precision depth testing (less Z error on overlapping polygons)
-	glEnable(GL_DEPTH_TEST);
+	renderStateEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LEQUAL);
 #ifndef MORPHOS
-    glEnable(GL_RESCALE_NORMAL);
+    renderStateEnable(GL_RESCALE_NORMAL);
 #endif
     //glEnable(GL_NORMALIZE);
 
@@ -707,9 +759,9 @@ void playerInit(void)
 
 	//Enable line and point smoothing
 	glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
-	glEnable(GL_LINE_SMOOTH);
+	renderStateEnable(GL_LINE_SMOOTH);
 	glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
-	glEnable(GL_POINT_SMOOTH);
+	renderStateEnable(GL_POINT_SMOOTH);
 
 	glClearDepth(1.0);
 	
@@ -734,6 +786,10 @@ void playerInit(void)
 
 	playerInitLoadingBar();
 
+#ifdef SUPPORT_GLSL
+	shaderCompileBatchBegin();
+#endif
+
 	int i;
 	playerSceneCurrent = playerSceneHead;
 	for(i = 0; playerSceneCurrent != NULL; i++)
@@ -757,6 +813,10 @@ void playerInit(void)
 		playerSceneCurrent = (playerScene*)playerSceneCurrent->next;
 	}
 
+#ifdef SUPPORT_GLSL
+	shaderCompileBatchEnd();
+#endif
+
 	sceneResourceCount = -1;
 
 	timerCounterEnd(counter);
@@ -798,8 +858,10 @@ void playerRun(void)
 		{
 			if (currentTime < playerSceneCurrent->end)
 			{
-				glPushMatrix();
-				glPushAttrib(GL_ALL_ATTRIB_BITS);
+				profilerZoneBegin(playerSceneCurrent->name);
+				profilerGpuZoneBegin(playerSceneCurrent->name);
+				matrixPush();
+				renderStatePushAttrib(GL_ALL_ATTRIB_BITS);
 
 				populateSceneTime(playerSceneCurrent);
 
@@ -812,8 +874,10 @@ void playerRun(void)
 					playerRunSubScenes(playerSceneCurrent);
 				}
 				
-				glPopAttrib();
-				glPopMatrix();
+				renderStatePopAttrib();
+				matrixPop();
+				profilerGpuZoneEnd();
+				profilerZoneEnd();
 
 				if (isOpenGlError())
 				{
@@ -824,6 +888,11 @@ void playerRun(void)
 				}
 			}
 		}
+		else if (currentTime >= playerSceneCurrent->start - PLAYER_SCENE_PREROLL_TIME && playerSceneCurrent->effect)
+		{
+			populateSceneTime(playerSceneCurrent);
+			prerollEffect(playerSceneCurrent->effect, playerSceneCurrent);
+		}
 
 		playerSceneCurrent = (playerScene*)playerSceneCurrent->next;
 	}
@@ -831,14 +900,14 @@ void playerRun(void)
 
 static void drawScreenLog(void)
 {
-	glPushMatrix();
-	glPushAttrib(GL_ALL_ATTRIB_BITS);
+	matrixPush();
+	renderStatePushAttrib(GL_ALL_ATTRIB_BITS);
 	int width = getScreenWidth();
 	int height = getScreenHeight();
 	
 	perspective2dBegin(width, height);
 
-	glEnable(GL_BLEND);
+	renderStateEnable(GL_BLEND);
 	glColor4f(0,0,0,0.5);
 	glBegin(GL_QUADS);
 	glVertex2f(0,0);
@@ -846,7 +915,7 @@ static void drawScreenLog(void)
 	glVertex2f(width,height);
 	glVertex2f(0,height);
 	glEnd();
-	glDisable(GL_BLEND);
+	renderStateDisable(GL_BLEND);
 
 	setTextDefaults();
 	setTextWrap(1);
@@ -861,16 +930,46 @@ static void drawScreenLog(void)
 
 	perspective2dEnd();
 	
-	glPopAttrib();
-	glPopMatrix();
+	renderStatePopAttrib();
+	matrixPop();
 }
 
-static double shaderRefreshCheck = 0.0f;
-static const double shaderRefreshDelay = 0.1f;
+static void drawProfilerOverlay(void)
+{
+	matrixPush();
+	renderStatePushAttrib(GL_ALL_ATTRIB_BITS);
+
+	perspective2dBegin(getScreenWidth(), getScreenHeight());
+
+	static char summary[4096];
+	snprintf(summary, sizeof(summary), "%s%s%s", renderStateGetSummary(), profilerGetSummary(), profilerGpuGetSummary());
+
+	setTextDefaults();
+	setDrawTextString(summary);
+	double size = 0.25;
+	setTextSize(size, size);
+	setTextCenterAlignment(4); //LEFT
+	setTextPosition(0, getScreenHeight() - (getTextStringHeight()+getTextCharacterHeight())*size/2.0, 0);
+	glColor4f(1,1,0,1);
+	drawText2d();
+	setTextDefaults();
+
+	perspective2dEnd();
+
+	renderStatePopAttrib();
+	matrixPop();
+}
 
 static void playerRefresh(int full);
 void playerDraw(void)
 {
+#ifdef JAVASCRIPT
+	unsigned long long frameStart = timerGetNanoseconds();
+#endif
+	profilerGpuFrameBegin();
+	profilerFrameBegin();
+	renderStateFrameBegin();
+
 	forceRedrawHandling = 0;
 	if (isForceRedraw)
 	{
@@ -899,6 +998,11 @@ void playerDraw(void)
 		{
 			drawScreenLog();
 		}
+
+		if (showProfilerOverlay)
+		{
+			drawProfilerOverlay();
+		}
 		
 		if (getPlayerRefreshRequest() > -1)
 		{
@@ -914,17 +1018,19 @@ void playerDraw(void)
 			TwDraw();
 		}
 #endif
+		benchmarkFrameCapture();
 		graphicsFlush();
 	}
+
+#ifdef JAVASCRIPT
+	double frameSeconds = (timerGetNanoseconds() - frameStart) / 1e9;
+	jsIdleGarbageCollect(1.0 / timerGetTargetFps() - frameSeconds);
+#endif
 	
 	if (isPlayerEditor())
 	{
-		double now = timerGetSeconds();
-		if (now > shaderRefreshCheck+shaderRefreshDelay)
-		{
-			shaderProgramCheckForUpdatesAndRefresh();
-			shaderRefreshCheck = now;
-		}
+		fileWatchUpdate();
+		shaderProgramCheckForUpdatesAndRefresh();
 	}
 }
 
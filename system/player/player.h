@@ -15,12 +15,15 @@ typedef struct playerEffect playerEffect;
 struct playerEffect {
 	char *name;
 	char *reference;
-	time_t fileLastModifiedTime;
+	/* set by the file watch, the effect is refreshed before it is run next time */
+	int fileChanged;
 	void (*init)(playerScene*);
 	void (*run)(playerScene*);
 	void (*deinit)(playerScene*);
 	int initialized;
 	int type;
+	/* JavaScript reference of the run function, resolved at init, -1 if not resolved */
+	int jsRun;
 
 	struct playerEffect *next;
 };
@@ -52,6 +55,7 @@ struct playerScene {
 extern void playerDrawLoaderBar(void);
 extern void playerForceRedraw(void);
 extern void playerShowScreenLog(int show);
+extern void playerShowProfilerOverlay(int show);
 extern void playerInit(void);
 extern void playerRun(void);
 extern void playerDraw(void);
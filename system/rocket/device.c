@@ -9,15 +9,72 @@
 #include "synceditor.h"
 #include "system/debug/debug.h"
 #include "system/xml/xml.h"
+#include "system/io/io.h"
+
+/* FNV-1a */
+static uint32_t hash_name(const char *name)
+{
+	uint32_t hash = 2166136261u;
+	while (*name) {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
 
 static int find_track(struct sync_device *d, const char *name)
 {
+	size_t mask = d->track_hash_size - 1;
+	size_t i;
+
+	if (!d->track_hash_size)
+		return -1;
+
+	for (i = hash_name(name) & mask; d->track_hash[i]; i = (i + 1) & mask) {
+		int idx = (int)d->track_hash[i] - 1;
+		if (!strcmp(name, d->tracks[idx]->name))
+			return idx;
+	}
+	return -1; /* not found */
+}
+
+static void hash_insert_track(struct sync_device *d, int idx)
+{
+	size_t mask = d->track_hash_size - 1;
+	size_t i = hash_name(d->tracks[idx]->name) & mask;
+	while (d->track_hash[i])
+		i = (i + 1) & mask;
+	d->track_hash[i] = (uint32_t)idx + 1;
+}
+
+static int grow_track_hash(struct sync_device *d)
+{
+	size_t size = d->track_hash_size ? d->track_hash_size * 2 : 64;
+	uint32_t *hash = calloc(size, sizeof(uint32_t));
 	int i;
+	if (!hash)
+		return -1;
+
+	free(d->track_hash);
+	d->track_hash = hash;
+	d->track_hash_size = size;
 	for (i = 0; i < (int)d->num_tracks; ++i)
-		if (!strcmp(name, d->tracks[i]->name))
-			return i;
-	debugPrintf("Did not find '%s'", name);
-	return -1; /* not found */
+		hash_insert_track(d, i);
+	return 0;
+}
+
+static int is_bundle_keys(const struct sync_device *d, const struct sync_track *t)
+{
+	return d->bundle && (const char *)t->keys >= d->bundle &&
+	    (const char *)t->keys < d->bundle + d->bundle_size;
+}
+
+static void free_keys(struct sync_device *d, struct sync_track *t)
+{
+	if (!is_bundle_keys(d, t))
+		free(t->keys);
+	t->keys = NULL;
+	t->num_keys = 0;
 }
 
 static const char *sync_track_path(const char *base, const char *name)
@@ -205,6 +262,10 @@ struct sync_device *sync_create_device(const char *base)
 
 	d->tracks = NULL;
 	d->num_tracks = 0;
+	d->track_hash = NULL;
+	d->track_hash_size = 0;
+	d->bundle = NULL;
+	d->bundle_size = 0;
 
 //MR 2015/11 - sync editor & player must work dynamically without recompilation
 //#ifndef SYNC_PLAYER
@@ -224,10 +285,13 @@ void sync_destroy_device(struct sync_device *d)
 	int i;
 	for (i = 0; i < (int)d->num_tracks; ++i) {
 		free(d->tracks[i]->name);
-		free(d->tracks[i]->keys);
+		free_keys(d, d->tracks[i]);
 		free(d->tracks[i]);
 	}
 	free(d->tracks);
+	free(d->track_hash);
+	if (d->bundle)
+		ioUnmapFile(d->bundle, d->bundle_size);
 	free(d->base);
 	free(d);
 
@@ -360,11 +424,15 @@ static int save_track(const struct sync_track *t, const char *path)
 
 void sync_save_tracks(const struct sync_device *d)
 {
+	char path[FILENAME_MAX];
 	int i;
 	for (i = 0; i < (int)d->num_tracks; ++i) {
 		const struct sync_track *t = d->tracks[i];
 		save_track(t, sync_track_path(d->base, t->name));
 	}
+
+	snprintf(path, sizeof(path), "%s.bundle", d->base);
+	sync_save_bundle(d, path);
 }
 
 static int handle_set_key_cmd(SOCKET sock, struct sync_device *data)
@@ -420,11 +488,8 @@ int sync_connect(struct sync_device *d, const char *host, unsigned short port)
 	if (d->sock == INVALID_SOCKET)
 		return -1;
 
-	for (i = 0; i < (int)d->num_tracks; ++i) {
-		free(d->tracks[i]->keys);
-		d->tracks[i]->keys = NULL;
-		d->tracks[i]->num_keys = 0;
-	}
+	for (i = 0; i < (int)d->num_tracks; ++i)
+		free_keys(d, d->tracks[i]);
 
 	for (i = 0; i < (int)d->num_tracks; ++i) {
 		if (get_track_data(d, d->tracks[i])) {
@@ -514,9 +579,17 @@ static int create_track(struct sync_device *d, const char *name)
 	d->tracks = realloc(d->tracks, sizeof(d->tracks[0]) * d->num_tracks);
 	d->tracks[d->num_tracks - 1] = t;
 
+	/* keep the hash at most half full */
+	if (d->num_tracks * 2 > d->track_hash_size)
+		grow_track_hash(d);
+	else
+		hash_insert_track(d, (int)d->num_tracks - 1);
+
 	return (int)d->num_tracks - 1;
 }
 
+static int get_track_data_bundle(struct sync_device *d, struct sync_track *t);
+
 const struct sync_track *sync_get_track(struct sync_device *d,
     const char *name)
 {
@@ -528,73 +601,274 @@ const struct sync_track *sync_get_track(struct sync_device *d,
 	idx = create_track(d, name);
 	t = d->tracks[idx];
 
+	if (d->bundle && !isSyncEditor()) {
+		if (get_track_data_bundle(d, t))
+			debugPrintf("Did not find '%s'", name);
+		return t;
+	}
+
 	get_track_data(d, t);
 	return t;
 }
 
-void parseRocketXml(struct sync_device *d, const char *filename)
+/*
+ * Track bundle: all tracks of a project in one file that is memory mapped
+ * in player mode. The file is in native endianness and layout, bundles
+ * written on another kind of machine are rejected by the header check.
+ *
+ * header
+ * track table, sorted by name
+ * name hash, open addressing, track index + 1 or 0 for empty
+ * key arrays
+ * null terminated names
+ */
+
+#define SYNC_BUNDLE_MAGIC 0x42535953 /* "SYSB" */
+#define SYNC_BUNDLE_VERSION 1
+
+struct sync_bundle_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t key_size;
+	uint32_t num_tracks;
+	uint32_t hash_size;
+};
+
+struct sync_bundle_track {
+	uint32_t name;
+	uint32_t keys;
+	uint32_t num_keys;
+	uint32_t hash;
+};
+
+static int compare_track_names(const void *a, const void *b)
 {
-	xml_t xml;
-	if (!xmlInit(&xml)) {
-		debugErrorPrintf("Could not init xml");
-		return;
+	const struct sync_track *ta = *(const struct sync_track * const *)a;
+	const struct sync_track *tb = *(const struct sync_track * const *)b;
+	return strcmp(ta->name, tb->name);
+}
+
+int sync_save_bundle(const struct sync_device *d, const char *path)
+{
+	struct sync_bundle_header header;
+	const struct sync_track **sorted;
+	uint32_t *hash;
+	uint32_t offset, name_offset;
+	uint32_t i;
+	FILE *fp;
+
+	header.magic = SYNC_BUNDLE_MAGIC;
+	header.version = SYNC_BUNDLE_VERSION;
+	header.key_size = sizeof(struct track_key);
+	header.num_tracks = (uint32_t)d->num_tracks;
+	header.hash_size = 16;
+	while (header.hash_size < header.num_tracks * 2)
+		header.hash_size *= 2;
+
+	sorted = malloc(sizeof(*sorted) * (d->num_tracks + 1));
+	hash = calloc(header.hash_size, sizeof(uint32_t));
+	if (!sorted || !hash) {
+		free(sorted);
+		free(hash);
+		return -1;
 	}
-	
-	xmlSetParseFile(&xml, filename);
 
-	if (!xmlParse(&xml)) {
-		debugErrorPrintf("Could not parse xml");
-		return;
+	memcpy(sorted, d->tracks, sizeof(*sorted) * d->num_tracks);
+	qsort(sorted, d->num_tracks, sizeof(*sorted), compare_track_names);
+
+	fp = fopen(path, "wb");
+	if (!fp) {
+		debugWarningPrintf("Could not write sync bundle '%s'", path);
+		free(sorted);
+		free(hash);
+		return -1;
 	}
 
-	xml_element_t *sync = xml.rootElement;
-	assert(!strcmp(sync->name, "sync"));
+	fwrite(&header, sizeof(header), 1, fp);
 
-	//const char *rows = elementGetAttributeValue(sync, "rows");
-	//printf("sync rows: %s\n", rows);
+	offset = sizeof(header) + sizeof(struct sync_bundle_track) * header.num_tracks +
+	    sizeof(uint32_t) * header.hash_size;
+	name_offset = offset;
+	for (i = 0; i < header.num_tracks; ++i)
+		name_offset += sizeof(struct track_key) * sorted[i]->num_keys;
 
-	xml_element_t *tracks = sync->elements[0];
-	assert(!strcmp(tracks->name, "tracks"));
-	int i;
-	for(i = 0; i < tracks->elementsSize; i++)
-	{
-		xml_element_t *track = tracks->elements[i];
-		if (strcmp(track->name, "track")) {
-			continue;
-		}
+	for (i = 0; i < header.num_tracks; ++i) {
+		struct sync_bundle_track entry;
+		uint32_t mask = header.hash_size - 1;
+		uint32_t slot;
+
+		entry.name = name_offset;
+		entry.keys = offset;
+		entry.num_keys = (uint32_t)sorted[i]->num_keys;
+		entry.hash = hash_name(sorted[i]->name);
+		fwrite(&entry, sizeof(entry), 1, fp);
+
+		for (slot = entry.hash & mask; hash[slot]; slot = (slot + 1) & mask)
+			;
+		hash[slot] = i + 1;
 
-		const char* trackName = elementGetAttributeValue(track, "name");
+		offset += sizeof(struct track_key) * entry.num_keys;
+		name_offset += (uint32_t)strlen(sorted[i]->name) + 1;
+	}
+
+	fwrite(hash, sizeof(uint32_t), header.hash_size, fp);
+	for (i = 0; i < header.num_tracks; ++i)
+		fwrite(sorted[i]->keys, sizeof(struct track_key), sorted[i]->num_keys, fp);
+	for (i = 0; i < header.num_tracks; ++i)
+		fwrite(sorted[i]->name, 1, strlen(sorted[i]->name) + 1, fp);
 
-		int idx = find_track(d, trackName);
-		if (idx >= 0 || track->elementsSize == 0) {
+	fclose(fp);
+	free(sorted);
+	free(hash);
+	return 0;
+}
+
+int sync_load_bundle(struct sync_device *d, const char *path)
+{
+	const struct sync_bundle_header *header;
+	size_t size = 0;
+	char *data = ioMapFile(path, &size);
+	if (!data)
+		return -1;
+
+	header = (const struct sync_bundle_header *)data;
+	if (size < sizeof(*header) ||
+	    header->magic != SYNC_BUNDLE_MAGIC ||
+	    header->version != SYNC_BUNDLE_VERSION ||
+	    header->key_size != sizeof(struct track_key) ||
+	    header->hash_size == 0 || (header->hash_size & (header->hash_size - 1)) ||
+	    size < sizeof(*header) + sizeof(struct sync_bundle_track) * (size_t)header->num_tracks +
+	    sizeof(uint32_t) * (size_t)header->hash_size) {
+		debugWarningPrintf("Sync bundle '%s' is not compatible", path);
+		ioUnmapFile(data, size);
+		return -1;
+	}
+
+	if (d->bundle)
+		ioUnmapFile(d->bundle, d->bundle_size);
+	d->bundle = data;
+	d->bundle_size = size;
+
+	debugPrintf("Mapped sync bundle '%s' (tracks: %u)", path, (unsigned int)header->num_tracks);
+	return 0;
+}
+
+static int get_track_data_bundle(struct sync_device *d, struct sync_track *t)
+{
+	const struct sync_bundle_header *header = (const struct sync_bundle_header *)d->bundle;
+	const struct sync_bundle_track *tracks = (const struct sync_bundle_track *)(header + 1);
+	const uint32_t *hash = (const uint32_t *)(tracks + header->num_tracks);
+	uint32_t mask = header->hash_size - 1;
+	uint32_t h = hash_name(t->name);
+	uint32_t slot, probes;
+
+	for (slot = h & mask, probes = 0; hash[slot] && probes < header->hash_size;
+	    slot = (slot + 1) & mask, ++probes) {
+		const struct sync_bundle_track *entry;
+		if (hash[slot] > header->num_tracks)
+			return -1;
+
+		entry = tracks + hash[slot] - 1;
+		if (entry->hash != h || entry->name >= d->bundle_size ||
+		    strcmp(d->bundle + entry->name, t->name))
 			continue;
+
+		if ((size_t)entry->keys + sizeof(struct track_key) * (size_t)entry->num_keys > d->bundle_size)
+			return -1;
+
+		t->keys = (struct track_key *)(d->bundle + entry->keys);
+		t->num_keys = (int)entry->num_keys;
+		return 0;
+	}
+
+	return -1;
+}
+
+struct rocket_xml_state {
+	struct sync_device *d;
+	struct sync_track *track;
+	int capacity;
+	int skip;
+};
+
+static const char *rocket_xml_attribute(xml_element_t *element, const char *name)
+{
+	const char *value = elementGetAttributeValue(element, name);
+	return value ? value : "0";
+}
+
+static int rocket_xml_element(xml_element_t *element, void *user_data)
+{
+	struct rocket_xml_state *state = (struct rocket_xml_state *)user_data;
+	struct track_key *k;
+
+	if (!strcmp(element->name, "track")) {
+		/* release the unused key capacity of the finished track */
+		if (state->track && state->track->num_keys < state->capacity) {
+			k = realloc(state->track->keys, sizeof(struct track_key) * state->track->num_keys);
+			if (k)
+				state->track->keys = k;
 		}
+		state->track = NULL;
+		state->capacity = 0;
+		state->skip = 0;
+		return 1;
+	}
 
-		idx = create_track(d, trackName);
-		struct sync_track *t = d->tracks[idx];
+	if (state->skip || strcmp(element->name, "key") ||
+	    !element->parentElement || strcmp(element->parentElement->name, "track"))
+		return 1;
 
-		t->num_keys = track->elementsSize;
-		t->keys = malloc(sizeof(struct track_key) * t->num_keys);
-		if (!t->keys) {
-			debugErrorPrintf("Could not allocate memory. track:'%s', keys:%d", trackName, t->num_keys);
-			continue;
+	if (!state->track) {
+		const char *trackName = elementGetAttributeValue(element->parentElement, "name");
+		int idx;
+		if (!trackName || find_track(state->d, trackName) >= 0) {
+			state->skip = 1;
+			return 1;
 		}
 
-		debugPrintf("Processing track '%s' (keys: %d)", trackName, t->num_keys);
-		int j;
-		for(j = 0; j < track->elementsSize; j++)
-		{
-			xml_element_t *key = track->elements[j];
-			if (strcmp(key->name, "key")) {
-				continue;
-			}
+		idx = create_track(state->d, trackName);
+		state->track = state->d->tracks[idx];
+		debugPrintf("Processing track '%s'", trackName);
+	}
 
-			struct track_key *k = t->keys + j;
-			k->value = atof(elementGetAttributeValue(key, "value"));
-			k->row = atoi(elementGetAttributeValue(key, "row"));
-			k->type = atoi(elementGetAttributeValue(key, "interpolation"));
+	if (state->track->num_keys == state->capacity) {
+		int capacity = state->capacity ? state->capacity * 2 : 16;
+		k = realloc(state->track->keys, sizeof(struct track_key) * capacity);
+		if (!k) {
+			debugErrorPrintf("Could not allocate memory. track:'%s', keys:%d", state->track->name, capacity);
+			state->skip = 1;
+			return 1;
 		}
+		state->track->keys = k;
+		state->capacity = capacity;
+	}
+
+	k = state->track->keys + state->track->num_keys++;
+	k->value = atof(rocket_xml_attribute(element, "value"));
+	k->row = atoi(rocket_xml_attribute(element, "row"));
+	k->type = atoi(rocket_xml_attribute(element, "interpolation"));
+
+	return 1;
+}
+
+/* keys are read in a single pass without building the document tree */
+void parseRocketXml(struct sync_device *d, const char *filename)
+{
+	struct rocket_xml_state state = { d, NULL, 0, 0 };
+	xml_t xml;
+	if (!xmlInit(&xml)) {
+		debugErrorPrintf("Could not init xml");
+		return;
 	}
 
+	xmlSetBuildTree(&xml, 0);
+	xmlSetElementCallback(&xml, rocket_xml_element);
+	xmlSetUserData(&xml, &state);
+	xmlSetParseFile(&xml, filename);
+
+	if (!xmlParse(&xml))
+		debugErrorPrintf("Could not parse xml");
+
 	xmlDeinit(&xml);
 }
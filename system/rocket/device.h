@@ -44,6 +44,14 @@ struct sync_device {
 	struct sync_track **tracks;
 	size_t num_tracks;
 
+	/* open addressing hash of track names, values are track index + 1 */
+	uint32_t *track_hash;
+	size_t track_hash_size;
+
+	/* memory mapped track bundle, keys of bundle tracks point into it */
+	char *bundle;
+	size_t bundle_size;
+
 //MR 2015/11 - sync editor & player must work dynamically without recompilation
 //#ifndef SYNC_PLAYER
 	int row;
@@ -28,6 +28,9 @@ struct sync_cb {
 int sync_connect(struct sync_device *, const char *, unsigned short);
 int sync_update(struct sync_device *, int, struct sync_cb *, void *);
 void sync_save_tracks(const struct sync_device *);
+int sync_save_bundle(const struct sync_device *, const char *);
+int sync_load_bundle(struct sync_device *, const char *);
+void parseRocketXml(struct sync_device *, const char *);
 //#else /* defined(SYNC_PLAYER) */
 struct sync_io_cb {
 	void *(*open)(const char *filename, const char *mode);
@@ -39,6 +42,7 @@ void sync_set_io_cb(struct sync_device *d, struct sync_io_cb *cb);
 
 const struct sync_track *sync_get_track(struct sync_device *, const char *);
 double sync_get_val(const struct sync_track *, double);
+double sync_get_val_cursor(const struct sync_track *, double, int *);
 
 #ifdef __cplusplus
 }
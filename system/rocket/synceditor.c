@@ -11,9 +11,9 @@
 #include "system/xml/xml.h"
 
 #include "sync.h"
+#include "track.h"
 #include "synceditor.h"
 
-extern void parseRocketXml(struct sync_device *d, const char *filename);
 
 /**
  * @defgroup syncEditor GNU Rocket Sync Editor
@@ -55,6 +55,31 @@ static double syncEditorGetRow(void)
 	return syncEditorCurrentRow;
 }
 
+typedef struct {
+	const struct sync_track *track;
+	int index;
+	/* key index of the previous sample, see sync_get_val_cursor */
+	int cursor;
+	float *baked;
+	int bakedCount;
+	int bakedResolution;
+} syncEditorTrack_t;
+
+static syncEditorTrack_t **syncEditorTracks = NULL;
+static int syncEditorTrackCount = 0;
+static int syncEditorBakeResolution = 0;
+
+/**
+ * Set the resolution of baked track lookup tables. Baking is used only in playback mode
+ * where the tracks can't change. Sampled values are quantized to 1/resolution rows.
+ * @param resolution [in] samples per row, 0 disables baking (default)
+ * @ingroup syncEditor
+ */
+void syncEditorSetBakeResolution(int resolution)
+{
+	syncEditorBakeResolution = resolution > 0 ? resolution : 0;
+}
+
 /**
  * Get pointer to track data structure
  * @param trackName [in] Track name
@@ -63,10 +88,115 @@ static double syncEditorGetRow(void)
  */
 void* syncEditorGetTrack(const char *trackName)
 {
-	void *pointer = (void*)sync_get_track(rocket, trackName);
-	assert(pointer);
-	
-	return pointer;
+	const struct sync_track *track = sync_get_track(rocket, trackName);
+	assert(track);
+
+	int i;
+	for (i = 0; i < syncEditorTrackCount; i++)
+	{
+		if (syncEditorTracks[i]->track == track)
+		{
+			return (void*)syncEditorTracks[i];
+		}
+	}
+
+	syncEditorTracks = (syncEditorTrack_t**)realloc(syncEditorTracks, sizeof(syncEditorTrack_t*) * (syncEditorTrackCount + 1));
+	assert(syncEditorTracks);
+	syncEditorTrack_t *syncTrack = (syncEditorTrack_t*)malloc(sizeof(syncEditorTrack_t));
+	assert(syncTrack);
+	syncTrack->track = track;
+	syncTrack->index = syncEditorTrackCount;
+	syncTrack->cursor = -1;
+	syncTrack->baked = NULL;
+	syncTrack->bakedCount = 0;
+	syncTrack->bakedResolution = 0;
+	syncEditorTracks[syncEditorTrackCount++] = syncTrack;
+
+	return (void*)syncTrack;
+}
+
+/**
+ * Get index of the track in the values given by syncEditorGetTrackValues()
+ * @param trackPointer [in] pointer to track data structure
+ * @return track index
+ * @ingroup syncEditor
+ */
+int syncEditorGetTrackIndex(void *trackPointer)
+{
+	assert(trackPointer);
+	return ((syncEditorTrack_t*)trackPointer)->index;
+}
+
+/**
+ * Get count of the tracks requested with syncEditorGetTrack()
+ * @ingroup syncEditor
+ */
+int syncEditorGetTrackCount(void)
+{
+	return syncEditorTrackCount;
+}
+
+static void syncEditorBakeTrack(syncEditorTrack_t *syncTrack)
+{
+	const struct sync_track *track = syncTrack->track;
+	int resolution = syncEditorBakeResolution;
+
+	free(syncTrack->baked);
+	syncTrack->baked = NULL;
+	syncTrack->bakedCount = 0;
+	syncTrack->bakedResolution = resolution;
+
+	if (track->num_keys == 0)
+	{
+		return;
+	}
+
+	//values after the last key are constant
+	int count = track->keys[track->num_keys - 1].row * resolution + 1;
+	float *baked = (float*)malloc(sizeof(float) * count);
+	if (baked == NULL)
+	{
+		debugWarningPrintf("Could not bake sync track '%s'", track->name);
+		return;
+	}
+
+	int cursor = -1;
+	int i;
+	for (i = 0; i < count; i++)
+	{
+		baked[i] = (float)sync_get_val_cursor(track, i / (double)resolution, &cursor);
+	}
+
+	syncTrack->baked = baked;
+	syncTrack->bakedCount = count;
+}
+
+static double syncEditorSampleTrack(syncEditorTrack_t *syncTrack, double row)
+{
+	if (syncEditorBakeResolution > 0 && !isSyncEditor())
+	{
+		if (syncTrack->bakedResolution != syncEditorBakeResolution)
+		{
+			syncEditorBakeTrack(syncTrack);
+		}
+
+		if (syncTrack->baked)
+		{
+			int i = (int)(row * syncTrack->bakedResolution);
+			if (i < 0)
+			{
+				i = 0;
+			}
+			else if (i >= syncTrack->bakedCount)
+			{
+				i = syncTrack->bakedCount - 1;
+			}
+
+			return syncTrack->baked[i];
+		}
+	}
+
+	return sync_get_val_cursor(syncTrack->track, row, &syncTrack->cursor);
 }
 
 /**
@@ -77,7 +207,24 @@ void* syncEditorGetTrack(const char *trackName)
  */
 double syncEditorGetTrackCurrentValue(void *trackPointer)
 {
-	return sync_get_val((const struct sync_track*)trackPointer, syncEditorGetRow());
+	assert(trackPointer);
+	return syncEditorSampleTrack((syncEditorTrack_t*)trackPointer, syncEditorGetRow());
+}
+
+/**
+ * Sample current values of all tracks requested with syncEditorGetTrack()
+ * @param values [out] values in track index order, must hold syncEditorGetTrackCount() values
+ * @ingroup syncEditor
+ */
+void syncEditorGetTrackValues(double *values)
+{
+	double row = syncEditorGetRow();
+
+	int i;
+	for (i = 0; i < syncEditorTrackCount; i++)
+	{
+		values[i] = syncEditorSampleTrack(syncEditorTracks[i], row);
+	}
 }
 
 // callback functions for GNU Rocket
@@ -150,6 +297,25 @@ static void setSyncEditor(int _syncEditor)
 }
 
 #define PATH_SIZE 2048
+#define SYNC_XML_FILE "data/sync/rocketman.rocket"
+
+/* bundle is used only if it's not older than the Rocket XML file */
+static int syncEditorIsBundleCurrent(const char *bundlePath, const char *xmlPath)
+{
+	time_t bundleTime = 0;
+	if (fileModified(bundlePath, &bundleTime) == -1)
+	{
+		return 0;
+	}
+
+	time_t xmlTime = 0;
+	if (fileModified(xmlPath, &xmlTime) == -1)
+	{
+		return 1;
+	}
+
+	return bundleTime >= xmlTime;
+}
 
 /**
  * Initialize sync editor. If tool mode is enabled then attempt to connect to GNU Rocket.
@@ -181,7 +347,20 @@ int syncEditorInit(void)
 
 	if (!isSyncEditor())
 	{
-		parseRocketXml(rocket, "data/sync/rocketman.rocket");
+		char bundlePath[PATH_SIZE + 16];
+		snprintf(bundlePath, sizeof(bundlePath), "%s.bundle", syncPath);
+
+		if (syncEditorIsBundleCurrent(bundlePath, SYNC_XML_FILE) && sync_load_bundle(rocket, bundlePath) == 0)
+		{
+			return 1;
+		}
+
+		parseRocketXml(rocket, SYNC_XML_FILE);
+		if (isPlayerEditor())
+		{
+			//refresh the bundle for the player
+			sync_save_bundle(rocket, bundlePath);
+		}
 	}
 
 	return 1;
@@ -218,5 +397,15 @@ void syncEditorDeinit(void)
 		sync_save_tracks(rocket);
 	}
 
+	int i;
+	for (i = 0; i < syncEditorTrackCount; i++)
+	{
+		free(syncEditorTracks[i]->baked);
+		free(syncEditorTracks[i]);
+	}
+	free(syncEditorTracks);
+	syncEditorTracks = NULL;
+	syncEditorTrackCount = 0;
+
 	sync_destroy_device(rocket);
 }
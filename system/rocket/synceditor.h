@@ -3,8 +3,12 @@
 
 extern void syncEditorSetRowsPerBeat(int _rowsPerBeat);
 extern int syncEditorGetRowsPerBeat(void);
+extern void syncEditorSetBakeResolution(int resolution);
 extern void* syncEditorGetTrack(const char *trackName);
+extern int syncEditorGetTrackIndex(void *trackPointer);
+extern int syncEditorGetTrackCount(void);
 extern double syncEditorGetTrackCurrentValue(void *trackPointer);
+extern void syncEditorGetTrackValues(double *values);
 extern int isSyncEditor(void);
 
 extern int syncEditorInit(void);
@@ -29,17 +29,8 @@ static double key_ramp(const struct track_key k[2], double row)
 	return k[0].value + (k[1].value - k[0].value) * t;
 }
 
-double sync_get_val(const struct sync_track *t, double row)
+static double key_eval(const struct sync_track *t, int idx, double row)
 {
-	int idx, irow;
-
-	/* If we have no keys at all, return a constant 0 */
-	if (!t->num_keys)
-		return 0.0f;
-
-	irow = (int)floor(row);
-	idx = key_idx_floor(t, irow);
-
 	/* at the edges, return the first/last value */
 	if (idx < 0)
 		return t->keys[0].value;
@@ -62,6 +53,52 @@ double sync_get_val(const struct sync_track *t, double row)
 	}
 }
 
+double sync_get_val(const struct sync_track *t, double row)
+{
+	/* If we have no keys at all, return a constant 0 */
+	if (!t->num_keys)
+		return 0.0f;
+
+	return key_eval(t, key_idx_floor(t, (int)floor(row)), row);
+}
+
+/* forward steps taken from the cursor before falling back to binary search */
+#define SYNC_CURSOR_MAX_STEPS 8
+
+/*
+ * Same as sync_get_val, but the key search starts from the key found by the
+ * previous call, so sampling forward in time is O(1) amortized. The cursor
+ * stays safe when keys are edited, it is only a search hint.
+ * Initialize the cursor to -1.
+ */
+double sync_get_val_cursor(const struct sync_track *t, double row, int *cursor)
+{
+	int idx, irow, steps;
+
+	if (!t->num_keys)
+		return 0.0f;
+
+	irow = (int)floor(row);
+	idx = *cursor;
+
+	if (idx < -1 || idx >= t->num_keys || (idx >= 0 && t->keys[idx].row > irow)) {
+		/* stale cursor or seeking backwards */
+		idx = key_idx_floor(t, irow);
+	} else {
+		steps = 0;
+		while (idx + 1 < t->num_keys && t->keys[idx + 1].row <= irow) {
+			if (++steps > SYNC_CURSOR_MAX_STEPS) {
+				idx = key_idx_floor(t, irow);
+				break;
+			}
+			idx++;
+		}
+	}
+
+	*cursor = idx;
+	return key_eval(t, idx, row);
+}
+
 int sync_find_key(const struct sync_track *t, int row)
 {
 	int lo = 0, hi = t->num_keys;
@@ -49,6 +49,21 @@ typedef struct {
 static threadQueue_t* queues = NULL;
 static unsigned int queueBalancer = 0;
 
+/*
+ * Workers for CPU-only parallel jobs during run time. Unlike the loader queues
+ * these do not need OpenGL contexts and stay alive until threadDeinit().
+ */
+static SDL_Thread **workers = NULL;
+static unsigned int workerCount = 0;
+static int workerActive = 0;
+static SDL_mutex* workerMutex = NULL;
+static SDL_sem* workerStart = NULL;
+static SDL_sem* workerDone = NULL;
+static void (*workerFunction)(void*, unsigned int) = NULL;
+static void *workerData = NULL;
+static unsigned int workerJobCount = 0;
+static unsigned int workerJobNext = 0;
+
 static void queueAddThread(thread_t *thread)
 {
 	assert(thread);
@@ -394,6 +409,203 @@ void threadGlobalMutexUnlock(void)
 	}
 }
 
+/**
+ * Create a mutex for state that is guarded separately from the global mutex.
+ * Unlike the global mutex it exists also when multithreading is not in use.
+ * @return mutex handle for threadMutexLock() and threadMutexUnlock()
+ */
+void* threadMutexCreate(void)
+{
+	SDL_mutex *mutex = SDL_CreateMutex();
+	assert(mutex);
+	return (void*)mutex;
+}
+
+void threadMutexDestroy(void *mutex)
+{
+	if (mutex != NULL)
+	{
+		SDL_DestroyMutex((SDL_mutex*)mutex);
+	}
+}
+
+void threadMutexLock(void *mutex)
+{
+	if (mutex != NULL)
+	{
+		SDL_LockMutex((SDL_mutex*)mutex);
+	}
+}
+
+void threadMutexUnlock(void *mutex)
+{
+	if (mutex != NULL)
+	{
+		SDL_UnlockMutex((SDL_mutex*)mutex);
+	}
+}
+
+static int workerTakeJob(unsigned int *index)
+{
+	int ok = 0;
+
+	SDL_LockMutex(workerMutex);
+	if (workerJobNext < workerJobCount)
+	{
+		*index = workerJobNext++;
+		ok = 1;
+	}
+	SDL_UnlockMutex(workerMutex);
+
+	return ok;
+}
+
+static void workerProcessJobs(void)
+{
+	unsigned int index;
+	while(workerTakeJob(&index))
+	{
+		workerFunction(workerData, index);
+	}
+}
+
+static int workerRun(void *data)
+{
+	while(1)
+	{
+		if (SDL_SemWait(workerStart) == -1)
+		{
+			return -1;
+		}
+
+		if (!workerActive)
+		{
+			break;
+		}
+
+		workerProcessJobs();
+		SDL_SemPost(workerDone);
+	}
+
+	return 0;
+}
+
+static void workersInit(unsigned int count)
+{
+	workerCount = 0;
+	if (count == 0)
+	{
+		return;
+	}
+
+	workerMutex = SDL_CreateMutex();
+	assert(workerMutex);
+	workerStart = SDL_CreateSemaphore(0);
+	assert(workerStart);
+	workerDone = SDL_CreateSemaphore(0);
+	assert(workerDone);
+
+	workers = (SDL_Thread**)malloc(sizeof(SDL_Thread*)*count);
+	assert(workers);
+
+	workerActive = 1;
+	for(workerCount = 0; workerCount < count; workerCount++)
+	{
+		workers[workerCount] = SDL_CreateThread(workerRun, NULL);
+		assert(workers[workerCount]);
+	}
+}
+
+static void workersDeinit(void)
+{
+	workerActive = 0;
+
+	unsigned int i;
+	for(i = 0; i < workerCount; i++)
+	{
+		SDL_SemPost(workerStart);
+	}
+
+	for(i = 0; i < workerCount; i++)
+	{
+		int returnValue = 0;
+		SDL_WaitThread(workers[i], &returnValue);
+		if (returnValue == -1)
+		{
+			debugErrorPrintf("Worker '%d' did not exit successfully!", i);
+		}
+	}
+	workerCount = 0;
+
+	if (workers)
+	{
+		free(workers);
+		workers = NULL;
+	}
+
+	if (workerDone != NULL)
+	{
+		SDL_DestroySemaphore(workerDone);
+		workerDone = NULL;
+	}
+
+	if (workerStart != NULL)
+	{
+		SDL_DestroySemaphore(workerStart);
+		workerStart = NULL;
+	}
+
+	if (workerMutex != NULL)
+	{
+		SDL_DestroyMutex(workerMutex);
+		workerMutex = NULL;
+	}
+}
+
+/**
+ * Run function(data, index) for each index in [0, count) and wait until all calls have returned.
+ * Jobs are distributed to the worker threads and the calling thread. Functions must not call OpenGL.
+ * Falls back to a plain loop if multithreading is not in use.
+ * @param function [in] job function
+ * @param data [in] user data passed to each job
+ * @param count [in] amount of jobs
+ */
+void threadParallelFor(void (*function)(void*, unsigned int), void *data, unsigned int count)
+{
+	assert(function);
+
+	if (workerCount == 0 || count < 2)
+	{
+		unsigned int i;
+		for(i = 0; i < count; i++)
+		{
+			function(data, i);
+		}
+		return;
+	}
+
+	SDL_LockMutex(workerMutex);
+	workerFunction = function;
+	workerData = data;
+	workerJobCount = count;
+	workerJobNext = 0;
+	SDL_UnlockMutex(workerMutex);
+
+	unsigned int wakeCount = count - 1 < workerCount ? count - 1 : workerCount;
+	unsigned int i;
+	for(i = 0; i < wakeCount; i++)
+	{
+		SDL_SemPost(workerStart);
+	}
+
+	workerProcessJobs();
+
+	for(i = 0; i < wakeCount; i++)
+	{
+		SDL_SemWait(workerDone);
+	}
+}
+
 void threadInit(unsigned int threadCount)
 {
 #ifdef MORPHOS
@@ -402,6 +614,8 @@ void threadInit(unsigned int threadCount)
 	maxThreads = threadCount;
 #endif
 
+	workersInit(maxThreads);
+
 	if (!mainContext.ok)
 	{
 		maxThreads = 0;
@@ -426,6 +640,8 @@ void threadInit(unsigned int threadCount)
 
 void threadDeinit(void)
 {
+	workersDeinit();
+
 	if (threadSemaphore != NULL)
 	{
 		SDL_DestroySemaphore(threadSemaphore);
@@ -12,12 +12,17 @@ extern void threadQueueDeinit(void);
 extern unsigned int threadGetCurrentId(void);
 extern void threadGlobalMutexLock(void);
 extern void threadGlobalMutexUnlock(void);
+extern void* threadMutexCreate(void);
+extern void threadMutexDestroy(void *mutex);
+extern void threadMutexLock(void *mutex);
+extern void threadMutexUnlock(void *mutex);
 extern void threadInit(unsigned int threadCount);
 extern void threadDeinit(void);
 extern void threadAsyncCall(void (*function)(void*), void *data);
 extern int threadIsAsyncCallRunning(void);
 extern void threadWaitAsyncCalls(void);
 extern int threadIsEnabled(void);
+extern void threadParallelFor(void (*function)(void*, unsigned int), void *data, unsigned int count);
 
 #ifdef __cplusplus
 /* end 'extern "C"' wrapper */
@@ -0,0 +1,50 @@
+#include <stdio.h>
+
+#ifdef SDL
+#include <SDL/SDL.h>
+#endif
+
+#if defined(WINDOWS)
+#include <windows.h>
+#elif defined(OS_X)
+#include <mach/mach_time.h>
+#elif defined(_UNIX)
+#include <time.h>
+#endif
+
+#include "timer.h"
+
+/**
+ * Get monotonic high resolution clock value. Intended for profiling and benchmarking.
+ * The clock is independent from the (possibly fixed timestep) demo time.
+ * @return nanoseconds from an arbitrary starting point
+ * @ingroup timer
+ */
+unsigned long long timerGetNanoseconds(void)
+{
+#if defined(WINDOWS)
+	static LARGE_INTEGER frequency = {{0, 0}};
+	if (frequency.QuadPart == 0)
+	{
+		QueryPerformanceFrequency(&frequency);
+	}
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (unsigned long long)(counter.QuadPart / (double)frequency.QuadPart * 1000000000.0);
+#elif defined(OS_X)
+	static mach_timebase_info_data_t timebase = {0, 0};
+	if (timebase.denom == 0)
+	{
+		mach_timebase_info(&timebase);
+	}
+
+	return mach_absolute_time() * timebase.numer / timebase.denom;
+#elif defined(_UNIX)
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+#else
+	return (unsigned long long)SDL_GetTicks() * 1000000ULL;
+#endif
+}
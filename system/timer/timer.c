@@ -44,8 +44,38 @@ double timerGetTargetFps()
 	return targetFps;
 }
 
+static double fixedTimestep = 0.0;
+static unsigned long fixedTimestepFrame = 0;
+
+/**
+ * Set fixed timestep mode. In fixed timestep mode the clock advances exactly by step seconds
+ * on each timerAdjustFramerate() call regardless of the wall clock. The clock starts from zero and is
+ * calculated as frame * step, so the frame times don't depend on when the run started or on accumulated rounding.
+ * @param step [in] seconds per frame, 0.0 restores wall clock timing
+ * @ingroup timer
+ */
+void timerSetFixedTimestep(double step)
+{
+	if (step > 0.0 && fixedTimestep <= 0.0)
+	{
+		fixedTimestepFrame = 0;
+	}
+
+	fixedTimestep = step;
+}
+
+double timerGetFixedTimestep(void)
+{
+	return fixedTimestep;
+}
+
 double timerGetSeconds(void)
 {
+	if (fixedTimestep > 0.0)
+	{
+		return fixedTimestepFrame * fixedTimestep;
+	}
+
 #ifdef SDL
         return SDL_GetTicks()/1000.0;
 #elif WINDOWS
@@ -301,6 +331,17 @@ int timerIsEnd(void)
 
 void timerAdjustFramerate(void)
 {
+	if (fixedTimestep > 0.0)
+	{
+		//no sleeping in fixed timestep mode, just step to the next frame
+		if (!timerPaused)
+		{
+			fixedTimestepFrame++;
+		}
+
+		return;
+	}
+
 	double delayTime = ctime;
 	timerSetCurrentTime();
 	int milliDelayTime = (ctime-delayTime)*1000;
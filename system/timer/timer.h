@@ -27,6 +27,9 @@ extern double timerGetCurrentBeat(void);
 extern void timerSetTargetFps(double fps);
 extern double timerGetTargetFps();
 extern double timerGetSeconds(void);
+extern void timerSetFixedTimestep(double step);
+extern double timerGetFixedTimestep(void);
+extern unsigned long long timerGetNanoseconds(void);
 extern double timerGetTime(void);
 extern double timerGetEndTime(void);
 extern int timerIsEnd(void);
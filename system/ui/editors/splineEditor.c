@@ -63,8 +63,8 @@ void splineEditorRun(void)
 	resetViewport();
 	viewReset();
 
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glEnable(GL_BLEND);
+	renderStateBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	renderStateEnable(GL_BLEND);
 
 	glLineWidth(10.0f);
 
@@ -261,7 +261,7 @@ void splineEditorRun(void)
 
 	perspective2dEnd();
 
-	glDisable(GL_BLEND);
+	renderStateDisable(GL_BLEND);
 glColor3f(1,1,1);
 //	graphicsFlush();
 
@@ -27,6 +27,7 @@ int lineRedraw = 4;
 
 #ifndef NDEBUG
 static int screenLog = 0;
+static int profilerOverlay = 0;
 #endif
 
 static int exitPending = 0;
@@ -159,6 +160,13 @@ int isUserExit(void)
 						imageTakeScreenshot((const char*)filename);
 					}
 					
+					break;
+				case SDLK_g:
+					if (ctrlPressed && isPlayerEditor())
+					{
+						profilerOverlay = !profilerOverlay;
+						playerShowProfilerOverlay(profilerOverlay);
+					}
 					break;
 				default:
 					break;
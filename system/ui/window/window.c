@@ -2,6 +2,7 @@
 
 #include "graphicsIncludes.h"
 #include "system/debug/debug.h"
+#include "system/graphics/matrix.h"
 
 #include "window.h"
 #include "windowSdl.h"
@@ -155,12 +156,12 @@ void resetViewport(void)
 {
 	if (!fbo)
 	{
-		glViewport(screenPositionX, screenPositionY, getWindowScreenAreaWidth(), getWindowScreenAreaHeight());
+		matrixSetViewport(screenPositionX, screenPositionY, getWindowScreenAreaWidth(), getWindowScreenAreaHeight());
 	}
 	else
 	{
 #ifdef SUPPORT_GL_FBO
-		glViewport(0, 0, fboGetWidth(fbo), fboGetHeight(fbo));
+		matrixSetViewport(0, 0, fboGetWidth(fbo), fboGetHeight(fbo));
 #endif
 	}
 }
@@ -10,131 +10,224 @@
 
 #include "xml.h"
 
-#define YXML_BUFFER_SIZE 4096
+/**
+ * @defgroup xml XML parser
+ * Streaming parser on top of yxml. The document tree, attributes and strings are allocated from
+ * an arena that is released as a whole in xmlDeinit(), element content and attribute values are
+ * collected into strings with amortized growth.
+ * With xmlSetBuildTree(xml, 0) no tree is kept: each element is valid only during its element
+ * callback (parent elements stay valid until they end), so memory use is bound by the nesting depth.
+ */
 
-static char *xmlAppendToString(char *content, const char *string);
+#define YXML_BUFFER_SIZE 4096
+#define XML_ARENA_BLOCK_SIZE (64 * 1024)
+#define XML_ARENA_ALIGN sizeof(void*)
+#define XML_STRING_INITIAL_CAPACITY 64
+#define XML_INITIAL_DEPTH 16
 
-xml_attribute_t* setAttribute(xml_attribute_t *attribute, const char* name, const char* value)
+struct xml_arena_block_t
 {
-	assert(name);
+	struct xml_arena_block_t *next;
+	size_t size;
+	size_t used;
+};
+
+typedef struct {
+	xml_arena_block_t *block;
+	size_t used;
+} xml_arena_mark_t;
+
+typedef struct {
+	char *data;
+	size_t length;
+	size_t capacity;
+} xml_string_t;
+
+typedef struct {
+	xml_element_t *element;
+	xml_string_t content;
+	xml_arena_mark_t mark;
+	/* attributes and then child elements of the element are collected to the scratch stack from this index on */
+	size_t scratchBase;
+	int attributesDone;
+} xml_frame_t;
+
+typedef struct {
+	xml_frame_t *frames;
+	unsigned int depth;
+	unsigned int framesCapacity;
+	void **scratch;
+	size_t scratchSize;
+	size_t scratchCapacity;
+	xml_string_t attributeContent;
+} xml_parse_state_t;
+
+static void* xmlArenaAlloc(xml_t *xml, size_t size)
+{
+	size = (size + XML_ARENA_ALIGN - 1) & ~(XML_ARENA_ALIGN - 1);
 
-	if (attribute == NULL)
+	xml_arena_block_t *block = xml->arenaCurrent;
+	if (block == NULL || block->used + size > block->size)
 	{
-		attribute = (xml_attribute_t*)malloc(sizeof(xml_attribute_t));
-		assert(attribute);
+		//blocks after the current one are empty, reuse the next one if it's big enough
+		xml_arena_block_t *next = block ? block->next : xml->arena;
+		if (next == NULL || size > next->size)
+		{
+			size_t blockSize = size > XML_ARENA_BLOCK_SIZE ? size : XML_ARENA_BLOCK_SIZE;
+			xml_arena_block_t *newBlock = (xml_arena_block_t*)malloc(sizeof(xml_arena_block_t) + blockSize);
+			assert(newBlock);
+
+			newBlock->next = next;
+			newBlock->size = blockSize;
+			newBlock->used = 0;
+			if (block)
+			{
+				block->next = newBlock;
+			}
+			else
+			{
+				xml->arena = newBlock;
+			}
+			next = newBlock;
+		}
+
+		block = next;
+		xml->arenaCurrent = block;
 	}
 
-	attribute->name = strdup(name);
-	attribute->value = strdup(value);
+	void *data = (char*)(block + 1) + block->used;
+	block->used += size;
 
-	return attribute;
+	return data;
 }
 
-void freeAttribute(xml_attribute_t **attribute)
+static char* xmlArenaStrdup(xml_t *xml, const char *string, size_t length)
 {
-	assert(*attribute);
+	char *copy = (char*)xmlArenaAlloc(xml, length + 1);
+	memcpy(copy, string, length);
+	copy[length] = '\0';
 
-	freeAttributeData(*attribute);
-	free(*attribute);
-	*attribute = NULL;
+	return copy;
 }
 
-void freeAttributeData(xml_attribute_t *attribute)
+static xml_arena_mark_t xmlArenaGetMark(xml_t *xml)
 {
-	assert(attribute);
+	xml_arena_mark_t mark;
+	mark.block = xml->arenaCurrent;
+	mark.used = mark.block ? mark.block->used : 0;
 
-	free(attribute->name);
-	free(attribute->value);
+	return mark;
 }
 
-xml_element_t* initElement()
+/* release everything allocated after the mark, the blocks are kept for reuse */
+static void xmlArenaRewind(xml_t *xml, xml_arena_mark_t mark)
 {
-	xml_element_t *element = (xml_element_t*)malloc(sizeof(xml_element_t));
-	assert(element);
-
-	element->name = NULL;
-	element->value = NULL;
-
-	element->attributes = NULL;
-	element->attributesSize = 0;
-
-	element->elements = NULL;
-	element->elementsSize = 0;
-
-	element->parentElement = NULL;
+	xml_arena_block_t *block = mark.block ? mark.block->next : xml->arena;
+	for (; block != NULL; block = block->next)
+	{
+		block->used = 0;
+	}
 
-	return element;
+	if (mark.block)
+	{
+		mark.block->used = mark.used;
+	}
+	xml->arenaCurrent = mark.block;
 }
 
-xml_element_t* setElement(xml_element_t *element, const char* name)
+static void xmlArenaFree(xml_t *xml)
 {
-	assert(name);
-
-	if (element == NULL)
+	xml_arena_block_t *block = xml->arena;
+	while (block != NULL)
 	{
-		element = initElement();
+		xml_arena_block_t *next = block->next;
+		free(block);
+		block = next;
 	}
 
-	element->name = strdup(name);
-
-	return element;
+	xml->arena = NULL;
+	xml->arenaCurrent = NULL;
 }
 
-void setElementValue(xml_element_t *element, const char *value)
+static void xmlStringAppend(xml_string_t *string, const char *data, size_t length)
 {
-	assert(element);
+	if (string->length + length + 1 > string->capacity)
+	{
+		size_t capacity = string->capacity ? string->capacity : XML_STRING_INITIAL_CAPACITY;
+		while (string->length + length + 1 > capacity)
+		{
+			capacity *= 2;
+		}
+
+		string->data = (char*)realloc(string->data, capacity);
+		assert(string->data);
+		string->capacity = capacity;
+	}
 
-	element->value = strdup(value);
+	memcpy(string->data + string->length, data, length);
+	string->length += length;
+	string->data[string->length] = '\0';
 }
 
-char* getElementPath(xml_element_t *element)
+static void xmlStringFree(xml_string_t *string)
 {
-	//<moi><test><jee/></test></moi>
-// /test
+	free(string->data);
+	string->data = NULL;
+	string->length = 0;
+	string->capacity = 0;
+}
 
-	char *path = xmlAppendToString(NULL, "/");
-	path = xmlAppendToString(path, element->name);
-	element = element->parentElement;
-	while(element != NULL)
+static void xmlScratchPush(xml_parse_state_t *state, void *pointer)
+{
+	if (state->scratchSize == state->scratchCapacity)
 	{
-		char *newPath = xmlAppendToString(NULL, "/");
-		newPath = xmlAppendToString(newPath, element->name);
-		newPath = xmlAppendToString(newPath, path);
-		free(path);
-		path = newPath;
-		element = element->parentElement;
+		state->scratchCapacity = state->scratchCapacity ? state->scratchCapacity * 2 : XML_INITIAL_DEPTH;
+		state->scratch = (void**)realloc(state->scratch, sizeof(void*) * state->scratchCapacity);
+		assert(state->scratch);
 	}
 
-	return path;
+	state->scratch[state->scratchSize++] = pointer;
 }
 
-xml_element_t* elementAddElement(xml_element_t *parentElement, xml_element_t *element)
+/* move the pointers collected since the frame's scratch base to an arena array */
+static void** xmlScratchPop(xml_t *xml, xml_parse_state_t *state, xml_frame_t *frame, int *count)
 {
-	assert(parentElement);
-	assert(element);
+	*count = (int)(state->scratchSize - frame->scratchBase);
+	if (*count == 0)
+	{
+		return NULL;
+	}
 
-	parentElement->elementsSize++;
-	parentElement->elements = (xml_element_t**)realloc(parentElement->elements, sizeof(xml_element_t*)*parentElement->elementsSize);
-	assert(parentElement->elements);
+	void **array = (void**)xmlArenaAlloc(xml, sizeof(void*) * (*count));
+	memcpy(array, state->scratch + frame->scratchBase, sizeof(void*) * (*count));
+	state->scratchSize = frame->scratchBase;
 
-	parentElement->elements[parentElement->elementsSize-1] = element;
-	element->parentElement = parentElement;
-
-	return (xml_element_t*)parentElement->elements[parentElement->elementsSize-1];
+	return array;
 }
 
-xml_attribute_t* elementAddAttribute(xml_element_t *element, const char* name, const char* value)
+static void xmlFinishAttributes(xml_t *xml, xml_parse_state_t *state, xml_frame_t *frame)
 {
-	assert(element);
-	assert(name);
+	if (frame->attributesDone)
+	{
+		return;
+	}
 
-	element->attributesSize++;
-	element->attributes = (xml_attribute_t**)realloc(element->attributes, sizeof(xml_attribute_t*)*element->attributesSize);
-	assert(element->attributes);
+	frame->element->attributes = (xml_attribute_t**)xmlScratchPop(xml, state, frame, &frame->element->attributesSize);
+	frame->attributesDone = 1;
+}
 
-	element->attributes[element->attributesSize-1] = setAttribute(NULL, name, value);
+static xml_frame_t* xmlPushFrame(xml_parse_state_t *state)
+{
+	if (state->depth == state->framesCapacity)
+	{
+		unsigned int capacity = state->framesCapacity ? state->framesCapacity * 2 : XML_INITIAL_DEPTH;
+		state->frames = (xml_frame_t*)realloc(state->frames, sizeof(xml_frame_t) * capacity);
+		assert(state->frames);
+		memset(state->frames + state->framesCapacity, 0, sizeof(xml_frame_t) * (capacity - state->framesCapacity));
+		state->framesCapacity = capacity;
+	}
 
-	return element->attributes[element->attributesSize-1];
+	return &state->frames[state->depth++];
 }
 
 const char* elementGetAttributeValue(xml_element_t *element, const char* name)
@@ -154,27 +247,35 @@ const char* elementGetAttributeValue(xml_element_t *element, const char* name)
 	return NULL;
 }
 
-void freeElement(xml_element_t **element)
+/**
+ * Get slash separated path of the element from the document root, e.g. "/svg/g/path".
+ * @return path, release with free()
+ * @ingroup xml
+ */
+char* getElementPath(xml_element_t *element)
 {
-	assert(*element);
+	assert(element);
 
-	int i;
-	for(i = 0; i < (*element)->attributesSize; i++)
+	size_t length = 0;
+	xml_element_t *parent;
+	for (parent = element; parent != NULL; parent = parent->parentElement)
 	{
-		freeAttribute(&(*element)->attributes[i]);
+		length += 1 + strlen(parent->name);
 	}
-	free((*element)->attributes);
 
-	for(i = 0; i < (*element)->elementsSize; i++)
+	char *path = (char*)malloc(length + 1);
+	assert(path);
+	path[length] = '\0';
+
+	for (parent = element; parent != NULL; parent = parent->parentElement)
 	{
-		freeElement(&((*element)->elements[i]));
+		size_t nameLength = strlen(parent->name);
+		length -= nameLength;
+		memcpy(path + length, parent->name, nameLength);
+		path[--length] = '/';
 	}
-	free((*element)->elements);
 
-	free((*element)->name);
-	free((*element)->value);
-	free(*element);
-	*element = NULL;
+	return path;
 }
 
 int xmlInit(xml_t *xml)
@@ -192,7 +293,11 @@ int xmlInit(xml_t *xml)
 
 	xml->elementCallback = NULL;
 	xml->attributeCallback = NULL;
+	xml->userData = NULL;
+	xml->buildTree = 1;
 
+	xml->arena = NULL;
+	xml->arenaCurrent = NULL;
 	xml->rootElement = NULL;
 
 	yxml_init(xml->parser, xml->parserBuffer, YXML_BUFFER_SIZE);
@@ -228,17 +333,13 @@ int xmlDeinit(xml_t *xml)
 	assert(xml);
 
 	xmlFree(xml);
-
-	if (xml->rootElement)
-	{
-		freeElement(&xml->rootElement);
-	}
-
+	xmlArenaFree(xml);
+	xml->rootElement = NULL;
 
 	return 1;
 }
 
-int xmlSetAttributeCallback(xml_t *xml, int (*callback)(xml_element_t*, xml_attribute_t*))
+int xmlSetAttributeCallback(xml_t *xml, int (*callback)(xml_element_t*, xml_attribute_t*, void*))
 {
 	assert(xml);
 	xml->attributeCallback = callback;
@@ -246,7 +347,7 @@ int xmlSetAttributeCallback(xml_t *xml, int (*callback)(xml_element_t*, xml_attr
 	return 1;
 }
 
-int xmlSetElementCallback(xml_t *xml, int (*callback)(xml_element_t*))
+int xmlSetElementCallback(xml_t *xml, int (*callback)(xml_element_t*, void*))
 {
 	assert(xml);
 	xml->elementCallback = callback;
@@ -254,6 +355,31 @@ int xmlSetElementCallback(xml_t *xml, int (*callback)(xml_element_t*))
 	return 1;
 }
 
+/**
+ * Set the pointer that is passed to the attribute and element callbacks.
+ * @ingroup xml
+ */
+int xmlSetUserData(xml_t *xml, void *userData)
+{
+	assert(xml);
+	xml->userData = userData;
+
+	return 1;
+}
+
+/**
+ * Select whether xmlParse() keeps the document tree in xml->rootElement (default)
+ * or only reports elements to the callbacks.
+ * @ingroup xml
+ */
+int xmlSetBuildTree(xml_t *xml, int buildTree)
+{
+	assert(xml);
+	xml->buildTree = buildTree;
+
+	return 1;
+}
+
 int xmlSetParseFile(xml_t *xml, const char *file)
 {
 	assert(xml);
@@ -271,42 +397,93 @@ int xmlSetParseFile(xml_t *xml, const char *file)
 	return 1;
 }
 
-static char *xmlInitializeString(char *content)
+static void xmlElementStart(xml_t *xml, xml_parse_state_t *state, const char *name)
 {
-	if (content)
+	xml_element_t *parentElement = NULL;
+	if (state->depth > 0)
 	{
-		free(content);
+		xml_frame_t *parentFrame = &state->frames[state->depth - 1];
+		xmlFinishAttributes(xml, state, parentFrame);
+		parentElement = parentFrame->element;
 	}
 
-	return NULL;
+	xml_frame_t *frame = xmlPushFrame(state);
+	frame->mark = xmlArenaGetMark(xml);
+	frame->scratchBase = state->scratchSize;
+	frame->attributesDone = 0;
+	frame->content.length = 0;
+
+	xml_element_t *element = (xml_element_t*)xmlArenaAlloc(xml, sizeof(xml_element_t));
+	element->name = xmlArenaStrdup(xml, name, strlen(name));
+	element->value = NULL;
+	element->parentElement = parentElement;
+	element->elements = NULL;
+	element->elementsSize = 0;
+	element->attributes = NULL;
+	element->attributesSize = 0;
+	frame->element = element;
+
+	if (xml->rootElement == NULL && xml->buildTree)
+	{
+		xml->rootElement = element;
+	}
 }
 
-static char *xmlAppendToString(char *content, const char *string)
+static void xmlElementEnd(xml_t *xml, xml_parse_state_t *state)
 {
-	char *newContent = content;
-	size_t sourceLength = strlen(string);
-	size_t newLength = sourceLength + 1;
-	if (newContent == NULL)
+	assert(state->depth > 0);
+
+	xml_frame_t *frame = &state->frames[state->depth - 1];
+	xml_element_t *element = frame->element;
+
+	xmlFinishAttributes(xml, state, frame);
+	element->elements = (xml_element_t**)xmlScratchPop(xml, state, frame, &element->elementsSize);
+	element->value = xmlArenaStrdup(xml, frame->content.length ? frame->content.data : "", frame->content.length);
+
+	if (xml->elementCallback)
 	{
-		newContent = (char*)malloc(sizeof(char) * newLength);
-		newContent[0] = '\0';
+		xml->elementCallback(element, xml->userData);
 	}
-	else
-	{
-		size_t contentLength = strlen((const char*)content);
-		newLength += contentLength;
 
-		if (newLength > contentLength+1)
+	state->depth--;
+	if (xml->buildTree)
+	{
+		if (state->depth > 0)
 		{
-			newContent = (char*)realloc(content, sizeof(char) * newLength);
+			xmlScratchPush(state, element);
 		}
-	}	
+	}
+	else
+	{
+		xmlArenaRewind(xml, frame->mark);
+	}
+}
+
+static void xmlAttributeEnd(xml_t *xml, xml_parse_state_t *state, const char *name)
+{
+	if (state->depth == 0)
+	{
+		return;
+	}
 
-	strncat(newContent, string, sourceLength);
+	xml_frame_t *frame = &state->frames[state->depth - 1];
+	xml_attribute_t *attribute = (xml_attribute_t*)xmlArenaAlloc(xml, sizeof(xml_attribute_t));
+	attribute->name = xmlArenaStrdup(xml, name, strlen(name));
+	attribute->value = xmlArenaStrdup(xml, state->attributeContent.length ? state->attributeContent.data : "", state->attributeContent.length);
+	xmlScratchPush(state, attribute);
+	state->attributeContent.length = 0;
 
-	return newContent;
+	if (xml->attributeCallback)
+	{
+		xml->attributeCallback(frame->element, attribute, xml->userData);
+	}
 }
 
+/**
+ * Parse the data set with xmlSetParseFile(). Parsing time is linear to the data size.
+ * @return 1 on success, 0 on failure
+ * @ingroup xml
+ */
 int xmlParse(xml_t *xml)
 {
 	assert(xml);
@@ -317,124 +494,80 @@ int xmlParse(xml_t *xml)
 		return 0;
 	}
 
-	char *path = NULL;
-
-	char *elementContent = NULL;
-	char *attributeContent = NULL;
+	yxml_t *parser = (yxml_t*)xml->parser;
+	xml_parse_state_t state;
+	memset(&state, 0, sizeof(xml_parse_state_t));
 
-	xml_element_t *element = NULL;
-	xml_element_t *parentElement = NULL;
-
-	char *bufferIterator = NULL;
-	for(bufferIterator = xml->buffer; *bufferIterator; bufferIterator++)
+	int success = 1;
+	unsigned int i;
+	for(i = 0; i < xml->bufferSize && xml->buffer[i]; i++)
 	{
-		yxml_ret_t returnValue = yxml_parse(xml->parser, *bufferIterator);
+		yxml_ret_t returnValue = yxml_parse(parser, xml->buffer[i]);
 		if (returnValue < 0)
 		{
-			debugErrorPrintf("XML parsing error(%d): line: %d, byte: %u, offset: %u", returnValue, ((yxml_t*)xml->parser)->line, ((yxml_t*)xml->parser)->byte, ((yxml_t*)xml->parser)->total);
+			debugErrorPrintf("XML parsing error(%d): line: %d, byte: %u, offset: %u", returnValue, parser->line, parser->byte, parser->total);
+			success = 0;
 			break;
 		}
 
-		char first = 0;
-		char *elementName = NULL;
-		char *attributeName = NULL;
-
 		switch (returnValue)
 		{
 			case YXML_ELEMSTART:
-				elementName = ((yxml_t*)xml->parser)->elem;
-				path = xmlAppendToString(path, "/");
-				path = xmlAppendToString(path, elementName);
-
-				parentElement = element;
-				element = setElement(NULL, (const char*)elementName);
-				if (parentElement)
-				{
-					elementAddElement(parentElement, element);
-				}
-
-				if (xml->rootElement == NULL)
-				{
-					xml->rootElement = element;
-				}
-
+				xmlElementStart(xml, &state, parser->elem);
 				break;
 
 			case YXML_CONTENT:
-				//strip white spaces from the begin of element during parsing
-				first = ((yxml_t*)xml->parser)->data[0];
-				if (elementContent == NULL && (first == ' ' || first == '\t' || first == '\n'))
+				if (state.depth > 0)
 				{
-					break;
+					xml_string_t *content = &state.frames[state.depth - 1].content;
+					//strip white spaces from the begin of element during parsing
+					char first = parser->data[0];
+					if (content->length == 0 && (first == ' ' || first == '\t' || first == '\n' || first == '\r'))
+					{
+						break;
+					}
+
+					xmlStringAppend(content, parser->data, strlen(parser->data));
 				}
-
-				elementContent = xmlAppendToString(elementContent, ((yxml_t*)xml->parser)->data);
 				break;
 
 			case YXML_ELEMEND:
-				if (element == NULL)
-				{
-					elementName = ((yxml_t*)xml->parser)->elem;
-					element = setElement(element, (const char*)elementName);
-				}
-
-				setElementValue(element, (const char*)elementContent);
-				if (xml->elementCallback)
-				{
-					xml->elementCallback(element);
-				}
-
-				element = element->parentElement;
-				elementContent = xmlInitializeString(elementContent);
-				path[strlen(path) - strlen(strrchr(path, '/'))] = '\0';
+				xmlElementEnd(xml, &state);
 				break;
 
 			case YXML_ATTRVAL:
-				attributeContent = xmlAppendToString(attributeContent, ((yxml_t*)xml->parser)->data);
+				xmlStringAppend(&state.attributeContent, parser->data, strlen(parser->data));
 				break;
 
 			case YXML_ATTREND:
-				attributeName = ((yxml_t*)xml->parser)->attr;
-				xml_attribute_t *attribute = elementAddAttribute(element, (const char*)attributeName, (const char*)attributeContent);
-
-				if (xml->attributeCallback)
-				{
-					xml->attributeCallback(element, attribute);
-				}
-
-				attributeContent = xmlInitializeString(attributeContent);
+				xmlAttributeEnd(xml, &state, parser->attr);
 				break;
 
 			default:
 				//out-of-scope
 				break;
 		}
-
-	}
-
-	if (path)
-	{
-		free(path);
-	}
-
-	if (attributeContent)
-	{
-		free(elementContent);
 	}
 
-	if (elementContent)
+	for (i = 0; i < state.framesCapacity; i++)
 	{
-		free(elementContent);
+		xmlStringFree(&state.frames[i].content);
 	}
+	free(state.frames);
+	free(state.scratch);
+	xmlStringFree(&state.attributeContent);
 
-	yxml_ret_t returnValue = yxml_eof(xml->parser);
-	if(returnValue < 0)
+	if (success)
 	{
-		debugErrorPrintf("XML parsing error(%d) in deinitialization", returnValue);
-		return 0;
+		yxml_ret_t returnValue = yxml_eof(parser);
+		if(returnValue < 0)
+		{
+			debugErrorPrintf("XML parsing error(%d) in deinitialization", returnValue);
+			success = 0;
+		}
 	}
 
 	xmlFree(xml);
 
-	return 1;
+	return success;
 }